@@ -0,0 +1,178 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisPlanarTransformBenchmark.h"
+
+#include <QTest>
+
+#include <KoConfig.h>
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+#include <KoColorTransformation.h>
+
+#include <KisPlanarScratchBuffer.h>
+
+#include "kis_benchmark_values.h"
+
+namespace {
+
+/**
+ * The sequential iterator used by KisColorTransformationFilter gives
+ * the pixels in chunks of at most a tile row, so we feed both paths
+ * with chunks of the same size.
+ */
+const int chunkSize = 64;
+
+void initData()
+{
+    QTest::addColumn<QString>("colorDepthId");
+    QTest::addColumn<QString>("transformationId");
+
+    QList<KoID> depths;
+    depths << Integer8BitsColorDepthID << Integer16BitsColorDepthID;
+#ifdef HAVE_OPENEXR
+    depths << Float16BitsColorDepthID;
+#endif
+    depths << Float32BitsColorDepthID;
+
+    Q_FOREACH (const KoID &depth, depths) {
+        QTest::newRow(QString("hsv-%1").arg(depth.id()).toLatin1())
+            << depth.id() << "hsv_adjustment";
+        QTest::newRow(QString("color_balance-%1").arg(depth.id()).toLatin1())
+            << depth.id() << "ColorBalance";
+    }
+}
+
+KoColorTransformation* createTransformation(const KoColorSpace *cs, const QString &id)
+{
+    QHash<QString, QVariant> params;
+
+    if (id == "hsv_adjustment") {
+        params["h"] = 0.2;
+        params["s"] = 0.1;
+        params["v"] = -0.05;
+        params["type"] = 1;
+        params["colorize"] = false;
+        params["lumaRed"]   = cs->lumaCoefficients()[0];
+        params["lumaGreen"] = cs->lumaCoefficients()[1];
+        params["lumaBlue"]  = cs->lumaCoefficients()[2];
+    } else {
+        params["cyan_red_midtones"] = 0.2;
+        params["magenta_green_shadows"] = -0.1;
+        params["yellow_blue_highlights"] = 0.15;
+        params["preserve_luminosity"] = true;
+    }
+
+    return cs->createColorTransformation(id, params);
+}
+
+QVector<quint8> randomPixels(const KoColorSpace *cs, int numPixels)
+{
+    const int pixelSize = cs->pixelSize();
+    QVector<quint8> pixels(numPixels * pixelSize);
+
+    srand(31524744);
+
+    for (int i = 0; i < numPixels; i++) {
+        KoColor color(QColor(rand() % 255, rand() % 255, rand() % 255), cs);
+        memcpy(pixels.data() + i * pixelSize, color.data(), pixelSize);
+    }
+
+    return pixels;
+}
+
+struct BenchmarkData
+{
+    BenchmarkData(const QString &colorDepthId, const QString &transformationId)
+        : cs(KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), colorDepthId, 0)),
+          numPixels(GMP_IMAGE_WIDTH * GMP_IMAGE_HEIGHT),
+          src(randomPixels(cs, numPixels)),
+          dst(src.size()),
+          transformation(createTransformation(cs, transformationId))
+    {
+    }
+
+    const KoColorSpace *cs;
+    const int numPixels;
+    QVector<quint8> src;
+    QVector<quint8> dst;
+    QScopedPointer<KoColorTransformation> transformation;
+};
+
+}
+
+void KisPlanarTransformBenchmark::benchmarkInterleaved_data()
+{
+    initData();
+}
+
+void KisPlanarTransformBenchmark::benchmarkInterleaved()
+{
+    QFETCH(QString, colorDepthId);
+    QFETCH(QString, transformationId);
+
+    BenchmarkData d(colorDepthId, transformationId);
+    if (!d.transformation) {
+        QSKIP("The transformation is not available");
+    }
+
+    const int pixelSize = d.cs->pixelSize();
+
+    QBENCHMARK {
+        for (int i = 0; i < d.numPixels; i += chunkSize) {
+            const int numPixels = qMin(chunkSize, d.numPixels - i);
+            d.transformation->transform(d.src.constData() + i * pixelSize,
+                                        d.dst.data() + i * pixelSize,
+                                        numPixels);
+        }
+    }
+}
+
+void KisPlanarTransformBenchmark::benchmarkPlanar_data()
+{
+    initData();
+}
+
+void KisPlanarTransformBenchmark::benchmarkPlanar()
+{
+    QFETCH(QString, colorDepthId);
+    QFETCH(QString, transformationId);
+
+    BenchmarkData d(colorDepthId, transformationId);
+    if (!d.transformation || !d.transformation->supportsPlanarTransform()) {
+        QSKIP("The transformation has no planar implementation");
+    }
+
+    QVERIFY(KisPlanarScratchBuffer::canRepresent(d.cs));
+
+    const int pixelSize = d.cs->pixelSize();
+    KisPlanarScratchBuffer buffer(d.cs, chunkSize);
+
+    QBENCHMARK {
+        for (int i = 0; i < d.numPixels; i += chunkSize) {
+            const int numPixels = qMin(chunkSize, d.numPixels - i);
+            buffer.deinterleave(d.src.constData() + i * pixelSize, numPixels);
+            d.transformation->transformPlanar(buffer.planes(), numPixels);
+            buffer.interleave(d.dst.data() + i * pixelSize, numPixels);
+        }
+    }
+}
+
+QTEST_MAIN(KisPlanarTransformBenchmark)
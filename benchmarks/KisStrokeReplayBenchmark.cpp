@@ -0,0 +1,430 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisStrokeReplayBenchmark.h"
+
+#include <QTest>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_painter.h>
+#include <kis_distance_information.h>
+#include <brushengine/kis_paintop.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_random_source.h>
+#include <brushengine/KisPerStrokeRandomSource.h>
+#include <KisRunnableStrokeJobData.h>
+#include <KisRunnableStrokeJobsInterface.h>
+
+#include "kis_canvas_resource_provider.h"
+#include "kis_resources_snapshot.h"
+#include "strokes/freehand_stroke.h"
+#include "strokes/KisFreehandStrokeInfo.h"
+#include "stroke_testing_utils.h"
+
+#include "kis_benchmark_values.h"
+
+namespace {
+
+typedef KisFreehandStrokeRecording::Segment Segment;
+
+/**
+ * The same period KisToolFreehandHelper uses for requesting
+ * updates from the paintops with asynchronous rendering
+ */
+const int asynchronousUpdatesPeriod = 80;
+
+QStringList collectFiles(const QString &list, const QString &nameFilter)
+{
+    QStringList result;
+
+    Q_FOREACH (const QString &path, list.split(QDir::listSeparator(), QString::SkipEmptyParts)) {
+        QFileInfo info(path);
+
+        if (info.isDir()) {
+            QDir dir(path);
+            Q_FOREACH (const QString &fileName, dir.entryList({nameFilter}, QDir::Files, QDir::Name)) {
+                result << dir.absoluteFilePath(fileName);
+            }
+        } else if (info.exists()) {
+            result << info.absoluteFilePath();
+        } else {
+            qWarning() << "Replay file does not exist:" << path;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Generates a stroke similar to the one produced by a 200Hz tablet
+ * without any smoothing: a wave over the canvas with the pressure
+ * and tilt varying along the way
+ */
+KisFreehandStrokeRecording generateSyntheticRecording(const QSize &canvasSize)
+{
+    const int numEvents = 1000;
+    const int eventInterval = 5;
+
+    auto eventInfo = [canvasSize] (int i) {
+        const qreal t = qreal(i) / (numEvents - 1);
+        const QPointF pos(canvasSize.width() * (0.1 + 0.8 * t),
+                          canvasSize.height() * (0.5 + 0.3 * std::sin(4 * M_PI * t)));
+        const qreal pressure = qBound(0.05, 1.1 * std::sin(M_PI * t), 1.0);
+        const qreal xTilt = 40.0 * std::sin(2 * M_PI * t);
+        const qreal yTilt = 20.0 * std::cos(2 * M_PI * t);
+
+        return KisPaintInformation(pos, pressure, xTilt, yTilt, 0.0, 0.0, 1.0,
+                                   i * eventInterval, 0.0);
+    };
+
+    KisFreehandStrokeRecording recording;
+    recording.startStroke(0.0, eventInfo(0), 1, 0, false);
+
+    for (int i = 1; i < numEvents; i++) {
+        Segment segment;
+        segment.type = KisFreehandStrokeRecording::PaintLine;
+        segment.timestamp = i * eventInterval;
+        segment.pi1 = eventInfo(i - 1);
+        segment.pi2 = eventInfo(i);
+        recording.addSegment(segment);
+    }
+
+    return recording;
+}
+
+KisStrokeJobData* createStrokeJobData(const Segment &segment)
+{
+    switch (segment.type) {
+    case KisFreehandStrokeRecording::PaintPoint:
+        return new FreehandStrokeStrategy::Data(segment.strokeInfoId, segment.pi1);
+    case KisFreehandStrokeRecording::PaintLine:
+        return new FreehandStrokeStrategy::Data(segment.strokeInfoId, segment.pi1, segment.pi2);
+    case KisFreehandStrokeRecording::PaintBezierCurve:
+        return new FreehandStrokeStrategy::Data(segment.strokeInfoId,
+                                                segment.pi1,
+                                                segment.control1, segment.control2,
+                                                segment.pi2);
+    }
+
+    return 0;
+}
+
+void flushAsyncUpdates(KisPainter *painter)
+{
+    KisPaintOp *paintOp = painter->paintOp();
+    if (!paintOp) return;
+
+    bool needsMoreUpdates = true;
+    while (needsMoreUpdates) {
+        QVector<KisRunnableStrokeJobData*> jobs;
+        needsMoreUpdates = paintOp->doAsyncronousUpdate(jobs).second;
+        painter->runnableStrokeJobsInterface()->addRunnableJobs(jobs);
+    }
+}
+
+qreal percentile(const QVector<qint64> &sortedValues, qreal p)
+{
+    if (sortedValues.isEmpty()) return 0.0;
+
+    const int index = qBound(0, qRound(p * (sortedValues.size() - 1)), sortedValues.size() - 1);
+    return sortedValues[index];
+}
+
+KisPaintLayerSP createCanvas(KisImageSP image)
+{
+    KisPaintLayerSP layer = new KisPaintLayer(image, "replay", OPACITY_OPAQUE_U8, image->colorSpace());
+    image->addNode(layer);
+
+    KoColor white(Qt::white, image->colorSpace());
+    layer->paintDevice()->fill(image->bounds(), white);
+
+    return layer;
+}
+
+}
+
+void KisStrokeReplayBenchmark::initTestCase()
+{
+    m_canvasSize = QSize(TEST_IMAGE_WIDTH, TEST_IMAGE_HEIGHT);
+
+    const QString canvasString = QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_CANVAS"));
+    if (!canvasString.isEmpty()) {
+        const QStringList parts = canvasString.split('x');
+        if (parts.size() == 2 && parts[0].toInt() > 0 && parts[1].toInt() > 0) {
+            m_canvasSize = QSize(parts[0].toInt(), parts[1].toInt());
+        } else {
+            qWarning() << "Invalid canvas size:" << canvasString;
+        }
+    }
+
+    m_colorSpace = KoColorSpaceRegistry::instance()->rgb8();
+
+    const QString colorSpaceString = QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_COLORSPACE"));
+    if (!colorSpaceString.isEmpty()) {
+        const QStringList parts = colorSpaceString.split('/');
+        const KoColorSpace *cs =
+            parts.size() == 2 ?
+            KoColorSpaceRegistry::instance()->colorSpace(parts[0], parts[1], QString()) : 0;
+
+        if (cs) {
+            m_colorSpace = cs;
+        } else {
+            qWarning() << "Unknown color space:" << colorSpaceString;
+        }
+    }
+
+    m_realtimeReplay = qgetenv("KRITA_STROKE_REPLAY_REALTIME") == "1";
+
+    const QString recordingsList = QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_RECORDINGS"));
+    Q_FOREACH (const QString &fileName, collectFiles(recordingsList, "*.kisstroke")) {
+        KisFreehandStrokeRecording recording;
+        if (recording.load(fileName)) {
+            m_recordings.insert(QFileInfo(fileName).completeBaseName(), recording);
+        }
+    }
+
+    if (m_recordings.isEmpty()) {
+        m_recordings.insert("synthetic", generateSyntheticRecording(m_canvasSize));
+    }
+
+    const QString presetsList = QString::fromLocal8Bit(qgetenv("KRITA_STROKE_REPLAY_PRESETS"));
+    m_presetFiles = collectFiles(presetsList, "*.kpp");
+
+    if (m_presetFiles.isEmpty()) {
+        const QString dataPath = QString(FILES_DATA_DIR) + QDir::separator();
+
+        m_presetFiles << dataPath + "softbrush_30px.kpp"
+                      << dataPath + "softbrush-300px.kpp"
+                      << dataPath + "AutoBrush_70px_rotated.kpp"
+                      << dataPath + "colorsmudge.kpp"
+                      << dataPath + "hairy-70px.kpp"
+                      << dataPath + "spray_30px21rasterParticles.kpp"
+                      << dataPath + "deform-default.kpp"
+                      << dataPath + "dyna301.kpp"
+                      << dataPath + "filterOp_gauss.kpp"
+                      << dataPath + "experimental.kpp";
+    }
+
+    qDebug() << "Replaying" << m_recordings.size() << "recordings with" << m_presetFiles.size() << "presets";
+    qDebug() << "Canvas:" << m_canvasSize << "color space:" << m_colorSpace->id();
+}
+
+void KisStrokeReplayBenchmark::populateReplayData()
+{
+    QTest::addColumn<QString>("recordingName");
+    QTest::addColumn<QString>("presetFile");
+
+    for (auto it = m_recordings.constBegin(); it != m_recordings.constEnd(); ++it) {
+        Q_FOREACH (const QString &presetFile, m_presetFiles) {
+            const QString rowName = it.key() + "/" + QFileInfo(presetFile).completeBaseName();
+            QTest::newRow(rowName.toLatin1().constData()) << it.key() << presetFile;
+        }
+    }
+}
+
+void KisStrokeReplayBenchmark::benchmarkDirectReplay_data()
+{
+    populateReplayData();
+}
+
+void KisStrokeReplayBenchmark::benchmarkDirectReplay()
+{
+    QFETCH(QString, recordingName);
+    QFETCH(QString, presetFile);
+
+    const KisFreehandStrokeRecording &recording = m_recordings[recordingName];
+
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(presetFile);
+    QVERIFY(preset->load());
+
+    KisImageSP image = new KisImage(0, m_canvasSize.width(), m_canvasSize.height(),
+                                    m_colorSpace, "stroke replay");
+    KisPaintLayerSP layer = createCanvas(image);
+
+    KisPainter painter(layer->paintDevice());
+    painter.setPaintColor(KoColor(Qt::black, m_colorSpace));
+    painter.setPaintOpPreset(preset, layer, image);
+
+    QVector<qint64> jobTimes;
+    qint64 strokeTime = 0;
+    int numDabs = 0;
+
+    QBENCHMARK {
+        // every replay should generate the same sequence of per-dab random values
+        KisRandomSourceSP randomSource = new KisRandomSource(0);
+        KisPerStrokeRandomSourceSP strokeRandomSource = new KisPerStrokeRandomSource();
+
+        QVector<KisDistanceInformation> distances(
+            recording.numStrokeInfos(),
+            KisDistanceInformation(recording.startInfo().pos(), recording.startAngle()));
+
+        jobTimes.clear();
+        jobTimes.reserve(recording.segments().size());
+
+        QElapsedTimer strokeTimer;
+        strokeTimer.start();
+
+        Q_FOREACH (Segment segment, recording.segments()) {
+            segment.pi1.setRandomSource(randomSource);
+            segment.pi1.setPerStrokeRandomSource(strokeRandomSource);
+            segment.pi2.setRandomSource(randomSource);
+            segment.pi2.setPerStrokeRandomSource(strokeRandomSource);
+
+            KisDistanceInformation *distance = &distances[segment.strokeInfoId];
+
+            QElapsedTimer jobTimer;
+            jobTimer.start();
+
+            switch (segment.type) {
+            case KisFreehandStrokeRecording::PaintPoint:
+                painter.paintAt(segment.pi1, distance);
+                break;
+            case KisFreehandStrokeRecording::PaintLine:
+                painter.paintLine(segment.pi1, segment.pi2, distance);
+                break;
+            case KisFreehandStrokeRecording::PaintBezierCurve:
+                painter.paintBezierCurve(segment.pi1,
+                                         segment.control1, segment.control2,
+                                         segment.pi2, distance);
+                break;
+            }
+
+            jobTimes << jobTimer.nsecsElapsed();
+        }
+
+        flushAsyncUpdates(&painter);
+
+        strokeTime = strokeTimer.nsecsElapsed();
+
+        numDabs = 0;
+        Q_FOREACH (const KisDistanceInformation &distance, distances) {
+            numDabs += distance.currentDabSeqNo();
+        }
+    }
+
+    std::sort(jobTimes.begin(), jobTimes.end());
+
+    const qreal strokeTimeMs = strokeTime / 1e6;
+
+    qDebug() << qPrintable(
+        QString("%1 dabs in %2 ms (%3 dabs/sec), job time (us): median %4, 95%: %5, max %6")
+            .arg(numDabs)
+            .arg(strokeTimeMs, 0, 'f', 2)
+            .arg(strokeTimeMs > 0 ? 1000.0 * numDabs / strokeTimeMs : 0.0, 0, 'f', 0)
+            .arg(percentile(jobTimes, 0.5) / 1e3, 0, 'f', 1)
+            .arg(percentile(jobTimes, 0.95) / 1e3, 0, 'f', 1)
+            .arg(percentile(jobTimes, 1.0) / 1e3, 0, 'f', 1));
+}
+
+void KisStrokeReplayBenchmark::benchmarkStrokeReplay_data()
+{
+    populateReplayData();
+}
+
+void KisStrokeReplayBenchmark::benchmarkStrokeReplay()
+{
+    QFETCH(QString, recordingName);
+    QFETCH(QString, presetFile);
+
+    const KisFreehandStrokeRecording &recording = m_recordings[recordingName];
+
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(presetFile);
+    QVERIFY(preset->load());
+
+    KisImageSP image = new KisImage(0, m_canvasSize.width(), m_canvasSize.height(),
+                                    m_colorSpace, "stroke replay");
+    KisPaintLayerSP layer = createCanvas(image);
+
+    QScopedPointer<KoCanvasResourceProvider> manager(
+        utils::createResourceManager(image, layer, QString()));
+
+    QVariant presetResource;
+    presetResource.setValue(preset);
+    manager->setResource(KisCanvasResourceProvider::CurrentPaintOpPreset, presetResource);
+
+    qint64 strokeTime = 0;
+    qint64 completionLatency = 0;
+
+    QBENCHMARK {
+        KisResourcesSnapshotSP resources =
+            new KisResourcesSnapshot(image, layer, manager.data());
+
+        const bool needsAsynchronousUpdates = resources->presetNeedsAsynchronousUpdates();
+
+        QVector<KisFreehandStrokeInfo*> strokeInfos;
+        for (int i = 0; i < recording.numStrokeInfos(); i++) {
+            strokeInfos << new KisFreehandStrokeInfo(
+                KisDistanceInformation(recording.startInfo().pos(), recording.startAngle()));
+        }
+
+        KisStrokeId strokeId =
+            image->startStroke(new FreehandStrokeStrategy(resources, strokeInfos,
+                                                          kundo2_noi18n("Replayed Stroke")));
+
+        QElapsedTimer strokeTimer;
+        strokeTimer.start();
+
+        int lastUpdateTime = 0;
+
+        Q_FOREACH (const Segment &segment, recording.segments()) {
+            if (m_realtimeReplay) {
+                const qint64 delay = segment.timestamp - strokeTimer.elapsed();
+                if (delay > 0) {
+                    QThread::msleep(delay);
+                }
+            }
+
+            image->addJob(strokeId, createStrokeJobData(segment));
+
+            if (needsAsynchronousUpdates &&
+                segment.timestamp - lastUpdateTime >= asynchronousUpdatesPeriod) {
+
+                image->addJob(strokeId, new FreehandStrokeStrategy::UpdateData(false));
+                lastUpdateTime = segment.timestamp;
+            }
+        }
+
+        image->addJob(strokeId, new FreehandStrokeStrategy::UpdateData(true));
+
+        QElapsedTimer latencyTimer;
+        latencyTimer.start();
+
+        image->endStroke(strokeId);
+        image->waitForDone();
+
+        completionLatency = latencyTimer.nsecsElapsed();
+        strokeTime = strokeTimer.nsecsElapsed();
+    }
+
+    qDebug() << qPrintable(
+        QString("%1 jobs in %2 ms, stroke completion latency: %3 ms")
+            .arg(recording.segments().size())
+            .arg(strokeTime / 1e6, 0, 'f', 2)
+            .arg(completionLatency / 1e6, 0, 'f', 2));
+}
+
+QTEST_MAIN(KisStrokeReplayBenchmark)
@@ -0,0 +1,80 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef KISSTROKEREPLAYBENCHMARK_H
+#define KISSTROKEREPLAYBENCHMARK_H
+
+#include <QtTest>
+
+#include <kis_types.h>
+#include "KisFreehandStrokeRecording.h"
+
+class KoColorSpace;
+
+/**
+ * Replays freehand strokes recorded by KisToolFreehandHelper (see
+ * KisFreehandStrokeRecording) against a set of presets without any GUI.
+ *
+ * The benchmark is configured with the following environment variables:
+ *
+ * KRITA_STROKE_REPLAY_RECORDINGS: list of *.kisstroke files or
+ *     directories containing them. When unset, a synthetic stroke is
+ *     generated.
+ *
+ * KRITA_STROKE_REPLAY_PRESETS: list of *.kpp files or directories
+ *     containing them (e.g. the paintoppresets folder of an unpacked
+ *     bundle). When unset, the presets from the benchmarks' data
+ *     folder are used.
+ *
+ * KRITA_STROKE_REPLAY_CANVAS: the canvas size, e.g. "4096x4096"
+ *
+ * KRITA_STROKE_REPLAY_COLORSPACE: the color space of the canvas in
+ *     "model/depth" form, e.g. "RGBA/U8" or "CMYKA/F32"
+ *
+ * KRITA_STROKE_REPLAY_REALTIME: if set to 1, the jobs of the stroke are
+ *     added with the same timing as they were recorded, so the measured
+ *     stroke completion latency is the one the user would see
+ *
+ * The lists are separated by the platform's path list separator.
+ */
+class KisStrokeReplayBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+
+    void benchmarkDirectReplay_data();
+    void benchmarkDirectReplay();
+
+    void benchmarkStrokeReplay_data();
+    void benchmarkStrokeReplay();
+
+private:
+    void populateReplayData();
+
+private:
+    QMap<QString, KisFreehandStrokeRecording> m_recordings;
+    QStringList m_presetFiles;
+    QSize m_canvasSize;
+    const KoColorSpace *m_colorSpace = 0;
+    bool m_realtimeReplay = false;
+};
+
+#endif // KISSTROKEREPLAYBENCHMARK_H
@@ -24,6 +24,7 @@
 
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
 #include <KoColor.h>
 
 #include <kis_image.h>
@@ -36,6 +37,9 @@
 
 #include "kis_selection.h"
 #include <kis_iterator_ng.h>
+#include <kis_convolution_painter.h>
+#include <kis_convolution_kernel.h>
+#include <kis_gaussian_kernel.h>
 
 void KisBlurBenchmark::initTestCase()
 {
@@ -88,5 +92,123 @@ void KisBlurBenchmark::benchmarkFilter()
 }
 
 
+void KisBlurBenchmark::benchmarkSpatialConvolution_data()
+{
+    QTest::addColumn<QString>("depth");
+    QTest::addColumn<QString>("kernelType");
+
+    QStringList depths;
+    depths << Integer8BitsColorDepthID.id()
+           << Integer16BitsColorDepthID.id()
+           << Float32BitsColorDepthID.id();
+
+    Q_FOREACH (const QString &depth, depths) {
+        QTest::newRow(QString("%1-sharpen3x3").arg(depth).toLatin1()) << depth << "sharpen";
+        QTest::newRow(QString("%1-log").arg(depth).toLatin1()) << depth << "log";
+        QTest::newRow(QString("%1-gaussian-horizontal").arg(depth).toLatin1()) << depth << "horizontal";
+    }
+}
+
+void KisBlurBenchmark::benchmarkSpatialConvolution()
+{
+    QFETCH(QString, depth);
+    QFETCH(QString, kernelType);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), depth, 0);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(*m_device);
+    dev->convertTo(cs);
+
+    KisConvolutionKernelSP kernel;
+
+    if (kernelType == "sharpen") {
+        Eigen::Matrix<qreal, 3, 3> matrix;
+        matrix <<  0, -2,  0,
+                  -2, 11, -2,
+                   0, -2,  0;
+        kernel = KisConvolutionKernel::fromMatrix(matrix, 0, 3);
+    } else if (kernelType == "log") {
+        kernel = KisConvolutionKernel::fromMatrix(KisGaussianKernel::createLoGMatrix(2.0), 0, 0);
+    } else {
+        kernel = KisGaussianKernel::createHorizontalKernel(5.0);
+    }
+
+    const QRect rc(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    QBENCHMARK {
+        KisConvolutionPainter gc(dev, KisConvolutionPainter::SPATIAL);
+        gc.applyMatrix(kernel, dev, rc.topLeft(), rc.topLeft(), rc.size(), BORDER_REPEAT);
+    }
+}
+
+void KisBlurBenchmark::benchmarkFFTConvolution_data()
+{
+    QTest::addColumn<qreal>("radius");
+    QTest::addColumn<bool>("useFFT");
+
+    const QVector<qreal> radii({2, 5, 10, 25, 50});
+
+    Q_FOREACH (qreal radius, radii) {
+        QTest::newRow(QString("spatial-%1").arg(radius).toLatin1()) << radius << false;
+        QTest::newRow(QString("fftw-%1").arg(radius).toLatin1()) << radius << true;
+    }
+}
+
+void KisBlurBenchmark::benchmarkFFTConvolution()
+{
+    QFETCH(qreal, radius);
+    QFETCH(bool, useFFT);
+
+    // a non-separable 2D gaussian kernel
+    const Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> matrix =
+        KisGaussianKernel::createVerticalMatrix(radius) *
+        KisGaussianKernel::createHorizontalMatrix(radius);
+
+    KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMatrix(matrix, 0, matrix.sum());
+
+    const QRect rc(0, 0, GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(*m_device);
+
+    QBENCHMARK_ONCE {
+        KisConvolutionPainter gc(dev, useFFT ? KisConvolutionPainter::FFTW : KisConvolutionPainter::SPATIAL);
+        gc.applyMatrix(kernel, dev, rc.topLeft(), rc.topLeft(), rc.size(), BORDER_REPEAT);
+    }
+}
+
+void KisBlurBenchmark::benchmarkGaussian_data()
+{
+    QTest::addColumn<qreal>("radius");
+    QTest::addColumn<int>("engine");
+
+    const QVector<qreal> radii({1, 5, 10, 25, 50, 100, 250, 500});
+
+    Q_FOREACH (qreal radius, radii) {
+        QTest::newRow(QString("convolution-%1").arg(radius).toLatin1()) << radius << int(KisGaussianKernel::ConvolutionEngine);
+        QTest::newRow(QString("recursive-%1").arg(radius).toLatin1()) << radius << int(KisGaussianKernel::RecursiveEngine);
+    }
+}
+
+void KisBlurBenchmark::benchmarkGaussian()
+{
+    QFETCH(qreal, radius);
+    QFETCH(int, engine);
+
+    /**
+     * The convolution engine on the largest radii is really slow,
+     * so we use only a part of the image here
+     */
+    const QRect rc(0, 0, 1024, 1024);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(m_colorSpace);
+    dev->makeCloneFromRough(m_device, rc);
+
+    QBENCHMARK_ONCE {
+        KisGaussianKernel::applyGaussian(dev, rc, radius, radius, QBitArray(), 0, true,
+                                         KisGaussianKernel::Engine(engine));
+    }
+}
+
 
 QTEST_MAIN(KisBlurBenchmark)
@@ -39,6 +39,15 @@ private Q_SLOTS:
     void cleanupTestCase();
     
     void benchmarkFilter();
+
+    void benchmarkSpatialConvolution_data();
+    void benchmarkSpatialConvolution();
+
+    void benchmarkFFTConvolution_data();
+    void benchmarkFFTConvolution();
+
+    void benchmarkGaussian_data();
+    void benchmarkGaussian();
     
 };
 
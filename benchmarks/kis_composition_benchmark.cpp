@@ -157,6 +157,28 @@ struct RandomGenerator<double> : RandomGenerator<float>
     }
 };
 
+#ifdef HAVE_OPENEXR
+template <>
+struct RandomGenerator<half>
+{
+    RandomGenerator(int seed)
+        : m_rnd(seed)
+    {
+    }
+
+    half operator() () {
+        return half(m_smallfloat(m_rnd));
+    }
+
+    half unit() {
+        return KoColorSpaceMathsTraits<half>::unitValue;
+    }
+
+    boost::uniform_real<float> m_smallfloat;
+    boost::mt11213b m_rnd;
+};
+#endif
+
 
 template <typename channel_type>
 void generateDataLine(uint seed, int numPixels, quint8 *srcPixels, quint8 *dstPixels, quint8 *mask, AlphaRange srcAlphaRange, AlphaRange dstAlphaRange)
@@ -257,6 +279,10 @@ QVector<Tile> generateTiles(int size,
             generateDataLine<quint8>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
         } else if (pixelSize == 16) {
             generateDataLine<float>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+#ifdef HAVE_OPENEXR
+        } else if (pixelSize == 8) {
+            generateDataLine<half>(1, numPixels, tiles[i].src, tiles[i].dst, tiles[i].mask, srcAlphaRange, dstAlphaRange);
+#endif
         } else {
             qFatal("Pixel size %i is not implemented", pixelSize);
         }
@@ -357,6 +383,12 @@ bool compareTwoOps(bool haveMask, const KoCompositeOp *op1, const KoCompositeOp
     else if (pixelSize == 16) {
         compareResult = compareTwoOpsPixels<float>(tiles, 2e-7);
     }
+#ifdef HAVE_OPENEXR
+    else if (pixelSize == 8) {
+        // the legacy ops do all the intermediate math in half precision
+        compareResult = compareTwoOpsPixels<half>(tiles, half(1.0f / 256));
+    }
+#endif
     else {
         qFatal("Pixel size %i is not implemented", pixelSize);
     }
@@ -710,6 +742,34 @@ void KisCompositionBenchmark::compareRgbF32OverOps()
     delete opAct;
 }
 
+void KisCompositionBenchmark::compareRgbF16AlphaDarkenOps()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *opAct = KoOptimizedCompositeOpFactory::createAlphaDarkenOpF16(cs);
+    KoCompositeOp *opExp = new KoCompositeOpAlphaDarken<KoRgbF16Traits>(cs);
+
+    QVERIFY(compareTwoOps(true, opAct, opExp));
+
+    delete opExp;
+    delete opAct;
+#endif
+}
+
+void KisCompositionBenchmark::compareRgbF16OverOps()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *opAct = KoOptimizedCompositeOpFactory::createOverOpF16(cs);
+    KoCompositeOp *opExp = new KoCompositeOpOver<KoRgbF16Traits>(cs);
+
+    QVERIFY(compareTwoOps(false, opAct, opExp));
+
+    delete opExp;
+    delete opAct;
+#endif
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenLegacy()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
@@ -774,6 +834,46 @@ void KisCompositionBenchmark::testRgbF32CompositeOverOptimized()
     delete op;
 }
 
+void KisCompositionBenchmark::testRgbF16CompositeAlphaDarkenLegacy()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *op = new KoCompositeOpAlphaDarken<KoRgbF16Traits>(cs);
+    benchmarkCompositeOp(op, "RGBF16 Legacy");
+    delete op;
+#endif
+}
+
+void KisCompositionBenchmark::testRgbF16CompositeAlphaDarkenOptimized()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *op = KoOptimizedCompositeOpFactory::createAlphaDarkenOpF16(cs);
+    benchmarkCompositeOp(op, "RGBF16 Optimized");
+    delete op;
+#endif
+}
+
+void KisCompositionBenchmark::testRgbF16CompositeOverLegacy()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *op = new KoCompositeOpOver<KoRgbF16Traits>(cs);
+    benchmarkCompositeOp(op, "RGBF16 Legacy");
+    delete op;
+#endif
+}
+
+void KisCompositionBenchmark::testRgbF16CompositeOverOptimized()
+{
+#ifdef HAVE_OPENEXR
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->colorSpace("RGBA", "F16", "");
+    KoCompositeOp *op = KoOptimizedCompositeOpFactory::createOverOpF16(cs);
+    benchmarkCompositeOp(op, "RGBF16 Optimized");
+    delete op;
+#endif
+}
+
 void KisCompositionBenchmark::testRgb8CompositeAlphaDarkenReal_Aligned()
 {
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
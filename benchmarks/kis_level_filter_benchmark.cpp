@@ -24,6 +24,7 @@
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColor.h>
+#include <KoColorModelStandardIds.h>
 
 #include <kis_image.h>
 
@@ -102,5 +103,94 @@ void KisLevelFilterBenchmark::benchmarkFilter()
 }
 
 
+void KisLevelFilterBenchmark::benchmarkPerChannelFilter_data()
+{
+    QTest::addColumn<QString>("colorDepthId");
+
+    QTest::newRow("U8") << Integer8BitsColorDepthID.id();
+    QTest::newRow("U16") << Integer16BitsColorDepthID.id();
+    QTest::newRow("F32") << Float32BitsColorDepthID.id();
+}
+
+void KisLevelFilterBenchmark::benchmarkPerChannelFilter()
+{
+    // curves for the red, green and blue channels only
+    const QString configXml =
+        "<!DOCTYPE params>"
+        "<params version=\"1\">"
+        " <param name=\"nTransfers\">8</param>"
+        " <param name=\"curve0\">0,0;1,1;</param>"
+        " <param name=\"curve1\">0,0;0.218097,0.561594;0.798144,0.101449;1,1;</param>"
+        " <param name=\"curve2\">0,0;0.696056,0.402174;1,1;</param>"
+        " <param name=\"curve3\">0,0.1;0.5,0.6;1,0.9;</param>"
+        " <param name=\"curve4\">0,0;1,1;</param>"
+        " <param name=\"curve5\">0,0;1,1;</param>"
+        " <param name=\"curve6\">0,0;1,1;</param>"
+        " <param name=\"curve7\">0,0;1,1;</param>"
+        "</params>";
+
+    benchmarkMultiChannelFilter("perchannel", configXml);
+}
+
+void KisLevelFilterBenchmark::benchmarkCrossChannelFilter_data()
+{
+    benchmarkPerChannelFilter_data();
+}
+
+void KisLevelFilterBenchmark::benchmarkCrossChannelFilter()
+{
+    // red driven by green, the rest of the curves are neutral
+    const QString configXml =
+        "<!DOCTYPE params>"
+        "<params version=\"1\">"
+        " <param name=\"nTransfers\">8</param>"
+        " <param name=\"curve0\">0,0.5;1,0.5;</param>"
+        " <param name=\"curve1\">0,0.5;0.5,0.7;1,0.5;</param>"
+        " <param name=\"curve2\">0,0.5;1,0.5;</param>"
+        " <param name=\"curve3\">0,0.5;1,0.5;</param>"
+        " <param name=\"curve4\">0,0.5;1,0.5;</param>"
+        " <param name=\"curve5\">0,0.5;1,0.5;</param>"
+        " <param name=\"curve6\">0,0.5;1,0.5;</param>"
+        " <param name=\"curve7\">0,0.5;1,0.5;</param>"
+        " <param name=\"driver1\">2</param>"
+        "</params>";
+
+    benchmarkMultiChannelFilter("crosschannel", configXml);
+}
+
+void KisLevelFilterBenchmark::benchmarkMultiChannelFilter(const QString &filterId, const QString &configXml)
+{
+    QFETCH(QString, colorDepthId);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), colorDepthId, 0);
+    QVERIFY(cs);
+
+    KisPaintDeviceSP device = new KisPaintDevice(cs);
+    KoColor color(cs);
+
+    srand(31524744);
+
+    KisSequentialIterator it(device, QRect(0,0,GMP_IMAGE_WIDTH, GMP_IMAGE_HEIGHT));
+    while (it.nextPixel()) {
+        color.fromQColor(QColor(rand() % 255, rand() % 255, rand() % 255));
+        memcpy(it.rawData(), color.data(), cs->pixelSize());
+    }
+
+    KisFilterSP filter = KisFilterRegistry::instance()->value(filterId);
+    QVERIFY(filter);
+
+    KisFilterConfigurationSP config = filter->defaultConfiguration();
+    config->fromXML(configXml);
+
+    QSize size = KritaUtils::optimalPatchSize();
+    QVector<QRect> rects = KritaUtils::splitRectIntoPatches(QRect(0, 0, GMP_IMAGE_WIDTH,GMP_IMAGE_HEIGHT), size);
+
+    QBENCHMARK{
+        Q_FOREACH (const QRect &rc, rects) {
+            filter->process(device, rc, config);
+        }
+    }
+}
 
 QTEST_MAIN(KisLevelFilterBenchmark)
@@ -40,6 +40,15 @@ private Q_SLOTS:
     void cleanupTestCase();
 
     void benchmarkFilter();
+
+    void benchmarkPerChannelFilter_data();
+    void benchmarkPerChannelFilter();
+
+    void benchmarkCrossChannelFilter_data();
+    void benchmarkCrossChannelFilter();
+
+private:
+    void benchmarkMultiChannelFilter(const QString &filterId, const QString &configXml);
 };
 
 #endif // KIS_LEVEL_FILTER_BENCHMARK_H
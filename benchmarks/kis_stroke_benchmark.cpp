@@ -43,11 +43,15 @@ inline double drand48()
 
 #include <brushengine/kis_paint_information.h>
 #include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paintop_settings.h>
 
 #define GMP_IMAGE_WIDTH 3274
 #define GMP_IMAGE_HEIGHT 2067
 #include <kis_painter.h>
+#include <brushengine/kis_paintop.h>
 #include <brushengine/kis_paintop_registry.h>
+#include <KisRunnableStrokeJobData.h>
+#include <KisRunnableStrokeJobsInterface.h>
 
 //#define SAVE_OUTPUT
 
@@ -278,6 +282,19 @@ void KisStrokeBenchmark::hairy30InkDepletionRL()
     benchmarkRandomLines(presetFileName);
 }
 
+void KisStrokeBenchmark::hairy70pxDense()
+{
+    // about 3800 bristles, exercises batched deposition of the ink
+    QString presetFileName = "hairy-70px.kpp";
+    benchmarkStroke(presetFileName);
+}
+
+void KisStrokeBenchmark::hairy70pxDenseRL()
+{
+    QString presetFileName = "hairy-70px.kpp";
+    benchmarkRandomLines(presetFileName);
+}
+
 
 void KisStrokeBenchmark::softbrushOpacity()
 {
@@ -315,6 +332,18 @@ void KisStrokeBenchmark::experimentalCircle()
     benchmarkCircle(presetFileName);
 }
 
+void KisStrokeBenchmark::filterOpGauss()
+{
+    QString presetFileName = "filterOp_gauss.kpp";
+    benchmarkStroke(presetFileName);
+}
+
+void KisStrokeBenchmark::filterOpGaussRL()
+{
+    QString presetFileName = "filterOp_gauss.kpp";
+    benchmarkRandomLines(presetFileName);
+}
+
 void KisStrokeBenchmark::colorsmudge()
 {
     QString presetFileName = "colorsmudge.kpp";
@@ -327,6 +356,40 @@ void KisStrokeBenchmark::colorsmudgeRL()
     benchmarkStroke(presetFileName);
 }
 
+void KisStrokeBenchmark::colorsmudgeDullingRadius()
+{
+    QString presetFileName = "colorsmudge.kpp";
+
+    KisPaintOpPresetSP preset = new KisPaintOpPreset(m_dataPath + presetFileName);
+    bool loadedOk = preset->load();
+    if (!loadedOk){
+        dbgKrita << "The preset was not loaded correctly. Done.";
+        return;
+    }
+
+    /**
+     * Dulling mode with the smudge radius enabled samples the average
+     * color of the area under every dab, which is the heaviest user
+     * of KoMixColorsOp in the brush engines
+     */
+    preset->settings()->setProperty("SmudgeRateMode", 1 /* KisSmudgeOption::DULLING_MODE */);
+    preset->settings()->setProperty("PressureSmudgeRadius", true);
+    preset->settings()->setProperty("SmudgeRadiusValue", 100.0);
+
+    m_painter->setPaintOpPreset(preset, m_layer, m_image);
+
+    QBENCHMARK{
+        KisDistanceInformation currentDistance;
+        m_painter->paintBezierCurve(m_pi1, m_c1, m_c1, m_pi2, &currentDistance);
+        m_painter->paintBezierCurve(m_pi2, m_c2, m_c2, m_pi3, &currentDistance);
+        flushAsyncUpdates();
+    }
+
+#ifdef SAVE_OUTPUT
+    m_layer->paintDevice()->convertToQImage(0).save(m_outputPath + presetFileName + "_dulling_radius" + OUTPUT_FORMAT);
+#endif
+}
+
 /*
 void KisStrokeBenchmark::predefinedBrush()
 {
@@ -374,6 +437,7 @@ inline void KisStrokeBenchmark::benchmarkLine(QString presetFileName)
 
     QBENCHMARK{
         m_painter->paintLine(pi1, pi2, &currentDistance);
+        flushAsyncUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -425,6 +489,7 @@ QBENCHMARK{
         }
         m_painter->paintLine(prev, first, &currentDistance);
     }
+    flushAsyncUpdates();
 }
 
 #ifdef SAVE_OUTPUT
@@ -455,6 +520,7 @@ void KisStrokeBenchmark::benchmarkRandomLines(QString presetFileName)
             KisPaintInformation pi2(m_endPoints[i], 1.0);
             m_painter->paintLine(pi1, pi2, &currentDistance);
         }
+        flushAsyncUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -462,6 +528,25 @@ void KisStrokeBenchmark::benchmarkRandomLines(QString presetFileName)
 #endif
 }
 
+void KisStrokeBenchmark::flushAsyncUpdates()
+{
+    /**
+     * The paintops rendering their dabs asynchronously blit them only
+     * when the stroke asks for an update. Outside the stroke the jobs are
+     * executed by the fake executor of the painter right away, so we
+     * just need to request the updates until the paintop has no dabs left.
+     */
+    KisPaintOp *paintOp = m_painter->paintOp();
+    if (!paintOp) return;
+
+    bool needsMoreUpdates = true;
+    while (needsMoreUpdates) {
+        QVector<KisRunnableStrokeJobData*> jobs;
+        needsMoreUpdates = paintOp->doAsyncronousUpdate(jobs).second;
+        m_painter->runnableStrokeJobsInterface()->addRunnableJobs(jobs);
+    }
+}
+
 void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
 {
     KisPaintOpPresetSP preset = new KisPaintOpPreset(m_dataPath + presetFileName);
@@ -479,6 +564,7 @@ void KisStrokeBenchmark::benchmarkStroke(QString presetFileName)
         KisDistanceInformation currentDistance;
         m_painter->paintBezierCurve(m_pi1, m_c1, m_c1, m_pi2, &currentDistance);
         m_painter->paintBezierCurve(m_pi2, m_c2, m_c2, m_pi3, &currentDistance);
+        flushAsyncUpdates();
     }
 
 #ifdef SAVE_OUTPUT
@@ -62,6 +62,7 @@ private:
         inline void benchmarkStroke(QString presetFileName);
         inline void benchmarkLine(QString presetFileName);
         inline void benchmarkCircle(QString presetFileName);
+        void flushAsyncUpdates();
 
 private Q_SLOTS:
     void initTestCase();
@@ -96,6 +97,9 @@ private Q_SLOTS:
     void hairy30InkDepletion();
     void hairy30InkDepletionRL();
 
+    void hairy70pxDense();
+    void hairy70pxDenseRL();
+
     // Spray brush benchmark1
     void spray30px21particles();
     void spray30px21particlesRL();
@@ -118,8 +122,12 @@ private Q_SLOTS:
     void experimental();
     void experimentalCircle();
 
+    void filterOpGauss();
+    void filterOpGaussRL();
+
     void colorsmudge();
     void colorsmudgeRL();
+    void colorsmudgeDullingRadius();
 /*
     void predefinedBrush();
     void predefinedBrushRL();
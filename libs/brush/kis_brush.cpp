@@ -482,13 +482,14 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
     Q_UNUSED(info_);
     Q_UNUSED(softnessFactor);
 
-    QImage outputImage = d->brushPyramid->pyramid(this)->createImage(KisDabShape(
+    QVector<quint8> maskData;
+    const QSize maskSize = d->brushPyramid->pyramid(this)->createMask(KisDabShape(
             shape.scale() * d->scale, shape.ratio(),
             -normalizeAngle(shape.rotation() + d->angle)),
-        subPixelX, subPixelY);
+        subPixelX, subPixelY, &maskData);
 
-    qint32 maskWidth = outputImage.width();
-    qint32 maskHeight = outputImage.height();
+    qint32 maskWidth = maskSize.width();
+    qint32 maskHeight = maskSize.height();
 
     dst->setRect(QRect(0, 0, maskWidth, maskHeight));
     dst->lazyGrowBufferWithoutInitialization();
@@ -504,13 +505,9 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
     const KoColorSpace *cs = dst->colorSpace();
     qint32 pixelSize = cs->pixelSize();
     quint8 *dabPointer = dst->data();
-    quint8 *rowPointer = dabPointer;
-    quint8 *alphaArray = new quint8[maskWidth];
-    bool hasColor = this->hasColor();
 
-    for (int y = 0; y < maskHeight; y++) {
-        const quint8* maskPointer = outputImage.constScanLine(y);
-        if (coloringInformation) {
+    if (coloringInformation) {
+        for (int y = 0; y < maskHeight; y++) {
             for (int x = 0; x < maskWidth; x++) {
                 if (color) {
                     memcpy(dabPointer, color, pixelSize);
@@ -521,41 +518,14 @@ void KisBrush::generateMaskAndApplyMaskOrCreateDab(KisFixedPaintDeviceSP dst,
                 }
                 dabPointer += pixelSize;
             }
-        }
-
-        if (hasColor) {
-            const quint8 *src = maskPointer;
-            quint8 *dst = alphaArray;
-            for (int x = 0; x < maskWidth; x++) {
-                const QRgb *c = reinterpret_cast<const QRgb*>(src);
-
-                *dst = KoColorSpaceMaths<quint8>::multiply(255 - qGray(*c), qAlpha(*c));
-                src += 4;
-                dst++;
-            }
-        }
-        else {
-            const quint8 *src = maskPointer;
-            quint8 *dst = alphaArray;
-            for (int x = 0; x < maskWidth; x++) {
-                const QRgb *c = reinterpret_cast<const QRgb*>(src);
 
-                *dst = KoColorSpaceMaths<quint8>::multiply(255 - *src, qAlpha(*c));
-                src += 4;
-                dst++;
+            if (!color) {
+                coloringInformation->nextRow();
             }
         }
-
-        cs->applyAlphaU8Mask(rowPointer, alphaArray, maskWidth);
-        rowPointer += maskWidth * pixelSize;
-        dabPointer = rowPointer;
-
-        if (!color && coloringInformation) {
-            coloringInformation->nextRow();
-        }
     }
 
-    delete[] alphaArray;
+    cs->applyAlphaU8Mask(dst->data(), maskData.constData(), maskWidth * maskHeight);
 }
 
 KisFixedPaintDeviceSP KisBrush::paintDevice(const KoColorSpace * colorSpace,
@@ -568,12 +538,11 @@ KisFixedPaintDeviceSP KisBrush::paintDevice(const KoColorSpace * colorSpace,
     double angle = normalizeAngle(shape.rotation() + d->angle);
     double scale = shape.scale() * d->scale;
 
-    QImage outputImage = d->brushPyramid->pyramid(this)->createImage(
-        KisDabShape(scale, shape.ratio(), -angle), subPixelX, subPixelY);
-
     KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(colorSpace);
     Q_CHECK_PTR(dab);
-    dab->convertFromQImage(outputImage, "");
+
+    d->brushPyramid->pyramid(this)->createDab(
+        KisDabShape(scale, shape.ratio(), -angle), subPixelX, subPixelY, dab);
 
     return dab;
 }
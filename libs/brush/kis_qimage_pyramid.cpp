@@ -19,8 +19,14 @@
 #include "kis_qimage_pyramid.h"
 
 #include <limits>
+#include <cmath>
+#include <algorithm>
 #include <QPainter>
 #include <kis_debug.h>
+#include <kis_fixed_paint_device.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceMaths.h>
+#include <KoColorSpaceRegistry.h>
 
 #define MIPMAP_SIZE_THRESHOLD 512
 #define MAX_MIPMAP_SCALE 8.0
@@ -253,32 +259,61 @@ void KisQImagePyramid::appendPyramidLevel(const QImage &image)
      *
      * See a unittest in: KisGbrBrushTest::testQPainterTransformationBorder
      */
-    
-QSize levelSize = image.size();
+
+    QSize levelSize = image.size();
     QImage tmp = image.convertToFormat(QImage::Format_ARGB32);
     tmp = tmp.copy(-QPAINTER_WORKAROUND_BORDER,
                    -QPAINTER_WORKAROUND_BORDER,
                    image.width() + 2 * QPAINTER_WORKAROUND_BORDER,
                    image.height() + 2 * QPAINTER_WORKAROUND_BORDER);
-    m_levels.append(PyramidLevel(tmp, levelSize));
+
+    /**
+     * The mask is linear in premultiplied color components, so we can
+     * precalculate it once and interpolate the mask values directly
+     * when generating the dab. For grayscale brushes qGray() returns
+     * exactly the value of any channel.
+     */
+    QVector<quint8> mask(tmp.width() * tmp.height());
+    quint8 *maskPtr = mask.data();
+
+    for (int y = 0; y < tmp.height(); y++) {
+        const QRgb *srcPtr = reinterpret_cast<const QRgb*>(tmp.constScanLine(y));
+        for (int x = 0; x < tmp.width(); x++) {
+            *maskPtr = KoColorSpaceMaths<quint8>::multiply(255 - qGray(*srcPtr), qAlpha(*srcPtr));
+            srcPtr++;
+            maskPtr++;
+        }
+    }
+
+    m_levels.append(PyramidLevel(tmp, levelSize, mask));
 }
 
-QImage KisQImagePyramid::createImage(KisDabShape const& shape,
-                                     qreal subPixelX, qreal subPixelY) const
+int KisQImagePyramid::calculateLevelParams(KisDabShape const& shape,
+                                           qreal subPixelX, qreal subPixelY,
+                                           QTransform *outputTransform, QSize *outputSize) const
 {
-    if (m_levels.isEmpty()) return QImage();
-
     qreal baseScale = -1.0;
     int level = findNearestLevel(shape.scale(), &baseScale);
 
-    const QImage &srcImage = m_levels[level].image;
+    calculateParams(shape, subPixelX, subPixelY,
+                    m_originalSize, baseScale, m_levels[level].size,
+                    outputTransform, outputSize);
+
+    return level;
+}
+
+QImage KisQImagePyramid::createImage(KisDabShape const& shape,
+                                     qreal subPixelX, qreal subPixelY) const
+{
+    if (m_levels.isEmpty()) return QImage();
 
     QTransform transform;
     QSize dstSize;
 
-    calculateParams(shape, subPixelX, subPixelY,
-                    m_originalSize, baseScale, m_levels[level].size,
-                    &transform, &dstSize);
+    const int level = calculateLevelParams(shape, subPixelX, subPixelY,
+                                           &transform, &dstSize);
+
+    const QImage &srcImage = m_levels[level].image;
 
     if (transform.isIdentity() &&
             srcImage.format() == QImage::Format_ARGB32) {
@@ -318,6 +353,260 @@ QImage KisQImagePyramid::createImage(KisDabShape const& shape,
     return dstImage;
 }
 
+namespace {
+
+/**
+ * Policies for the bilinear resampler. The accumulator is always
+ * linear in the source values, so the same code can blend rows and
+ * columns independently. Colors are accumulated premultiplied, just
+ * like QPainter does when scaling a QImage::Format_ARGB32 image.
+ */
+struct MaskSamplingPolicy
+{
+    static const int srcPixelSize = 1;
+    static const int numChannels = 1;
+
+    static inline void accumulate(const quint8 *src, float weight, float *acc) {
+        acc[0] += weight * src[0];
+    }
+
+    static inline void store(const float *acc, quint8 *dst) {
+        dst[0] = quint8(qMin(acc[0] + 0.5f, 255.0f));
+    }
+};
+
+struct ColorSamplingPolicy
+{
+    static const int srcPixelSize = 4;
+    static const int numChannels = 4;
+
+    static inline void accumulate(const quint8 *src, float weight, float *acc) {
+        const float alphaWeight = weight * src[3];
+        acc[0] += alphaWeight * src[0];
+        acc[1] += alphaWeight * src[1];
+        acc[2] += alphaWeight * src[2];
+        acc[3] += alphaWeight;
+    }
+
+    static inline void store(const float *acc, quint8 *dst) {
+        const float alpha = qMin(acc[3] + 0.5f, 255.0f);
+
+        if (alpha < 1.0f) {
+            dst[0] = dst[1] = dst[2] = dst[3] = 0;
+            return;
+        }
+
+        const float invAlpha = 1.0f / acc[3];
+        dst[0] = quint8(qMin(acc[0] * invAlpha + 0.5f, 255.0f));
+        dst[1] = quint8(qMin(acc[1] * invAlpha + 0.5f, 255.0f));
+        dst[2] = quint8(qMin(acc[2] * invAlpha + 0.5f, 255.0f));
+        dst[3] = quint8(alpha);
+    }
+};
+
+struct BilinearTap {
+    int index0 = 0;
+    int index1 = 0;
+    float weight0 = 0.0f;
+    float weight1 = 0.0f;
+};
+
+/**
+ * Calculates two source taps for the sampling point \p pos in
+ * a line of \p size pixels. The taps falling outside the line are
+ * clamped and get zero weight, which is equivalent to sampling
+ * a transparent pixel.
+ */
+inline BilinearTap calculateTap(float pos, int size)
+{
+    BilinearTap tap;
+
+    const float floorPos = std::floor(pos);
+    const int index0 = int(floorPos);
+    const float fraction = pos - floorPos;
+
+    if (index0 >= 0 && index0 < size) {
+        tap.index0 = index0;
+        tap.weight0 = 1.0f - fraction;
+    }
+
+    if (index0 + 1 >= 0 && index0 + 1 < size) {
+        tap.index1 = index0 + 1;
+        tap.weight1 = fraction;
+    }
+
+    return tap;
+}
+
+/**
+ * Resamples the source image into \p dst using inverse transform
+ * \p invTransform, which maps the centers of the destination pixels
+ * into the source coordinates. The source pixels outside the image
+ * are considered transparent.
+ */
+template <class Policy>
+void resampleBilinear(const quint8 *src, int srcWidth, int srcHeight, int srcRowStride,
+                      const QTransform &invTransform,
+                      quint8 *dst, int dstWidth, int dstHeight)
+{
+    const int numChannels = Policy::numChannels;
+    const int srcPixelSize = Policy::srcPixelSize;
+
+    // sampling position of pixel (x, y) is (x * dxx + y * dxy + x0, x * dyx + y * dyy + y0)
+    const qreal dxx = invTransform.m11();
+    const qreal dxy = invTransform.m21();
+    const qreal dyx = invTransform.m12();
+    const qreal dyy = invTransform.m22();
+    const qreal x0 = 0.5 * (dxx + dxy) + invTransform.dx() - 0.5;
+    const qreal y0 = 0.5 * (dyx + dyy) + invTransform.dy() - 0.5;
+
+    if (invTransform.type() <= QTransform::TxScale) {
+        /**
+         * Axis-aligned case (no rotation), which is the most common one: the
+         * filter is separable, so we precalculate horizontal taps and blend two
+         * source rows into a temporary row first. The blending loop is a plain
+         * linear pass over memory, which is easily vectorized by the compiler.
+         */
+
+        QVector<BilinearTap> columnTaps(dstWidth);
+        for (int x = 0; x < dstWidth; x++) {
+            columnTaps[x] = calculateTap(x * dxx + x0, srcWidth);
+        }
+
+        QVector<float> blendedRow(srcWidth * numChannels);
+        float *blendedPtr = blendedRow.data();
+
+        for (int y = 0; y < dstHeight; y++) {
+            const BilinearTap rowTap = calculateTap(y * dyy + y0, srcHeight);
+
+            const quint8 *srcRow0 = src + rowTap.index0 * srcRowStride;
+            const quint8 *srcRow1 = src + rowTap.index1 * srcRowStride;
+
+            std::fill(blendedRow.begin(), blendedRow.end(), 0.0f);
+
+            for (int i = 0; i < srcWidth; i++) {
+                Policy::accumulate(srcRow0 + i * srcPixelSize, rowTap.weight0, blendedPtr + i * numChannels);
+                Policy::accumulate(srcRow1 + i * srcPixelSize, rowTap.weight1, blendedPtr + i * numChannels);
+            }
+
+            for (int x = 0; x < dstWidth; x++) {
+                const BilinearTap &tap = columnTaps[x];
+                const float *blended0 = blendedPtr + tap.index0 * numChannels;
+                const float *blended1 = blendedPtr + tap.index1 * numChannels;
+
+                float acc[numChannels];
+                for (int c = 0; c < numChannels; c++) {
+                    acc[c] = tap.weight0 * blended0[c] + tap.weight1 * blended1[c];
+                }
+
+                Policy::store(acc, dst);
+                dst += numChannels;
+            }
+        }
+
+    } else {
+        for (int y = 0; y < dstHeight; y++) {
+            const qreal rowX = y * dxy + x0;
+            const qreal rowY = y * dyy + y0;
+
+            for (int x = 0; x < dstWidth; x++) {
+                const BilinearTap tapX = calculateTap(rowX + x * dxx, srcWidth);
+                const BilinearTap tapY = calculateTap(rowY + x * dyx, srcHeight);
+
+                const quint8 *srcRow0 = src + tapY.index0 * srcRowStride;
+                const quint8 *srcRow1 = src + tapY.index1 * srcRowStride;
+
+                float acc[numChannels];
+                std::fill(acc, acc + numChannels, 0.0f);
+
+                Policy::accumulate(srcRow0 + tapX.index0 * srcPixelSize, tapX.weight0 * tapY.weight0, acc);
+                Policy::accumulate(srcRow0 + tapX.index1 * srcPixelSize, tapX.weight1 * tapY.weight0, acc);
+                Policy::accumulate(srcRow1 + tapX.index0 * srcPixelSize, tapX.weight0 * tapY.weight1, acc);
+                Policy::accumulate(srcRow1 + tapX.index1 * srcPixelSize, tapX.weight1 * tapY.weight1, acc);
+
+                Policy::store(acc, dst);
+                dst += numChannels;
+            }
+        }
+    }
+}
+
+}
+
+QSize KisQImagePyramid::createMask(KisDabShape const& shape,
+                                   qreal subPixelX, qreal subPixelY,
+                                   QVector<quint8> *mask) const
+{
+    if (m_levels.isEmpty()) return QSize();
+
+    QTransform transform;
+    QSize dstSize;
+
+    const int level = calculateLevelParams(shape, subPixelX, subPixelY,
+                                           &transform, &dstSize);
+
+    const PyramidLevel &srcLevel = m_levels[level];
+
+    mask->resize(dstSize.width() * dstSize.height());
+
+    const QTransform invTransform =
+        (QTransform::fromTranslate(-QPAINTER_WORKAROUND_BORDER,
+                                   -QPAINTER_WORKAROUND_BORDER) * transform).inverted();
+
+    resampleBilinear<MaskSamplingPolicy>(srcLevel.mask.constData(),
+                                         srcLevel.image.width(), srcLevel.image.height(),
+                                         srcLevel.image.width(),
+                                         invTransform,
+                                         mask->data(), dstSize.width(), dstSize.height());
+
+    return dstSize;
+}
+
+void KisQImagePyramid::createDab(KisDabShape const& shape,
+                                 qreal subPixelX, qreal subPixelY,
+                                 KisFixedPaintDeviceSP dab) const
+{
+    if (m_levels.isEmpty()) return;
+
+    QTransform transform;
+    QSize dstSize;
+
+    const int level = calculateLevelParams(shape, subPixelX, subPixelY,
+                                           &transform, &dstSize);
+
+    const QImage &srcImage = m_levels[level].image;
+
+    dab->setRect(QRect(QPoint(), dstSize));
+    dab->lazyGrowBufferWithoutInitialization();
+
+    const KoColorSpace *rgb8 = KoColorSpaceRegistry::instance()->rgb8();
+    const bool canWriteDirectly = dab->colorSpace()->id() == rgb8->id();
+    const int numPixels = dstSize.width() * dstSize.height();
+
+    QVector<quint8> tempBuffer;
+    if (!canWriteDirectly) {
+        tempBuffer.resize(numPixels * rgb8->pixelSize());
+    }
+
+    quint8 *dstPtr = canWriteDirectly ? dab->data() : tempBuffer.data();
+
+    const QTransform invTransform =
+        (QTransform::fromTranslate(-QPAINTER_WORKAROUND_BORDER,
+                                   -QPAINTER_WORKAROUND_BORDER) * transform).inverted();
+
+    resampleBilinear<ColorSamplingPolicy>(srcImage.constBits(),
+                                          srcImage.width(), srcImage.height(),
+                                          srcImage.bytesPerLine(),
+                                          invTransform,
+                                          dstPtr, dstSize.width(), dstSize.height());
+
+    if (!canWriteDirectly) {
+        rgb8->convertPixelsTo(tempBuffer.constData(), dab->data(), dab->colorSpace(), numPixels,
+                              KoColorConversionTransformation::internalRenderingIntent(),
+                              KoColorConversionTransformation::internalConversionFlags());
+    }
+}
+
 QImage KisQImagePyramid::getClosest(QTransform transform, qreal *scale) const
 {
     if (m_levels.isEmpty()) return QImage();
@@ -22,6 +22,7 @@
 #include <QImage>
 #include <QVector>
 #include <kis_dab_shape.h>
+#include <kis_types.h>
 #include <kritabrush_export.h>
 
 
@@ -41,6 +42,32 @@ public:
     QImage createImage(KisDabShape const&,
                        qreal subPixelX, qreal subPixelY) const;
 
+    /**
+     * Resamples the nearest pyramid level directly into a plain 8-bit
+     * alpha mask without creating an intermediate QImage. The value of
+     * every mask pixel is `alpha * (255 - gray) / 255`, that is exactly
+     * what KisBrush uses for masking the dab. The interpolation is done
+     * on premultiplied values, so the result is equivalent to the one of
+     * createImage() up to the rounding.
+     *
+     * @return the size of the generated mask, \p mask is resized to
+     *         width * height
+     */
+    QSize createMask(KisDabShape const&,
+                     qreal subPixelX, qreal subPixelY,
+                     QVector<quint8> *mask) const;
+
+    /**
+     * Resamples the nearest pyramid level directly into \p dab. The
+     * colorspace of the dab is preserved. If the dab is RGBA 8-bit, then
+     * the pixels are written into the device as-is, otherwise they are
+     * converted from sRGB as KisFixedPaintDevice::convertFromQImage()
+     * does.
+     */
+    void createDab(KisDabShape const&,
+                   qreal subPixelX, qreal subPixelY,
+                   KisFixedPaintDeviceSP dab) const;
+
     QImage getClosest(QTransform transform, qreal *scale) const;
 
 private:
@@ -59,16 +86,27 @@ private:
                                 qreal baseScale, const QSize &baseSize,
                                 QTransform *outputTransform, QSize *outputSize);
 
+    int calculateLevelParams(KisDabShape const& shape,
+                             qreal subPixelX, qreal subPixelY,
+                             QTransform *outputTransform, QSize *outputSize) const;
+
 private:
     QSize m_originalSize;
     qreal m_baseScale;
 
     struct PyramidLevel {
         PyramidLevel() {}
-        PyramidLevel(QImage _image, QSize _size) : image(_image), size(_size) {}
+        PyramidLevel(QImage _image, QSize _size, QVector<quint8> _mask)
+            : image(_image), size(_size), mask(_mask) {}
 
         QImage image;
         QSize size;
+
+        /**
+         * Premultiplied brush mask of the level, has the same size
+         * as \p image (including the workaround border)
+         */
+        QVector<quint8> mask;
     };
 
     QVector<PyramidLevel> m_levels;
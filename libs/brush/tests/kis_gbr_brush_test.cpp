@@ -31,6 +31,8 @@
 #include "brushengine/kis_paint_information.h"
 #include <kis_fixed_paint_device.h>
 #include "kis_qimage_pyramid.h"
+#include <KoColorSpaceMaths.h>
+#include <QElapsedTimer>
 
 
 void KisGbrBrushTest::testMaskGenerationSingleColor()
@@ -251,6 +253,116 @@ void KisGbrBrushTest::testPyramidDabTransform()
     QCOMPARE(dabTransformHelper(KisDabShape(1.0, 0.5, M_PI / 4)), QSize(160, 160));
 }
 
+static QVector<quint8> maskFromQImage(const QImage &image)
+{
+    QVector<quint8> mask;
+
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *pixel = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = 0; x < image.width(); x++) {
+            mask << KoColorSpaceMaths<quint8>::multiply(255 - qGray(*pixel), qAlpha(*pixel));
+            pixel++;
+        }
+    }
+
+    return mask;
+}
+
+void KisGbrBrushTest::testPyramidDirectResampling()
+{
+    QScopedPointer<KisGbrBrush> brush(new KisGbrBrush(QString(FILES_DATA_DIR) + QDir::separator() + "testing_brush_512_bars.gbr"));
+    brush->load();
+    QVERIFY(!brush->brushTipImage().isNull());
+
+    KisQImagePyramid pyramid(brush->brushTipImage());
+
+    const QVector<KisDabShape> shapes({
+        KisDabShape(1.0, 1.0, 0.0),
+        KisDabShape(0.3, 1.0, 0.0),
+        KisDabShape(0.77, 0.5, 0.0),
+        KisDabShape(1.7, 1.0, 0.0),
+        KisDabShape(0.5, 1.0, M_PI / 6),
+        KisDabShape(0.9, 0.7, 5 * M_PI / 4)});
+
+    const QVector<QPointF> subPixels({QPointF(), QPointF(0.3, 0.7)});
+
+    Q_FOREACH (const KisDabShape &shape, shapes) {
+        Q_FOREACH (const QPointF &subPixel, subPixels) {
+            const QImage image = pyramid.createImage(shape, subPixel.x(), subPixel.y());
+
+            QVector<quint8> mask;
+            const QSize maskSize = pyramid.createMask(shape, subPixel.x(), subPixel.y(), &mask);
+            QCOMPARE(maskSize, image.size());
+
+            const QVector<quint8> referenceMask = maskFromQImage(image);
+
+            // QPainter and the direct resampler round the
+            // intermediate values differently
+            for (int i = 0; i < mask.size(); i++) {
+                if (qAbs(int(mask[i]) - int(referenceMask[i])) > 3) {
+                    QFAIL(QString("Mask pixel %1 differs: %2 vs %3 (scale %4, ratio %5, rotation %6)")
+                          .arg(i).arg(mask[i]).arg(referenceMask[i])
+                          .arg(shape.scale()).arg(shape.ratio()).arg(shape.rotation())
+                          .toLatin1());
+                }
+            }
+        }
+    }
+}
+
+void KisGbrBrushTest::benchmarkDabResampling_data()
+{
+    QTest::addColumn<bool>("useDirectResampling");
+    QTest::addColumn<bool>("useRotation");
+
+    QTest::newRow("qimage") << false << false;
+    QTest::newRow("direct") << true << false;
+    QTest::newRow("qimage-rotated") << false << true;
+    QTest::newRow("direct-rotated") << true << true;
+}
+
+void KisGbrBrushTest::benchmarkDabResampling()
+{
+    QFETCH(bool, useDirectResampling);
+    QFETCH(bool, useRotation);
+
+    QScopedPointer<KisGbrBrush> brush(new KisGbrBrush(QString(FILES_DATA_DIR) + QDir::separator() + "testing_brush_512_bars.gbr"));
+    brush->load();
+    QVERIFY(!brush->brushTipImage().isNull());
+    qsrand(1);
+
+    KisQImagePyramid pyramid(brush->brushTipImage());
+
+    const int numDabs = 200;
+    QVector<KisDabShape> shapes;
+    for (int i = 0; i < numDabs; i++) {
+        shapes << KisDabShape(0.1 + qreal(qrand()) / RAND_MAX * 0.9, 1.0,
+                              useRotation ? qreal(qrand()) / RAND_MAX * 2 * M_PI : 0.0);
+    }
+
+    QVector<quint8> mask;
+    QElapsedTimer timer;
+    qint64 elapsedNSecs = 0;
+    int dabsGenerated = 0;
+
+    QBENCHMARK {
+        timer.start();
+
+        Q_FOREACH (const KisDabShape &shape, shapes) {
+            if (useDirectResampling) {
+                pyramid.createMask(shape, 0.3, 0.3, &mask);
+            } else {
+                mask = maskFromQImage(pyramid.createImage(shape, 0.3, 0.3));
+            }
+        }
+
+        elapsedNSecs += timer.nsecsElapsed();
+        dabsGenerated += numDabs;
+    }
+
+    qDebug() << "Dabs per second:" << qRound(dabsGenerated * 1e9 / qMax(elapsedNSecs, qint64(1)));
+}
+
 // see comment in KisQImagePyramid::appendPyramidLevel
 void KisGbrBrushTest::testQPainterTransformationBorder()
 {
@@ -41,6 +41,10 @@ private Q_SLOTS:
     void testPyramidLevelRounding();
     void testPyramidDabTransform();
 
+    void testPyramidDirectResampling();
+    void benchmarkDabResampling_data();
+    void benchmarkDabResampling();
+
     void testQPainterTransformationBorder();
 };
 
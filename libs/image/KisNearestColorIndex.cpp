@@ -0,0 +1,271 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisNearestColorIndex.h"
+
+#include <QtGlobal>
+#include <QPair>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+/************************************************************************/
+/*             KisNearestColorIndex::Cache                              */
+/************************************************************************/
+
+KisNearestColorIndex::Cache::Cache(int sizeLog2)
+    : m_sizeLog2(qBound(1, sizeLog2, 24)),
+      m_entries(new std::atomic<quint64>[1 << m_sizeLog2])
+{
+    for (int i = 0; i < (1 << m_sizeLog2); i++) {
+        m_entries[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+KisNearestColorIndex::Cache::~Cache()
+{
+}
+
+inline quint64 KisNearestColorIndex::Cache::key(const Color &color) const
+{
+    return (quint64(color[0]) << 32) | (quint64(color[1]) << 16) | quint64(color[2]);
+}
+
+inline int KisNearestColorIndex::Cache::slot(quint64 key) const
+{
+    return int((key * Q_UINT64_C(0x9E3779B97F4A7C15)) >> (64 - m_sizeLog2));
+}
+
+/**
+ * An entry keeps the 48-bit color in the higher bits and the index
+ * incremented by one in the lower 16 bits, so that the zero-initialized
+ * entries never match.
+ */
+
+bool KisNearestColorIndex::Cache::fetch(const Color &color, int *index) const
+{
+    const quint64 k = key(color);
+    const quint64 entry = m_entries[slot(k)].load(std::memory_order_relaxed);
+
+    if ((entry >> 16) != k || !(entry & 0xFFFF)) return false;
+
+    *index = int(entry & 0xFFFF) - 1;
+    return true;
+}
+
+void KisNearestColorIndex::Cache::store(const Color &color, int index)
+{
+    if (index < 0 || index >= 0xFFFF) return;
+
+    const quint64 k = key(color);
+    m_entries[slot(k)].store((k << 16) | quint64(index + 1), std::memory_order_relaxed);
+}
+
+
+/************************************************************************/
+/*             KisNearestColorIndex                                     */
+/************************************************************************/
+
+namespace {
+
+struct NearestVisitor
+{
+    inline void visit(int index, qreal distanceSq) {
+        if (distanceSq < bestDistanceSq ||
+            (distanceSq == bestDistanceSq && index < bestIndex)) {
+
+            bestDistanceSq = distanceSq;
+            bestIndex = index;
+        }
+    }
+
+    // equal distances are still visited to find the lowest index
+    inline bool accepts(qreal axisDistanceSq) const {
+        return axisDistanceSq <= bestDistanceSq;
+    }
+
+    qreal bestDistanceSq = std::numeric_limits<qreal>::max();
+    int bestIndex = -1;
+};
+
+struct CandidatesVisitor
+{
+    CandidatesVisitor(qreal _slack) : slack(_slack) {}
+
+    inline void visit(int index, qreal distanceSq) {
+        const qreal distance = std::sqrt(distanceSq);
+
+        if (distance <= bestDistance + slack) {
+            found.append(qMakePair(index, distance));
+        }
+        bestDistance = qMin(bestDistance, distance);
+    }
+
+    inline bool accepts(qreal axisDistanceSq) const {
+        return std::sqrt(axisDistanceSq) <= bestDistance + slack;
+    }
+
+    const qreal slack;
+    qreal bestDistance = std::numeric_limits<qreal>::max();
+    QVector<QPair<int, qreal>> found;
+};
+
+}
+
+KisNearestColorIndex::KisNearestColorIndex(const QVector<Color> &palette,
+                                           qreal weight0, qreal weight1, qreal weight2)
+    : m_palette(palette),
+      m_weights({{weight0, weight1, weight2}})
+{
+    m_nodes.resize(palette.size());
+
+    for (int i = 0; i < palette.size(); i++) {
+        m_nodes[i].color = palette[i];
+        m_nodes[i].index = i;
+        m_nodes[i].axis = 0;
+    }
+
+    build(0, m_nodes.size());
+}
+
+int KisNearestColorIndex::numColors() const
+{
+    return m_palette.size();
+}
+
+KisNearestColorIndex::Color KisNearestColorIndex::color(int index) const
+{
+    return m_palette[index];
+}
+
+/**
+ * The tree is stored implicitly: the node of a range is in its middle,
+ * the left subtree is on the left of it and the right one on the right.
+ * Every node splits its range along the axis of the largest weighted
+ * spread of the colors in the range.
+ */
+void KisNearestColorIndex::build(int begin, int end)
+{
+    if (end - begin <= 0) return;
+
+    int bestAxis = 0;
+    qreal bestSpread = -1.0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        quint16 minValue = std::numeric_limits<quint16>::max();
+        quint16 maxValue = 0;
+
+        for (int i = begin; i < end; i++) {
+            minValue = qMin(minValue, m_nodes[i].color[axis]);
+            maxValue = qMax(maxValue, m_nodes[i].color[axis]);
+        }
+
+        const qreal spread = (maxValue - minValue) * m_weights[axis];
+        if (spread > bestSpread) {
+            bestSpread = spread;
+            bestAxis = axis;
+        }
+    }
+
+    const int middle = begin + (end - begin) / 2;
+
+    std::nth_element(m_nodes.begin() + begin, m_nodes.begin() + middle, m_nodes.begin() + end,
+                     [bestAxis] (const Node &lhs, const Node &rhs) {
+                         return lhs.color[bestAxis] < rhs.color[bestAxis] ||
+                             (lhs.color[bestAxis] == rhs.color[bestAxis] && lhs.index < rhs.index);
+                     });
+
+    m_nodes[middle].axis = bestAxis;
+
+    build(begin, middle);
+    build(middle + 1, end);
+}
+
+inline qreal KisNearestColorIndex::distanceSq(const Color &lhs, const Color &rhs) const
+{
+    qreal result = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        const qreal diff = (qreal(lhs[axis]) - rhs[axis]) * m_weights[axis];
+        result += diff * diff;
+    }
+
+    return result;
+}
+
+template <class Visitor>
+void KisNearestColorIndex::search(const Color &color, int begin, int end, Visitor &visitor) const
+{
+    if (end - begin <= 0) return;
+
+    const int middle = begin + (end - begin) / 2;
+    const Node &node = m_nodes[middle];
+
+    visitor.visit(node.index, distanceSq(color, node.color));
+
+    const qreal axisDistance = (qreal(color[node.axis]) - node.color[node.axis]) * m_weights[node.axis];
+
+    if (axisDistance < 0) {
+        search(color, begin, middle, visitor);
+        if (visitor.accepts(axisDistance * axisDistance)) {
+            search(color, middle + 1, end, visitor);
+        }
+    } else {
+        search(color, middle + 1, end, visitor);
+        if (visitor.accepts(axisDistance * axisDistance)) {
+            search(color, begin, middle, visitor);
+        }
+    }
+}
+
+int KisNearestColorIndex::nearestIndex(const Color &color) const
+{
+    NearestVisitor visitor;
+    search(color, 0, m_nodes.size(), visitor);
+    return visitor.bestIndex;
+}
+
+int KisNearestColorIndex::nearestIndex(const Color &color, Cache *cache) const
+{
+    int index = -1;
+
+    if (!cache->fetch(color, &index)) {
+        index = nearestIndex(color);
+        cache->store(color, index);
+    }
+
+    return index;
+}
+
+void KisNearestColorIndex::nearestCandidates(const Color &color, qreal slack, QVector<int> *candidates) const
+{
+    CandidatesVisitor visitor(slack);
+    search(color, 0, m_nodes.size(), visitor);
+
+    candidates->clear();
+
+    for (auto it = visitor.found.constBegin(); it != visitor.found.constEnd(); ++it) {
+        if (it->second <= visitor.bestDistance + slack) {
+            candidates->append(it->first);
+        }
+    }
+
+    std::sort(candidates->begin(), candidates->end());
+}
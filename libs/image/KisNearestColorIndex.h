@@ -0,0 +1,125 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_NEAREST_COLOR_INDEX_H
+#define __KIS_NEAREST_COLOR_INDEX_H
+
+#include "kritaimage_export.h"
+
+#include <QVector>
+#include <QScopedArrayPointer>
+
+#include <array>
+#include <atomic>
+
+/**
+ * A k-d tree over the colors of a palette that finds the palette color
+ * nearest to a given one in logarithmic time instead of comparing it to
+ * every color of the palette.
+ *
+ * A color is a triplet of 16-bit components in any color model, e.g.
+ * L*a*b* of Lab16 or 8-bit RGB values. The distance is Euclidean, every
+ * component difference is multiplied by its weight first. When several
+ * palette colors are equally near, the one with the lowest index wins,
+ * the same what a linear search over the palette would return.
+ *
+ * The index is immutable after construction, so it can be shared between
+ * threads. Images usually contain much fewer distinct colors than pixels,
+ * so the callers are expected to put a Cache in front of it.
+ */
+class KRITAIMAGE_EXPORT KisNearestColorIndex
+{
+public:
+    typedef std::array<quint16, 3> Color;
+
+    /**
+     * A fixed-size direct-mapped cache of the search results. The entries
+     * are atomic, so a cache may be shared by the threads processing the
+     * same image: a race may only cause a miss, never a wrong index.
+     * The cache stores indices lower than 65535 only.
+     */
+    class KRITAIMAGE_EXPORT Cache
+    {
+    public:
+        Cache(int sizeLog2 = 14);
+        ~Cache();
+
+        bool fetch(const Color &color, int *index) const;
+        void store(const Color &color, int index);
+
+    private:
+        Cache(const Cache &rhs) = delete;
+        Cache& operator=(const Cache &rhs) = delete;
+
+        inline quint64 key(const Color &color) const;
+        inline int slot(quint64 key) const;
+
+    private:
+        const int m_sizeLog2;
+        QScopedArrayPointer<std::atomic<quint64>> m_entries;
+    };
+
+public:
+    KisNearestColorIndex(const QVector<Color> &palette,
+                         qreal weight0 = 1.0, qreal weight1 = 1.0, qreal weight2 = 1.0);
+
+    int numColors() const;
+    Color color(int index) const;
+
+    /**
+     * @return the index of the palette color nearest to \p color or -1
+     * if the palette is empty
+     */
+    int nearestIndex(const Color &color) const;
+
+    /**
+     * Same as nearestIndex(), but looks into \p cache first and stores
+     * the result there
+     */
+    int nearestIndex(const Color &color, Cache *cache) const;
+
+    /**
+     * Collects the indices of all palette colors which are not further
+     * from \p color than the nearest one plus \p slack, in the order of
+     * increasing index. It lets the callers that compare colors in their
+     * own way, e.g. with a limited precision, check only the few colors
+     * that can win instead of the whole palette.
+     */
+    void nearestCandidates(const Color &color, qreal slack, QVector<int> *candidates) const;
+
+private:
+    struct Node {
+        Color color;
+        int index;
+        int axis;
+    };
+
+    void build(int begin, int end);
+
+    template <class Visitor>
+    void search(const Color &color, int begin, int end, Visitor &visitor) const;
+
+    inline qreal distanceSq(const Color &lhs, const Color &rhs) const;
+
+private:
+    QVector<Color> m_palette;
+    QVector<Node> m_nodes;
+    std::array<qreal, 3> m_weights;
+};
+
+#endif /* __KIS_NEAREST_COLOR_INDEX_H */
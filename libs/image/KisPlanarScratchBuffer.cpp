@@ -0,0 +1,293 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisPlanarScratchBuffer.h"
+
+#include <QVector>
+
+#include <KoConfig.h>
+#include <KoColorSpace.h>
+#include <KoChannelInfo.h>
+#include <KoColorSpaceMaths.h>
+
+#include "kis_assert.h"
+
+namespace {
+
+/**
+ * The number of channels is passed as a template parameter for the
+ * most common cases so that the compiler could unroll the strided
+ * access. Zero means "the number of channels is known only in runtime".
+ */
+template <typename T, int staticNumPlanes>
+void deinterleaveImpl(const quint8 *srcBytes, float * const *planes, int numPlanes, int numPixels)
+{
+    if (staticNumPlanes) {
+        numPlanes = staticNumPlanes;
+    }
+
+    const T *src = reinterpret_cast<const T*>(srcBytes);
+
+    for (int c = 0; c < numPlanes; c++) {
+        float *dst = planes[c];
+        const T *s = src + c;
+
+        for (int i = 0; i < numPixels; i++) {
+            dst[i] = KoColorSpaceMaths<T, float>::scaleToA(*s);
+            s += numPlanes;
+        }
+    }
+}
+
+template <typename T, int staticNumPlanes>
+void interleaveImpl(const float * const *planes, quint8 *dstBytes, int numPlanes, int numPixels)
+{
+    if (staticNumPlanes) {
+        numPlanes = staticNumPlanes;
+    }
+
+    T *dst = reinterpret_cast<T*>(dstBytes);
+
+    for (int c = 0; c < numPlanes; c++) {
+        const float *src = planes[c];
+        T *d = dst + c;
+
+        for (int i = 0; i < numPixels; i++) {
+            *d = KoColorSpaceMaths<float, T>::scaleToA(src[i]);
+            d += numPlanes;
+        }
+    }
+}
+
+typedef void (*DeinterleaveFunc)(const quint8*, float * const *, int, int);
+typedef void (*InterleaveFunc)(const float * const *, quint8*, int, int);
+
+template <typename T>
+void selectKernels(int numPlanes, DeinterleaveFunc *deinterleave, InterleaveFunc *interleave)
+{
+    switch (numPlanes) {
+    case 2:
+        *deinterleave = &deinterleaveImpl<T, 2>;
+        *interleave = &interleaveImpl<T, 2>;
+        break;
+    case 4:
+        *deinterleave = &deinterleaveImpl<T, 4>;
+        *interleave = &interleaveImpl<T, 4>;
+        break;
+    case 5:
+        *deinterleave = &deinterleaveImpl<T, 5>;
+        *interleave = &interleaveImpl<T, 5>;
+        break;
+    default:
+        *deinterleave = &deinterleaveImpl<T, 0>;
+        *interleave = &interleaveImpl<T, 0>;
+    }
+}
+
+}
+
+struct KisPlanarScratchBuffer::Private
+{
+    const KoColorSpace *colorSpace = 0;
+    int numPlanes = 0;
+    int capacity = 0;
+
+    bool isHalf = false;
+
+    QVector<float> data;
+    QVector<float*> planes;
+
+    /**
+     * Half float pixels are first converted in bulk with
+     * KoHalfBatchConversion into this buffer and only then
+     * shuffled into the planes as floats.
+     */
+    mutable QVector<float> halfConversionBuffer;
+
+    DeinterleaveFunc deinterleave = 0;
+    InterleaveFunc interleave = 0;
+};
+
+KisPlanarScratchBuffer::KisPlanarScratchBuffer(const KoColorSpace *colorSpace, int capacity)
+    : m_d(new Private)
+{
+    KIS_ASSERT(canRepresent(colorSpace));
+
+    m_d->colorSpace = colorSpace;
+    m_d->numPlanes = colorSpace->channelCount();
+
+    const KoChannelInfo::enumChannelValueType type =
+        colorSpace->channels().first()->channelValueType();
+
+    switch (type) {
+    case KoChannelInfo::UINT8:
+        selectKernels<quint8>(m_d->numPlanes, &m_d->deinterleave, &m_d->interleave);
+        break;
+    case KoChannelInfo::UINT16:
+        selectKernels<quint16>(m_d->numPlanes, &m_d->deinterleave, &m_d->interleave);
+        break;
+#ifdef HAVE_OPENEXR
+    case KoChannelInfo::FLOAT16:
+        m_d->isHalf = true;
+        selectKernels<float>(m_d->numPlanes, &m_d->deinterleave, &m_d->interleave);
+        break;
+#endif
+    case KoChannelInfo::FLOAT32:
+        selectKernels<float>(m_d->numPlanes, &m_d->deinterleave, &m_d->interleave);
+        break;
+    default:
+        KIS_ASSERT(0 && "unsupported channel type");
+    }
+
+    reserve(capacity);
+}
+
+KisPlanarScratchBuffer::~KisPlanarScratchBuffer()
+{
+}
+
+bool KisPlanarScratchBuffer::canRepresent(const KoColorSpace *colorSpace)
+{
+    const QList<KoChannelInfo*> channels = colorSpace->channels();
+    if (channels.isEmpty()) return false;
+
+    const KoChannelInfo::enumChannelValueType type = channels.first()->channelValueType();
+
+    if (type != KoChannelInfo::UINT8 &&
+        type != KoChannelInfo::UINT16 &&
+#ifdef HAVE_OPENEXR
+        type != KoChannelInfo::FLOAT16 &&
+#endif
+        type != KoChannelInfo::FLOAT32) {
+
+        return false;
+    }
+
+    const int channelSize = channels.first()->size();
+    QVector<bool> positionUsed(channels.size(), false);
+
+    Q_FOREACH (const KoChannelInfo *channel, channels) {
+        if (channel->channelValueType() != type ||
+            channel->size() != channelSize ||
+            channel->pos() % channelSize != 0) {
+
+            return false;
+        }
+
+        const int index = channel->pos() / channelSize;
+        if (index >= channels.size() || positionUsed[index]) {
+            return false;
+        }
+        positionUsed[index] = true;
+    }
+
+    return int(colorSpace->pixelSize()) == channels.size() * channelSize;
+}
+
+bool KisPlanarScratchBuffer::isPreferred(const KoColorSpace *colorSpace)
+{
+#ifdef HAVE_OPENEXR
+    return canRepresent(colorSpace) &&
+        colorSpace->channels().first()->channelValueType() == KoChannelInfo::FLOAT16;
+#else
+    Q_UNUSED(colorSpace);
+    return false;
+#endif
+}
+
+const KoColorSpace *KisPlanarScratchBuffer::colorSpace() const
+{
+    return m_d->colorSpace;
+}
+
+int KisPlanarScratchBuffer::numPlanes() const
+{
+    return m_d->numPlanes;
+}
+
+int KisPlanarScratchBuffer::capacity() const
+{
+    return m_d->capacity;
+}
+
+void KisPlanarScratchBuffer::reserve(int numPixels)
+{
+    if (numPixels <= m_d->capacity) return;
+
+    m_d->capacity = numPixels;
+    m_d->data.resize(m_d->numPlanes * numPixels);
+    m_d->planes.resize(m_d->numPlanes);
+
+    for (int i = 0; i < m_d->numPlanes; i++) {
+        m_d->planes[i] = m_d->data.data() + i * numPixels;
+    }
+
+    if (m_d->isHalf) {
+        m_d->halfConversionBuffer.resize(m_d->numPlanes * numPixels);
+    }
+}
+
+float *KisPlanarScratchBuffer::plane(int index)
+{
+    return m_d->planes[index];
+}
+
+const float *KisPlanarScratchBuffer::plane(int index) const
+{
+    return m_d->planes[index];
+}
+
+float * const *KisPlanarScratchBuffer::planes()
+{
+    return m_d->planes.constData();
+}
+
+void KisPlanarScratchBuffer::deinterleave(const quint8 *src, int numPixels)
+{
+    reserve(numPixels);
+
+#ifdef HAVE_OPENEXR
+    if (m_d->isHalf) {
+        float *buf = m_d->halfConversionBuffer.data();
+        KoHalfBatchConversion::instance()->toFloat(reinterpret_cast<const half*>(src), buf,
+                                                   numPixels * m_d->numPlanes);
+        src = reinterpret_cast<const quint8*>(buf);
+    }
+#endif
+
+    m_d->deinterleave(src, m_d->planes.constData(), m_d->numPlanes, numPixels);
+}
+
+void KisPlanarScratchBuffer::interleave(quint8 *dst, int numPixels) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(numPixels <= m_d->capacity);
+
+#ifdef HAVE_OPENEXR
+    if (m_d->isHalf) {
+        float *buf = m_d->halfConversionBuffer.data();
+        m_d->interleave(m_d->planes.constData(), reinterpret_cast<quint8*>(buf),
+                        m_d->numPlanes, numPixels);
+        KoHalfBatchConversion::instance()->fromFloat(buf, reinterpret_cast<half*>(dst),
+                                                     numPixels * m_d->numPlanes);
+        return;
+    }
+#endif
+
+    m_d->interleave(m_d->planes.constData(), dst, m_d->numPlanes, numPixels);
+}
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_PLANAR_SCRATCH_BUFFER_H
+#define __KIS_PLANAR_SCRATCH_BUFFER_H
+
+#include <QScopedPointer>
+#include "kritaimage_export.h"
+
+class KoColorSpace;
+
+/**
+ * A scratch buffer that keeps pixels in channel-planar form, that is,
+ * one contiguous float array per channel instead of interleaved pixels.
+ * Such layout lets per-pixel math be written as simple loops over
+ * contiguous memory, which the compiler can vectorize.
+ *
+ * The planes are ordered as the channels are stored in the pixel and
+ * keep the values as KoColorSpaceMaths<T, float>::scaleToA() produces
+ * them, i.e. integer channels are normalized into [0, 1] and floating
+ * point channels are stored as they are. That is the representation
+ * KoColorTransformation::transformPlanar() expects.
+ *
+ * Only color spaces with all the channels of the same type and stored
+ * without gaps can be represented, check canRepresent() before creating
+ * the buffer.
+ *
+ * The buffer is not shared between threads. Create one per worker and
+ * reuse it for all the chunks of pixels it processes.
+ */
+class KRITAIMAGE_EXPORT KisPlanarScratchBuffer
+{
+public:
+    KisPlanarScratchBuffer(const KoColorSpace *colorSpace, int capacity = 0);
+    ~KisPlanarScratchBuffer();
+
+    /**
+     * @return true if the pixels of \p colorSpace can be stored in
+     *         a planar scratch buffer
+     */
+    static bool canRepresent(const KoColorSpace *colorSpace);
+
+    /**
+     * @return true if a per-pixel transformation of \p colorSpace is
+     *         expected to run faster through the planar buffer than
+     *         on the interleaved pixels directly
+     *
+     * The transformations we have are scalar per-pixel math, so the
+     * planar layout by itself doesn't make them faster, it only adds
+     * two more passes over the pixels. The only case when it wins is
+     * half float, where the buffer converts the whole chunk with
+     * KoHalfBatchConversion instead of converting every channel
+     * separately. See KisPlanarTransformBenchmark.
+     */
+    static bool isPreferred(const KoColorSpace *colorSpace);
+
+    const KoColorSpace* colorSpace() const;
+
+    int numPlanes() const;
+
+    /**
+     * @return the number of pixels the buffer can hold without
+     *         reallocation
+     */
+    int capacity() const;
+
+    /**
+     * Grow the buffer to hold at least \p numPixels pixels. The
+     * content of the planes is not preserved.
+     */
+    void reserve(int numPixels);
+
+    float* plane(int index);
+    const float* plane(int index) const;
+
+    /**
+     * @return the array of numPlanes() plane pointers, suitable for
+     *         passing to KoColorTransformation::transformPlanar()
+     */
+    float * const * planes();
+
+    /**
+     * Unpack \p numPixels interleaved pixels from \p src into the
+     * planes. The buffer is grown if needed.
+     */
+    void deinterleave(const quint8 *src, int numPixels);
+
+    /**
+     * Pack \p numPixels pixels from the planes into \p dst. Integer
+     * channels are rounded and clamped into their range.
+     */
+    void interleave(quint8 *dst, int numPixels) const;
+
+private:
+    Q_DISABLE_COPY(KisPlanarScratchBuffer)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif /* __KIS_PLANAR_SCRATCH_BUFFER_H */
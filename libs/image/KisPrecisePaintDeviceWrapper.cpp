@@ -38,6 +38,10 @@ struct KisPrecisePaintDeviceWrapper::Private
     const KoColorSpace *precColorSpace = 0;
 
     int keepRectsHistory = 50;
+
+    QRegion requestedRegion(const QVector<QRect> &rects, const QRect &cropRect) const;
+    void fetchRegion(const QRegion &region) const;
+    void addPreparedRegion(const QRegion &requestedRects);
 };
 
 
@@ -167,56 +171,103 @@ struct ReadProcessor {
 
 }
 
-void KisPrecisePaintDeviceWrapper::readRects(const QVector<QRect> &rects)
+QRegion KisPrecisePaintDeviceWrapper::Private::requestedRegion(const QVector<QRect> &rects, const QRect &cropRect) const
 {
-    if (m_d->precDevice == m_d->srcDevice) return;
-
-    const QRect srcExtent = m_d->srcDevice->extent();
-
     QRegion requestedRects;
     Q_FOREACH (const QRect &rc, rects) {
-        if (m_d->srcDevice->defaultBounds()->wrapAroundMode()) {
-            const QRect wrapRect = m_d->srcDevice->defaultBounds()->bounds();
+        if (srcDevice->defaultBounds()->wrapAroundMode()) {
+            const QRect wrapRect = srcDevice->defaultBounds()->bounds();
             KisWrappedRect wrappedRect(rc, wrapRect);
             Q_FOREACH (const QRect &wrc, wrappedRect) {
-                const QRect croppedRect = wrc & srcExtent;
-
-                requestedRects += croppedRect;
+                requestedRects += cropRect.isValid() ? wrc & cropRect : wrc;
             }
         } else {
-            const QRect croppedRect = rc & srcExtent;
-
-            requestedRects += croppedRect;
+            requestedRects += cropRect.isValid() ? rc & cropRect : rc;
         }
     }
 
-    QRegion diff(requestedRects);
-    diff -= m_d->preparedRegion;
+    return requestedRects;
+}
 
-    if (rects.isEmpty()) return;
-    const QPoint firstPoint = rects.first().topLeft();
-    const int channelCount = m_d->precColorSpace->channelCount();
+void KisPrecisePaintDeviceWrapper::Private::fetchRegion(const QRegion &region) const
+{
+    if (region.isEmpty()) return;
 
-    KisRandomConstAccessorSP srcIt = m_d->srcDevice->createRandomConstAccessorNG(firstPoint.x(), firstPoint.y());
-    KisRandomAccessorSP dstIt = m_d->precDevice->createRandomAccessorNG(firstPoint.x(), firstPoint.y());
+    const QPoint firstPoint = region.boundingRect().topLeft();
+    const int channelCount = precColorSpace->channelCount();
 
-    Q_FOREACH (const QRect &rc, diff.rects()) {
+    KisRandomConstAccessorSP srcIt = srcDevice->createRandomConstAccessorNG(firstPoint.x(), firstPoint.y());
+    KisRandomAccessorSP dstIt = precDevice->createRandomAccessorNG(firstPoint.x(), firstPoint.y());
+
+    Q_FOREACH (const QRect &rc, region.rects()) {
         KritaUtils::processTwoDevices(rc,
                                       srcIt, dstIt,
-                                      m_d->srcDevice->pixelSize(),
-                                      m_d->precDevice->pixelSize(),
+                                      srcDevice->pixelSize(),
+                                      precDevice->pixelSize(),
                                       ReadProcessor(channelCount));
     }
+}
 
+void KisPrecisePaintDeviceWrapper::Private::addPreparedRegion(const QRegion &requestedRects)
+{
     /**
      * Don't let the region grow too much. When the region has too many
      * rects, it becomes really slow
      */
-    if (m_d->preparedRegion.rectCount() > m_d->keepRectsHistory) {
-        m_d->preparedRegion = requestedRects;
+    if (preparedRegion.rectCount() > keepRectsHistory) {
+        preparedRegion = requestedRects;
     } else {
-        m_d->preparedRegion += requestedRects;
+        preparedRegion += requestedRects;
+    }
+}
+
+void KisPrecisePaintDeviceWrapper::readRects(const QVector<QRect> &rects)
+{
+    if (m_d->precDevice == m_d->srcDevice) return;
+    if (rects.isEmpty()) return;
+
+    const QRegion requestedRects = m_d->requestedRegion(rects, m_d->srcDevice->extent());
+
+    QRegion diff(requestedRects);
+    diff -= m_d->preparedRegion;
+
+    m_d->fetchRegion(diff);
+    m_d->addPreparedRegion(requestedRects);
+}
+
+QVector<QRect> KisPrecisePaintDeviceWrapper::planReadRects(const QVector<QRect> &rects)
+{
+    if (m_d->precDevice == m_d->srcDevice) return QVector<QRect>();
+    if (rects.isEmpty()) return QVector<QRect>();
+
+    const QRegion requestedRects = m_d->requestedRegion(rects, QRect());
+
+    QRegion diff(requestedRects);
+    diff -= m_d->preparedRegion;
+
+    m_d->addPreparedRegion(requestedRects);
+
+    return diff.rects();
+}
+
+void KisPrecisePaintDeviceWrapper::fetchRects(const QVector<QRect> &rects) const
+{
+    if (m_d->precDevice == m_d->srcDevice) return;
+
+    /**
+     * The areas outside the extent of the source device contain the default
+     * pixel in both devices, so cropping doesn't change the result. It is
+     * safe even when the extent is changed concurrently by writes into
+     * other areas.
+     */
+    const QRect srcExtent = m_d->srcDevice->extent();
+
+    QRegion region;
+    Q_FOREACH (const QRect &rc, rects) {
+        region += rc & srcExtent;
     }
+
+    m_d->fetchRegion(region);
 }
 
 void KisPrecisePaintDeviceWrapper::writeRects(const QVector<QRect> &rects)
@@ -147,6 +147,28 @@ public:
      */
     void writeRects(const QVector<QRect> &rects);
 
+    /**
+     * Split readRects() into two parts: planning and fetching. The function
+     * calculates which parts of \p rects are not cached yet, marks them as
+     * cached and returns them. The data is not read until the returned rects
+     * are passed to fetchRects().
+     *
+     * In contrast to readRects(), the plan doesn't depend on the extent of the
+     * source device, so the sequence of plans is the same no matter how the
+     * fetches are ordered in time. It lets a paintop plan the reads of its
+     * dabs sequentially, but perform them in background threads.
+     */
+    QVector<QRect> planReadRects(const QVector<QRect> &rects);
+
+    /**
+     * Read \p rects from the source device into the precise device without
+     * any caching. It is safe to call this function from multiple threads as
+     * long as the rects of the concurrent calls don't intersect.
+     *
+     * \see planReadRects()
+     */
+    void fetchRects(const QVector<QRect> &rects) const;
+
 private:
     struct Private;
     const QScopedPointer<Private> m_d;
@@ -0,0 +1,282 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisQuantizationUtils.h"
+
+#include <QImage>
+#include <QSet>
+#include <QRect>
+
+#include <algorithm>
+
+#include "KisNearestColorIndex.h"
+#include "krita_utils.h"
+#include "kis_assert.h"
+
+
+namespace {
+
+inline KisNearestColorIndex::Color toIndexColor(QRgb rgb)
+{
+    return {{quint16(qRed(rgb)), quint16(qGreen(rgb)), quint16(qBlue(rgb))}};
+}
+
+/**
+ * An occupied cell of the 5-bit per channel histogram
+ */
+struct HistogramBin
+{
+    std::array<quint8, 3> position;
+    quint32 count = 0;
+    std::array<quint64, 3> sum = {{0, 0, 0}};
+};
+
+struct Box
+{
+    int begin;
+    int end;
+    quint64 count;
+};
+
+QVector<QRgb> medianCut(const QImage &image, int maxColors)
+{
+    const int histogramSize = 1 << 15;
+    QVector<HistogramBin> histogram(histogramSize);
+
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *src = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+
+        for (int x = 0; x < image.width(); x++) {
+            const QRgb rgb = src[x];
+            const int r = qRed(rgb) >> 3;
+            const int g = qGreen(rgb) >> 3;
+            const int b = qBlue(rgb) >> 3;
+
+            HistogramBin &bin = histogram[(r << 10) | (g << 5) | b];
+            bin.position = {{quint8(r), quint8(g), quint8(b)}};
+            bin.count++;
+            bin.sum[0] += qRed(rgb);
+            bin.sum[1] += qGreen(rgb);
+            bin.sum[2] += qBlue(rgb);
+        }
+    }
+
+    QVector<HistogramBin> bins;
+    Q_FOREACH (const HistogramBin &bin, histogram) {
+        if (bin.count) {
+            bins.append(bin);
+        }
+    }
+
+    QVector<Box> boxes;
+    boxes.append({0, bins.size(), quint64(image.width()) * image.height()});
+
+    while (boxes.size() < maxColors) {
+        // split the most populated box which still has more than one bin
+        int boxIndex = -1;
+        for (int i = 0; i < boxes.size(); i++) {
+            if (boxes[i].end - boxes[i].begin > 1 &&
+                (boxIndex < 0 || boxes[i].count > boxes[boxIndex].count)) {
+
+                boxIndex = i;
+            }
+        }
+        if (boxIndex < 0) break;
+
+        Box box = boxes[boxIndex];
+
+        std::array<int, 3> minPos = {{31, 31, 31}};
+        std::array<int, 3> maxPos = {{0, 0, 0}};
+        for (int i = box.begin; i < box.end; i++) {
+            for (int c = 0; c < 3; c++) {
+                minPos[c] = qMin(minPos[c], int(bins[i].position[c]));
+                maxPos[c] = qMax(maxPos[c], int(bins[i].position[c]));
+            }
+        }
+
+        int axis = 0;
+        for (int c = 1; c < 3; c++) {
+            if (maxPos[c] - minPos[c] > maxPos[axis] - minPos[axis]) {
+                axis = c;
+            }
+        }
+
+        std::sort(bins.begin() + box.begin, bins.begin() + box.end,
+                  [axis] (const HistogramBin &lhs, const HistogramBin &rhs) {
+                      return lhs.position[axis] < rhs.position[axis];
+                  });
+
+        // both halves must get at least one bin
+        int split = box.begin + 1;
+        quint64 lowerCount = bins[box.begin].count;
+        while (split < box.end - 1 && 2 * lowerCount < box.count) {
+            lowerCount += bins[split].count;
+            split++;
+        }
+
+        boxes[boxIndex] = {box.begin, split, lowerCount};
+        boxes.append({split, box.end, box.count - lowerCount});
+    }
+
+    QVector<QRgb> palette;
+    Q_FOREACH (const Box &box, boxes) {
+        std::array<quint64, 3> sum = {{0, 0, 0}};
+
+        for (int i = box.begin; i < box.end; i++) {
+            for (int c = 0; c < 3; c++) {
+                sum[c] += bins[i].sum[c];
+            }
+        }
+
+        if (!box.count) continue;
+
+        palette.append(qRgb((sum[0] + box.count / 2) / box.count,
+                            (sum[1] + box.count / 2) / box.count,
+                            (sum[2] + box.count / 2) / box.count));
+    }
+
+    return palette;
+}
+
+}
+
+namespace KisQuantizationUtils
+{
+
+QVector<QRgb> generatePalette(const QImage &_image, int maxColors)
+{
+    const QImage image = _image.convertToFormat(QImage::Format_RGB32);
+
+    QSet<QRgb> distinctColors;
+    QVector<QRgb> palette;
+
+    for (int y = 0; y < image.height() && palette.size() <= maxColors; y++) {
+        const QRgb *src = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+
+        for (int x = 0; x < image.width() && palette.size() <= maxColors; x++) {
+            const QRgb rgb = qRgb(qRed(src[x]), qGreen(src[x]), qBlue(src[x]));
+
+            if (!distinctColors.contains(rgb)) {
+                distinctColors.insert(rgb);
+                palette.append(rgb);
+            }
+        }
+    }
+
+    if (palette.size() <= maxColors) {
+        return palette;
+    }
+
+    return medianCut(image, maxColors);
+}
+
+QImage convertToIndexed8(const QImage &_image, const QVector<QRgb> &palette, bool errorDiffusion)
+{
+    KIS_ASSERT_RECOVER(!palette.isEmpty() && palette.size() <= 256) { return QImage(); }
+
+    const QImage image = _image.convertToFormat(QImage::Format_RGB32);
+
+    QImage result(image.size(), QImage::Format_Indexed8);
+    result.setColorTable(palette);
+
+    QVector<KisNearestColorIndex::Color> colors;
+    Q_FOREACH (QRgb rgb, palette) {
+        colors.append(toIndexColor(rgb));
+    }
+
+    const KisNearestColorIndex index(colors);
+    KisNearestColorIndex::Cache cache;
+
+    const int width = image.width();
+
+    if (!errorDiffusion) {
+        // the cache is thread-safe, so the rows may go in parallel
+        uchar *resultBits = result.bits();
+        const int resultBytesPerLine = result.bytesPerLine();
+
+        QVector<QRect> bands;
+        for (int y = 0; y < image.height(); y += 64) {
+            bands.append(QRect(0, y, width, qMin(64, image.height() - y)));
+        }
+
+        KritaUtils::processRectsInParallel(bands,
+            [&] (const QRect &band) {
+                for (int y = band.top(); y <= band.bottom(); y++) {
+                    const QRgb *src = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+                    uchar *dst = resultBits + y * resultBytesPerLine;
+
+                    for (int x = 0; x < width; x++) {
+                        dst[x] = uchar(index.nearestIndex(toIndexColor(src[x]), &cache));
+                    }
+                }
+            });
+
+        return result;
+    }
+
+    /**
+     * Floyd-Steinberg error diffusion. The errors are kept in
+     * 1/16 units, so that the weights 7, 3, 5 and 1 stay integer.
+     * The buffers have one extra pixel on every side.
+     */
+    QVector<int> currentErrors((width + 2) * 3, 0);
+    QVector<int> nextErrors((width + 2) * 3, 0);
+
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *src = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        uchar *dst = result.scanLine(y);
+
+        std::fill(nextErrors.begin(), nextErrors.end(), 0);
+
+        for (int x = 0; x < width; x++) {
+            const int *error = currentErrors.constData() + (x + 1) * 3;
+
+            const std::array<int, 3> value = {{
+                qBound(0, qRed(src[x]) + error[0] / 16, 255),
+                qBound(0, qGreen(src[x]) + error[1] / 16, 255),
+                qBound(0, qBlue(src[x]) + error[2] / 16, 255)
+            }};
+
+            const int i = index.nearestIndex({{quint16(value[0]), quint16(value[1]), quint16(value[2])}}, &cache);
+            dst[x] = uchar(i);
+
+            const QRgb chosen = palette[i];
+            const std::array<int, 3> diff = {{
+                value[0] - qRed(chosen),
+                value[1] - qGreen(chosen),
+                value[2] - qBlue(chosen)
+            }};
+
+            int *right = currentErrors.data() + (x + 2) * 3;
+            int *below = nextErrors.data() + (x + 1) * 3;
+
+            for (int c = 0; c < 3; c++) {
+                right[c] += diff[c] * 7;
+                below[c - 3] += diff[c] * 3;
+                below[c] += diff[c] * 5;
+                below[c + 3] += diff[c];
+            }
+        }
+
+        std::swap(currentErrors, nextErrors);
+    }
+
+    return result;
+}
+
+}
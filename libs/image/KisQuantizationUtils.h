@@ -0,0 +1,56 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KIS_QUANTIZATION_UTILS_H
+#define __KIS_QUANTIZATION_UTILS_H
+
+#include "kritaimage_export.h"
+
+#include <QVector>
+#include <QRgb>
+
+class QImage;
+
+/**
+ * Conversion of RGB images into indexed ones, e.g. for the file formats
+ * that support palettes only. The colors are mapped to the palette with
+ * KisNearestColorIndex, so even big images and palettes are fast.
+ */
+namespace KisQuantizationUtils
+{
+    /**
+     * Generates a palette of at most \p maxColors opaque colors for \p image.
+     * When the image has few enough distinct colors, all of them are
+     * returned as they are. Otherwise the palette is built with the median
+     * cut algorithm over a 15-bit color histogram of the image.
+     */
+    KRITAIMAGE_EXPORT QVector<QRgb> generatePalette(const QImage &image, int maxColors = 256);
+
+    /**
+     * Converts \p image into QImage::Format_Indexed8 with \p palette as its
+     * color table. Every pixel gets the nearest palette color. With
+     * \p errorDiffusion the quantization error is spread to the neighbour
+     * pixels with the Floyd-Steinberg weights, which hides the banding of
+     * small palettes. The alpha channel is ignored.
+     */
+    KRITAIMAGE_EXPORT QImage convertToIndexed8(const QImage &image,
+                                                const QVector<QRgb> &palette,
+                                                bool errorDiffusion);
+}
+
+#endif /* __KIS_QUANTIZATION_UTILS_H */
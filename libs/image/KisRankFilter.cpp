@@ -0,0 +1,412 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "KisRankFilter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QBitArray>
+#include <QRect>
+#include <QVector>
+
+#include <KoColorSpace.h>
+#include <KoChannelInfo.h>
+
+#include "kis_assert.h"
+#include "kis_global.h"
+#include "kis_paint_device.h"
+#include "krita_utils.h"
+
+
+namespace {
+
+/**
+ * The 8-bit version uses Perreault-Hebert algorithm. The source plane
+ * has \p radius pixels of halo on every side.
+ */
+void filterPlane(const quint8 *src, int srcWidth,
+                 quint8 *dst, int width, int height,
+                 int radius, int rankIndex)
+{
+    const int numBins = 256;
+    const int diameter = 2 * radius + 1;
+
+    QVector<quint16> columns(srcWidth * numBins, 0);
+    QVector<int> kernel(numBins);
+
+    quint16 *columnsData = columns.data();
+    int *kernelData = kernel.data();
+
+    for (int y = 0; y < diameter - 1; y++) {
+        const quint8 *row = src + y * srcWidth;
+
+        for (int x = 0; x < srcWidth; x++) {
+            columnsData[x * numBins + row[x]]++;
+        }
+    }
+
+    for (int y = 0; y < height; y++) {
+        // slide the column histograms one row down
+        const quint8 *bottomRow = src + (y + diameter - 1) * srcWidth;
+        for (int x = 0; x < srcWidth; x++) {
+            columnsData[x * numBins + bottomRow[x]]++;
+        }
+
+        if (y > 0) {
+            const quint8 *topRow = src + (y - 1) * srcWidth;
+            for (int x = 0; x < srcWidth; x++) {
+                columnsData[x * numBins + topRow[x]]--;
+            }
+        }
+
+        std::fill(kernelData, kernelData + numBins, 0);
+
+        for (int x = 0; x < diameter; x++) {
+            const quint16 *column = columnsData + x * numBins;
+            for (int i = 0; i < numBins; i++) {
+                kernelData[i] += column[i];
+            }
+        }
+
+        quint8 *dstRow = dst + y * width;
+
+        for (int x = 0; x < width; x++) {
+            if (x > 0) {
+                const quint16 *addedColumn = columnsData + (x + diameter - 1) * numBins;
+                const quint16 *removedColumn = columnsData + (x - 1) * numBins;
+
+                for (int i = 0; i < numBins; i++) {
+                    kernelData[i] += int(addedColumn[i]) - int(removedColumn[i]);
+                }
+            }
+
+            int sum = 0;
+            int bin = 0;
+            for (; bin < numBins - 1; bin++) {
+                sum += kernelData[bin];
+                if (sum > rankIndex) break;
+            }
+
+            dstRow[x] = bin;
+        }
+    }
+}
+
+/**
+ * The 16-bit version uses a two-level histogram of the window: the rank
+ * is first looked up in the coarse histogram of the high bytes and then
+ * in the part of the fine histogram that belongs to the found coarse bin.
+ */
+void filterPlane(const quint16 *src, int srcWidth,
+                 quint16 *dst, int width, int height,
+                 int radius, int rankIndex)
+{
+    const int diameter = 2 * radius + 1;
+
+    QVector<int> coarse(256, 0);
+    QVector<int> fine(65536, 0);
+
+    int *coarseData = coarse.data();
+    int *fineData = fine.data();
+
+    auto addColumn = [&] (const quint16 *column) {
+        for (int i = 0; i < diameter; i++) {
+            const quint16 value = column[i * srcWidth];
+            coarseData[value >> 8]++;
+            fineData[value]++;
+        }
+    };
+
+    auto removeColumn = [&] (const quint16 *column) {
+        for (int i = 0; i < diameter; i++) {
+            const quint16 value = column[i * srcWidth];
+            coarseData[value >> 8]--;
+            fineData[value]--;
+        }
+    };
+
+    for (int y = 0; y < height; y++) {
+        const quint16 *window = src + y * srcWidth;
+
+        for (int x = 0; x < diameter; x++) {
+            addColumn(window + x);
+        }
+
+        quint16 *dstRow = dst + y * width;
+
+        for (int x = 0; x < width; x++) {
+            if (x > 0) {
+                removeColumn(window + x - 1);
+                addColumn(window + x + diameter - 1);
+            }
+
+            int sum = 0;
+            int coarseBin = 0;
+            for (; coarseBin < 255; coarseBin++) {
+                if (sum + coarseData[coarseBin] > rankIndex) break;
+                sum += coarseData[coarseBin];
+            }
+
+            const int *fineBins = fineData + (coarseBin << 8);
+            int fineBin = 0;
+            for (; fineBin < 255; fineBin++) {
+                sum += fineBins[fineBin];
+                if (sum > rankIndex) break;
+            }
+
+            dstRow[x] = (coarseBin << 8) | fineBin;
+        }
+
+        // empty the histograms for the next row
+        for (int x = width - 1; x < width - 1 + diameter; x++) {
+            removeColumn(window + x);
+        }
+    }
+}
+
+/**
+ * 32- and 64-bit keys are too wide for a histogram, so the window of
+ * every pixel is gathered and the rank is selected by std::nth_element.
+ * The cost grows with the square of the radius, but the result is exact.
+ */
+template <typename T>
+void filterPlane(const T *src, int srcWidth,
+                 T *dst, int width, int height,
+                 int radius, int rankIndex)
+{
+    const int diameter = 2 * radius + 1;
+    QVector<T> window(diameter * diameter);
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            T *windowPtr = window.data();
+
+            for (int wy = 0; wy < diameter; wy++) {
+                const T *srcRow = src + (y + wy) * srcWidth + x;
+                windowPtr = std::copy(srcRow, srcRow + diameter, windowPtr);
+            }
+
+            std::nth_element(window.begin(), window.begin() + rankIndex, window.end());
+            dst[y * width + x] = window[rankIndex];
+        }
+    }
+}
+
+/**
+ * Floating point values are ranked by their bit patterns turned into
+ * order-preserving unsigned keys: the sign bit of a positive value is
+ * set, all the bits of a negative value are inverted. The keys compare
+ * exactly as the values do, so the filter is exact for any value,
+ * including HDR values above 1.0 and the negative ones, and the pixels
+ * that the rank doesn't change keep their bit patterns.
+ */
+template <typename T, bool isFloat>
+struct RankKey
+{
+    static inline T fromBits(T bits) {
+        return bits;
+    }
+
+    static inline T toBits(T key) {
+        return key;
+    }
+};
+
+template <typename T>
+struct RankKey<T, true>
+{
+    static const T signBit = T(T(1) << (sizeof(T) * 8 - 1));
+
+    static inline T fromBits(T bits) {
+        return bits & signBit ? T(~bits) : T(bits | signBit);
+    }
+
+    static inline T toBits(T key) {
+        return key & signBit ? T(key & ~signBit) : T(~key);
+    }
+};
+
+/**
+ * Filters the channel at \p pos of the patch \p dstRect. \p srcData
+ * contains the pixels of \p readRect, the pixels of the halo that fall
+ * outside it are clamped to its border.
+ */
+template <typename T, bool isFloat>
+void filterChannel(const quint8 *srcData, const QRect &readRect,
+                   quint8 *dstData, const QRect &dstRect,
+                   int pixelSize, int pos,
+                   int radius, int rankIndex)
+{
+    const QRect srcRect = dstRect.adjusted(-radius, -radius, radius, radius);
+
+    QVector<T> plane(srcRect.width() * srcRect.height());
+    T *planePtr = plane.data();
+
+    for (int y = srcRect.top(); y <= srcRect.bottom(); y++) {
+        const int readY = qBound(readRect.top(), y, readRect.bottom()) - readRect.top();
+        const quint8 *readRow = srcData + readY * readRect.width() * pixelSize + pos;
+
+        for (int x = srcRect.left(); x <= srcRect.right(); x++) {
+            const int readX = qBound(readRect.left(), x, readRect.right()) - readRect.left();
+            *planePtr++ = RankKey<T, isFloat>::fromBits(*reinterpret_cast<const T*>(readRow + readX * pixelSize));
+        }
+    }
+
+    QVector<T> result(dstRect.width() * dstRect.height());
+    filterPlane(plane.constData(), srcRect.width(),
+                result.data(), dstRect.width(), dstRect.height(),
+                radius, rankIndex);
+
+    const T *resultPtr = result.constData();
+    quint8 *dstPtr = dstData + pos;
+
+    for (int i = 0; i < result.size(); i++) {
+        *reinterpret_cast<T*>(dstPtr) = RankKey<T, isFloat>::toBits(*resultPtr++);
+        dstPtr += pixelSize;
+    }
+}
+
+struct ChannelDescription
+{
+    int pos;
+    KoChannelInfo::enumChannelValueType type;
+};
+
+void filterChannel(const ChannelDescription &channel,
+                   const quint8 *srcData, const QRect &readRect,
+                   quint8 *dstData, const QRect &dstRect,
+                   int pixelSize, int radius, int rankIndex)
+{
+    switch (channel.type) {
+    case KoChannelInfo::UINT8:
+        filterChannel<quint8, false>(srcData, readRect, dstData, dstRect, pixelSize, channel.pos, radius, rankIndex);
+        break;
+    case KoChannelInfo::UINT16:
+        filterChannel<quint16, false>(srcData, readRect, dstData, dstRect, pixelSize, channel.pos, radius, rankIndex);
+        break;
+    case KoChannelInfo::UINT32:
+        filterChannel<quint32, false>(srcData, readRect, dstData, dstRect, pixelSize, channel.pos, radius, rankIndex);
+        break;
+    case KoChannelInfo::FLOAT16:
+        filterChannel<quint16, true>(srcData, readRect, dstData, dstRect, pixelSize, channel.pos, radius, rankIndex);
+        break;
+    case KoChannelInfo::FLOAT32:
+        filterChannel<quint32, true>(srcData, readRect, dstData, dstRect, pixelSize, channel.pos, radius, rankIndex);
+        break;
+    case KoChannelInfo::FLOAT64:
+        filterChannel<quint64, true>(srcData, readRect, dstData, dstRect, pixelSize, channel.pos, radius, rankIndex);
+        break;
+    default:
+        KIS_SAFE_ASSERT_RECOVER_NOOP(0 && "unsupported channel type");
+    }
+}
+
+}
+
+void KisRankFilter::apply(KisPaintDeviceSP src,
+                          KisPaintDeviceSP dst,
+                          const QRect &rect,
+                          int radius, qreal percentile,
+                          const QBitArray &channelFlags,
+                          KoUpdater *progressUpdater)
+{
+    if (rect.isEmpty()) return;
+
+    const KoColorSpace *cs = src->colorSpace();
+    KIS_SAFE_ASSERT_RECOVER_RETURN(supportsColorSpace(cs));
+    KIS_SAFE_ASSERT_RECOVER_RETURN(*cs == *dst->colorSpace());
+
+    const QRect dataRect = rect | src->exactBounds();
+
+    if (src == dst) {
+        /**
+         * The patches read the halo around them, which is overwritten
+         * by the neighbouring patches. The copy shares the tiles with
+         * the original device, so it is cheap.
+         */
+        src = new KisPaintDevice(*src);
+    }
+
+    radius = qMax(0, radius);
+    const int windowSize = pow2(2 * radius + 1);
+    const int rankIndex = qBound(0, qRound(percentile / 100.0 * (windowSize - 1)), windowSize - 1);
+
+    QVector<ChannelDescription> channels;
+    const QList<KoChannelInfo*> channelInfos = cs->channels();
+
+    for (int i = 0; i < channelInfos.size(); i++) {
+        if (channelFlags.isEmpty() || channelFlags.testBit(i)) {
+            channels.append({channelInfos[i]->pos(),
+                             channelInfos[i]->channelValueType()});
+        }
+    }
+
+    const int pixelSize = cs->pixelSize();
+    const QVector<QRect> patches = KritaUtils::splitRectIntoPatches(rect, KritaUtils::optimalPatchSize());
+
+    KritaUtils::processRectsInParallel(patches,
+        [&] (const QRect &patch) {
+            const QRect readRect = patch.adjusted(-radius, -radius, radius, radius) & dataRect;
+
+            QVector<quint8> srcData(readRect.width() * readRect.height() * pixelSize);
+            src->readBytes(srcData.data(), readRect);
+
+            QVector<quint8> dstData(patch.width() * patch.height() * pixelSize);
+
+            // keep the channels that are not filtered intact
+            for (int y = 0; y < patch.height(); y++) {
+                const int readOffset =
+                    ((patch.y() - readRect.y() + y) * readRect.width() + patch.x() - readRect.x()) * pixelSize;
+
+                memcpy(dstData.data() + y * patch.width() * pixelSize,
+                       srcData.constData() + readOffset,
+                       patch.width() * pixelSize);
+            }
+
+            Q_FOREACH (const ChannelDescription &channel, channels) {
+                filterChannel(channel, srcData.constData(), readRect,
+                              dstData.data(), patch,
+                              pixelSize, radius, rankIndex);
+            }
+
+            dst->writeBytes(dstData.constData(), patch);
+        },
+        progressUpdater);
+}
+
+bool KisRankFilter::supportsColorSpace(const KoColorSpace *cs)
+{
+    Q_FOREACH (KoChannelInfo *channel, cs->channels()) {
+        switch (channel->channelValueType()) {
+        case KoChannelInfo::UINT8:
+        case KoChannelInfo::UINT16:
+        case KoChannelInfo::UINT32:
+        case KoChannelInfo::FLOAT16:
+        case KoChannelInfo::FLOAT32:
+        case KoChannelInfo::FLOAT64:
+            break;
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,81 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+
+#ifndef __KIS_RANK_FILTER_H
+#define __KIS_RANK_FILTER_H
+
+#include "kritaimage_export.h"
+#include "kis_types.h"
+
+class QRect;
+class QBitArray;
+class KoColorSpace;
+class KoUpdater;
+
+/**
+ * A rank filter engine: every channel of every pixel is replaced with
+ * the value of the given percentile of the same channel in the square
+ * (2 * radius + 1) x (2 * radius + 1) neighbourhood of the pixel. The
+ * 50th percentile gives the median filter, 0th and 100th ones give the
+ * minimum and the maximum filters.
+ *
+ * The neighbourhood is never sorted. 8-bit channels use the constant-time
+ * algorithm by Perreault and Hebert ("Median Filtering in Constant Time",
+ * IEEE Transactions on Image Processing 16(9), 2007): every column keeps
+ * a histogram of its part of the window, and moving the window to the
+ * right adds one column histogram and subtracts another one, regardless
+ * of the radius. 16-bit channels would need too much memory for the
+ * column histograms, so they use a two-level (coarse/fine) sliding
+ * histogram by Huang, whose cost grows linearly with the radius.
+ * Floating point channels are ranked by order-preserving integer keys
+ * of their bit patterns, so half floats share the 16-bit code and wider
+ * types select the rank from the gathered window, which is exact for
+ * HDR values, but costs O(radius^2) per pixel.
+ *
+ * The pixels outside rect | exactBounds() of the source device are
+ * considered to be equal to the nearest pixel inside, the same what
+ * BORDER_REPEAT mode of KisConvolutionPainter does.
+ *
+ * The area is split into patches, which are read with the halo of
+ * the radius and processed concurrently.
+ */
+class KRITAIMAGE_EXPORT KisRankFilter
+{
+public:
+    /**
+     * Filters \p rect of \p src and writes the result into \p dst.
+     * The devices may coincide. The channels disabled in \p channelFlags
+     * are copied from the source intact.
+     */
+    static void apply(KisPaintDeviceSP src,
+                      KisPaintDeviceSP dst,
+                      const QRect &rect,
+                      int radius, qreal percentile,
+                      const QBitArray &channelFlags,
+                      KoUpdater *progressUpdater);
+
+    /**
+     * \return true if all the channels of \p cs are unsigned integers
+     * or floating point values
+     */
+    static bool supportsColorSpace(const KoColorSpace *cs);
+};
+
+#endif /* __KIS_RANK_FILTER_H */
@@ -0,0 +1,422 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisRecursiveGaussianBlur.h"
+
+#include <cmath>
+
+#include <QBitArray>
+#include <QRect>
+#include <QVector>
+
+#include <KoColorSpace.h>
+#include <KoChannelInfo.h>
+#include <KoUpdater.h>
+
+#include "kis_paint_device.h"
+#include "kis_gaussian_kernel.h"
+#include "kis_math_toolbox.h"
+#include "krita_utils.h"
+
+
+namespace {
+
+struct RecursiveCoefficients
+{
+    double B;
+    double b1;
+    double b2;
+    double b3;
+};
+
+RecursiveCoefficients calculateCoefficients(qreal sigma)
+{
+    // the approximation is valid for sigma >= 0.5 only
+    sigma = qMax(sigma, 0.5);
+
+    const double q =
+        sigma >= 2.5 ?
+        0.98711 * sigma - 0.96330 :
+        3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+
+    const double q2 = q * q;
+    const double q3 = q2 * q;
+
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    const double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    const double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    const double b3 = 0.422205 * q3;
+
+    RecursiveCoefficients c;
+    c.b1 = b1 / b0;
+    c.b2 = b2 / b0;
+    c.b3 = b3 / b0;
+    c.B = 1.0 - (c.b1 + c.b2 + c.b3);
+
+    return c;
+}
+
+/**
+ * Filters a contiguous line of samples in place. The samples before the
+ * beginning and after the end of the line are considered to be equal to
+ * the first and the last sample correspondingly, which is the steady
+ * state of the filter, so the edges are extended infinitely.
+ */
+void filterLine(double *data, int size, const RecursiveCoefficients &c)
+{
+    double w1 = data[0];
+    double w2 = w1;
+    double w3 = w1;
+
+    for (int i = 0; i < size; i++) {
+        const double w = c.B * data[i] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        data[i] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    w1 = data[size - 1];
+    w2 = w1;
+    w3 = w1;
+
+    for (int i = size - 1; i >= 0; i--) {
+        const double w = c.B * data[i] + c.b1 * w1 + c.b2 * w2 + c.b3 * w3;
+        data[i] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+}
+
+/**
+ * Filters all the columns of a row-major block of samples in place. The
+ * recursion runs over the rows, and the inner loop goes over the
+ * contiguous columns of a row, so it can be vectorized by the compiler.
+ *
+ * The edges are handled the same way as in filterLine(): the rows
+ * outside the block are clamped to the first or the last row.
+ */
+void filterColumns(double *data, int rows, int columns, const RecursiveCoefficients &c)
+{
+    for (int i = 0; i < rows; i++) {
+        double *row = data + i * columns;
+        const double *p1 = data + qMax(i - 1, 0) * columns;
+        const double *p2 = data + qMax(i - 2, 0) * columns;
+        const double *p3 = data + qMax(i - 3, 0) * columns;
+
+        for (int j = 0; j < columns; j++) {
+            row[j] = c.B * row[j] + c.b1 * p1[j] + c.b2 * p2[j] + c.b3 * p3[j];
+        }
+    }
+
+    for (int i = rows - 1; i >= 0; i--) {
+        double *row = data + i * columns;
+        const double *p1 = data + qMin(i + 1, rows - 1) * columns;
+        const double *p2 = data + qMin(i + 2, rows - 1) * columns;
+        const double *p3 = data + qMin(i + 3, rows - 1) * columns;
+
+        for (int j = 0; j < columns; j++) {
+            row[j] = c.B * row[j] + c.b1 * p1[j] + c.b2 * p2[j] + c.b3 * p3[j];
+        }
+    }
+}
+
+/**
+ * Converts interleaved pixels into channel-planar samples premultiplied
+ * by alpha and back. The conversion is the same as the one of the
+ * spatial convolution worker, including handling of the channel flags.
+ */
+class ChannelsConverter
+{
+public:
+    ChannelsConverter(const KoColorSpace *cs, const QBitArray &channelFlags)
+        : m_pixelSize(cs->pixelSize())
+    {
+        const QList<KoChannelInfo *> channels = cs->channels();
+
+        for (int i = 0; i < channels.size(); i++) {
+            if (channelFlags.isEmpty() || channelFlags.testBit(i)) {
+                m_channels.append(channels[i]);
+            }
+        }
+
+        for (int i = 0; i < m_channels.size(); i++) {
+            if (m_channels[i]->channelType() == KoChannelInfo::ALPHA) {
+                m_alphaIndex = i;
+            }
+        }
+
+        KisMathToolbox mathToolbox;
+        m_toDouble.resize(m_channels.size());
+        m_fromDouble.resize(m_channels.size());
+
+        m_isValid =
+            !m_channels.isEmpty() &&
+            mathToolbox.getToDoubleChannelPtr(m_channels, m_toDouble) &&
+            mathToolbox.getFromDoubleChannelPtr(m_channels, m_fromDouble);
+
+        Q_FOREACH (KoChannelInfo *channel, m_channels) {
+            m_minValue.append(mathToolbox.minChannelValue(channel));
+            m_maxValue.append(mathToolbox.maxChannelValue(channel));
+        }
+    }
+
+    bool isValid() const {
+        return m_isValid;
+    }
+
+    int numChannels() const {
+        return m_channels.size();
+    }
+
+    void load(const quint8 *pixels, int numPixels, double * const *planes) const {
+        const int numChannels = m_channels.size();
+
+        for (int i = 0; i < numPixels; i++) {
+            const double alpha = m_alphaIndex >= 0 ?
+                m_toDouble[m_alphaIndex](pixels, m_channels[m_alphaIndex]->pos()) : 1.0;
+
+            for (int k = 0; k < numChannels; k++) {
+                planes[k][i] = k == m_alphaIndex ? alpha :
+                    m_toDouble[k](pixels, m_channels[k]->pos()) * alpha;
+            }
+
+            pixels += m_pixelSize;
+        }
+    }
+
+    void store(const double * const *planes, int offset, quint8 *pixels, int numPixels) const {
+        const int numChannels = m_channels.size();
+
+        for (int i = offset; i < offset + numPixels; i++) {
+            if (m_alphaIndex >= 0) {
+                const double alpha = storeChannel(pixels, m_alphaIndex, planes[m_alphaIndex][i]);
+                const double alphaInv = alpha != 0.0 ? 1.0 / alpha : 0.0;
+
+                for (int k = 0; k < numChannels; k++) {
+                    if (k == m_alphaIndex) continue;
+                    storeChannel(pixels, k, planes[k][i] * alphaInv);
+                }
+            } else {
+                for (int k = 0; k < numChannels; k++) {
+                    storeChannel(pixels, k, planes[k][i]);
+                }
+            }
+
+            pixels += m_pixelSize;
+        }
+    }
+
+private:
+    inline double storeChannel(quint8 *pixel, int channel, double value) const {
+        if (value > m_maxValue[channel]) {
+            value = m_maxValue[channel];
+        } else if (!(value >= m_minValue[channel])) { // catches NaN as well
+            value = m_minValue[channel];
+        }
+
+        m_fromDouble[channel](pixel, m_channels[channel]->pos(), value);
+        return value;
+    }
+
+private:
+    int m_pixelSize;
+    QList<KoChannelInfo *> m_channels;
+    int m_alphaIndex = -1;
+    bool m_isValid = false;
+    QVector<PtrToDouble> m_toDouble;
+    QVector<PtrFromDouble> m_fromDouble;
+    QVector<double> m_minValue;
+    QVector<double> m_maxValue;
+};
+
+/**
+ * Reads \p rc from \p device. The pixels outside \p dataRect are replaced
+ * with the nearest pixel on the border of \p dataRect, which is the same
+ * what BORDER_REPEAT mode of KisConvolutionPainter does.
+ */
+void readBytesRepeated(KisPaintDeviceSP device, quint8 *data, const QRect &rc, const QRect &dataRect)
+{
+    if (dataRect.contains(rc)) {
+        device->readBytes(data, rc);
+        return;
+    }
+
+    const int pixelSize = device->pixelSize();
+
+    const QRect clampedRect(QPoint(qBound(dataRect.left(), rc.left(), dataRect.right()),
+                                   qBound(dataRect.top(), rc.top(), dataRect.bottom())),
+                            QPoint(qBound(dataRect.left(), rc.right(), dataRect.right()),
+                                   qBound(dataRect.top(), rc.bottom(), dataRect.bottom())));
+
+    QVector<quint8> clampedData(clampedRect.width() * clampedRect.height() * pixelSize);
+    device->readBytes(clampedData.data(), clampedRect);
+
+    for (int y = rc.top(); y <= rc.bottom(); y++) {
+        const int srcY = qBound(clampedRect.top(), y, clampedRect.bottom()) - clampedRect.top();
+        const quint8 *srcRow = clampedData.constData() + srcY * clampedRect.width() * pixelSize;
+
+        for (int x = rc.left(); x <= rc.right(); x++) {
+            const int srcX = qBound(clampedRect.left(), x, clampedRect.right()) - clampedRect.left();
+            memcpy(data, srcRow + srcX * pixelSize, pixelSize);
+            data += pixelSize;
+        }
+    }
+}
+
+/**
+ * Blurs \p src in one direction and writes the result into \p dstRect of
+ * \p dst. The pixels are read from \p dstRect extended by \p halo in the
+ * direction of the blur. The devices may coincide: every band reads only
+ * the rows (or columns) it writes to.
+ */
+void filterPass(KisPaintDeviceSP src, KisPaintDeviceSP dst,
+                const QRect &dstRect, const QRect &dataRect,
+                Qt::Orientation orientation, int halo,
+                const RecursiveCoefficients &coefficients,
+                const ChannelsConverter &converter,
+                KoUpdater *progressUpdater, int progressStart, int progressEnd)
+{
+    const int bandSize = 32;
+    const bool horizontal = orientation == Qt::Horizontal;
+
+    QVector<QRect> bands;
+
+    if (horizontal) {
+        for (int y = dstRect.top(); y <= dstRect.bottom(); y += bandSize) {
+            bands << QRect(dstRect.left(), y, dstRect.width(), qMin(bandSize, dstRect.bottom() - y + 1));
+        }
+    } else {
+        for (int x = dstRect.left(); x <= dstRect.right(); x += bandSize) {
+            bands << QRect(x, dstRect.top(), qMin(bandSize, dstRect.right() - x + 1), dstRect.height());
+        }
+    }
+
+    const int pixelSize = src->pixelSize();
+    const int numChannels = converter.numChannels();
+
+    KritaUtils::processRectsInParallel(bands,
+        [&] (const QRect &band) {
+            const QRect srcRect = horizontal ?
+                band.adjusted(-halo, 0, halo, 0) :
+                band.adjusted(0, -halo, 0, halo);
+
+            const int numSrcPixels = srcRect.width() * srcRect.height();
+
+            QVector<quint8> srcData(numSrcPixels * pixelSize);
+            readBytesRepeated(src, srcData.data(), srcRect, dataRect);
+
+            QVector<double> samples(numSrcPixels * numChannels);
+            QVector<double*> planes(numChannels);
+            for (int k = 0; k < numChannels; k++) {
+                planes[k] = samples.data() + k * numSrcPixels;
+            }
+
+            converter.load(srcData.constData(), numSrcPixels, planes.constData());
+
+            for (int k = 0; k < numChannels; k++) {
+                if (horizontal) {
+                    for (int row = 0; row < srcRect.height(); row++) {
+                        filterLine(planes[k] + row * srcRect.width(), srcRect.width(), coefficients);
+                    }
+                } else {
+                    filterColumns(planes[k], srcRect.height(), srcRect.width(), coefficients);
+                }
+            }
+
+            QVector<quint8> dstData(band.width() * band.height() * pixelSize);
+
+            for (int row = 0; row < band.height(); row++) {
+                const int srcOffset = horizontal ?
+                    row * srcRect.width() + halo :
+                    (row + halo) * srcRect.width();
+
+                quint8 *dstRow = dstData.data() + row * band.width() * pixelSize;
+
+                // keep the channels that are not blurred intact
+                memcpy(dstRow, srcData.constData() + srcOffset * pixelSize, band.width() * pixelSize);
+                converter.store(planes.constData(), srcOffset, dstRow, band.width());
+            }
+
+            dst->writeBytes(dstData.constData(), band);
+        },
+        progressUpdater, progressStart, progressEnd);
+}
+
+}
+
+void KisRecursiveGaussianBlur::apply(KisPaintDeviceSP device,
+                                     const QRect& rect,
+                                     qreal xRadius, qreal yRadius,
+                                     const QBitArray &channelFlags,
+                                     KoUpdater *progressUpdater)
+{
+    if (rect.isEmpty()) return;
+
+    ChannelsConverter converter(device->colorSpace(), channelFlags);
+    if (!converter.isValid()) return;
+
+    const int xHalo = xRadius > 0.0 ? KisGaussianKernel::kernelSizeFromRadius(xRadius) / 2 : 0;
+    const int yHalo = yRadius > 0.0 ? KisGaussianKernel::kernelSizeFromRadius(yRadius) / 2 : 0;
+
+    if (xRadius > 0.0 && yRadius > 0.0) {
+        KisPaintDeviceSP interm = new KisPaintDevice(device->colorSpace());
+
+        // the vertical pass needs horizontally blurred rows above and below the rect
+        const QRect horizontalRect = rect.adjusted(0, -yHalo, 0, yHalo);
+
+        filterPass(device, interm, horizontalRect, horizontalRect | device->exactBounds(),
+                   Qt::Horizontal, xHalo,
+                   calculateCoefficients(KisGaussianKernel::sigmaFromRadius(xRadius)),
+                   converter, progressUpdater, 0, 50);
+
+        if (progressUpdater && progressUpdater->interrupted()) return;
+
+        filterPass(interm, device, rect, horizontalRect,
+                   Qt::Vertical, yHalo,
+                   calculateCoefficients(KisGaussianKernel::sigmaFromRadius(yRadius)),
+                   converter, progressUpdater, 50, 100);
+
+    } else if (xRadius > 0.0) {
+        applyPass(device, device, rect, rect | device->exactBounds(),
+                  Qt::Horizontal, xRadius, channelFlags, progressUpdater);
+
+    } else if (yRadius > 0.0) {
+        applyPass(device, device, rect, rect | device->exactBounds(),
+                  Qt::Vertical, yRadius, channelFlags, progressUpdater);
+    }
+}
+
+void KisRecursiveGaussianBlur::applyPass(KisPaintDeviceSP src, KisPaintDeviceSP dst,
+                                         const QRect &dstRect, const QRect &dataRect,
+                                         Qt::Orientation orientation, qreal radius,
+                                         const QBitArray &channelFlags,
+                                         KoUpdater *progressUpdater)
+{
+    if (dstRect.isEmpty() || radius <= 0.0) return;
+
+    ChannelsConverter converter(src->colorSpace(), channelFlags);
+    if (!converter.isValid()) return;
+
+    filterPass(src, dst, dstRect, dataRect,
+               orientation, KisGaussianKernel::kernelSizeFromRadius(radius) / 2,
+               calculateCoefficients(KisGaussianKernel::sigmaFromRadius(radius)),
+               converter, progressUpdater, 0, 100);
+}
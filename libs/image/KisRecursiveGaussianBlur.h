@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_RECURSIVE_GAUSSIAN_BLUR_H
+#define __KIS_RECURSIVE_GAUSSIAN_BLUR_H
+
+#include "kritaimage_export.h"
+#include "kis_types.h"
+
+class QRect;
+class QBitArray;
+class KoUpdater;
+
+/**
+ * A Gaussian blur engine whose cost per pixel does not depend on the
+ * radius. The blur is approximated with the third order recursive (IIR)
+ * filter by Young and van Vliet ("Recursive implementation of the
+ * Gaussian filter", Signal Processing 44, 1995), which is run forward
+ * and backward over every row and then over every column.
+ *
+ * The sigma and the size of the area the blur reads around \p rect are
+ * the same as for KisGaussianKernel with the same radius, so the engine
+ * is a drop-in replacement for the convolution-based blur. The result
+ * differs from the exact Gaussian by a few levels on sharp edges, which
+ * is invisible on large radii, where this engine is supposed to be used.
+ *
+ * The area is processed in bands of rows (horizontal pass) and strips of
+ * columns (vertical pass), so only a small part of the image is kept in
+ * memory at once and the bands are processed concurrently.
+ */
+class KRITAIMAGE_EXPORT KisRecursiveGaussianBlur
+{
+public:
+    static void apply(KisPaintDeviceSP device,
+                      const QRect& rect,
+                      qreal xRadius, qreal yRadius,
+                      const QBitArray &channelFlags,
+                      KoUpdater *progressUpdater);
+
+    /**
+     * Blurs \p src along one axis and writes the result into \p dstRect
+     * of \p dst. The pixels outside \p dataRect are replaced with the
+     * nearest pixel on its border, the same as BORDER_REPEAT mode of
+     * KisConvolutionPainter does. The devices may coincide.
+     */
+    static void applyPass(KisPaintDeviceSP src, KisPaintDeviceSP dst,
+                          const QRect &dstRect, const QRect &dataRect,
+                          Qt::Orientation orientation, qreal radius,
+                          const QBitArray &channelFlags,
+                          KoUpdater *progressUpdater);
+};
+
+#endif /* __KIS_RECURSIVE_GAUSSIAN_BLUR_H */
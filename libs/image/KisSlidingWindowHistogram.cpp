@@ -0,0 +1,174 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisSlidingWindowHistogram.h"
+
+#include <algorithm>
+
+#include "kis_assert.h"
+
+
+KisSlidingWindowHistogram::KisSlidingWindowHistogram(const QRect &tileRect, int numBins, int numValues)
+    : m_tileRect(tileRect),
+      m_numBins(numBins),
+      m_numValues(numValues),
+      m_pixelBins(tileRect.width() * tileRect.height()),
+      m_pixelValues(tileRect.width() * tileRect.height() * numValues),
+      m_totalCount(0),
+      m_counts(numBins),
+      m_sums(numBins * numValues)
+{
+}
+
+QRect KisSlidingWindowHistogram::tileRect() const
+{
+    return m_tileRect;
+}
+
+int KisSlidingWindowHistogram::numBins() const
+{
+    return m_numBins;
+}
+
+int KisSlidingWindowHistogram::numValues() const
+{
+    return m_numValues;
+}
+
+void KisSlidingWindowHistogram::setPixel(const QPoint &pt, int bin, const float *values)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_tileRect.contains(pt));
+    KIS_SAFE_ASSERT_RECOVER_RETURN(bin >= 0 && bin < m_numBins);
+
+    const int index = (pt.y() - m_tileRect.y()) * m_tileRect.width() + pt.x() - m_tileRect.x();
+    const bool isInWindow = m_window.contains(pt);
+
+    if (isInWindow) {
+        addPixel(index, -1);
+    }
+
+    m_pixelBins[index] = bin;
+    if (m_numValues) {
+        std::copy(values, values + m_numValues, m_pixelValues.begin() + index * m_numValues);
+    }
+
+    if (isInWindow) {
+        addPixel(index, 1);
+    }
+}
+
+void KisSlidingWindowHistogram::setWindow(const QRect &window)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_tileRect.contains(window));
+
+    const bool canSlide =
+        !m_window.isEmpty() &&
+        window.top() == m_window.top() &&
+        window.bottom() == m_window.bottom() &&
+        window.left() >= m_window.left() &&
+        window.right() >= m_window.right() &&
+        window.left() <= m_window.right() + 1;
+
+    if (canSlide) {
+        for (int x = m_window.left(); x < window.left(); x++) {
+            addColumn(x, -1);
+        }
+        m_window.setLeft(window.left());
+
+        for (int x = m_window.right() + 1; x <= window.right(); x++) {
+            addColumn(x, 1);
+        }
+        m_window.setRight(window.right());
+    } else {
+        reset();
+
+        m_window = window;
+        for (int x = window.left(); x <= window.right(); x++) {
+            addColumn(x, 1);
+        }
+    }
+}
+
+QRect KisSlidingWindowHistogram::window() const
+{
+    return m_window;
+}
+
+int KisSlidingWindowHistogram::totalCount() const
+{
+    return m_totalCount;
+}
+
+int KisSlidingWindowHistogram::count(int bin) const
+{
+    return m_counts[bin];
+}
+
+const double* KisSlidingWindowHistogram::sums(int bin) const
+{
+    return m_sums.constData() + bin * m_numValues;
+}
+
+int KisSlidingWindowHistogram::mostFrequentBin() const
+{
+    int result = -1;
+    int maxCount = 0;
+
+    for (int i = 0; i < m_numBins; i++) {
+        if (m_counts[i] > maxCount) {
+            result = i;
+            maxCount = m_counts[i];
+        }
+    }
+
+    return result;
+}
+
+void KisSlidingWindowHistogram::addColumn(int x, int sign)
+{
+    int index = (m_window.top() - m_tileRect.y()) * m_tileRect.width() + x - m_tileRect.x();
+
+    for (int y = m_window.top(); y <= m_window.bottom(); y++) {
+        addPixel(index, sign);
+        index += m_tileRect.width();
+    }
+}
+
+void KisSlidingWindowHistogram::addPixel(int index, int sign)
+{
+    const int bin = m_pixelBins[index];
+
+    m_counts[bin] += sign;
+    m_totalCount += sign;
+
+    double *sums = m_sums.data() + bin * m_numValues;
+    const float *values = m_pixelValues.constData() + index * m_numValues;
+
+    for (int i = 0; i < m_numValues; i++) {
+        sums[i] += sign * values[i];
+    }
+}
+
+void KisSlidingWindowHistogram::reset()
+{
+    m_window = QRect();
+    m_totalCount = 0;
+    std::fill(m_counts.begin(), m_counts.end(), 0);
+    std::fill(m_sums.begin(), m_sums.end(), 0.0);
+}
@@ -0,0 +1,120 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_SLIDING_WINDOW_HISTOGRAM_H
+#define __KIS_SLIDING_WINDOW_HISTOGRAM_H
+
+#include <QRect>
+#include <QVector>
+
+#include "kritaimage_export.h"
+
+/**
+ * A histogram of the pixels inside a rectangular window sliding over
+ * a tile of precomputed pixel descriptions. Filters that need some
+ * statistics of a neighbourhood of every pixel (the most frequent
+ * color, the median, etc.) fill the tile once and then move the window
+ * over it. Moving the window by one pixel to the right costs only the
+ * height of the window, not its area, so the cost of such filters
+ * doesn't grow quadratically with the radius anymore.
+ *
+ * Every pixel of the tile is described by a bin and, optionally, by
+ * a vector of \p numValues values (e.g. normalized channels). The
+ * histogram tracks both the number of pixels and the sums of their
+ * values for every bin.
+ *
+ * Usage:
+ *
+ * \code{.cpp}
+ * KisSlidingWindowHistogram histogram(tileRect, 256, channelCount);
+ *
+ * // fill the tile
+ * histogram.setPixel(QPoint(x, y), bin, values);
+ *
+ * // process the pixels row by row from left to right
+ * histogram.setWindow(windowRect);
+ * const int bin = histogram.mostFrequentBin();
+ * const double *sums = histogram.sums(bin);
+ * \endcode
+ */
+class KRITAIMAGE_EXPORT KisSlidingWindowHistogram
+{
+public:
+    KisSlidingWindowHistogram(const QRect &tileRect, int numBins, int numValues = 0);
+
+    QRect tileRect() const;
+    int numBins() const;
+    int numValues() const;
+
+    /**
+     * Sets the description of the pixel \p pt of the tile. If the
+     * pixel is inside the current window, the histogram is updated
+     * accordingly, which is useful for the filters that process the
+     * device in-place and read back the pixels they have written.
+     *
+     * \p values should contain numValues() elements or be null if
+     * numValues() is zero
+     */
+    void setPixel(const QPoint &pt, int bin, const float *values = 0);
+
+    /**
+     * Moves the window to \p window, which should be inside the tile.
+     *
+     * If the new window has the same vertical extent as the current
+     * one and both its edges moved to the right (or stayed), only the
+     * columns that entered or left the window are processed. Otherwise
+     * the histogram is rebuilt from scratch.
+     */
+    void setWindow(const QRect &window);
+    QRect window() const;
+
+    int totalCount() const;
+    int count(int bin) const;
+
+    /**
+     * The sums of the values of the pixels falling into \p bin
+     */
+    const double* sums(int bin) const;
+
+    /**
+     * @return the bin with the highest number of pixels (the lowest
+     * one if there are several of them) or -1 if the window is empty
+     */
+    int mostFrequentBin() const;
+
+private:
+    void addColumn(int x, int sign);
+    void addPixel(int index, int sign);
+    void reset();
+
+private:
+    QRect m_tileRect;
+    int m_numBins;
+    int m_numValues;
+
+    QVector<int> m_pixelBins;
+    QVector<float> m_pixelValues;
+
+    QRect m_window;
+    int m_totalCount;
+    QVector<int> m_counts;
+    QVector<double> m_sums;
+};
+
+#endif /* __KIS_SLIDING_WINDOW_HISTOGRAM_H */
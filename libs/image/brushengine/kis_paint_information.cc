@@ -20,6 +20,7 @@
 
 #include <QDomElement>
 #include <boost/optional.hpp>
+#include <algorithm>
 
 #include "kis_paintop.h"
 #include "kis_algebra_2d.h"
@@ -90,6 +91,17 @@ struct KisPaintInformation::Private {
         }
 
         levelOfDetail = rhs.levelOfDetail;
+
+        cachedSensorValuesMask = rhs.cachedSensorValuesMask;
+        if (cachedSensorValuesMask) {
+            std::copy(rhs.cachedSensorValues,
+                      rhs.cachedSensorValues + maxCachedSensorValues,
+                      cachedSensorValues);
+        }
+    }
+
+    void resetSensorValuesCache() {
+        cachedSensorValuesMask = 0;
     }
 
 
@@ -136,6 +148,9 @@ struct KisPaintInformation::Private {
 
     int levelOfDetail;
 
+    mutable quint32 cachedSensorValuesMask = 0;
+    mutable qreal cachedSensorValues[maxCachedSensorValues];
+
     void registerDistanceInfo(KisDistanceInformation *di) {
         directionHistoryInfo = DirectionHistoryInfo(di->scalarDistanceApprox(),
                                                     di->currentDabSeqNo(),
@@ -278,6 +293,8 @@ int KisPaintInformation::canvasRotation() const
 
 void KisPaintInformation::setCanvasRotation(int rotation)
 {
+    d->resetSensorValuesCache();
+
     if (rotation < 0) {
         d->canvasRotation= 360- abs(rotation % 360);
     } else {
@@ -294,6 +311,7 @@ bool KisPaintInformation::canvasMirroredH() const
 void KisPaintInformation::setCanvasHorizontalMirrorState(bool mir)
 {
     d->canvasMirroredH = mir;
+    d->resetSensorValuesCache();
 
 }
 
@@ -339,6 +357,7 @@ const QPointF& KisPaintInformation::pos() const
 void KisPaintInformation::setPos(const QPointF& p)
 {
     d->pos = p;
+    d->resetSensorValuesCache();
 }
 
 qreal KisPaintInformation::pressure() const
@@ -349,6 +368,7 @@ qreal KisPaintInformation::pressure() const
 void KisPaintInformation::setPressure(qreal p)
 {
     d->pressure = p;
+    d->resetSensorValuesCache();
 }
 
 qreal KisPaintInformation::xTilt() const
@@ -364,6 +384,7 @@ qreal KisPaintInformation::yTilt() const
 void KisPaintInformation::overrideDrawingAngle(qreal angle)
 {
     d->drawingAngleOverride = angle;
+    d->resetSensorValuesCache();
 }
 
 qreal KisPaintInformation::drawingAngleSafe(const KisDistanceInformation &distance) const
@@ -507,6 +528,25 @@ void KisPaintInformation::setPerStrokeRandomSource(KisPerStrokeRandomSourceSP va
 void KisPaintInformation::setLevelOfDetail(int levelOfDetail)
 {
     d->levelOfDetail = levelOfDetail;
+    d->resetSensorValuesCache();
+}
+
+bool KisPaintInformation::fetchCachedSensorValue(int id, qreal *value) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(id >= 0 && id < maxCachedSensorValues, false);
+
+    if (!(d->cachedSensorValuesMask & (1U << id))) return false;
+
+    *value = d->cachedSensorValues[id];
+    return true;
+}
+
+void KisPaintInformation::cacheSensorValue(int id, qreal value) const
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(id >= 0 && id < maxCachedSensorValues);
+
+    d->cachedSensorValues[id] = value;
+    d->cachedSensorValuesMask |= 1U << id;
 }
 
 QDebug operator<<(QDebug dbg, const KisPaintInformation &info)
@@ -582,6 +622,7 @@ void KisPaintInformation::mixOtherImpl(const QPointF &p, qreal t, const KisPaint
         this->d->pos = p;
         this->d->isHoveringMode = false;
         this->d->levelOfDetail = 0;
+        this->d->resetSensorValuesCache();
         return;
     }
     else {
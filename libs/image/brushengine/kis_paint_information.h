@@ -274,6 +274,31 @@ public:
      */
     void setCanvasHorizontalMirrorState(bool mir);
 
+    /**
+     * Several curve options of a paintop are usually controlled by the
+     * same sensor (e.g. pressure drives both size and opacity). To avoid
+     * evaluating the sensor for every option, the value of a stateless
+     * sensor is computed once per paint information object and stored
+     * in this per-dab cache. The cache is reset every time the object
+     * is modified.
+     *
+     * The cache is not thread-safe, just like the rest of the object.
+     *
+     * @param id the type of the sensor, should be less than
+     *           maxCachedSensorValues
+     * @return true if the value has been found in the cache
+     */
+    bool fetchCachedSensorValue(int id, qreal *value) const;
+
+    /**
+     * Stores the value of the sensor \p id in the per-dab cache
+     *
+     * \see fetchCachedSensorValue()
+     */
+    void cacheSensorValue(int id, qreal value) const;
+
+    static const int maxCachedSensorValues = 32;
+
     void toXML(QDomDocument&, QDomElement&) const;
 
     static KisPaintInformation fromXML(const QDomElement&);
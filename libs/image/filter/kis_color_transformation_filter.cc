@@ -30,6 +30,7 @@
 #include <QTime>
 #endif
 #include <KisSequentialIteratorProgress.h>
+#include <KisPlanarScratchBuffer.h>
 #include "kis_color_transformation_configuration.h"
 
 KisColorTransformationFilter::KisColorTransformationFilter(const KoID& id, const KoID & category, const QString & entry) : KisFilter(id, category, entry)
@@ -63,10 +64,29 @@ void KisColorTransformationFilter::processImpl(KisPaintDeviceSP device,
 
     KisSequentialIteratorProgress it(device, applyRect, progressUpdater);
 
-    int conseq = it.nConseqPixels();
-    while (it.nextPixels(conseq)) {
-        conseq = it.nConseqPixels();
-        colorTransformation->transform(it.oldRawData(), it.rawData(), conseq);
+    if (colorTransformation->supportsPlanarTransform() &&
+        KisPlanarScratchBuffer::isPreferred(cs)) {
+
+        /**
+         * The iterator gives us the pixels in chunks of at most a tile
+         * row, so the buffer grows only once and is reused for the rest
+         * of the pass.
+         */
+        KisPlanarScratchBuffer buffer(cs);
+
+        int conseq = it.nConseqPixels();
+        while (it.nextPixels(conseq)) {
+            conseq = it.nConseqPixels();
+            buffer.deinterleave(it.oldRawData(), conseq);
+            colorTransformation->transformPlanar(buffer.planes(), conseq);
+            buffer.interleave(it.rawData(), conseq);
+        }
+    } else {
+        int conseq = it.nConseqPixels();
+        while (it.nextPixels(conseq)) {
+            conseq = it.nConseqPixels();
+            colorTransformation->transform(it.oldRawData(), it.rawData(), conseq);
+        }
     }
 
     if (!colorTransformationConfiguration) {
@@ -30,10 +30,13 @@
 #include "kis_types.h"
 #include <kis_painter.h>
 #include <KoUpdater.h>
+#include "krita_utils.h"
+#include "kis_lod_transform.h"
 
 KisFilter::KisFilter(const KoID& _id, const KoID & category, const QString & entry)
     : KisBaseProcessor(_id, category, entry),
-      m_supportsLevelOfDetail(false)
+      m_supportsLevelOfDetail(false),
+      m_supportsLevelOfDetailApproximation(false)
 {
     init(id() + "_filter_bookmarks");
 }
@@ -71,6 +74,29 @@ void KisFilter::process(const KisPaintDeviceSP src,
         temporary = src;
     }
     else {
+        /**
+         * Filters that don't support threading may depend on the
+         * whole applyRect (e.g. they normalize it), so they are
+         * always processed in one go
+         */
+        if (supportsThreading()) {
+            const QVector<QRect> patches =
+                KritaUtils::splitRectIntoPatches(applyRect, KritaUtils::optimalPatchSize());
+
+            if (patches.size() > 1) {
+                /**
+                 * The patches read the pixels around them, so they
+                 * must not see the results of their neighbours when
+                 * the device is filtered in-place
+                 */
+                KisPaintDeviceSP patchesSource =
+                    src == dst ? new KisPaintDevice(*src) : src;
+
+                processInPatches(patchesSource, dst, selection, patches, config, progressUpdater);
+                return;
+            }
+        }
+
         temporary = dst->createCompositionSourceDevice(src, needRect);
         transaction = new KisTransaction(temporary);
     }
@@ -98,6 +124,37 @@ void KisFilter::process(const KisPaintDeviceSP src,
     }
 }
 
+void KisFilter::processInPatches(const KisPaintDeviceSP src,
+                                 KisPaintDeviceSP dst,
+                                 KisSelectionSP selection,
+                                 const QVector<QRect> &patches,
+                                 const KisFilterConfigurationSP config,
+                                 KoUpdater* progressUpdater) const
+{
+    const int lod = src->defaultBounds()->currentLevelOfDetail();
+
+    KritaUtils::processRectsInParallel(patches,
+        [&] (const QRect &rc) {
+            KisPaintDeviceSP temporary =
+                dst->createCompositionSourceDevice(src, neededRect(rc, config, lod));
+
+            {
+                KisTransaction transaction(temporary);
+                KoDummyUpdater patchUpdater;
+
+                try {
+                    processImpl(temporary, rc, config, &patchUpdater);
+                }
+                catch (const std::bad_alloc&) {
+                    warnKrita << "Filter" << name() << "failed to allocate enough memory to run.";
+                }
+            }
+
+            KisPainter::copyAreaOptimized(rc.topLeft(), temporary, dst, rc, selection);
+        },
+        progressUpdater);
+}
+
 QRect KisFilter::neededRect(const QRect & rect, const KisFilterConfigurationSP c, int lod) const
 {
     Q_UNUSED(c);
@@ -116,7 +173,7 @@ bool KisFilter::supportsLevelOfDetail(const KisFilterConfigurationSP config, int
 {
     Q_UNUSED(config);
     Q_UNUSED(lod);
-    return m_supportsLevelOfDetail;
+    return m_supportsLevelOfDetail || m_supportsLevelOfDetailApproximation;
 }
 
 void KisFilter::setSupportsLevelOfDetail(bool value)
@@ -124,6 +181,47 @@ void KisFilter::setSupportsLevelOfDetail(bool value)
     m_supportsLevelOfDetail = value;
 }
 
+void KisFilter::setSupportsLevelOfDetailApproximation(const QStringList &lengthProperties)
+{
+    m_supportsLevelOfDetailApproximation = true;
+    m_lodLengthProperties = lengthProperties;
+}
+
+KisFilterConfigurationSP KisFilter::lodConfiguration(const KisFilterConfigurationSP config, int lod) const
+{
+    if (!lod || !m_supportsLevelOfDetailApproximation || m_lodLengthProperties.isEmpty()) {
+        return config;
+    }
+
+    KisFilterConfigurationSP lodConfig = defaultConfiguration();
+    lodConfig->fromXML(config->toXML());
+    lodConfig->setChannelFlags(config->channelFlags());
+
+    // the loaded properties are strings, so take their types from the factory
+    const KisFilterConfigurationSP factoryConfig = factoryConfiguration();
+
+    KisLodTransformScalar t(lod);
+
+    Q_FOREACH (const QString &name, m_lodLengthProperties) {
+        QVariant value;
+        if (!lodConfig->getProperty(name, value)) continue;
+
+        const qreal length = value.toDouble();
+
+        QVariant factoryValue;
+        if (factoryConfig->getProperty(name, factoryValue) &&
+            factoryValue.type() == QVariant::Double) {
+
+            lodConfig->setProperty(name, t.scale(length));
+        } else {
+            // a non-zero length should not disappear on the preview
+            lodConfig->setProperty(name, length != 0.0 ? qMax(1, qRound(t.scale(length))) : 0);
+        }
+    }
+
+    return lodConfig;
+}
+
 bool KisFilter::needsTransparentPixels(const KisFilterConfigurationSP config, const KoColorSpace *cs) const
 {
     Q_UNUSED(config);
@@ -21,6 +21,7 @@
 #include <list>
 
 #include <QString>
+#include <QStringList>
 
 #include <klocalizedstring.h>
 
@@ -67,6 +68,14 @@ public:
      * If \p dst is an alpha color space device, it will get special
      * treatment.
      *
+     * When \p src and \p dst differ (or there is a selection), the filter
+     * is applied to a temporary device. If the filter supports threading
+     * and the rect is bigger than a patch, the rect is streamed through
+     * tile-aligned patches instead: every patch gets its own temporary
+     * device covering only neededRect() of the patch, so the peak memory
+     * consumption depends on the patch size, not on the size of the
+     * image, and the patches are processed in parallel.
+     *
      * @param src the source paint device
      * @param dst the destination paint device
      * @param selection the selection
@@ -110,6 +119,15 @@ public:
      */
     virtual bool supportsLevelOfDetail(const KisFilterConfigurationSP config, int lod) const;
 
+    /**
+     * Returns the configuration the filter should be run with on LoD
+     * planes of level \p lod. For the filters that only approximate
+     * LoD (see setSupportsLevelOfDetailApproximation()) the lengths in
+     * the configuration are scaled down, for all the other filters
+     * \p config is returned as it is.
+     */
+    KisFilterConfigurationSP lodConfiguration(const KisFilterConfigurationSP config, int lod) const;
+
     virtual bool needsTransparentPixels(const KisFilterConfigurationSP config, const KoColorSpace *cs) const;
 
 protected:
@@ -117,9 +135,30 @@ protected:
     QString configEntryGroup() const;
     void setSupportsLevelOfDetail(bool value);
 
+    /**
+     * Allows the filter to generate its preview on LoD planes even
+     * though it doesn't handle the level of detail itself. The filter
+     * is just run on the scaled down planes with the configuration
+     * returned by lodConfiguration(), in which the properties listed in
+     * \p lengthProperties (the sizes in pixels) are scaled down as well.
+     * The preview is only an approximation then, the final result is
+     * still calculated at full resolution.
+     */
+    void setSupportsLevelOfDetailApproximation(const QStringList &lengthProperties);
+
+
+private:
+    void processInPatches(const KisPaintDeviceSP src,
+                          KisPaintDeviceSP dst,
+                          KisSelectionSP selection,
+                          const QVector<QRect> &patches,
+                          const KisFilterConfigurationSP config,
+                          KoUpdater* progressUpdater) const;
 
 private:
     bool m_supportsLevelOfDetail;
+    bool m_supportsLevelOfDetailApproximation;
+    QStringList m_lodLengthProperties;
 };
 
 
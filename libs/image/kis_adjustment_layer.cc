@@ -74,7 +74,8 @@ QRect KisAdjustmentLayer::incomingChangeRect(const QRect &rect) const
 
     if (filterConfig) {
         KisFilterSP filter = KisFilterRegistry::instance()->value(filterConfig->name());
-        filteredRect = filter->changedRect(rect, filterConfig.data(), projection()->defaultBounds()->currentLevelOfDetail());
+        const int lod = projection()->defaultBounds()->currentLevelOfDetail();
+        filteredRect = filter->changedRect(rect, filter->lodConfiguration(filterConfig, lod).data(), lod);
     }
 
     /**
@@ -104,7 +105,8 @@ QRect KisAdjustmentLayer::needRect(const QRect& rect, PositionToFilthy pos) cons
      * That's why simply we do not call
      * KisSelectionBasedLayer::needRect here :)
      */
-    return filter->neededRect(rect, filterConfig.data(), projection()->defaultBounds()->currentLevelOfDetail());
+    const int lod = projection()->defaultBounds()->currentLevelOfDetail();
+    return filter->neededRect(rect, filter->lodConfiguration(filterConfig, lod).data(), lod);
 }
 
 bool KisAdjustmentLayer::accept(KisNodeVisitor & v)
@@ -120,6 +120,8 @@ public:
             KIS_ASSERT_RECOVER_NOOP(layer->busyProgressIndicator());
             layer->busyProgressIndicator()->update();
 
+            filterConfig = filter->lodConfiguration(filterConfig, m_projection->defaultBounds()->currentLevelOfDetail());
+
             // We do not create a transaction here, as srcDevice != dstDevice
             filter->process(m_projection, dstDevice, 0, filterRect, filterConfig.data(), 0);
         }
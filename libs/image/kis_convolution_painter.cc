@@ -58,18 +58,56 @@
 #endif
 
 
+#ifdef HAVE_FFTW3
+#define THRESHOLD_SIZE 5
+
+namespace {
+
+/**
+ * Flat kernels are handled by the spatial engine using the summed-area
+ * decomposition of the runs of equal coefficients. Its cost does not
+ * depend on the area, so it is compared with the estimated cost of the
+ * FFT engine for a big area. The spatial engine is preferred when it
+ * is not more expensive, since, unlike FFT, it has no rounding noise.
+ */
+bool spansAreCheaperThanFFT(const KisConvolutionKernelSP kernel)
+{
+    const int kw = kernel->width();
+    const int kh = kernel->height();
+
+    QVector<qreal> kernelData(kw * kh);
+    int numCoefficients = 0;
+
+    for (int r = 0; r < kh; r++) {
+        for (int c = 0; c < kw; c++) {
+            const qreal value = (*(kernel->data()))(r, c);
+            kernelData[r * kw + c] = value;
+            numCoefficients += value != 0.0;
+        }
+    }
+
+    const int cost = KisConvolutionSpans::cost(
+        KisConvolutionSpans::decompose(
+            KisConvolutionSpans::split(kernelData, kw, kh)));
+
+    return KisConvolutionSpans::isPreferred(cost, numCoefficients) &&
+        cost <= KisConvolutionFFTBlocks::cost(kw, kh);
+}
+
+}
+#endif
+
 bool KisConvolutionPainter::useFFTImplemenation(const KisConvolutionKernelSP kernel) const
 {
     bool result = false;
 
 #ifdef HAVE_FFTW3
-    #define THRESHOLD_SIZE 5
-
     result =
         m_enginePreference == FFTW ||
         (m_enginePreference == NONE &&
          kernel->width() > THRESHOLD_SIZE &&
-         kernel->height() > THRESHOLD_SIZE);
+         kernel->height() > THRESHOLD_SIZE &&
+         !spansAreCheaperThanFFT(kernel));
 #else
     Q_UNUSED(kernel);
 #endif
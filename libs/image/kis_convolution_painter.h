@@ -74,8 +74,15 @@ public:
      */
     bool needsTransaction(const KisConvolutionKernelSP kernel) const;
 
+    /**
+     * \return true if \p kernel is going to be applied by the FFT
+     * engine instead of the spatial one
+     */
+    bool useFFTImplemenation(const KisConvolutionKernelSP kernel) const;
+
 protected:
     friend class KisConvolutionPainterTest;
+    friend class KisBlurBenchmark;
     enum TestingEnginePreference {
         NONE,
         SPATIAL,
@@ -92,8 +99,6 @@ private:
                                                     KisPainter *painter,
                                                     KoUpdater *progress);
 
-     bool useFFTImplemenation(const KisConvolutionKernelSP kernel) const;
-
 private:
     TestingEnginePreference m_enginePreference;
 };
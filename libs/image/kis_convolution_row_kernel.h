@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_CONVOLUTION_ROW_KERNEL_H
+#define __KIS_CONVOLUTION_ROW_KERNEL_H
+
+#include "kritaimage_export.h"
+
+/**
+ * A vectorized building block for the spatial convolution engine.
+ *
+ * The convolution worker keeps the source area in channel-planar
+ * rows (one contiguous array of samples per channel) and computes
+ * the result of a whole row at once as a sum of the source rows
+ * shifted by the kernel offsets. That is, for every non-zero
+ * coefficient of the kernel it calls accumulate() once, which is a
+ * simple "dst += weight * src" loop over contiguous memory and can
+ * be processed with the widest vector instructions available on the
+ * CPU.
+ *
+ * The class is stateless, so a single instance is shared by all the
+ * convolution workers.
+ */
+class KRITAIMAGE_EXPORT KisConvolutionRowKernel
+{
+public:
+    virtual ~KisConvolutionRowKernel();
+
+    /**
+     * dst[i] += weight * src[i] for i in [0, numSamples)
+     */
+    virtual void accumulate(float *dst, const float *src, float weight, int numSamples) const = 0;
+
+    /**
+     * dst[i] += weight * src[i] for i in [0, numSamples)
+     */
+    virtual void accumulate(double *dst, const double *src, double weight, int numSamples) const = 0;
+
+    /**
+     * @return the implementation optimized for the current CPU
+     */
+    static const KisConvolutionRowKernel* instance();
+};
+
+#endif /* __KIS_CONVOLUTION_ROW_KERNEL_H */
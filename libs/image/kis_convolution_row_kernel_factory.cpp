@@ -0,0 +1,72 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "kis_convolution_row_kernel_factory.h"
+#include "kis_convolution_row_kernel.h"
+
+
+namespace {
+
+template<Vc::Implementation _impl>
+struct KisConvolutionRowKernelImpl : public KisConvolutionRowKernel
+{
+    void accumulate(float *dst, const float *src, float weight, int numSamples) const override {
+        accumulateImpl(dst, src, weight, numSamples);
+    }
+
+    void accumulate(double *dst, const double *src, double weight, int numSamples) const override {
+        accumulateImpl(dst, src, weight, numSamples);
+    }
+
+private:
+    template<typename T>
+    static inline void accumulateImpl(T *dst, const T *src, T weight, int numSamples) {
+        int i = 0;
+
+#if defined HAVE_VC
+        typedef Vc::Vector<T> vector_type;
+        const int vectorSize = static_cast<int>(vector_type::size());
+        const vector_type vWeight(weight);
+
+        /**
+         * The source rows are shifted by the kernel offset, so
+         * neither of the pointers is guaranteed to be aligned
+         */
+        for (; i <= numSamples - vectorSize; i += vectorSize) {
+            vector_type d(dst + i, Vc::Unaligned);
+            vector_type s(src + i, Vc::Unaligned);
+            d += vWeight * s;
+            d.store(dst + i, Vc::Unaligned);
+        }
+#endif
+
+        for (; i < numSamples; i++) {
+            dst[i] += weight * src[i];
+        }
+    }
+};
+
+}
+
+template<>
+KisConvolutionRowKernelFactory::ReturnType
+KisConvolutionRowKernelFactory::create<Vc::CurrentImplementation::current()>(ParamType)
+{
+    return new KisConvolutionRowKernelImpl<Vc::CurrentImplementation::current()>();
+}
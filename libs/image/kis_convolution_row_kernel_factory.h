@@ -0,0 +1,40 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __KIS_CONVOLUTION_ROW_KERNEL_FACTORY_H
+#define __KIS_CONVOLUTION_ROW_KERNEL_FACTORY_H
+
+#include <compositeops/KoVcMultiArchBuildSupport.h>
+
+class KisConvolutionRowKernel;
+
+struct KisConvolutionRowKernelFactory
+{
+    /**
+     * The row kernel doesn't need any parameters, the type is
+     * present only to satisfy the interface of createOptimizedClass()
+     */
+    typedef void* ParamType;
+    typedef KisConvolutionRowKernel* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType);
+};
+
+#endif /* __KIS_CONVOLUTION_ROW_KERNEL_FACTORY_H */
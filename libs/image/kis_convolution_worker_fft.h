@@ -26,33 +26,170 @@
 
 #include "kis_convolution_worker.h"
 #include "kis_math_toolbox.h"
+#include "krita_utils.h"
 
 #include <QMutex>
 #include <QVector>
 #include <QTextStream>
 #include <QFile>
 #include <QDir>
+#include <QSize>
+#include <QPair>
+#include <QSharedPointer>
+
+#include <cmath>
+#include <limits>
 
 #include <fftw3.h>
 
 template<class _IteratorFactory_> class KisConvolutionWorkerFFT;
+class KisConvolutionWorkerFFTPlanCache;
 class KisConvolutionWorkerFFTLock
 {
 private:
     static QMutex fftwMutex;
     template<class _IteratorFactory_> friend class KisConvolutionWorkerFFT;
+    friend class KisConvolutionWorkerFFTPlanCache;
 };
 
 QMutex KisConvolutionWorkerFFTLock::fftwMutex;
 
+/**
+ * The FFTW planner is not thread-safe and creating a plan is expensive,
+ * but executing an existing plan on new arrays of the same size and
+ * alignment is thread-safe. So the plans are created once per transform
+ * size and then shared by all the threads, which run them with
+ * fftw_execute_dft_r2c()/fftw_execute_dft_c2r().
+ *
+ * The plans are in-place, the arrays passed to them must be allocated
+ * with fftw_malloc() and have the row stride of (width + 2 - width % 2)
+ * doubles.
+ */
+class KisConvolutionWorkerFFTPlanCache
+{
+public:
+    struct Plans {
+        Plans(int width, int height) {
+            const int length = height * (width / 2 + 1);
+            fftw_complex *buffer = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * length);
+
+            QMutexLocker l(&KisConvolutionWorkerFFTLock::fftwMutex);
+            forward = fftw_plan_dft_r2c_2d(height, width, (double*)buffer, buffer, FFTW_ESTIMATE);
+            backward = fftw_plan_dft_c2r_2d(height, width, buffer, (double*)buffer, FFTW_ESTIMATE);
+            l.unlock();
+
+            fftw_free(buffer);
+        }
+
+        ~Plans() {
+            QMutexLocker l(&KisConvolutionWorkerFFTLock::fftwMutex);
+            fftw_destroy_plan(forward);
+            fftw_destroy_plan(backward);
+        }
+
+        fftw_plan forward;
+        fftw_plan backward;
+    };
+
+    typedef QSharedPointer<Plans> PlansSP;
+
+    static KisConvolutionWorkerFFTPlanCache* instance() {
+        static KisConvolutionWorkerFFTPlanCache s_instance;
+        return &s_instance;
+    }
+
+    PlansSP fetchPlans(int width, int height) {
+        QMutexLocker l(&m_mutex);
+
+        const QSize size(width, height);
+
+        for (int i = 0; i < m_plans.size(); i++) {
+            if (m_plans[i].first == size) {
+                m_plans.move(i, 0);
+                return m_plans.first().second;
+            }
+        }
+
+        PlansSP plans(new Plans(width, height));
+        m_plans.prepend(qMakePair(size, plans));
+
+        /**
+         * The evicted plans are destroyed only when the last
+         * worker using them releases its pointer
+         */
+        while (m_plans.size() > maxCachedPlans) {
+            m_plans.removeLast();
+        }
+
+        return plans;
+    }
+
+private:
+    static const int maxCachedPlans = 16;
+
+    QMutex m_mutex;
+    QList<QPair<QSize, PlansSP>> m_plans;
+};
+
+
+namespace KisConvolutionFFTBlocks {
+
+/**
+ * Size of the transform along one axis. The transform should be a few
+ * times bigger than the kernel, otherwise most of the work would be
+ * spent on the margins.
+ */
+inline int transformSize(int kernelSize, int areaSize)
+{
+    const int preferredFFTSize = 512;
+    const int halfKernelSize = (kernelSize - 1) / 2;
+
+    return qMin(areaSize + 2 * halfKernelSize,
+                qMax(preferredFFTSize, 4 * kernelSize));
+}
+
+/**
+ * Estimated number of row operations per output pixel and channel
+ * needed to convolve a big area, in the same units as
+ * KisConvolutionSpans::cost(). A real transform of N samples takes
+ * about 2.5 * N * log2(N) flops, that is 1.25 * log2(N) multiply-adds
+ * per sample, and there are two of them (forward and backward) plus
+ * the product of the spectra. The margins of every block are
+ * transformed, but not written.
+ */
+inline qreal cost(int kernelWidth, int kernelHeight)
+{
+    const int bigArea = std::numeric_limits<int>::max() / 2;
+    const qreal fftWidth = transformSize(kernelWidth, bigArea);
+    const qreal fftHeight = transformSize(kernelHeight, bigArea);
+
+    const qreal blockWidth = fftWidth - 2 * ((kernelWidth - 1) / 2);
+    const qreal blockHeight = fftHeight - 2 * ((kernelHeight - 1) / 2);
 
+    const qreal margins = (fftWidth * fftHeight) / (blockWidth * blockHeight);
+
+    return (2 * 1.25 * std::log2(fftWidth * fftHeight) + 2) * margins;
+}
+
+}
+
+/**
+ * The FFT convolution engine splits the area into blocks and convolves
+ * every block separately using the overlap-save method: the transform
+ * of a block covers the block itself and the margins of half of the
+ * kernel size, so the cyclic convolution gives exact result for the
+ * pixels of the block. All the blocks have the same size, so they share
+ * the same FFTW plans and the transform of the kernel.
+ *
+ * The blocks are processed in parallel, and the memory usage is limited
+ * by the block size rather than by the size of the area.
+ */
 template<class _IteratorFactory_>
 class KisConvolutionWorkerFFT : public KisConvolutionWorker<_IteratorFactory_>
 {
 public:
     KisConvolutionWorkerFFT(KisPainter *painter, KoUpdater *progress)
         : KisConvolutionWorker<_IteratorFactory_>(painter, progress),
-          m_currentProgress(0),
           m_kernelFFT(0)
     {
     }
@@ -76,95 +213,102 @@ public:
         if (areaSize.width() == 0 || areaSize.height() == 0)
             return;
 
-        addToProgress(0);
+        setProgress(0);
         if (isInterrupted()) return;
 
         const quint32 halfKernelWidth = (kernel->width() - 1) / 2;
         const quint32 halfKernelHeight = (kernel->height() - 1) / 2;
 
-        m_fftWidth = areaSize.width() + 4 * halfKernelWidth;
-        m_fftHeight = areaSize.height() + 2 * halfKernelHeight;
-
-        /**
-         * FIXME: check whether this "optimization" is needed to
-         * be uncommented. My tests showed about 30% better performance
-         * when the line is commented out (DK).
-         */
-        //optimumDimensions(m_fftWidth, m_fftHeight);
+        m_fftWidth = KisConvolutionFFTBlocks::transformSize(kernel->width(), areaSize.width());
+        m_fftHeight = KisConvolutionFFTBlocks::transformSize(kernel->height(), areaSize.height());
 
         m_fftLength = m_fftHeight * (m_fftWidth / 2 + 1);
         m_extraMem = (m_fftWidth % 2) ? 1 : 2;
 
+        const int blockWidth = m_fftWidth - 2 * halfKernelWidth;
+        const int blockHeight = m_fftHeight - 2 * halfKernelHeight;
+
+        KisConvolutionWorkerFFTPlanCache::PlansSP plans =
+            KisConvolutionWorkerFFTPlanCache::instance()->fetchPlans(m_fftWidth, m_fftHeight);
+
         // create and fill kernel
         m_kernelFFT = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_fftLength);
         memset(m_kernelFFT, 0, sizeof(fftw_complex) * m_fftLength);
         fftFillKernelMatrix(kernel, m_kernelFFT);
+        fftw_execute_dft_r2c(plans->forward, (double*)m_kernelFFT, m_kernelFFT);
 
         // find out which channels need convolving
         QList<KoChannelInfo*> convChannelList = this->convolvableChannelList(src);
 
-        m_channelFFT.resize(convChannelList.count());
-        for (auto i = m_channelFFT.begin(); i != m_channelFFT.end(); ++i) {
-            *i = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_fftLength);
-        }
-
         const double kernelFactor = kernel->factor() ? kernel->factor() : 1;
         const double fftScale = 1.0 / (m_fftHeight * m_fftWidth) / kernelFactor;
 
-        FFTInfo info (fftScale, convChannelList, kernel, this->m_painter->device()->colorSpace());
-        int cacheRowStride = m_fftWidth + m_extraMem;
+        const FFTInfo info (fftScale, convChannelList, kernel, this->m_painter->device()->colorSpace());
+        const int cacheRowStride = m_fftWidth + m_extraMem;
 
-        fillCacheFromDevice(src,
-                            QRect(srcPos.x() - halfKernelWidth,
-                                  srcPos.y() - halfKernelHeight,
-                                  m_fftWidth,
-                                  m_fftHeight),
-                            cacheRowStride,
-                            info, dataRect);
+        /**
+         * When the convolution is done in place, the blocks cannot write
+         * into the source device, because the margins of the neighbouring
+         * blocks would read the convolved data. So the result is collected
+         * in a copy of the device and copied back at the end. It must be
+         * a copy, not a blank device, because only the convolved channels
+         * are written, the others must be kept intact.
+         */
+        KisPaintDeviceSP dstDevice = this->m_painter->device();
+        KisPaintDeviceSP resultDevice =
+            src == dstDevice ? new KisPaintDevice(*dstDevice) : dstDevice;
+
+        QVector<QRect> blocks;
+        for (int y = 0; y < areaSize.height(); y += blockHeight) {
+            for (int x = 0; x < areaSize.width(); x += blockWidth) {
+                blocks << QRect(x, y,
+                                qMin(blockWidth, areaSize.width() - x),
+                                qMin(blockHeight, areaSize.height() - y));
+            }
+        }
 
-        addToProgress(10);
-        if (isInterrupted()) return;
+        KritaUtils::processRectsInParallel(blocks,
+            [&] (const QRect &block) {
+                QVector<fftw_complex*> channelFFT(info.numChannels());
+                for (auto i = channelFFT.begin(); i != channelFFT.end(); ++i) {
+                    *i = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * m_fftLength);
+                }
 
-        // calculate number off fft operations required for progress reporting
-        const float progressPerFFT = (100 - 30) / (double)(convChannelList.count() * 2 + 1);
+                fillCacheFromDevice(src,
+                                    QRect(srcPos.x() + block.x() - halfKernelWidth,
+                                          srcPos.y() + block.y() - halfKernelHeight,
+                                          m_fftWidth,
+                                          m_fftHeight),
+                                    cacheRowStride,
+                                    info, dataRect, channelFFT);
+
+                for (auto k = channelFFT.begin(); k != channelFFT.end(); ++k) {
+                    fftw_execute_dft_r2c(plans->forward, (double*)(*k), *k);
+                    fftMultiply(*k, m_kernelFFT);
+                    fftw_execute_dft_c2r(plans->backward, *k, (double*)*k);
+                }
 
-        // perform FFT
-        fftw_plan fftwPlanForward, fftwPlanBackward;
+                writeResultToDevice(resultDevice,
+                                    QRect(dstPos + block.topLeft(), block.size()),
+                                    cacheRowStride, halfKernelWidth, halfKernelHeight,
+                                    info, dataRect, channelFFT);
 
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        fftwPlanForward = fftw_plan_dft_r2c_2d(m_fftHeight, m_fftWidth, (double*)m_kernelFFT, m_kernelFFT, FFTW_ESTIMATE);
-        fftwPlanBackward = fftw_plan_dft_c2r_2d(m_fftHeight, m_fftWidth, m_kernelFFT, (double*)m_kernelFFT, FFTW_ESTIMATE);
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
-
-        fftw_execute(fftwPlanForward);
-        addToProgress(progressPerFFT);
-        if (isInterrupted()) return;
+                Q_FOREACH (fftw_complex *channel, channelFFT) {
+                    fftw_free(channel);
+                }
+            },
+            this->m_progress, 10, 90);
 
-        for (auto k = m_channelFFT.begin(); k != m_channelFFT.end(); ++k)
-        {
-            fftw_execute_dft_r2c(fftwPlanForward, (double*)(*k), *k);
-            addToProgress(progressPerFFT);
-            if (isInterrupted()) return;
+        cleanUp();
 
-            fftMultiply(*k, m_kernelFFT);
+        if (isInterrupted()) return;
 
-            fftw_execute_dft_c2r(fftwPlanBackward, *k, (double*)*k);
-            addToProgress(progressPerFFT);
-            if (isInterrupted()) return;
+        if (resultDevice != dstDevice) {
+            const QRect dstRect(dstPos, areaSize);
+            KisPainter::copyAreaOptimized(dstRect.topLeft(), resultDevice, dstDevice, dstRect);
         }
 
-        KisConvolutionWorkerFFTLock::fftwMutex.lock();
-        fftw_destroy_plan(fftwPlanForward);
-        fftw_destroy_plan(fftwPlanBackward);
-        KisConvolutionWorkerFFTLock::fftwMutex.unlock();
-
-
-        writeResultToDevice(QRect(dstPos.x(), dstPos.y(), areaSize.width(), areaSize.height()),
-                            cacheRowStride, halfKernelWidth, halfKernelHeight,
-                            info, dataRect);
-
-        addToProgress(20);
-        cleanUp();
+        setProgress(100);
     }
 
     struct FFTInfo {
@@ -222,7 +366,8 @@ public:
                              const QRect &rect,
                              const int cacheRowStride,
                              const FFTInfo &info,
-                             const QRect &dataRect) {
+                             const QRect &dataRect,
+                             const QVector<fftw_complex*> &channelFFT) {
 
         typename _IteratorFactory_::HLineConstIterator hitSrc =
             _IteratorFactory_::createHLineConstIterator(src,
@@ -234,7 +379,7 @@ public:
         const auto channelPtrBegin = channelPtr.begin();
         const auto channelPtrEnd = channelPtr.end();
 
-        auto iFFt = m_channelFFT.constBegin();
+        auto iFFt = channelFFT.constBegin();
         for (auto i = channelPtrBegin; i != channelPtrEnd; ++i, ++iFFt) {
             *i = (double*)*iFFt;
         }
@@ -308,15 +453,17 @@ public:
         return channelPixelValue;
     }
 
-    void writeResultToDevice(const QRect &rect,
+    void writeResultToDevice(KisPaintDeviceSP dst,
+                             const QRect &rect,
                              const int cacheRowStride,
                              const int halfKernelWidth,
                              const int halfKernelHeight,
                              const FFTInfo &info,
-                             const QRect &dataRect) {
+                             const QRect &dataRect,
+                             const QVector<fftw_complex*> &channelFFT) {
 
         typename _IteratorFactory_::HLineIterator hitDst =
-            _IteratorFactory_::createHLineIterator(this->m_painter->device(),
+            _IteratorFactory_::createHLineIterator(dst,
                                                    rect.x(), rect.y(), rect.width(),
                                                    dataRect);
 
@@ -327,7 +474,7 @@ public:
         const auto channelPtrBegin = channelPtr.begin();
         const auto channelPtrEnd = channelPtr.end();
 
-        auto iFFt = m_channelFFT.constBegin();
+        auto iFFt = channelFFT.constBegin();
         for (auto i = channelPtrBegin; i != channelPtrEnd; ++i, ++iFFt) {
             *i = (double*)*iFFt + initialOffset;
         }
@@ -427,11 +574,11 @@ private:
         }
     }
 
-    void fftMultiply(fftw_complex* channel, fftw_complex* kernel)
+    void fftMultiply(fftw_complex* channel, const fftw_complex* kernel) const
     {
         // perform complex multiplication
         fftw_complex *channelPtr = channel;
-        fftw_complex *kernelPtr = kernel;
+        const fftw_complex *kernelPtr = kernel;
 
         fftw_complex tmp;
 
@@ -499,23 +646,16 @@ private:
         KisConvolutionWorkerFFTLock::fftwMutex.unlock();
     }
 
-    void addToProgress(float amount)
+    void setProgress(int percent)
     {
-        m_currentProgress += amount;
-
         if (this->m_progress) {
-            this->m_progress->setProgress((int)m_currentProgress);
+            this->m_progress->setProgress(percent);
         }
     }
 
     bool isInterrupted()
     {
-        if (this->m_progress && this->m_progress->interrupted()) {
-            cleanUp();
-            return true;
-        }
-
-        return false;
+        return this->m_progress && this->m_progress->interrupted();
     }
 
     void cleanUp()
@@ -523,19 +663,13 @@ private:
         // free kernel fft data
         if (m_kernelFFT) {
             fftw_free(m_kernelFFT);
+            m_kernelFFT = 0;
         }
-
-        Q_FOREACH (fftw_complex *channel, m_channelFFT) {
-            fftw_free(channel);
-        }
-        m_channelFFT.clear();
     }
 private:
     quint32 m_fftWidth, m_fftHeight, m_fftLength, m_extraMem;
-    float m_currentProgress;
 
     fftw_complex* m_kernelFFT;
-    QVector<fftw_complex*> m_channelFFT;
 };
 
 #endif
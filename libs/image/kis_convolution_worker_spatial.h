@@ -20,9 +20,188 @@
 #ifndef KIS_CONVOLUTION_WORKER_SPATIAL_H
 #define KIS_CONVOLUTION_WORKER_SPATIAL_H
 
+#include <algorithm>
+#include <cmath>
+
 #include "kis_convolution_worker.h"
+#include "kis_convolution_row_kernel.h"
 #include "kis_math_toolbox.h"
+#include "krita_utils.h"
+
+#include <QAtomicInt>
+#include <functional>
+
+/**
+ * A run of equal non-zero coefficients [kx0, kx1] in the row ky of a
+ * convolution kernel.
+ */
+struct KisConvolutionSpan {
+    int ky;
+    int kx0;
+    int kx1;
+    qreal weight;
+};
+
+/**
+ * A term of the summed-area decomposition of a flat kernel: the
+ * prefix sums at the column \p kx (-1 is the leading zero sample)
+ * of the kernel rows [ky0, ky1] are added with \p weight.
+ */
+struct KisConvolutionColumnRun {
+    int ky0;
+    int ky1;
+    int kx;
+    qreal weight;
+};
+
+namespace KisConvolutionSpans {
+
+/**
+ * Splits the kernel stored in row-major \p kernelData into the runs
+ * of equal coefficients. Flat kernels (box blur, lens blur iris
+ * polygons, morphology-like masks) have only a few runs per row.
+ */
+inline QVector<KisConvolutionSpan> split(const QVector<qreal> &kernelData, int kw, int kh)
+{
+    QVector<KisConvolutionSpan> spans;
+
+    for (int ky = 0; ky < kh; ky++) {
+        const qreal *row = kernelData.constData() + ky * kw;
+
+        for (int kx = 0; kx < kw; kx++) {
+            if (row[kx] == 0.0) continue;
+
+            KisConvolutionSpan span = {ky, kx, kx, row[kx]};
+            while (span.kx1 + 1 < kw && row[span.kx1 + 1] == span.weight) {
+                span.kx1++;
+            }
+            spans.append(span);
+            kx = span.kx1;
+        }
+    }
+
+    return spans;
+}
+
+/**
+ * Turns the spans into the terms of the summed-area decomposition.
+ * Every span [kx0, kx1] is the difference of the row prefix sums at
+ * kx1 and kx0 - 1, the touching ends of the neighbouring spans of a
+ * row are merged. The ends at the same column with the same weight
+ * in the consecutive rows are merged into a single column run, which
+ * is the difference of two column sums of the row prefix sums. So a
+ * box kernel of any size has only two runs, and the edges of flat
+ * polygons close to vertical have a few.
+ */
+inline QVector<KisConvolutionColumnRun> decompose(const QVector<KisConvolutionSpan> &spans)
+{
+    QVector<KisConvolutionColumnRun> ends;
+
+    auto addEnd = [&ends] (int ky, int kx, qreal weight) {
+        for (int i = ends.size() - 1; i >= 0 && ends[i].ky0 == ky; i--) {
+            if (ends[i].kx == kx) {
+                ends[i].weight += weight;
+                return;
+            }
+        }
+        KisConvolutionColumnRun end = {ky, ky, kx, weight};
+        ends.append(end);
+    };
+
+    Q_FOREACH (const KisConvolutionSpan &span, spans) {
+        addEnd(span.ky, span.kx0 - 1, -span.weight);
+        addEnd(span.ky, span.kx1, span.weight);
+    }
+
+    std::stable_sort(ends.begin(), ends.end(),
+        [] (const KisConvolutionColumnRun &lhs, const KisConvolutionColumnRun &rhs) {
+            return lhs.kx < rhs.kx || (lhs.kx == rhs.kx && lhs.weight < rhs.weight);
+        });
+
+    QVector<KisConvolutionColumnRun> runs;
+
+    Q_FOREACH (const KisConvolutionColumnRun &end, ends) {
+        if (end.weight == 0.0) continue;
+
+        if (!runs.isEmpty() &&
+            runs.last().kx == end.kx &&
+            runs.last().weight == end.weight &&
+            runs.last().ky1 + 1 == end.ky0) {
+
+            runs.last().ky1 = end.ky1;
+        } else {
+            runs.append(end);
+        }
+    }
+
+    return runs;
+}
 
+inline bool hasColumnRuns(const QVector<KisConvolutionColumnRun> &runs)
+{
+    return std::any_of(runs.begin(), runs.end(),
+                       [] (const KisConvolutionColumnRun &run) { return run.ky0 != run.ky1; });
+}
+
+/**
+ * Estimated number of row operations per output pixel and channel
+ * needed to apply the decomposed kernel: one accumulation per single
+ * row term, two per column run, and one addition for each of the
+ * prefix sums.
+ */
+inline int cost(const QVector<KisConvolutionColumnRun> &runs)
+{
+    int result = hasColumnRuns(runs) ? 2 : 1;
+
+    Q_FOREACH (const KisConvolutionColumnRun &run, runs) {
+        result += run.ky0 == run.ky1 ? 1 : 2;
+    }
+
+    return result;
+}
+
+/**
+ * The spans code path works in doubles and has a bit of overhead for
+ * the prefix sums, so it is used only when it is at least twice
+ * cheaper than the dense one.
+ */
+inline bool isPreferred(int cost, int numCoefficients)
+{
+    return 2 * cost <= numCoefficients;
+}
+
+}
+
+/**
+ * The spatial convolution engine works in a row-oriented way. The
+ * source area is converted into channel-planar rows of premultiplied
+ * samples (a ring buffer of kernel-height rows per channel), and every
+ * output row is computed as a weighted sum of the source rows shifted
+ * by the kernel offsets. The inner loop of this sum runs over
+ * contiguous memory and is vectorized by KisConvolutionRowKernel.
+ *
+ * Precision: the samples are accumulated in doubles, which gives
+ * exactly the same result as the former per-pixel implementation for
+ * all the color depths. For 8-bit color spaces and kernels with integer
+ * coefficients (sharpen, edge detection, emboss and most of the
+ * custom kernels) all the intermediate sums are integers that fit
+ * into the float mantissa, so the accumulation is done in floats,
+ * which is still exact, but twice as wide in terms of vector lanes.
+ *
+ * Flat kernels (box-like or the polygonal iris of the lens blur) are
+ * not applied coefficient-by-coefficient. Every kernel row is split
+ * into runs of equal coefficients (spans), and the source rows are
+ * stored as prefix sums, so every span costs two accumulations
+ * regardless of its length. The ends of the spans repeating in the
+ * consecutive kernel rows are read from the column sums of the prefix
+ * rows (a summed-area table), so a box kernel costs O(1) per pixel
+ * and a flat polygon of radius R costs O(R) instead of O(R^2). Since
+ * the spans path operates on exactly the same kernel, its result is
+ * the same as the dense one up to the rounding of the double sums.
+ *
+ * Both paths process the area in parallel in horizontal bands, as long
+ * as the source data is not overwritten by the neighbouring bands.
+ */
 template <class _IteratorFactory_>
 class KisConvolutionWorkerSpatial : public KisConvolutionWorker<_IteratorFactory_>
 {
@@ -31,33 +210,13 @@ public:
         : KisConvolutionWorker<_IteratorFactory_>(painter, progress)
         ,  m_alphaCachePos(-1)
         ,  m_alphaRealPos(-1)
-        ,  m_pixelPtrCache(0)
-        ,  m_pixelPtrCacheCopy(0)
-        ,  m_minClamp(0)
-        ,  m_maxClamp(0)
-        ,  m_absoluteOffset(0)
+        ,  m_kernelFactor(1.0)
     {
     }
 
     ~KisConvolutionWorkerSpatial() override {
     }
 
-    inline void loadPixelToCache(qreal **cache, const quint8 *data, int index) {
-        // no alpha is rare case, so just multiply by 1.0 in that case
-        qreal alphaValue = m_alphaRealPos >= 0 ?
-            m_toDoubleFuncPtr[m_alphaCachePos](data, m_alphaRealPos) : 1.0;
-
-        for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
-            if (k != (quint32)m_alphaCachePos) {
-                const quint32 channelPos = m_convChannelList[k]->pos();
-                cache[index][k] = m_toDoubleFuncPtr[k](data, channelPos) * alphaValue;
-            } else {
-                cache[index][k] = alphaValue;
-            }
-        }
-
-    }
-
     void execute(const KisConvolutionKernelSP kernel, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect) override {
         // store some kernel characteristics
         m_kw = kernel->width();
@@ -66,16 +225,16 @@ public:
         m_khalfHeight = (m_kh - 1) / 2;
         m_cacheSize = m_kw * m_kh;
         m_pixelSize = src->colorSpace()->pixelSize();
-        quint32 channelCount = src->colorSpace()->channelCount();
-
-        m_kernelData = new qreal[m_cacheSize];
-        qreal *kernelDataPtr = m_kernelData;
 
-        // fill in data
+        /**
+         * The kernel is stored flipped, so that the coefficient
+         * (ky, kx) is applied to the pixel (y - khalfHeight + ky,
+         * x - khalfWidth + kx)
+         */
+        QVector<qreal> kernelData(m_cacheSize);
         for (quint32 r = 0; r < kernel->height(); r++) {
             for (quint32 c = 0; c < kernel->width(); c++) {
-                *kernelDataPtr = (*(kernel->data()))(r, c);
-                kernelDataPtr++;
+                kernelData[m_cacheSize - r * m_kw - c - 1] = (*(kernel->data()))(r, c);
             }
         }
 
@@ -97,6 +256,9 @@ public:
         m_convChannelList = this->convolvableChannelList(src);
         m_convolveChannelsNo = m_convChannelList.count();
 
+        m_alphaCachePos = -1;
+        m_alphaRealPos = -1;
+
         for (int i = 0; i < m_convChannelList.size(); i++) {
             if (m_convChannelList[i]->channelType() == KoChannelInfo::ALPHA) {
                 m_alphaCachePos = i;
@@ -104,25 +266,6 @@ public:
             }
         }
 
-        bool hasProgressUpdater = this->m_progress;
-        if (hasProgressUpdater)
-            this->m_progress->setProgress(0);
-
-        // Iterate over all pixels in our rect, create a cache of pixels around the current pixel and convolve them.
-        m_pixelPtrCache = new qreal*[m_cacheSize];
-        m_pixelPtrCacheCopy = new qreal*[m_cacheSize];
-        for (quint32 c = 0; c < m_cacheSize; ++c) {
-            m_pixelPtrCache[c] = new qreal[channelCount];
-            m_pixelPtrCacheCopy[c] = new qreal[channelCount];
-        }
-
-        // decide caching strategy
-        enum TraversingDirection { Horizontal, Vertical };
-        TraversingDirection traversingDirection = Vertical;
-        if (m_kw > m_kh) {
-            traversingDirection = Horizontal;
-        }
-
         KisMathToolbox mathToolbox;
         m_toDoubleFuncPtr = QVector<PtrToDouble>(m_convolveChannelsNo);
         if (!mathToolbox.getToDoubleChannelPtr(m_convChannelList, m_toDoubleFuncPtr))
@@ -133,121 +276,431 @@ public:
             return;
 
         m_kernelFactor = kernel->factor() ? 1.0 / kernel->factor() : 1;
-        m_maxClamp = new qreal[m_convChannelList.count()];
-        m_minClamp = new qreal[m_convChannelList.count()];
-        m_absoluteOffset = new qreal[m_convChannelList.count()];
+        m_maxClamp = QVector<qreal>(m_convolveChannelsNo);
+        m_minClamp = QVector<qreal>(m_convolveChannelsNo);
+        m_absoluteOffset = QVector<qreal>(m_convolveChannelsNo);
         for (quint16 i = 0; i < m_convChannelList.count(); ++i) {
             m_minClamp[i] = mathToolbox.minChannelValue(m_convChannelList[i]);
             m_maxClamp[i] = mathToolbox.maxChannelValue(m_convChannelList[i]);
             m_absoluteOffset[i] = (m_maxClamp[i] - m_minClamp[i]) * kernel->offset();
         }
 
-        qint32 row = srcPos.y();
-        qint32 col = srcPos.x();
+        const QVector<KisConvolutionColumnRun> runs =
+            KisConvolutionSpans::decompose(KisConvolutionSpans::split(kernelData, m_kw, m_kh));
+        const int numCoefficients =
+            std::count_if(kernelData.begin(), kernelData.end(),
+                          [] (qreal value) { return value != 0.0; });
 
-        // populate pixelPtrCacheCopy for starting position (0, 0)
-        qint32 i = 0;
-        typename _IteratorFactory_::HLineConstIterator hitInitSrc = _IteratorFactory_::createHLineConstIterator(src, col - m_khalfWidth, row - m_khalfHeight, m_kw, dataRect);
+        if (KisConvolutionSpans::isPreferred(KisConvolutionSpans::cost(runs), numCoefficients)) {
+            executeSpans(runs, src, srcPos, dstPos, areaSize, dataRect);
+        } else if (canUseFloatAccumulator(kernelData)) {
+            executeImpl<float>(kernelData, src, srcPos, dstPos, areaSize, dataRect);
+        } else {
+            executeImpl<double>(kernelData, src, srcPos, dstPos, areaSize, dataRect);
+        }
+    }
 
-        for (quint32 krow = 0; krow < m_kh; ++krow) {
-            do {
-                const quint8* data = hitInitSrc->oldRawData();
-                loadPixelToCache(m_pixelPtrCacheCopy, data, i);
-                ++i;
-            } while (hitInitSrc->nextPixel());
-            hitInitSrc->nextRow();
+private:
+    /**
+     * Float accumulation is used only when it is guaranteed to be
+     * exact: all the channels are 8-bit (the premultiplied samples
+     * are integers in range [0, 255 * 255]), all the kernel
+     * coefficients are integers and the absolute value of any
+     * partial sum cannot exceed 2^24.
+     */
+    bool canUseFloatAccumulator(const QVector<qreal> &kernelData) const {
+        Q_FOREACH (const KoChannelInfo *channel, m_convChannelList) {
+            if (channel->channelValueType() != KoChannelInfo::UINT8) {
+                return false;
+            }
         }
 
+        qreal absoluteSum = 0.0;
+        Q_FOREACH (qreal value, kernelData) {
+            if (std::floor(value) != value) {
+                return false;
+            }
+            absoluteSum += qAbs(value);
+        }
+
+        return absoluteSum * 255.0 * 255.0 < qreal(1 << 24);
+    }
+
+    /**
+     * Splits the area into vertical strips limited by \p maxStripWidth
+     * (the ring buffer of huge kernels may need a lot of memory) and
+     * the strips into horizontal bands. Every band reloads
+     * kernel-height rows of the source, so the bands are made tall
+     * enough to keep this overhead low.
+     */
+    QVector<QRect> splitIntoJobs(QSize areaSize, int maxStripWidth, bool canSplitIntoBands) const {
+        const int numStrips = (areaSize.width() + maxStripWidth - 1) / maxStripWidth;
+        const int stripWidth = (areaSize.width() + numStrips - 1) / numStrips;
+        const int bandHeight = canSplitIntoBands ? qMax(64, 4 * int(m_kh)) : areaSize.height();
+
+        QVector<QRect> jobs;
+        for (int y = 0; y < areaSize.height(); y += bandHeight) {
+            for (int x = 0; x < areaSize.width(); x += stripWidth) {
+                jobs << QRect(x, y,
+                              qMin(stripWidth, areaSize.width() - x),
+                              qMin(bandHeight, areaSize.height() - y));
+            }
+        }
+        return jobs;
+    }
+
+    /**
+     * The jobs read the source rows around their bands, so when the
+     * device is convolved in-place, they can run concurrently only if
+     * the original data is preserved by a transaction. Otherwise the
+     * area is processed sequentially in one band per strip, which
+     * is safe thanks to the ring buffer.
+     */
+    bool canProcessInParallel(const KisPaintDeviceSP src) const {
+        return src != this->m_painter->device() ||
+            src->dataManager()->hasCurrentMemento();
+    }
+
+    /**
+     * The vertical strips read the columns around them, so when the
+     * device is convolved in-place without a transaction, every strip
+     * but the first would read pixels already written by its
+     * neighbour. In such a case the strips read the source from a
+     * copy-on-write snapshot of the device.
+     */
+    KisPaintDeviceSP sourceForJobs(const KisPaintDeviceSP src, const QVector<QRect> &jobs, bool inParallel) const {
+        return !inParallel && jobs.size() > 1 ? new KisPaintDevice(*src) : src;
+    }
 
-        if (traversingDirection == Horizontal) {
-            if(hasProgressUpdater) {
-                this->m_progress->setRange(0, areaSize.height());
+    /**
+     * Runs \p func for every job. The jobs call the passed callback
+     * after every row and stop as soon as it returns false. KoUpdater
+     * is not thread-safe, so the progress is reported only from the
+     * calling thread: per job when the jobs run in parallel and per
+     * row otherwise.
+     */
+    void runJobs(const QVector<QRect> &jobs, bool inParallel, std::function<void(const QRect&, const std::function<bool()>&)> func) {
+        KoUpdater *progress = this->m_progress;
+        if (progress) {
+            progress->setProgress(0);
+        }
+
+        if (inParallel) {
+            QAtomicInt isInterrupted(0);
+            const std::function<bool()> rowDone =
+                [&isInterrupted] () { return !isInterrupted.load(); };
+
+            KritaUtils::processRectsInParallel(jobs,
+                [&] (const QRect &rc) { func(rc, rowDone); },
+                [&] (int numJobsDone) {
+                    if (progress) {
+                        progress->setProgress(100 * numJobsDone / jobs.size());
+
+                        if (progress->interrupted()) {
+                            isInterrupted.store(1);
+                        }
+                    }
+                    return !isInterrupted.load();
+                });
+        } else {
+            int numRows = 0;
+            Q_FOREACH (const QRect &rc, jobs) {
+                numRows += rc.height();
             }
-            typename _IteratorFactory_::HLineIterator hitDst = _IteratorFactory_::createHLineIterator(this->m_painter->device(), dstPos.x(), dstPos.y(), areaSize.width(), dataRect);
-            typename _IteratorFactory_::HLineConstIterator hitSrc = _IteratorFactory_::createHLineConstIterator(src, srcPos.x(), srcPos.y(), areaSize.width(), dataRect);
-
-            typename _IteratorFactory_::HLineConstIterator khitSrc = _IteratorFactory_::createHLineConstIterator(src, col - m_khalfWidth, row + m_khalfHeight, m_kw, dataRect);
-            for (int prow = 0; prow < areaSize.height(); ++prow) {
-                // reload cache from copy
-                for (quint32 i = 0; i < m_cacheSize; ++i)
-                    memcpy(m_pixelPtrCache[i], m_pixelPtrCacheCopy[i], channelCount * sizeof(qreal));
-
-                typename _IteratorFactory_::VLineConstIterator kitSrc = _IteratorFactory_::createVLineConstIterator(src, col + m_khalfWidth, row - m_khalfHeight, m_kh, dataRect);
-                for (int pcol = 0; pcol < areaSize.width(); ++pcol) {
-                    // write original channel values
-                    memcpy(hitDst->rawData(), hitSrc->oldRawData(), m_pixelSize);
-                    convolveCache(hitDst->rawData());
-
-                    ++col;
-                    kitSrc->nextColumn();
-                    hitDst->nextPixel();
-                    hitSrc->nextPixel();
-                    moveKernelRight(kitSrc, m_pixelPtrCache);
+
+            int numRowsDone = 0;
+            const std::function<bool()> rowDone =
+                [&] () {
+                    numRowsDone++;
+                    if (!progress) return true;
+
+                    progress->setProgress(100 * numRowsDone / numRows);
+                    return !progress->interrupted();
+                };
+
+            Q_FOREACH (const QRect &rc, jobs) {
+                func(rc, rowDone);
+                if (progress && progress->interrupted()) break;
+            }
+        }
+    }
+
+    template <typename T>
+    void executeImpl(const QVector<qreal> &kernelData, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect) {
+        struct Coefficient {
+            int ky;
+            int kx;
+            T weight;
+        };
+
+        /**
+         * Zero coefficients don't contribute to the result, so we skip
+         * them completely. The order of the others is the same as in
+         * the former per-pixel loop, so the sums are bit-exact.
+         */
+        QVector<Coefficient> coefficients;
+        for (quint32 ky = 0; ky < m_kh; ky++) {
+            for (quint32 kx = 0; kx < m_kw; kx++) {
+                const qreal value = kernelData[ky * m_kw + kx];
+                if (value != 0.0) {
+                    Coefficient c = {int(ky), int(kx), T(value)};
+                    coefficients.append(c);
+                }
+            }
+        }
+
+        const int maxBufferSize = 16 * 1024 * 1024;
+        const int channelsNo = m_convolveChannelsNo;
+        const int maxStripWidth =
+            qMax(64, int(maxBufferSize / (sizeof(T) * channelsNo * m_kh)) - int(m_kw - 1));
+
+        const bool inParallel = canProcessInParallel(src);
+        const QVector<QRect> jobs = splitIntoJobs(areaSize, maxStripWidth, inParallel);
+        const KisPaintDeviceSP source = sourceForJobs(src, jobs, inParallel);
+
+        const KisConvolutionRowKernel *rowKernel = KisConvolutionRowKernel::instance();
+
+        runJobs(jobs, inParallel,
+            [&] (const QRect &rc, const std::function<bool()> &rowDone) {
+                const int width = rc.width();
+                const int rowLength = width + m_kw - 1;
+
+                QVector<T> rowsBuffer(channelsNo * m_kh * rowLength);
+                QVector<T> accumulator(channelsNo * width);
+                QVector<T*> rows(channelsNo * m_kh);
+
+                for (int i = 0; i < rows.size(); i++) {
+                    rows[i] = rowsBuffer.data() + i * rowLength;
                 }
 
-                row++;
-                khitSrc->nextRow();
-                hitDst->nextRow();
-                hitSrc->nextRow();
-                col = srcPos.x();
+                typename _IteratorFactory_::HLineConstIterator kitSrc = _IteratorFactory_::createHLineConstIterator(source, srcPos.x() + rc.x() - m_khalfWidth, srcPos.y() + rc.y() - m_khalfHeight, width + m_kw - 1, dataRect);
 
-                moveKernelDown(khitSrc, m_pixelPtrCacheCopy);
+                for (quint32 krow = 0; krow < m_kh; ++krow) {
+                    loadRowToCache(kitSrc, rows.data(), krow);
+                    kitSrc->nextRow();
+                }
 
-                if (hasProgressUpdater) {
-                    this->m_progress->setValue(prow);
+                typename _IteratorFactory_::HLineIterator hitDst = _IteratorFactory_::createHLineIterator(this->m_painter->device(), dstPos.x() + rc.x(), dstPos.y() + rc.y(), width, dataRect);
+                typename _IteratorFactory_::HLineConstIterator hitSrc = _IteratorFactory_::createHLineConstIterator(source, srcPos.x() + rc.x(), srcPos.y() + rc.y(), width, dataRect);
 
-                    if (this->m_progress->interrupted()) {
-                        cleanUp();
+                for (int prow = 0; prow < rc.height(); ++prow) {
+                    if (prow > 0) {
+                        moveKernelDown(kitSrc, rows.data());
+                        kitSrc->nextRow();
+                    }
+
+                    std::fill(accumulator.begin(), accumulator.end(), T(0));
+
+                    Q_FOREACH (const Coefficient &c, coefficients) {
+                        for (int k = 0; k < channelsNo; k++) {
+                            rowKernel->accumulate(accumulator.data() + k * width,
+                                                  rows[k * m_kh + c.ky] + c.kx,
+                                                  c.weight, width);
+                        }
+                    }
+
+                    for (int pcol = 0; pcol < width; ++pcol) {
+                        // write original channel values
+                        memcpy(hitDst->rawData(), hitSrc->oldRawData(), m_pixelSize);
+                        convolvePixel(hitDst->rawData(), accumulator.constData() + pcol, width);
+
+                        hitDst->nextPixel();
+                        hitSrc->nextPixel();
+                    }
+
+                    hitDst->nextRow();
+                    hitSrc->nextRow();
+
+                    if (!rowDone()) {
                         return;
                     }
                 }
+            });
+    }
 
-            }
-        } else /* if (traversingDirection == Vertical) */ {
-            if(hasProgressUpdater) {
-                this->m_progress->setRange(0, areaSize.width());
-            }
-            typename _IteratorFactory_::VLineIterator vitDst = _IteratorFactory_::createVLineIterator(this->m_painter->device(), dstPos.x(), dstPos.y(), areaSize.height(), dataRect);
-            typename _IteratorFactory_::VLineConstIterator vitSrc = _IteratorFactory_::createVLineConstIterator(src, srcPos.x(), srcPos.y(), areaSize.height(), dataRect);
-
-            typename _IteratorFactory_::VLineConstIterator kitSrc = _IteratorFactory_::createVLineConstIterator(src, col + m_khalfWidth, row - m_khalfHeight, m_kh, dataRect);
-            for (int pcol = 0; pcol < areaSize.width(); pcol++) {
-                // reload cache from copy
-                for (quint32 i = 0; i < m_cacheSize; ++i)
-                    memcpy(m_pixelPtrCache[i], m_pixelPtrCacheCopy[i], channelCount * sizeof(qreal));
-
-                typename _IteratorFactory_::HLineConstIterator khitSrc = _IteratorFactory_::createHLineConstIterator(src, col - m_khalfWidth, row + m_khalfHeight, m_kw, dataRect);
-                for (int prow = 0; prow < areaSize.height(); prow++) {
-                    // write original channel values
-                    memcpy(vitDst->rawData(), vitSrc->oldRawData(), m_pixelSize);
-                    convolveCache(vitDst->rawData());
-
-                    ++row;
-                    khitSrc->nextRow();
-                    vitDst->nextPixel();
-                    vitSrc->nextPixel();
-                    moveKernelDown(khitSrc, m_pixelPtrCache);
+    void executeSpans(const QVector<KisConvolutionColumnRun> &runs, const KisPaintDeviceSP src, QPoint srcPos, QPoint dstPos, QSize areaSize, const QRect& dataRect) {
+        /**
+         * The prefix sums are stored in the ring buffer with one
+         * extra leading zero sample per row, so that a span
+         * [kx0, kx1] applied at position x is just
+         * row[x + kx1] - row[x + kx0 - 1].
+         *
+         * The column sums of the prefix rows are stored in another
+         * ring buffer of kernel-height + 1 rows, the first of them is
+         * the sum of the rows above the kernel. So a column run
+         * [ky0, ky1] at position x is
+         * sums[ky1 + 1][x + kx] - sums[ky0][x + kx].
+         */
+        const bool useColumnSums = KisConvolutionSpans::hasColumnRuns(runs);
+        const int numRowsPerChannel = m_kh + (useColumnSums ? m_kh + 1 : 0);
+
+        const int maxBufferSize = 16 * 1024 * 1024;
+        const int channelsNo = m_convolveChannelsNo;
+        const int maxStripWidth =
+            qMax(64, int(maxBufferSize / (sizeof(double) * channelsNo * numRowsPerChannel)) - int(m_kw));
+
+        const bool inParallel = canProcessInParallel(src);
+        const QVector<QRect> jobs = splitIntoJobs(areaSize, maxStripWidth, inParallel);
+        const KisPaintDeviceSP source = sourceForJobs(src, jobs, inParallel);
+
+        const KisConvolutionRowKernel *rowKernel = KisConvolutionRowKernel::instance();
+
+        runJobs(jobs, inParallel,
+            [&] (const QRect &rc, const std::function<bool()> &rowDone) {
+                const int width = rc.width();
+                const int rowLength = width + m_kw;
+
+                QVector<double> rowsBuffer(channelsNo * m_kh * rowLength);
+                QVector<double> accumulator(channelsNo * width);
+                QVector<double*> rows(channelsNo * m_kh);
+
+                for (int i = 0; i < rows.size(); i++) {
+                    rows[i] = rowsBuffer.data() + i * rowLength + 1;
+                }
+
+                QVector<double> sumsBuffer(useColumnSums ? channelsNo * (m_kh + 1) * rowLength : 0);
+                QVector<double*> sums(useColumnSums ? channelsNo * (m_kh + 1) : 0);
+
+                for (int i = 0; i < sums.size(); i++) {
+                    sums[i] = sumsBuffer.data() + i * rowLength + 1;
                 }
 
-                ++col;
-                kitSrc->nextColumn();
-                vitDst->nextColumn();
-                vitSrc->nextColumn();
-                row = srcPos.y();
+                typename _IteratorFactory_::HLineConstIterator kitSrc = _IteratorFactory_::createHLineConstIterator(source, srcPos.x() + rc.x() - m_khalfWidth, srcPos.y() + rc.y() - m_khalfHeight, width + m_kw - 1, dataRect);
+
+                for (quint32 krow = 0; krow < m_kh; ++krow) {
+                    loadRowToCache(kitSrc, rows.data(), krow);
+                    integrateRow(rows.data(), krow, rowLength - 1);
+                    if (useColumnSums) {
+                        integrateColumns(rows.data(), sums.data(), krow, rowLength - 1);
+                    }
+                    kitSrc->nextRow();
+                }
+
+                typename _IteratorFactory_::HLineIterator hitDst = _IteratorFactory_::createHLineIterator(this->m_painter->device(), dstPos.x() + rc.x(), dstPos.y() + rc.y(), width, dataRect);
+                typename _IteratorFactory_::HLineConstIterator hitSrc = _IteratorFactory_::createHLineConstIterator(source, srcPos.x() + rc.x(), srcPos.y() + rc.y(), width, dataRect);
+
+                for (int prow = 0; prow < rc.height(); ++prow) {
+                    if (prow > 0) {
+                        moveKernelDown(kitSrc, rows.data());
+                        integrateRow(rows.data(), m_kh - 1, rowLength - 1);
+                        if (useColumnSums) {
+                            moveColumnSumsDown(sums.data());
+                            integrateColumns(rows.data(), sums.data(), m_kh - 1, rowLength - 1);
+                        }
+                        kitSrc->nextRow();
+                    }
+
+                    std::fill(accumulator.begin(), accumulator.end(), 0.0);
+
+                    Q_FOREACH (const KisConvolutionColumnRun &run, runs) {
+                        for (int k = 0; k < channelsNo; k++) {
+                            double *dst = accumulator.data() + k * width;
+
+                            if (run.ky0 == run.ky1) {
+                                const double *row = rows[k * m_kh + run.ky0];
+                                rowKernel->accumulate(dst, row + run.kx, run.weight, width);
+                            } else {
+                                double * const *channelSums = sums.constData() + k * (m_kh + 1);
+                                rowKernel->accumulate(dst, channelSums[run.ky1 + 1] + run.kx, run.weight, width);
+                                rowKernel->accumulate(dst, channelSums[run.ky0] + run.kx, -run.weight, width);
+                            }
+                        }
+                    }
+
+                    for (int pcol = 0; pcol < width; ++pcol) {
+                        // write original channel values
+                        memcpy(hitDst->rawData(), hitSrc->oldRawData(), m_pixelSize);
+                        convolvePixel(hitDst->rawData(), accumulator.constData() + pcol, width);
 
-                moveKernelRight(kitSrc, m_pixelPtrCacheCopy);
+                        hitDst->nextPixel();
+                        hitSrc->nextPixel();
+                    }
 
-                if (hasProgressUpdater) {
-                    this->m_progress->setValue(pcol);
+                    hitDst->nextRow();
+                    hitSrc->nextRow();
 
-                    if (this->m_progress->interrupted()) {
-                        cleanUp();
+                    if (!rowDone()) {
                         return;
                     }
                 }
+            });
+    }
+
+    /**
+     * Converts the freshly loaded row \p krow of every channel into
+     * its prefix sums. The sample preceding the row is always zero.
+     */
+    inline void integrateRow(double **rows, int krow, int numSamples) {
+        for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
+            double *row = rows[k * m_kh + krow];
+            for (int x = 1; x < numSamples; x++) {
+                row[x] += row[x - 1];
+            }
+        }
+    }
+
+    /**
+     * Adds the prefix row \p krow of every channel to the column sums
+     * of the rows above it, the result is stored as the column sums
+     * of the row \p krow
+     */
+    inline void integrateColumns(double **rows, double **sums, int krow, int numSamples) {
+        for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
+            const double *row = rows[k * m_kh + krow];
+            const double *above = sums[k * (m_kh + 1) + krow];
+            double *dst = sums[k * (m_kh + 1) + krow + 1];
+
+            for (int x = 0; x < numSamples; x++) {
+                dst[x] = above[x] + row[x];
+            }
+        }
+    }
+
+    inline void moveColumnSumsDown(double **sums) {
+        for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
+            double **channelSums = sums + k * (m_kh + 1);
+            double *first = channelSums[0];
+            memmove(channelSums, channelSums + 1, m_kh * sizeof(double*));
+            channelSums[m_kh] = first;
+        }
+    }
+
+    template <typename T>
+    inline void loadRowToCache(typename _IteratorFactory_::HLineConstIterator& kitSrc, T **rows, int krow) {
+        int x = 0;
+
+        do {
+            const quint8* data = kitSrc->oldRawData();
+
+            // no alpha is rare case, so just multiply by 1.0 in that case
+            qreal alphaValue = m_alphaRealPos >= 0 ?
+                m_toDoubleFuncPtr[m_alphaCachePos](data, m_alphaRealPos) : 1.0;
+
+            for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
+                T *row = rows[k * m_kh + krow];
+
+                if (k != (quint32)m_alphaCachePos) {
+                    const quint32 channelPos = m_convChannelList[k]->pos();
+                    row[x] = T(m_toDoubleFuncPtr[k](data, channelPos) * alphaValue);
+                } else {
+                    row[x] = T(alphaValue);
+                }
             }
+
+            x++;
+        } while (kitSrc->nextPixel());
+    }
+
+    template <typename T>
+    inline void moveKernelDown(typename _IteratorFactory_::HLineConstIterator& kitSrc, T **rows) {
+        for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
+            T **channelRows = rows + k * m_kh;
+            T *first = channelRows[0];
+            memmove(channelRows, channelRows + 1, (m_kh - 1) * sizeof(T*));
+            channelRows[m_kh - 1] = first;
         }
-        cleanUp();
+
+        loadRowToCache(kitSrc, rows, m_kh - 1);
     }
 
     inline void limitValue(qreal *value, qreal lowBound, qreal highBound) {
@@ -260,14 +713,7 @@ public:
     }
 
     template <bool additionalMultiplierActive>
-    inline qreal convolveOneChannelFromCache(quint8* dstPtr, quint32 channel, qreal additionalMultiplier = 0.0) {
-        qreal interimConvoResult = 0;
-
-        for (quint32 pIndex = 0; pIndex < m_cacheSize; ++pIndex) {
-            qreal cacheValue = m_pixelPtrCache[pIndex][channel];
-            interimConvoResult += m_kernelData[m_cacheSize - pIndex - 1] * cacheValue;
-        }
-
+    inline qreal convolveOneChannel(quint8* dstPtr, quint32 channel, qreal interimConvoResult, qreal additionalMultiplier = 0.0) {
         qreal channelPixelValue;
         if (additionalMultiplierActive) {
             channelPixelValue = (interimConvoResult * m_kernelFactor) * additionalMultiplier + m_absoluteOffset[channel];
@@ -283,9 +729,10 @@ public:
         return channelPixelValue;
     }
 
-    inline void convolveCache(quint8* dstPtr) {
+    template <typename T>
+    inline void convolvePixel(quint8* dstPtr, const T *sums, int channelStride) {
         if (m_alphaCachePos >= 0) {
-            qreal alphaValue = convolveOneChannelFromCache<false>(dstPtr, m_alphaCachePos);
+            qreal alphaValue = convolveOneChannel<false>(dstPtr, m_alphaCachePos, sums[m_alphaCachePos * channelStride]);
 
             // TODO: we need a special case for applying LoG filter,
             // when the alpha i suniform and therefore should not be
@@ -297,7 +744,7 @@ public:
 
                 for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
                     if (k == (quint32)m_alphaCachePos) continue;
-                    convolveOneChannelFromCache<true>(dstPtr, k, alphaValueInv);
+                    convolveOneChannel<true>(dstPtr, k, sums[k * channelStride], alphaValueInv);
                 }
             } else {
                 for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
@@ -310,59 +757,11 @@ public:
             }
         } else {
             for (quint32 k = 0; k < m_convolveChannelsNo; ++k) {
-                convolveOneChannelFromCache<false>(dstPtr, k);
+                convolveOneChannel<false>(dstPtr, k, sums[k * channelStride]);
             }
         }
     }
 
-    inline void moveKernelRight(typename _IteratorFactory_::VLineConstIterator& kitSrc, qreal **pixelPtrCache) {
-        qreal** d = pixelPtrCache;
-
-        for (quint32 krow = 0; krow < m_kh; ++krow) {
-            qreal* first = *d;
-            memmove(d, d + 1, (m_kw - 1) * sizeof(qreal *));
-            *(d + m_kw - 1) = first;
-            d += m_kw;
-        }
-
-        qint32 i = m_kw - 1;
-        do {
-            const quint8* data = kitSrc->oldRawData();
-            loadPixelToCache(pixelPtrCache, data, i);
-            i += m_kw;
-        } while (kitSrc->nextPixel());
-    }
-
-    inline void moveKernelDown(typename _IteratorFactory_::HLineConstIterator& kitSrc, qreal **pixelPtrCache) {
-        quint8 **tmp = new quint8*[m_kw];
-        memcpy(tmp, pixelPtrCache, m_kw * sizeof(qreal *));
-        memmove(pixelPtrCache, pixelPtrCache + m_kw, (m_kw * m_kh - m_kw) * sizeof(quint8 *));
-        memcpy(pixelPtrCache + m_kw *(m_kh - 1), tmp, m_kw * sizeof(quint8 *));
-        delete[] tmp;
-
-        qint32 i = m_kw * (m_kh - 1);
-        do {
-            const quint8* data = kitSrc->oldRawData();
-            loadPixelToCache(pixelPtrCache, data, i);
-            i++;
-        } while (kitSrc->nextPixel());
-    }
-
-    void cleanUp() {
-        for (quint32 c = 0; c < m_cacheSize; ++c) {
-            delete[] m_pixelPtrCache[c];
-            delete[] m_pixelPtrCacheCopy[c];
-        }
-
-        delete[] m_kernelData;
-        delete[] m_pixelPtrCache;
-        delete[] m_pixelPtrCacheCopy;
-
-        delete[] m_minClamp;
-        delete[] m_maxClamp;
-        delete[] m_absoluteOffset;
-    }
-
 private:
     quint32 m_kw, m_kh;
     quint32 m_khalfWidth, m_khalfHeight;
@@ -372,9 +771,7 @@ private:
     int m_alphaCachePos;
     int m_alphaRealPos;
 
-    qreal *m_kernelData;
-    qreal** m_pixelPtrCache, ** m_pixelPtrCacheCopy;
-    qreal* m_minClamp, *m_maxClamp, *m_absoluteOffset;
+    QVector<qreal> m_minClamp, m_maxClamp, m_absoluteOffset;
 
     qreal m_kernelFactor;
     QList<KoChannelInfo *> m_convChannelList;
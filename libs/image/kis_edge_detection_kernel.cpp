@@ -24,7 +24,384 @@
 #include <QRect>
 #include <KoColorSpace.h>
 #include <kis_iterator_ng.h>
+#include <kis_sequential_iterator.h>
+#include <KoUpdater.h>
+#include "kis_paint_device.h"
+#include "kis_datamanager.h"
+#include "krita_utils.h"
+#include "kis_math_toolbox.h"
+#include "kis_convolution_row_kernel.h"
+#include "kis_default_bounds_base.h"
+#include <KoChannelInfo.h>
 #include <QVector3D>
+#include <cmath>
+#include <functional>
+
+namespace {
+
+/**
+ * The channels of the color space that are convolved, with everything
+ * needed to reproduce the arithmetic of the spatial convolution worker.
+ */
+struct GradientChannels
+{
+    GradientChannels(const KoColorSpace *cs, const QBitArray &channelFlags)
+        : pixelSize(cs->pixelSize()),
+          alphaIndex(-1),
+          alphaPos(-1)
+    {
+        QList<KoChannelInfo*> allChannels = cs->channels();
+
+        for (int i = 0; i < allChannels.size(); i++) {
+            if (channelFlags.isEmpty() || channelFlags.testBit(i)) {
+                channels.append(allChannels[i]);
+            }
+        }
+
+        for (int i = 0; i < channels.size(); i++) {
+            if (channels[i]->channelType() == KoChannelInfo::ALPHA) {
+                alphaIndex = i;
+                alphaPos = channels[i]->pos();
+            }
+        }
+
+        KisMathToolbox mathToolbox;
+        toDouble.resize(channels.size());
+        fromDouble.resize(channels.size());
+        isValid =
+            mathToolbox.getToDoubleChannelPtr(channels, toDouble) &&
+            mathToolbox.getFromDoubleChannelPtr(channels, fromDouble);
+
+        Q_FOREACH (KoChannelInfo *channel, channels) {
+            minValue.append(mathToolbox.minChannelValue(channel));
+            maxValue.append(mathToolbox.maxChannelValue(channel));
+        }
+    }
+
+    int pixelSize;
+    int alphaIndex;
+    int alphaPos;
+    bool isValid;
+    QList<KoChannelInfo*> channels;
+    QVector<PtrToDouble> toDouble;
+    QVector<PtrFromDouble> fromDouble;
+    QVector<double> minValue;
+    QVector<double> maxValue;
+};
+
+/**
+ * One of the gradient kernels. The filter has always been applied to
+ * the whole \p rect grown by \p extent pixels along \p orientation
+ * with BORDER_REPEAT, so the reads are clamped to that area united
+ * with the bounds of the source (unless the device wraps around).
+ *
+ * The kernels the convolution painter would apply with FFT are too
+ * expensive for a dense pass, so they are still convolved by the
+ * painter tile by tile.
+ */
+struct GradientKernel
+{
+    struct Coefficient {
+        int ky;
+        int kx;
+        double weight;
+    };
+
+    GradientKernel(KisConvolutionKernelSP kernel,
+                   KisPaintDeviceSP src,
+                   const QRect &rect,
+                   int extent,
+                   Qt::Orientation orientation,
+                   const GradientChannels &channels,
+                   const QBitArray &channelFlags)
+        : kernel(kernel),
+          channelFlags(channelFlags)
+    {
+        useFFT = KisConvolutionPainter().useFFTImplemenation(kernel);
+
+        const int kw = kernel->width();
+        const int kh = kernel->height();
+
+        halfWidth = (kw - 1) / 2;
+        halfHeight = (kh - 1) / 2;
+
+        // the coefficient (ky, kx) is applied to the pixel (y - halfHeight + ky, x - halfWidth + kx)
+        for (int ky = 0; ky < kh && !useFFT; ky++) {
+            for (int kx = 0; kx < kw; kx++) {
+                const double value = (*(kernel->data()))(kh - 1 - ky, kw - 1 - kx);
+                if (value != 0.0) {
+                    Coefficient c = {ky, kx, value};
+                    coefficients.append(c);
+                }
+            }
+        }
+
+        factor = kernel->factor() ? 1.0 / kernel->factor() : 1.0;
+
+        for (int i = 0; i < channels.channels.size(); i++) {
+            offset.append((channels.maxValue[i] - channels.minValue[i]) * kernel->offset());
+        }
+
+        area = orientation == Qt::Vertical ?
+            rect.adjusted(0, -extent, 0, extent) :
+            rect.adjusted(-extent, 0, extent, 0);
+
+        halo = qMax(extent, qMax(kw, kh) / 2 + 1);
+
+        wrapAround = src->defaultBounds()->wrapAroundMode();
+        dataRect = area | src->exactBounds();
+    }
+
+    QRect paddedRect(const QRect &tile) const {
+        return tile.adjusted(-halfWidth, -halfHeight, halfWidth, halfHeight);
+    }
+
+    QRect readRect(const QRect &tile) const {
+        return useFFT ? tile :
+            wrapAround ? paddedRect(tile) : paddedRect(tile) & dataRect;
+    }
+
+    /**
+     * Convolves the tile with the painter and reads the result into
+     * \p pixels. The tile is grown by a halo wide enough for the kernel
+     * and cut to the filtered area, so the reads are clamped only on
+     * the outer sides of the filtered rect.
+     */
+    void convolveTile(KisPaintDeviceSP src, const QRect &tile, QVector<quint8> *pixels) const
+    {
+        const QRect tileArea = area & tile.adjusted(-halo, -halo, halo, halo);
+
+        KisPaintDeviceSP result = new KisPaintDevice(src->colorSpace());
+        KisConvolutionPainter painter(result);
+        painter.setChannelFlags(channelFlags);
+        painter.applyMatrix(kernel, src,
+                            tileArea.topLeft(), tileArea.topLeft(),
+                            tileArea.size(), BORDER_REPEAT);
+
+        pixels->resize(tile.width() * tile.height() * src->pixelSize());
+        result->readBytes(pixels->data(), tile);
+    }
+
+    /**
+     * Converts the padded tile into premultiplied channel planes, the
+     * pixels outside the data rect repeat its border
+     */
+    void loadPlanes(const quint8 *data, const QRect &dataBounds,
+                    const QRect &tile, const GradientChannels &channels,
+                    QVector<double> *planes) const
+    {
+        const QRect padded = paddedRect(tile);
+        const int numChannels = channels.channels.size();
+        const int planeSize = padded.width() * padded.height();
+
+        planes->resize(numChannels * planeSize);
+        double *dstPtr = planes->data();
+
+        for (int y = padded.top(); y <= padded.bottom(); y++) {
+            const int readY = wrapAround ? y : qBound(dataRect.top(), y, dataRect.bottom());
+
+            for (int x = padded.left(); x <= padded.right(); x++) {
+                const int readX = wrapAround ? x : qBound(dataRect.left(), x, dataRect.right());
+                const quint8 *pixel = data +
+                    ((readY - dataBounds.top()) * dataBounds.width() + readX - dataBounds.left()) * channels.pixelSize;
+
+                const double alpha = channels.alphaIndex >= 0 ?
+                    channels.toDouble[channels.alphaIndex](pixel, channels.alphaPos) : 1.0;
+
+                for (int k = 0; k < numChannels; k++) {
+                    dstPtr[k * planeSize] = k == channels.alphaIndex ? alpha :
+                        channels.toDouble[k](pixel, channels.channels[k]->pos()) * alpha;
+                }
+                dstPtr++;
+            }
+        }
+    }
+
+    /**
+     * Sums the kernel over the row \p row of the tile for all the
+     * channels, in the same order as the spatial convolution worker
+     */
+    void accumulateRow(const QVector<double> &planes, const QRect &tile, int row,
+                       int numChannels, QVector<double> *sums) const
+    {
+        const QRect padded = paddedRect(tile);
+        const int width = tile.width();
+        const int planeSize = padded.width() * padded.height();
+        const KisConvolutionRowKernel *rowKernel = KisConvolutionRowKernel::instance();
+
+        sums->fill(0.0, numChannels * width);
+
+        Q_FOREACH (const Coefficient &c, coefficients) {
+            for (int k = 0; k < numChannels; k++) {
+                rowKernel->accumulate(sums->data() + k * width,
+                                      planes.constData() + k * planeSize + (row + c.ky) * padded.width() + c.kx,
+                                      c.weight, width);
+            }
+        }
+    }
+
+    /**
+     * Writes the convolved channels into \p pixel, which holds the
+     * original pixel, the same way the spatial convolution worker does
+     */
+    void writePixel(const GradientChannels &channels, const double *sums, int stride, quint8 *pixel) const
+    {
+        const int numChannels = channels.channels.size();
+
+        auto writeChannel = [&] (int k, double value) {
+            if (value > channels.maxValue[k]) {
+                value = channels.maxValue[k];
+            } else if (!(value >= channels.minValue[k])) {
+                value = channels.minValue[k];
+            }
+            channels.fromDouble[k](pixel, channels.channels[k]->pos(), value);
+            return value;
+        };
+
+        if (channels.alphaIndex >= 0) {
+            const double alpha =
+                writeChannel(channels.alphaIndex,
+                             sums[channels.alphaIndex * stride] * factor + offset[channels.alphaIndex]);
+
+            for (int k = 0; k < numChannels; k++) {
+                if (k == channels.alphaIndex) continue;
+
+                if (alpha != 0.0) {
+                    writeChannel(k, (sums[k * stride] * factor) * (1.0 / alpha) + offset[k]);
+                } else {
+                    channels.fromDouble[k](pixel, channels.channels[k]->pos(), 0.0);
+                }
+            }
+        } else {
+            for (int k = 0; k < numChannels; k++) {
+                writeChannel(k, sums[k * stride] * factor + offset[k]);
+            }
+        }
+    }
+
+    KisConvolutionKernelSP kernel;
+    QBitArray channelFlags;
+    bool useFFT;
+    int halfWidth;
+    int halfHeight;
+    int halo;
+    QRect area;
+    QVector<Coefficient> coefficients;
+    double factor;
+    QVector<double> offset;
+    bool wrapAround;
+    QRect dataRect;
+};
+
+/**
+ * Computes both gradients of every pixel of \p tile in a single pass and
+ * passes them to \p combine together with the pixel of the destination.
+ * The padded tile is read from \p src once and converted into channel
+ * planes; both kernels are applied to the planes row by row. The gradient
+ * pixels get the same values the convolution painter used to write into
+ * two temporary devices, but they never leave a per-pixel buffer.
+ * Only the kernels going to the FFT engine are convolved separately.
+ */
+void processGradientTile(KisPaintDeviceSP src, KisPaintDeviceSP dst,
+                         const QRect &tile,
+                         const GradientChannels &channels,
+                         const GradientKernel &kernelX,
+                         const GradientKernel &kernelY,
+                         std::function<void(const quint8*, const quint8*, quint8*)> combine)
+{
+    const int pixelSize = channels.pixelSize;
+    const int numChannels = channels.channels.size();
+
+    const QRect dataBounds = tile | kernelX.readRect(tile) | kernelY.readRect(tile);
+    QVector<quint8> data(dataBounds.width() * dataBounds.height() * pixelSize);
+    src->readBytes(data.data(), dataBounds);
+
+    QVector<double> planesX;
+    QVector<double> planesY;
+    QVector<quint8> convolvedX;
+    QVector<quint8> convolvedY;
+
+    if (kernelX.useFFT) {
+        kernelX.convolveTile(src, tile, &convolvedX);
+    } else {
+        kernelX.loadPlanes(data.constData(), dataBounds, tile, channels, &planesX);
+    }
+
+    if (kernelY.useFFT) {
+        kernelY.convolveTile(src, tile, &convolvedY);
+    } else {
+        kernelY.loadPlanes(data.constData(), dataBounds, tile, channels, &planesY);
+    }
+
+    const int width = tile.width();
+    QVector<quint8> result(width * tile.height() * pixelSize);
+    QVector<double> sumsX;
+    QVector<double> sumsY;
+    QVector<quint8> pixelX(pixelSize);
+    QVector<quint8> pixelY(pixelSize);
+
+    for (int row = 0; row < tile.height(); row++) {
+        if (!kernelX.useFFT) {
+            kernelX.accumulateRow(planesX, tile, row, numChannels, &sumsX);
+        }
+        if (!kernelY.useFFT) {
+            kernelY.accumulateRow(planesY, tile, row, numChannels, &sumsY);
+        }
+
+        const quint8 *srcRow = data.constData() +
+            ((tile.top() + row - dataBounds.top()) * dataBounds.width() + tile.left() - dataBounds.left()) * pixelSize;
+        quint8 *dstRow = result.data() + row * width * pixelSize;
+
+        memcpy(dstRow, srcRow, width * pixelSize);
+
+        for (int x = 0; x < width; x++) {
+            const int offset = (row * width + x) * pixelSize;
+
+            if (kernelX.useFFT) {
+                memcpy(pixelX.data(), convolvedX.constData() + offset, pixelSize);
+            } else {
+                memcpy(pixelX.data(), srcRow + x * pixelSize, pixelSize);
+                kernelX.writePixel(channels, sumsX.constData() + x, width, pixelX.data());
+            }
+
+            if (kernelY.useFFT) {
+                memcpy(pixelY.data(), convolvedY.constData() + offset, pixelSize);
+            } else {
+                memcpy(pixelY.data(), srcRow + x * pixelSize, pixelSize);
+                kernelY.writePixel(channels, sumsY.constData() + x, width, pixelY.data());
+            }
+
+            combine(pixelX.constData(), pixelY.constData(), dstRow + offset);
+        }
+    }
+
+    dst->writeBytes(result.constData(), tile);
+}
+
+/**
+ * Runs \p func for every tile-aligned patch of \p rect in parallel.
+ *
+ * The patches write into \p device while their neighbours still read
+ * it, so they read a copy-on-write snapshot of the device instead.
+ */
+void processGradientInTiles(KisPaintDeviceSP device,
+                            const QRect &rect,
+                            KoUpdater *progressUpdater,
+                            std::function<void(KisPaintDeviceSP, const QRect&)> func)
+{
+    KisPaintDeviceSP src = new KisPaintDevice(*device);
+
+    const QVector<QRect> patches =
+        KritaUtils::splitRectIntoPatches(rect, KritaUtils::optimalPatchSize());
+
+    KritaUtils::processRectsInParallel(patches,
+        [&] (const QRect &patch) {
+            func(src, patch);
+        },
+        progressUpdater);
+}
+
+}
 
 KisEdgeDetectionKernel::KisEdgeDetectionKernel()
 {
@@ -202,78 +579,64 @@ void KisEdgeDetectionKernel::applyEdgeDetection(KisPaintDeviceSP device,
                                                 bool writeToAlpha)
 {
     QPoint srcTopLeft = rect.topLeft();
-    KisPainter finalPainter(device);
-    finalPainter.setChannelFlags(channelFlags);
-    finalPainter.setProgress(progressUpdater);
     if (output == pythagorean || output == radian) {
-        KisPaintDeviceSP x_denormalised = new KisPaintDevice(device->colorSpace());
-        KisPaintDeviceSP y_denormalised = new KisPaintDevice(device->colorSpace());
-
         KisConvolutionKernelSP kernelHorizLeftRight = KisEdgeDetectionKernel::createHorizontalKernel(xRadius, type);
         KisConvolutionKernelSP kernelVerticalTopBottom = KisEdgeDetectionKernel::createVerticalKernel(yRadius, type);
 
         qreal horizontalCenter = qreal(kernelHorizLeftRight->width()) / 2.0;
         qreal verticalCenter = qreal(kernelVerticalTopBottom->height()) / 2.0;
 
-        KisConvolutionPainter horizPainterLR(x_denormalised);
-        horizPainterLR.setChannelFlags(channelFlags);
-        horizPainterLR.setProgress(progressUpdater);
-        horizPainterLR.applyMatrix(kernelHorizLeftRight, device,
-                                   srcTopLeft - QPoint(0, ceil(horizontalCenter)),
-                                   srcTopLeft - QPoint(0, ceil(horizontalCenter)),
-                                   rect.size() + QSize(0, 2 * ceil(horizontalCenter)), BORDER_REPEAT);
-
-
-        KisConvolutionPainter verticalPainterTB(y_denormalised);
-        verticalPainterTB.setChannelFlags(channelFlags);
-        verticalPainterTB.setProgress(progressUpdater);
-        verticalPainterTB.applyMatrix(kernelVerticalTopBottom, device,
-                                      srcTopLeft - QPoint(0, ceil(verticalCenter)),
-                                      srcTopLeft - QPoint(0, ceil(verticalCenter)),
-                                      rect.size() + QSize(0, 2 * ceil(verticalCenter)), BORDER_REPEAT);
-
-        KisSequentialIterator yItterator(y_denormalised, rect);
-        KisSequentialIterator xItterator(x_denormalised, rect);
-        KisSequentialIterator finalIt(device, rect);
-        const int pixelSize = device->colorSpace()->pixelSize();
-        const int channels = device->colorSpace()->channelCount();
-        QVector<float> yNormalised(channels);
-        QVector<float> xNormalised(channels);
-        QVector<float> finalNorm(channels);
+        const KoColorSpace *cs = device->colorSpace();
+        const int pixelSize = cs->pixelSize();
+        const int channels = cs->channelCount();
 
-        while(yItterator.nextPixel() && xItterator.nextPixel() && finalIt.nextPixel()) {
-            device->colorSpace()->normalisedChannelsValue(yItterator.rawData(), yNormalised);
-            device->colorSpace()->normalisedChannelsValue(xItterator.rawData(), xNormalised);
-            device->colorSpace()->normalisedChannelsValue(finalIt.rawData(), finalNorm);
+        const GradientChannels gradientChannels(cs, channelFlags);
+        if (!gradientChannels.isValid) return;
 
-            if (output == pythagorean) {
-                for (int c = 0; c<channels; c++) {
-                    finalNorm[c] = 2 * sqrt( ((xNormalised[c]-0.5)*(xNormalised[c]-0.5)) + ((yNormalised[c]-0.5)*(yNormalised[c]-0.5)));
-                }
-            } else { //radian
-                for (int c = 0; c<channels; c++) {
-                    finalNorm[c] = atan2(xNormalised[c]-0.5, yNormalised[c]-0.5);
-                }
-            }
+        const GradientKernel kernelX(kernelHorizLeftRight, device, rect,
+                                     ceil(horizontalCenter), Qt::Vertical, gradientChannels, channelFlags);
+        const GradientKernel kernelY(kernelVerticalTopBottom, device, rect,
+                                     ceil(verticalCenter), Qt::Vertical, gradientChannels, channelFlags);
 
-            if (writeToAlpha) {
-                KoColor col(finalIt.rawData(), device->colorSpace());
-                qreal alpha = 0;
+        processGradientInTiles(device, rect, progressUpdater,
+            [&] (KisPaintDeviceSP src, const QRect &tile) {
+
+            QVector<float> yNormalised(channels);
+            QVector<float> xNormalised(channels);
+            QVector<float> finalNorm(channels);
+
+            processGradientTile(src, device, tile, gradientChannels, kernelX, kernelY,
+                [&] (const quint8 *xPixel, const quint8 *yPixel, quint8 *dstPixel) {
+
+                cs->normalisedChannelsValue(yPixel, yNormalised);
+                cs->normalisedChannelsValue(xPixel, xNormalised);
 
-                for (int c = 0; c<(channels-1); c++) {
-                    alpha = alpha+finalNorm[c];
+                if (output == pythagorean) {
+                    for (int c = 0; c<channels; c++) {
+                        finalNorm[c] = 2 * sqrt( ((xNormalised[c]-0.5)*(xNormalised[c]-0.5)) + ((yNormalised[c]-0.5)*(yNormalised[c]-0.5)));
+                    }
+                } else { //radian
+                    for (int c = 0; c<channels; c++) {
+                        finalNorm[c] = atan2(xNormalised[c]-0.5, yNormalised[c]-0.5);
+                    }
                 }
 
-                alpha = qMin(alpha/(channels-1), col.opacityF());
-                col.setOpacity(alpha);
-                memcpy(finalIt.rawData(), col.data(), pixelSize);
-            } else {
-                quint8* f = finalIt.rawData();
-                device->colorSpace()->fromNormalisedChannelsValue(f, finalNorm);
-                memcpy(finalIt.rawData(), f, pixelSize);
-            }
+                if (writeToAlpha) {
+                    KoColor col(dstPixel, cs);
+                    qreal alpha = 0;
 
-        }
+                    for (int c = 0; c<(channels-1); c++) {
+                        alpha = alpha+finalNorm[c];
+                    }
+
+                    alpha = qMin(alpha/(channels-1), col.opacityF());
+                    col.setOpacity(alpha);
+                    memcpy(dstPixel, col.data(), pixelSize);
+                } else {
+                    cs->fromNormalisedChannelsValue(dstPixel, finalNorm);
+                }
+            });
+        });
     } else {
         KisConvolutionKernelSP kernel;
         qreal center = 0;
@@ -342,63 +705,50 @@ void KisEdgeDetectionKernel::convertToNormalMap(KisPaintDeviceSP device,
                                                 const QBitArray &channelFlags,
                                                 KoUpdater *progressUpdater)
 {
-    QPoint srcTopLeft = rect.topLeft();
-    KisPainter finalPainter(device);
-    finalPainter.setChannelFlags(channelFlags);
-    finalPainter.setProgress(progressUpdater);
-    KisPaintDeviceSP x_denormalised = new KisPaintDevice(device->colorSpace());
-    KisPaintDeviceSP y_denormalised = new KisPaintDevice(device->colorSpace());
-
     KisConvolutionKernelSP kernelHorizLeftRight = KisEdgeDetectionKernel::createHorizontalKernel(yRadius, type, true, !channelFlip[1]);
     KisConvolutionKernelSP kernelVerticalTopBottom = KisEdgeDetectionKernel::createVerticalKernel(xRadius, type, true, !channelFlip[0]);
 
     qreal horizontalCenter = qreal(kernelHorizLeftRight->width()) / 2.0;
     qreal verticalCenter = qreal(kernelVerticalTopBottom->height()) / 2.0;
 
-    KisConvolutionPainter horizPainterLR(y_denormalised);
-    horizPainterLR.setChannelFlags(channelFlags);
-    horizPainterLR.setProgress(progressUpdater);
-    horizPainterLR.applyMatrix(kernelHorizLeftRight, device,
-                               srcTopLeft - QPoint(ceil(horizontalCenter), 0),
-                               srcTopLeft - QPoint(ceil(horizontalCenter), 0),
-                               rect.size() + QSize(2 * ceil(horizontalCenter), 0), BORDER_REPEAT);
-
-
-    KisConvolutionPainter verticalPainterTB(x_denormalised);
-    verticalPainterTB.setChannelFlags(channelFlags);
-    verticalPainterTB.setProgress(progressUpdater);
-    verticalPainterTB.applyMatrix(kernelVerticalTopBottom, device,
-                                  srcTopLeft - QPoint(0, ceil(verticalCenter)),
-                                  srcTopLeft - QPoint(0, ceil(verticalCenter)),
-                                  rect.size() + QSize(0, 2 * ceil(verticalCenter)), BORDER_REPEAT);
-
-    KisSequentialIterator yItterator(y_denormalised, rect);
-    KisSequentialIterator xItterator(x_denormalised, rect);
-    KisSequentialIterator finalIt(device, rect);
-    const int pixelSize = device->colorSpace()->pixelSize();
-    const int channels = device->colorSpace()->channelCount();
-    QVector<float> yNormalised(channels);
-    QVector<float> xNormalised(channels);
-    QVector<float> finalNorm(channels);
-
-    while(yItterator.nextPixel() && xItterator.nextPixel() && finalIt.nextPixel()) {
-        device->colorSpace()->normalisedChannelsValue(yItterator.rawData(), yNormalised);
-        device->colorSpace()->normalisedChannelsValue(xItterator.rawData(), xNormalised);
-
-        qreal z = 1.0;
-        if (channelFlip[2]==true){
-            z=-1.0;
-        }
-        QVector3D normal = QVector3D((xNormalised[channelToConvert]-0.5)*2, (yNormalised[channelToConvert]-0.5)*2, z);
-        normal.normalize();
-        finalNorm.fill(1.0);
-        for (int c = 0; c<3; c++) {
-            finalNorm[device->colorSpace()->channels().at(channelOrder[c])->displayPosition()] = (normal[channelOrder[c]]/2)+0.5;
-        }
-
-        quint8* pixel = finalIt.rawData();
-        device->colorSpace()->fromNormalisedChannelsValue(pixel, finalNorm);
-        memcpy(finalIt.rawData(), pixel, pixelSize);
+    const KoColorSpace *cs = device->colorSpace();
+    const int channels = cs->channelCount();
+    const qreal z = channelFlip[2] ? -1.0 : 1.0;
 
+    QVector<int> channelPositions(3);
+    for (int c = 0; c < 3; c++) {
+        channelPositions[c] = cs->channels().at(channelOrder[c])->displayPosition();
     }
+
+    const GradientChannels gradientChannels(cs, channelFlags);
+    if (!gradientChannels.isValid) return;
+
+    const GradientKernel kernelX(kernelVerticalTopBottom, device, rect,
+                                 ceil(verticalCenter), Qt::Vertical, gradientChannels, channelFlags);
+    const GradientKernel kernelY(kernelHorizLeftRight, device, rect,
+                                 ceil(horizontalCenter), Qt::Horizontal, gradientChannels, channelFlags);
+
+    processGradientInTiles(device, rect, progressUpdater,
+        [&] (KisPaintDeviceSP src, const QRect &tile) {
+
+        QVector<float> yNormalised(channels);
+        QVector<float> xNormalised(channels);
+        QVector<float> finalNorm(channels);
+
+        processGradientTile(src, device, tile, gradientChannels, kernelX, kernelY,
+            [&] (const quint8 *xPixel, const quint8 *yPixel, quint8 *dstPixel) {
+
+            cs->normalisedChannelsValue(yPixel, yNormalised);
+            cs->normalisedChannelsValue(xPixel, xNormalised);
+
+            QVector3D normal = QVector3D((xNormalised[channelToConvert]-0.5)*2, (yNormalised[channelToConvert]-0.5)*2, z);
+            normal.normalize();
+            finalNorm.fill(1.0);
+            for (int c = 0; c<3; c++) {
+                finalNorm[channelPositions[c]] = (normal[channelOrder[c]]/2)+0.5;
+            }
+
+            cs->fromNormalisedChannelsValue(dstPixel, finalNorm);
+        });
+    });
 }
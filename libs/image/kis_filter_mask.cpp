@@ -97,9 +97,12 @@ QRect KisFilterMask::decorateRect(KisPaintDeviceSP &src,
     KIS_ASSERT_RECOVER_NOOP(this->busyProgressIndicator());
     this->busyProgressIndicator()->update();
 
+    const int lod = dst->defaultBounds()->currentLevelOfDetail();
+    filterConfig = filter->lodConfiguration(filterConfig, lod);
+
     filter->process(src, dst, 0, rc, filterConfig.data(), 0);
 
-    QRect r = filter->changedRect(rc, filterConfig.data(), dst->defaultBounds()->currentLevelOfDetail());
+    QRect r = filter->changedRect(rc, filterConfig.data(), lod);
     return r;
 }
 
@@ -133,7 +136,7 @@ QRect KisFilterMask::changeRect(const QRect &rect, PositionToFilthy pos) const
             parent->projection()->defaultBounds()->currentLevelOfDetail() : 0;
 
         KisFilterSP filter = KisFilterRegistry::instance()->value(filterConfig->name());
-        filteredRect = filter->changedRect(rect, filterConfig.data(), lod);
+        filteredRect = filter->changedRect(rect, filter->lodConfiguration(filterConfig, lod).data(), lod);
     }
 
     /**
@@ -177,6 +180,6 @@ QRect KisFilterMask::needRect(const QRect& rect, PositionToFilthy pos) const
      * And no KisMask::needRect will prevent us from doing this! ;)
      * That's why simply we do not call KisMask::needRect here :)
      */
-    return filter->neededRect(rect, filterConfig.data(), lod);
+    return filter->neededRect(rect, filter->lodConfiguration(filterConfig, lod).data(), lod);
 }
 
@@ -22,6 +22,9 @@
 #include "kis_convolution_kernel.h"
 #include <kis_convolution_painter.h>
 #include <kis_transaction.h>
+#include <kis_default_bounds_base.h>
+#include "KisRecursiveGaussianBlur.h"
+#include <KoUpdater.h>
 #include <QRect>
 
 
@@ -100,15 +103,105 @@ KisGaussianKernel::createVerticalKernel(qreal radius)
     return KisConvolutionKernel::fromMatrix(matrix, 0, matrix.sum());
 }
 
+bool KisGaussianKernel::prefersRecursiveEngine(KisPaintDeviceSP device, qreal radius)
+{
+    /**
+     * The recursive filter has constant cost per pixel, which becomes
+     * lower than the cost of the separable convolution at about 30 taps
+     * per pass. We don't switch too early though: on small radii the
+     * difference between the exact and the approximated blur may still
+     * be noticeable.
+     */
+    const int minRecursiveKernelSize = 49;
+
+    /**
+     * The recursive engine reads the device directly, so it doesn't
+     * support the wrap around mode of the device iterators.
+     */
+    if (device->defaultBounds()->wrapAroundMode()) return false;
+
+    return radius > 0.0 && kernelSizeFromRadius(radius) >= minRecursiveKernelSize;
+}
+
 void KisGaussianKernel::applyGaussian(KisPaintDeviceSP device,
                                       const QRect& rect,
                                       qreal xRadius, qreal yRadius,
                                       const QBitArray &channelFlags,
                                       KoUpdater *progressUpdater,
-                                      bool createTransaction)
+                                      bool createTransaction,
+                                      Engine engine)
 {
+    const bool xRecursive = xRadius > 0.0 &&
+        (engine == RecursiveEngine ||
+         (engine == AutoEngine && prefersRecursiveEngine(device, xRadius)));
+
+    const bool yRecursive = yRadius > 0.0 &&
+        (engine == RecursiveEngine ||
+         (engine == AutoEngine && prefersRecursiveEngine(device, yRadius)));
+
+    if ((xRecursive || yRecursive) &&
+        (xRecursive || xRadius <= 0.0) &&
+        (yRecursive || yRadius <= 0.0)) {
+
+        /**
+         * Every band of the recursive engine reads the source data before
+         * writing the result back, so no transaction is needed even when
+         * the blur is applied in place.
+         */
+        KisRecursiveGaussianBlur::apply(device, rect, xRadius, yRadius, channelFlags, progressUpdater);
+        return;
+    }
+
     QPoint srcTopLeft = rect.topLeft();
 
+    if (xRecursive || yRecursive) {
+        /**
+         * An anisotropic blur: the large axis goes to the recursive
+         * engine, and the small one, whose sigma is too small for the
+         * recursive approximation, to the exact convolution.
+         */
+        KisPaintDeviceSP interm = new KisPaintDevice(device->colorSpace());
+
+        // the same halos as the ones of the recursive and the convolution paths
+        const int verticalKernelSize = kernelSizeFromRadius(yRadius);
+        const int verticalHalo = yRecursive ?
+            verticalKernelSize / 2 :
+            ceil(qreal(verticalKernelSize) / 2.0);
+
+        // the vertical pass needs horizontally blurred rows above and below the rect
+        const QRect horizontalRect = rect.adjusted(0, -verticalHalo, 0, verticalHalo);
+
+        if (xRecursive) {
+            KisRecursiveGaussianBlur::applyPass(device, interm, horizontalRect,
+                                                horizontalRect | device->exactBounds(),
+                                                Qt::Horizontal, xRadius,
+                                                channelFlags, progressUpdater);
+        } else {
+            KisConvolutionPainter horizPainter(interm);
+            horizPainter.setChannelFlags(channelFlags);
+            horizPainter.setProgress(progressUpdater);
+            horizPainter.applyMatrix(KisGaussianKernel::createHorizontalKernel(xRadius), device,
+                                     horizontalRect.topLeft(), horizontalRect.topLeft(),
+                                     horizontalRect.size(), BORDER_REPEAT);
+        }
+
+        if (progressUpdater && progressUpdater->interrupted()) return;
+
+        if (yRecursive) {
+            KisRecursiveGaussianBlur::applyPass(interm, device, rect, horizontalRect,
+                                                Qt::Vertical, yRadius,
+                                                channelFlags, progressUpdater);
+        } else {
+            KisConvolutionPainter verticalPainter(device);
+            verticalPainter.setChannelFlags(channelFlags);
+            verticalPainter.setProgress(progressUpdater);
+            verticalPainter.applyMatrix(KisGaussianKernel::createVerticalKernel(yRadius), interm,
+                                        srcTopLeft, srcTopLeft, rect.size(), BORDER_REPEAT);
+        }
+
+        return;
+    }
+
     if (xRadius > 0.0 && yRadius > 0.0) {
         KisPaintDeviceSP interm = new KisPaintDevice(device->colorSpace());
 
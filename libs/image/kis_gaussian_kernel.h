@@ -29,6 +29,12 @@ class QRect;
 class KRITAIMAGE_EXPORT KisGaussianKernel
 {
 public:
+    enum Engine {
+        AutoEngine,        ///< choose the engine depending on the radius
+        ConvolutionEngine, ///< exact separable convolution, cost grows with the radius
+        RecursiveEngine    ///< constant-time IIR approximation, see KisRecursiveGaussianBlur
+    };
+
     static Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic>
         createHorizontalMatrix(qreal radius);
 
@@ -44,12 +50,21 @@ public:
     static qreal sigmaFromRadius(qreal radius);
     static int kernelSizeFromRadius(qreal radius);
 
+    /**
+     * \return true if AutoEngine would use the recursive engine for
+     *         blurring \p device along an axis with \p radius. The
+     *         engine is chosen for every axis separately, so an
+     *         anisotropic blur may use both engines.
+     */
+    static bool prefersRecursiveEngine(KisPaintDeviceSP device, qreal radius);
+
     static void applyGaussian(KisPaintDeviceSP device,
                               const QRect& rect,
                               qreal xRadius, qreal yRadius,
                               const QBitArray &channelFlags,
                               KoUpdater *updater,
-                              bool createTransaction = false);
+                              bool createTransaction = false,
+                              Engine engine = AutoEngine);
 
     static Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> createLoGMatrix(qreal radius, qreal coeff = 1.0);
 
@@ -598,3 +598,13 @@ void KisImageConfig::setSelectionOverlayMaskColor(const QColor &color)
 {
     m_config.writeEntry("selectionOverlayMaskColor", color);
 }
+
+int KisImageConfig::persistentDabCacheLimit(bool defaultValue) const
+{
+    return defaultValue ? 64 : m_config.readEntry("persistentDabCacheLimit", 64);
+}
+
+void KisImageConfig::setPersistentDabCacheLimit(int value)
+{
+    m_config.writeEntry("persistentDabCacheLimit", value);
+}
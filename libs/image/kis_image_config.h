@@ -141,6 +141,9 @@ public:
     QColor selectionOverlayMaskColor(bool defaultValue = false) const;
     void setSelectionOverlayMaskColor(const QColor &color);
 
+    int persistentDabCacheLimit(bool defaultValue = false) const; // MiB
+    void setPersistentDabCacheLimit(int value);
+
 private:
     Q_DISABLE_COPY(KisImageConfig)
 
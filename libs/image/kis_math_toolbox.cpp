@@ -28,11 +28,13 @@
 
 #include <QVector>
 #include <QGlobalStatic>
+#include <QScopedPointer>
 
 #include <KoColorSpaceMaths.h>
 
 #include <kis_debug.h>
 #include "kis_iterator_ng.h"
+#include "krita_utils.h"
 
 #include "math.h"
 
@@ -69,8 +71,8 @@ void KisMathToolbox::transformToFR(KisPaintDeviceSP src, KisFloatRepresentation*
 
     KisHLineConstIteratorSP srcIt = src->createHLineIteratorNG(rect.x(), rect.y(), rect.width());
 
-    for (int i = rect.y(); i < rect.height(); i++) {
-        float *dstIt = fr->coeffs + (i - rect.y()) * fr->size * fr->depth;
+    for (int i = 0; i < rect.height(); i++) {
+        float *dstIt = fr->coeffs + i * fr->size * fr->depth;
         do {
             const quint8* v1 = srcIt->oldRawData();
             for (int k = 0; k < depth; k++) {
@@ -132,8 +134,8 @@ void KisMathToolbox::transformFromFR(KisPaintDeviceSP dst, KisFloatRepresentatio
         return;
 
     KisHLineIteratorSP dstIt = dst->createHLineIteratorNG(rect.x(), rect.y(), rect.width());
-    for (int i = rect.y(); i < rect.height(); i++) {
-        float *srcIt = fr->coeffs + (i - rect.y()) * fr->size * fr->depth;
+    for (int i = 0; i < rect.height(); i++) {
+        float *srcIt = fr->coeffs + i * fr->size * fr->depth;
         do {
             quint8* v1 = dstIt->rawData();
             for (int k = 0; k < depth; k++) {
@@ -229,14 +231,22 @@ void KisMathToolbox::wavetrans(KisMathToolbox::KisWavelet* wav, KisMathToolbox::
         float * itS21 = wav->coeffs + (2 * i + 1) * wav->size * wav->depth;
         float * itS22 = wav->coeffs + ((2 * i + 1) * wav->size + 1) * wav->depth;
         for (uint j = 0; j < halfsize; j++) {
+            // horizontal and vertical butterflies of the Haar lifting step
             for (uint k = 0; k < wav->depth; k++) {
-                *(itLL++) = (*itS11 + *itS12 + *itS21 + *itS22) * M_SQRT1_2;
-                *(itHL++) = (*itS11 - *itS12 + *itS21 - *itS22) * M_SQRT1_2;
-                *(itLH++) = (*itS11 + *itS12 - *itS21 - *itS22) * M_SQRT1_2;
-                *(itHH++) = (*(itS11++) - *(itS12++) - *(itS21++) + *(itS22++)) * M_SQRT1_2;
+                const float a = itS11[k] + itS12[k];
+                const float b = itS11[k] - itS12[k];
+                const float c = itS21[k] + itS22[k];
+                const float d = itS21[k] - itS22[k];
+
+                itLL[k] = (a + c) * float(M_SQRT1_2);
+                itHL[k] = (b + d) * float(M_SQRT1_2);
+                itLH[k] = (a - c) * float(M_SQRT1_2);
+                itHH[k] = (b - d) * float(M_SQRT1_2);
             }
-            itS11 += wav->depth; itS12 += wav->depth;
-            itS21 += wav->depth; itS22 += wav->depth;
+            itLL += wav->depth; itHL += wav->depth;
+            itLH += wav->depth; itHH += wav->depth;
+            itS11 += 2 * wav->depth; itS12 += 2 * wav->depth;
+            itS21 += 2 * wav->depth; itS22 += 2 * wav->depth;
         }
     }
     for (uint i = 0; i < halfsize; i++) {
@@ -264,13 +274,20 @@ void KisMathToolbox::waveuntrans(KisMathToolbox::KisWavelet* wav, KisMathToolbox
         float * itS22 = buff->coeffs + ((2 * i + 1) * wav->size + 1) * wav->depth;
         for (uint j = 0; j < halfsize; j++) {
             for (uint k = 0; k < wav->depth; k++) {
-                *(itS11++) = (*itLL + *itHL + *itLH + *itHH) * 0.25 * M_SQRT2;
-                *(itS12++) = (*itLL - *itHL + *itLH - *itHH) * 0.25 * M_SQRT2;
-                *(itS21++) = (*itLL + *itHL - *itLH - *itHH) * 0.25 * M_SQRT2;
-                *(itS22++) = (*(itLL++) - *(itHL++) - *(itLH++) + *(itHH++)) * 0.25 * M_SQRT2;
+                const float a = itLL[k] + itHL[k];
+                const float b = itLL[k] - itHL[k];
+                const float c = itLH[k] + itHH[k];
+                const float d = itLH[k] - itHH[k];
+
+                itS11[k] = (a + c) * float(0.25 * M_SQRT2);
+                itS12[k] = (b + d) * float(0.25 * M_SQRT2);
+                itS21[k] = (a - c) * float(0.25 * M_SQRT2);
+                itS22[k] = (b - d) * float(0.25 * M_SQRT2);
             }
-            itS11 += wav->depth; itS12 += wav->depth;
-            itS21 += wav->depth; itS22 += wav->depth;
+            itLL += wav->depth; itHL += wav->depth;
+            itLH += wav->depth; itHH += wav->depth;
+            itS11 += 2 * wav->depth; itS12 += 2 * wav->depth;
+            itS21 += 2 * wav->depth; itS22 += 2 * wav->depth;
         }
     }
     for (uint i = 0; i < halfsize; i++) {
@@ -306,3 +323,25 @@ void KisMathToolbox::fastWaveletUntransformation(KisPaintDeviceSP dst, const QRe
     waveuntrans(wav, buff, 1);
     transformFromFR(dst, wav, rect);
 }
+
+void KisMathToolbox::fastWaveletTiledProcessing(KisPaintDeviceSP device, const QRect &rect,
+                                                std::function<void(KisWavelet*)> func,
+                                                KoUpdater *progressUpdater)
+{
+    const QVector<QRect> patches = KritaUtils::splitRectIntoPatches(rect, QSize(512, 512));
+
+    KritaUtils::processRectsInParallel(patches,
+        [&] (const QRect &patch) {
+            try {
+                QScopedPointer<KisWavelet> buff(initWavelet(device, patch));
+                QScopedPointer<KisWavelet> wav(fastWaveletTransformation(device, patch, buff.data()));
+
+                func(wav.data());
+
+                fastWaveletUntransformation(device, patch, wav.data(), buff.data());
+            } catch (const std::bad_alloc&) {
+                warnImage << "KisMathToolbox: not enough memory to transform patch" << patch;
+            }
+        },
+        progressUpdater);
+}
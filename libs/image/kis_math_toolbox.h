@@ -25,6 +25,7 @@
 #include <QRect>
 
 #include <new>
+#include <functional>
 
 #include <KoColorSpace.h>
 
@@ -42,6 +43,8 @@
 typedef double(*PtrToDouble)(const quint8*, int);
 typedef void (*PtrFromDouble)(quint8*, int, double);
 
+class KoUpdater;
+
 class KRITAIMAGE_EXPORT KisMathToolbox
 {
 
@@ -99,6 +102,26 @@ public:
      */
     void fastWaveletUntransformation(KisPaintDeviceSP dst, const QRect&, KisWavelet* wav, KisWavelet* buff = 0);
 
+    /**
+     * Transforms \p rect of \p device into wavelets, lets \p func modify
+     * the coefficients and transforms the result back into \p device.
+     *
+     * The rect is split into the patches aligned to a 512 px grid, every
+     * patch has its own wavelet pyramid, so the memory consumption is
+     * limited by the patch size instead of the size of the rect (rounded
+     * up to a power-of-two square!), and the patches are processed in
+     * parallel. The levels coarser than the patch size are not
+     * calculated. If the rect fits into a single patch, the result is
+     * the same as with fastWaveletTransformation() and
+     * fastWaveletUntransformation().
+     *
+     * \p func is called concurrently for different patches. A patch
+     * that cannot be allocated is left untouched.
+     */
+    void fastWaveletTiledProcessing(KisPaintDeviceSP device, const QRect &rect,
+                                    std::function<void(KisWavelet*)> func,
+                                    KoUpdater *progressUpdater = 0);
+
     bool getToDoubleChannelPtr(QList<KoChannelInfo *> cis, QVector<PtrToDouble>& f);
     bool getFromDoubleChannelPtr(QList<KoChannelInfo *> cis, QVector<PtrFromDouble>& f);
 
@@ -39,6 +39,14 @@
 
 #include <KisRenderedDab.h>
 
+#include <QThread>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <KisSharedRunnable.h>
+#include <KisSharedThreadPoolAdapter.h>
+#include <KoUpdater.h>
+
 
 namespace KritaUtils
 {
@@ -448,6 +456,114 @@ namespace KritaUtils
         return qreal(numTransparentPixels) / numPixels;
     }
 
+    struct ParallelRectsRunnable : public KisSharedRunnable
+    {
+        ParallelRectsRunnable(std::function<void()> func)
+            : m_func(func)
+        {
+        }
+
+        void runShared() override {
+            m_func();
+        }
+
+    private:
+        std::function<void()> m_func;
+    };
+
+    void processRectsInParallel(const QVector<QRect> &rects, std::function<void(const QRect&)> func)
+    {
+        processRectsInParallel(rects, func, std::function<bool(int)>());
+    }
+
+    void processRectsInParallel(const QVector<QRect> &rects,
+                                std::function<void(const QRect&)> func,
+                                std::function<bool(int)> progressFunc)
+    {
+        QAtomicInt nextRect(0);
+        QAtomicInt isCancelled(0);
+        QSemaphore numRectsDone;
+
+        auto processNextRect = [&nextRect, &isCancelled, &numRectsDone, &rects, &func] () {
+            const int index = nextRect.fetchAndAddOrdered(1);
+            if (index >= rects.size()) return false;
+
+            if (!isCancelled.load()) {
+                func(rects[index]);
+            }
+            numRectsDone.release();
+            return true;
+        };
+
+        /**
+         * Only the calling thread collects the finished rects, so the
+         * progress is reported from a single thread and never goes
+         * backwards.
+         */
+        int numRectsReported = 0;
+
+        auto reportProgress = [&] (bool waitForRect) {
+            const int numRects = qMax(numRectsDone.available(), waitForRect ? 1 : 0);
+            if (!numRects) return;
+
+            numRectsDone.acquire(numRects);
+            numRectsReported += numRects;
+
+            if (progressFunc && !isCancelled.load() && !progressFunc(numRectsReported)) {
+                isCancelled.store(1);
+            }
+        };
+
+        /**
+         * We use tryStart() instead of start() on purpose. The caller may
+         * be a thread pool job itself, so waiting for the jobs that are
+         * just queued may deadlock when the pool is saturated. The calling
+         * thread takes the rects itself, so the work is done even if no
+         * helper thread could be started.
+         */
+        KisSharedThreadPoolAdapter adapter(QThreadPool::globalInstance());
+
+        const int numHelpers = qMin(rects.size(), QThread::idealThreadCount()) - 1;
+        for (int i = 0; i < numHelpers; i++) {
+            ParallelRectsRunnable *runnable =
+                new ParallelRectsRunnable([&processNextRect] () { while (processNextRect()) ; });
+
+            if (!adapter.tryStart(runnable)) {
+                delete runnable;
+                break;
+            }
+        }
+
+        while (processNextRect()) {
+            reportProgress(false);
+        }
+
+        while (numRectsReported < rects.size()) {
+            reportProgress(true);
+        }
+
+        adapter.waitForDone();
+    }
+
+    void processRectsInParallel(const QVector<QRect> &rects,
+                                std::function<void(const QRect&)> func,
+                                KoUpdater *progressUpdater,
+                                int progressStart, int progressEnd)
+    {
+        if (!progressUpdater) {
+            processRectsInParallel(rects, func);
+            return;
+        }
+
+        progressUpdater->setProgress(progressStart);
+
+        processRectsInParallel(rects, func,
+            [&] (int numRectsDone) {
+                progressUpdater->setProgress(progressStart + (progressEnd - progressStart) * numRectsDone / rects.size());
+                return !progressUpdater->interrupted();
+            });
+    }
+
     void mirrorDab(Qt::Orientation dir, const QPoint &center, KisRenderedDab *dab)
     {
         const QRect rc = dab->realBounds();
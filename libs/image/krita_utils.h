@@ -27,6 +27,7 @@ class QPointF;
 class QPainterPath;
 class QBitArray;
 class QPainter;
+class KoUpdater;
 struct KisRenderedDab;
 
 #include <QVector>
@@ -112,6 +113,36 @@ namespace KritaUtils
 
     qreal KRITAIMAGE_EXPORT estimatePortionOfTransparentPixels(KisPaintDeviceSP dev, const QRect &rect, qreal samplePortion);
 
+    /**
+     * Calls \p func for every rect of \p rects and returns when all of
+     * them are processed. The rects are processed concurrently by the
+     * calling thread and by the idle threads of the global thread pool,
+     * so the function is safe to call from inside a thread pool job.
+     * The rects must not depend on each other.
+     */
+    void KRITAIMAGE_EXPORT processRectsInParallel(const QVector<QRect> &rects, std::function<void(const QRect&)> func);
+
+    /**
+     * Same as above, but also reports the progress. \p progressFunc is
+     * called with the number of rects processed so far, and it is always
+     * called from the calling thread, so it may use the reporters that
+     * are not thread-safe (e.g. KoUpdater). When it returns false, the
+     * rects that are not started yet are skipped.
+     */
+    void KRITAIMAGE_EXPORT processRectsInParallel(const QVector<QRect> &rects,
+                                                  std::function<void(const QRect&)> func,
+                                                  std::function<bool(int)> progressFunc);
+
+    /**
+     * Same as above, the progress is reported to \p progressUpdater
+     * (may be null) scaled into [\p progressStart, \p progressEnd], and
+     * the processing stops when the updater is interrupted.
+     */
+    void KRITAIMAGE_EXPORT processRectsInParallel(const QVector<QRect> &rects,
+                                                  std::function<void(const QRect&)> func,
+                                                  KoUpdater *progressUpdater,
+                                                  int progressStart = 0, int progressEnd = 100);
+
     void KRITAIMAGE_EXPORT mirrorDab(Qt::Orientation dir, const QPoint &center, KisRenderedDab *dab);
     void KRITAIMAGE_EXPORT mirrorRect(Qt::Orientation dir, const QPoint &center, QRect *rc);
 }
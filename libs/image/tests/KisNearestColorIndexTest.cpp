@@ -0,0 +1,220 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "KisNearestColorIndexTest.h"
+
+#include <QTest>
+#include <QImage>
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include "KisNearestColorIndex.h"
+#include "KisQuantizationUtils.h"
+
+namespace {
+
+typedef KisNearestColorIndex::Color Color;
+
+Color randomColor(int range)
+{
+    return {{quint16(qrand() % range), quint16(qrand() % range), quint16(qrand() % range)}};
+}
+
+qreal distanceSq(const Color &lhs, const Color &rhs, const std::array<qreal, 3> &weights)
+{
+    qreal result = 0;
+    for (int i = 0; i < 3; i++) {
+        const qreal diff = (qreal(lhs[i]) - rhs[i]) * weights[i];
+        result += diff * diff;
+    }
+    return result;
+}
+
+int linearSearch(const QVector<Color> &palette, const Color &color, const std::array<qreal, 3> &weights)
+{
+    int bestIndex = -1;
+    qreal bestDistance = std::numeric_limits<qreal>::max();
+
+    for (int i = 0; i < palette.size(); i++) {
+        const qreal distance = distanceSq(palette[i], color, weights);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            bestIndex = i;
+        }
+    }
+
+    return bestIndex;
+}
+
+}
+
+void KisNearestColorIndexTest::testMatchesLinearSearch_data()
+{
+    QTest::addColumn<int>("numColors");
+    QTest::addColumn<int>("range");
+    QTest::addColumn<qreal>("weight0");
+
+    QTest::newRow("empty") << 0 << 256 << 1.0;
+    QTest::newRow("single") << 1 << 256 << 1.0;
+    QTest::newRow("16") << 16 << 256 << 1.0;
+    QTest::newRow("256") << 256 << 256 << 1.0;
+    // small range gives a lot of equally near colors and duplicates
+    QTest::newRow("256-ties") << 256 << 8 << 1.0;
+    QTest::newRow("1000-lab16") << 1000 << 65536 << 1.0;
+    QTest::newRow("256-weighted") << 256 << 256 << 3.0;
+    QTest::newRow("256-zero-weight") << 256 << 256 << 0.0;
+}
+
+void KisNearestColorIndexTest::testMatchesLinearSearch()
+{
+    QFETCH(int, numColors);
+    QFETCH(int, range);
+    QFETCH(qreal, weight0);
+
+    qsrand(1);
+
+    QVector<Color> palette;
+    for (int i = 0; i < numColors; i++) {
+        palette.append(randomColor(range));
+    }
+
+    const std::array<qreal, 3> weights = {{weight0, 1.0, 0.5}};
+    KisNearestColorIndex index(palette, weights[0], weights[1], weights[2]);
+
+    QCOMPARE(index.numColors(), numColors);
+
+    for (int i = 0; i < 10000; i++) {
+        const Color color = randomColor(range);
+        QCOMPARE(index.nearestIndex(color), linearSearch(palette, color, weights));
+    }
+}
+
+void KisNearestColorIndexTest::testCandidates()
+{
+    qsrand(2);
+
+    QVector<Color> palette;
+    for (int i = 0; i < 300; i++) {
+        palette.append(randomColor(256));
+    }
+
+    const std::array<qreal, 3> weights = {{1.0, 1.0, 1.0}};
+    KisNearestColorIndex index(palette);
+
+    const qreal slack = 10.0;
+    QVector<int> candidates;
+
+    for (int i = 0; i < 1000; i++) {
+        const Color color = randomColor(256);
+        index.nearestCandidates(color, slack, &candidates);
+
+        const qreal best = std::sqrt(distanceSq(palette[linearSearch(palette, color, weights)], color, weights));
+
+        QVector<int> expected;
+        for (int j = 0; j < palette.size(); j++) {
+            if (std::sqrt(distanceSq(palette[j], color, weights)) <= best + slack) {
+                expected.append(j);
+            }
+        }
+
+        QCOMPARE(candidates, expected);
+    }
+}
+
+void KisNearestColorIndexTest::testCache()
+{
+    KisNearestColorIndex::Cache cache(4);
+    int index = -1;
+
+    const Color black = {{0, 0, 0}};
+    const Color white = {{255, 255, 255}};
+
+    // zero-initialized entries should not match black
+    QVERIFY(!cache.fetch(black, &index));
+
+    cache.store(black, 0);
+    QVERIFY(cache.fetch(black, &index));
+    QCOMPARE(index, 0);
+
+    cache.store(white, 7);
+    QVERIFY(cache.fetch(white, &index));
+    QCOMPARE(index, 7);
+
+    // indices that do not fit into an entry are not stored
+    const Color gray = {{128, 128, 128}};
+    cache.store(gray, 0xFFFF);
+    QVERIFY(!cache.fetch(gray, &index));
+
+    QVector<Color> palette({black, white});
+    KisNearestColorIndex colorIndex(palette);
+    KisNearestColorIndex::Cache resultCache;
+
+    QCOMPARE(colorIndex.nearestIndex({{200, 200, 200}}, &resultCache), 1);
+    QCOMPARE(colorIndex.nearestIndex({{200, 200, 200}}, &resultCache), 1);
+    QCOMPARE(colorIndex.nearestIndex({{20, 20, 20}}, &resultCache), 0);
+}
+
+void KisNearestColorIndexTest::testQuantization()
+{
+    QImage image(300, 200, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); y++) {
+        for (int x = 0; x < image.width(); x++) {
+            image.setPixel(x, y, qRgb(x * 255 / image.width(), y * 255 / image.height(), 128));
+        }
+    }
+
+    const QVector<QRgb> palette = KisQuantizationUtils::generatePalette(image, 64);
+    QVERIFY(!palette.isEmpty());
+    QVERIFY(palette.size() <= 64);
+
+    Q_FOREACH (bool errorDiffusion, QVector<bool>({false, true})) {
+        const QImage indexed = KisQuantizationUtils::convertToIndexed8(image, palette, errorDiffusion);
+
+        QCOMPARE(indexed.format(), QImage::Format_Indexed8);
+        QCOMPARE(indexed.size(), image.size());
+        QCOMPARE(indexed.colorTable(), palette);
+
+        // the gradient must stay close to the original
+        for (int y = 0; y < image.height(); y += 7) {
+            for (int x = 0; x < image.width(); x += 7) {
+                const QRgb src = image.pixel(x, y);
+                const QRgb dst = indexed.pixel(x, y);
+
+                QVERIFY(qAbs(qRed(src) - qRed(dst)) < 48);
+                QVERIFY(qAbs(qGreen(src) - qGreen(dst)) < 48);
+                QVERIFY(qAbs(qBlue(src) - qBlue(dst)) < 48);
+            }
+        }
+    }
+
+    // an image with few colors keeps them exactly
+    QImage twoColors(10, 10, QImage::Format_RGB32);
+    twoColors.fill(qRgb(10, 20, 30));
+    twoColors.setPixel(5, 5, qRgb(200, 100, 0));
+
+    const QVector<QRgb> exactPalette = KisQuantizationUtils::generatePalette(twoColors, 256);
+    QCOMPARE(exactPalette, QVector<QRgb>({qRgb(10, 20, 30), qRgb(200, 100, 0)}));
+
+    const QImage indexed = KisQuantizationUtils::convertToIndexed8(twoColors, exactPalette, true);
+    QCOMPARE(indexed.pixel(5, 5), qRgb(200, 100, 0));
+    QCOMPARE(indexed.pixel(0, 0), qRgb(10, 20, 30));
+}
+
+QTEST_MAIN(KisNearestColorIndexTest)
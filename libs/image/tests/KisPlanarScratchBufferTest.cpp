@@ -0,0 +1,146 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisPlanarScratchBufferTest.h"
+
+#include <QTest>
+
+#include <KoConfig.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoColorModelStandardIds.h>
+
+#include "KisPlanarScratchBuffer.h"
+
+void KisPlanarScratchBufferTest::testRoundTrip_data()
+{
+    QTest::addColumn<QString>("colorModelId");
+    QTest::addColumn<QString>("colorDepthId");
+
+    QTest::newRow("rgb8") << RGBAColorModelID.id() << Integer8BitsColorDepthID.id();
+    QTest::newRow("rgb16") << RGBAColorModelID.id() << Integer16BitsColorDepthID.id();
+#ifdef HAVE_OPENEXR
+    QTest::newRow("rgbf16") << RGBAColorModelID.id() << Float16BitsColorDepthID.id();
+#endif
+    QTest::newRow("rgbf32") << RGBAColorModelID.id() << Float32BitsColorDepthID.id();
+    QTest::newRow("gray8") << GrayAColorModelID.id() << Integer8BitsColorDepthID.id();
+    QTest::newRow("cmyk16") << CMYKAColorModelID.id() << Integer16BitsColorDepthID.id();
+}
+
+void KisPlanarScratchBufferTest::testRoundTrip()
+{
+    QFETCH(QString, colorModelId);
+    QFETCH(QString, colorDepthId);
+
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(colorModelId, colorDepthId, 0);
+    QVERIFY(cs);
+    QVERIFY(KisPlanarScratchBuffer::canRepresent(cs));
+
+    // odd number of pixels to exercise the tails of the loops
+    const int numPixels = 67;
+    const int numBytes = numPixels * cs->pixelSize();
+
+    QVector<quint8> src(numBytes);
+    QVector<quint8> dst(numBytes, 0);
+
+    // random colors, converted by the color space itself to be valid
+    // values for float channels as well
+    QVector<float> channelValues(cs->channelCount());
+    for (int i = 0; i < numPixels; i++) {
+        for (int c = 0; c < channelValues.size(); c++) {
+            channelValues[c] = float(qrand() % 1001) / 1000.0f;
+        }
+        cs->fromNormalisedChannelsValue(src.data() + i * cs->pixelSize(), channelValues);
+    }
+
+    KisPlanarScratchBuffer buffer(cs);
+    QCOMPARE(buffer.numPlanes(), int(cs->channelCount()));
+
+    buffer.deinterleave(src.constData(), numPixels);
+    QVERIFY(buffer.capacity() >= numPixels);
+
+    buffer.interleave(dst.data(), numPixels);
+
+    QCOMPARE(dst, src);
+}
+
+void KisPlanarScratchBufferTest::testPlaneOrder()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    // BGRA memory layout
+    const quint8 pixels[] = { 10, 20, 30, 255,
+                              0, 51, 102, 204 };
+
+    KisPlanarScratchBuffer buffer(cs, 2);
+    buffer.deinterleave(pixels, 2);
+
+    QCOMPARE(buffer.plane(0)[0], 10.0f / 255.0f);
+    QCOMPARE(buffer.plane(1)[0], 20.0f / 255.0f);
+    QCOMPARE(buffer.plane(2)[0], 30.0f / 255.0f);
+    QCOMPARE(buffer.plane(3)[0], 1.0f);
+
+    QCOMPARE(buffer.plane(0)[1], 0.0f);
+    QCOMPARE(buffer.plane(1)[1], 0.2f);
+    QCOMPARE(buffer.plane(2)[1], 0.4f);
+    QCOMPARE(buffer.plane(3)[1], 0.8f);
+
+    QCOMPARE(buffer.planes()[2], buffer.plane(2));
+}
+
+void KisPlanarScratchBufferTest::testClamping()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    const quint8 pixels[] = { 0, 0, 0, 0 };
+
+    KisPlanarScratchBuffer buffer(cs, 1);
+    buffer.deinterleave(pixels, 1);
+
+    buffer.plane(0)[0] = -0.5f;
+    buffer.plane(1)[0] = 1.5f;
+    buffer.plane(2)[0] = 0.6f;
+    buffer.plane(3)[0] = 1.0f;
+
+    quint8 result[4];
+    buffer.interleave(result, 1);
+
+    QCOMPARE(result[0], quint8(0));
+    QCOMPARE(result[1], quint8(255));
+    QCOMPARE(result[2], quint8(153));
+    QCOMPARE(result[3], quint8(255));
+}
+
+void KisPlanarScratchBufferTest::testIsPreferred()
+{
+    KoColorSpaceRegistry *registry = KoColorSpaceRegistry::instance();
+
+    QVERIFY(!KisPlanarScratchBuffer::isPreferred(registry->rgb8()));
+    QVERIFY(!KisPlanarScratchBuffer::isPreferred(registry->rgb16()));
+    QVERIFY(!KisPlanarScratchBuffer::isPreferred(
+                registry->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), 0)));
+
+#ifdef HAVE_OPENEXR
+    QVERIFY(KisPlanarScratchBuffer::isPreferred(
+                registry->colorSpace(RGBAColorModelID.id(), Float16BitsColorDepthID.id(), 0)));
+#endif
+}
+
+QTEST_MAIN(KisPlanarScratchBufferTest)
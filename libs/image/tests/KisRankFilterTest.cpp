@@ -0,0 +1,200 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisRankFilterTest.h"
+
+#include <QTest>
+
+#include <algorithm>
+
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+#include <KoChannelInfo.h>
+#include <KoColorModelStandardIds.h>
+
+#include "kis_paint_device.h"
+#include "KisRankFilter.h"
+
+namespace {
+
+KisPaintDeviceSP createRandomDevice(const KoColorSpace *cs, const QRect &rc)
+{
+    QVector<quint8> data(rc.width() * rc.height() * cs->pixelSize());
+
+    qsrand(1);
+    for (int i = 0; i < data.size(); i++) {
+        data[i] = qrand() % 256;
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->writeBytes(data.constData(), rc);
+    return dev;
+}
+
+template <typename T>
+T rankBySorting(const quint8 *data, const QRect &dataRect, int pixelSize, int pos,
+                const QPoint &pt, int radius, qreal percentile)
+{
+    QVector<T> values;
+
+    for (int y = pt.y() - radius; y <= pt.y() + radius; y++) {
+        for (int x = pt.x() - radius; x <= pt.x() + radius; x++) {
+            const int dataX = qBound(dataRect.left(), x, dataRect.right()) - dataRect.left();
+            const int dataY = qBound(dataRect.top(), y, dataRect.bottom()) - dataRect.top();
+            const quint8 *pixel = data + (dataY * dataRect.width() + dataX) * pixelSize;
+
+            values.append(*reinterpret_cast<const T*>(pixel + pos));
+        }
+    }
+
+    std::sort(values.begin(), values.end());
+    return values[qRound(percentile / 100.0 * (values.size() - 1))];
+}
+
+template <typename T>
+void verifyRank(KisPaintDeviceSP src, KisPaintDeviceSP dst, const QRect &rect,
+                int radius, qreal percentile)
+{
+    const KoColorSpace *cs = src->colorSpace();
+    const int pixelSize = cs->pixelSize();
+
+    const QRect dataRect = rect | src->exactBounds();
+    QVector<quint8> srcData(dataRect.width() * dataRect.height() * pixelSize);
+    src->readBytes(srcData.data(), dataRect);
+
+    QVector<quint8> dstData(rect.width() * rect.height() * pixelSize);
+    dst->readBytes(dstData.data(), rect);
+
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        for (int x = rect.left(); x <= rect.right(); x++) {
+            const quint8 *pixel = dstData.constData() +
+                ((y - rect.top()) * rect.width() + x - rect.left()) * pixelSize;
+
+            Q_FOREACH (KoChannelInfo *channel, cs->channels()) {
+                const T expected = rankBySorting<T>(srcData.constData(), dataRect, pixelSize,
+                                                    channel->pos(), QPoint(x, y), radius, percentile);
+                const T actual = *reinterpret_cast<const T*>(pixel + channel->pos());
+
+                if (actual != expected) {
+                    QFAIL(QString("Wrong value at %1,%2, channel %3: expected %4, got %5")
+                          .arg(x).arg(y).arg(channel->name())
+                          .arg(expected).arg(actual).toLatin1());
+                }
+            }
+        }
+    }
+}
+
+}
+
+void KisRankFilterTest::testMatchesSorting_data()
+{
+    QTest::addColumn<bool>("is16Bit");
+    QTest::addColumn<int>("radius");
+    QTest::addColumn<qreal>("percentile");
+
+    for (int is16Bit = 0; is16Bit <= 1; is16Bit++) {
+        const QString depth = is16Bit ? "u16" : "u8";
+
+        QTest::newRow((depth + " r1 median").toLatin1()) << bool(is16Bit) << 1 << 50.0;
+        QTest::newRow((depth + " r4 median").toLatin1()) << bool(is16Bit) << 4 << 50.0;
+        QTest::newRow((depth + " r3 min").toLatin1()) << bool(is16Bit) << 3 << 0.0;
+        QTest::newRow((depth + " r3 max").toLatin1()) << bool(is16Bit) << 3 << 100.0;
+        QTest::newRow((depth + " r7 p30").toLatin1()) << bool(is16Bit) << 7 << 30.0;
+    }
+}
+
+void KisRankFilterTest::testMatchesSorting()
+{
+    QFETCH(bool, is16Bit);
+    QFETCH(int, radius);
+    QFETCH(qreal, percentile);
+
+    const KoColorSpace *cs = is16Bit ?
+        KoColorSpaceRegistry::instance()->rgb16() :
+        KoColorSpaceRegistry::instance()->rgb8();
+
+    // the rect touches the border of the device on the right side
+    KisPaintDeviceSP src = createRandomDevice(cs, QRect(5, 7, 70, 50));
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+    const QRect rect(10, 10, 65, 40);
+
+    KisRankFilter::apply(src, dst, rect, radius, percentile, QBitArray(), 0);
+
+    if (is16Bit) {
+        verifyRank<quint16>(src, dst, rect, radius, percentile);
+    } else {
+        verifyRank<quint8>(src, dst, rect, radius, percentile);
+    }
+}
+
+void KisRankFilterTest::testFloatHdr()
+{
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(),
+                                                     Float32BitsColorDepthID.id(), 0);
+    QVERIFY(cs);
+    QVERIFY(KisRankFilter::supportsColorSpace(cs));
+
+    // scene-linear values, way above 1.0 and below zero
+    const QRect deviceRect(5, 7, 70, 50);
+    QVector<float> data(deviceRect.width() * deviceRect.height() * cs->channelCount());
+
+    qsrand(1);
+    for (int i = 0; i < data.size(); i++) {
+        data[i] = (qrand() % 20001 - 2000) / 1000.0f;
+    }
+
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    src->writeBytes(reinterpret_cast<const quint8*>(data.constData()), deviceRect);
+
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+    const QRect rect(10, 10, 65, 40);
+
+    KisRankFilter::apply(src, dst, rect, 3, 50.0, QBitArray(), 0);
+    verifyRank<float>(src, dst, rect, 3, 50.0);
+
+    KisRankFilter::apply(src, dst, rect, 2, 100.0, QBitArray(), 0);
+    verifyRank<float>(src, dst, rect, 2, 100.0);
+}
+
+void KisRankFilterTest::testInPlace()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    // bigger than a single patch, so the patches overlap with their halos
+    const QRect deviceRect(0, 0, 700, 600);
+    KisPaintDeviceSP src = createRandomDevice(cs, deviceRect);
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+    KisPaintDeviceSP inPlace = new KisPaintDevice(*src);
+
+    KisRankFilter::apply(src, dst, deviceRect, 5, 50.0, QBitArray(), 0);
+    KisRankFilter::apply(inPlace, inPlace, deviceRect, 5, 50.0, QBitArray(), 0);
+
+    const int pixelSize = cs->pixelSize();
+    QVector<quint8> expected(deviceRect.width() * deviceRect.height() * pixelSize);
+    QVector<quint8> actual(expected.size());
+
+    dst->readBytes(expected.data(), deviceRect);
+    inPlace->readBytes(actual.data(), deviceRect);
+
+    QVERIFY(expected == actual);
+}
+
+QTEST_MAIN(KisRankFilterTest)
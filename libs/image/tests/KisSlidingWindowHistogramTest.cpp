@@ -0,0 +1,161 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisSlidingWindowHistogramTest.h"
+
+#include <QTest>
+
+#include <algorithm>
+
+#include "KisSlidingWindowHistogram.h"
+
+namespace {
+
+const int numBins = 8;
+const int numValues = 2;
+
+void fillRandomly(KisSlidingWindowHistogram &histogram, QVector<int> &bins, QVector<float> &values)
+{
+    const QRect tileRect = histogram.tileRect();
+
+    bins.resize(tileRect.width() * tileRect.height());
+    values.resize(bins.size() * numValues);
+
+    qsrand(1);
+    for (int y = tileRect.top(); y <= tileRect.bottom(); y++) {
+        for (int x = tileRect.left(); x <= tileRect.right(); x++) {
+            const int index = (y - tileRect.top()) * tileRect.width() + x - tileRect.left();
+
+            bins[index] = qrand() % numBins;
+            for (int i = 0; i < numValues; i++) {
+                values[index * numValues + i] = (qrand() % 256) / 255.0f;
+            }
+
+            histogram.setPixel(QPoint(x, y), bins[index], values.constData() + index * numValues);
+        }
+    }
+}
+
+void verifyWindow(const KisSlidingWindowHistogram &histogram,
+                  const QVector<int> &bins, const QVector<float> &values)
+{
+    const QRect tileRect = histogram.tileRect();
+    const QRect window = histogram.window();
+
+    QVector<int> counts(numBins);
+    QVector<double> sums(numBins * numValues);
+
+    for (int y = window.top(); y <= window.bottom(); y++) {
+        for (int x = window.left(); x <= window.right(); x++) {
+            const int index = (y - tileRect.top()) * tileRect.width() + x - tileRect.left();
+            counts[bins[index]]++;
+
+            for (int i = 0; i < numValues; i++) {
+                sums[bins[index] * numValues + i] += values[index * numValues + i];
+            }
+        }
+    }
+
+    QCOMPARE(histogram.totalCount(), window.width() * window.height());
+
+    for (int bin = 0; bin < numBins; bin++) {
+        QCOMPARE(histogram.count(bin), counts[bin]);
+
+        for (int i = 0; i < numValues; i++) {
+            QVERIFY(qAbs(histogram.sums(bin)[i] - sums[bin * numValues + i]) < 1e-6);
+        }
+    }
+}
+
+}
+
+void KisSlidingWindowHistogramTest::testSlidingMatchesRebuild()
+{
+    const QRect tileRect(10, 20, 40, 30);
+    const int radius = 3;
+
+    KisSlidingWindowHistogram histogram(tileRect, numBins, numValues);
+    QVector<int> bins;
+    QVector<float> values;
+    fillRandomly(histogram, bins, values);
+
+    // the window is clipped by the tile, so it grows and shrinks on the edges
+    for (int y = tileRect.top(); y <= tileRect.bottom(); y++) {
+        for (int x = tileRect.left(); x <= tileRect.right(); x++) {
+            const QRect window =
+                QRect(x - radius, y - radius, 2 * radius + 1, 2 * radius + 1) & tileRect;
+
+            histogram.setWindow(window);
+            QCOMPARE(histogram.window(), window);
+            verifyWindow(histogram, bins, values);
+        }
+    }
+}
+
+void KisSlidingWindowHistogramTest::testSetPixelInsideWindow()
+{
+    const QRect tileRect(0, 0, 16, 16);
+
+    KisSlidingWindowHistogram histogram(tileRect, numBins, numValues);
+    QVector<int> bins;
+    QVector<float> values;
+    fillRandomly(histogram, bins, values);
+
+    histogram.setWindow(QRect(2, 2, 5, 5));
+
+    const float newValues[numValues] = {0.25f, 0.75f};
+
+    // one pixel inside the window and one outside of it
+    Q_FOREACH (const QPoint &pt, QVector<QPoint>({QPoint(4, 4), QPoint(10, 4)})) {
+        const int index = pt.y() * tileRect.width() + pt.x();
+        const int newBin = (bins[index] + 1) % numBins;
+
+        bins[index] = newBin;
+        std::copy(newValues, newValues + numValues, values.begin() + index * numValues);
+        histogram.setPixel(pt, newBin, newValues);
+    }
+
+    verifyWindow(histogram, bins, values);
+
+    // the pixel outside the window should be picked up when sliding
+    histogram.setWindow(QRect(7, 2, 5, 5));
+    verifyWindow(histogram, bins, values);
+}
+
+void KisSlidingWindowHistogramTest::testMostFrequentBin()
+{
+    const QRect tileRect(0, 0, 4, 1);
+    KisSlidingWindowHistogram histogram(tileRect, numBins);
+
+    histogram.setPixel(QPoint(0, 0), 5);
+    histogram.setPixel(QPoint(1, 0), 3);
+    histogram.setPixel(QPoint(2, 0), 5);
+    histogram.setPixel(QPoint(3, 0), 3);
+
+    QCOMPARE(histogram.mostFrequentBin(), -1);
+
+    histogram.setWindow(QRect(0, 0, 3, 1));
+    QCOMPARE(histogram.mostFrequentBin(), 5);
+
+    // ties are resolved in favor of the lower bin
+    histogram.setWindow(QRect(0, 0, 4, 1));
+    QCOMPARE(histogram.mostFrequentBin(), 3);
+}
+
+QTEST_MAIN(KisSlidingWindowHistogramTest)
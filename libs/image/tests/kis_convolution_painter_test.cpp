@@ -22,16 +22,20 @@
 #include <QTest>
 
 #include <QBitArray>
+#include <cmath>
 
 #include <KoColor.h>
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpaceTraits.h>
+#include <KoColorSpaceMaths.h>
 
 #include "kis_paint_device.h"
 #include "kis_convolution_painter.h"
 #include "kis_convolution_kernel.h"
 #include <kis_gaussian_kernel.h>
+#include <kis_edge_detection_kernel.h>
+#include <kis_sequential_iterator.h>
 #include <kis_mask_generator.h>
 #include "testutil.h"
 
@@ -225,6 +229,143 @@ void KisConvolutionPainterTest::testAsymmConvolutionImp(QBitArray channelFlags)
     }
 }
 
+template <class Traits>
+void testSpatialMatchesReferenceImpl(const KoColorSpace *cs, int tolerance,
+                                     const Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> &filter,
+                                     qreal factor, bool useTransaction = true)
+{
+    typedef typename Traits::channels_type channels_type;
+    const int channelsNb = Traits::channels_nb;
+    const int alphaPos = Traits::alpha_pos;
+    const qreal unitValue = KoColorSpaceMathsTraits<channels_type>::unitValue;
+
+    const int kw = filter.cols();
+    const int kh = filter.rows();
+
+    // wider than any vector size, so both the vector and the tail loops are used;
+    // without a transaction the area is also taller than a few bands
+    const int size = (useTransaction ? 37 : 200) + kw;
+    const QRect imageRect(0, 0, size, size);
+
+    QVector<channels_type> initialData(size * size * channelsNb);
+
+    qsrand(1);
+    for (int i = 0; i < initialData.size(); i++) {
+        const bool isTransparent = i % channelsNb == alphaPos && qrand() % 10 == 0;
+        initialData[i] = isTransparent ? 0 : channels_type(qrand() % (int(unitValue) + 1));
+    }
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->writeBytes(reinterpret_cast<const quint8*>(initialData.constData()), imageRect);
+
+    KisConvolutionKernelSP kernel =
+        KisConvolutionKernel::fromMatrix(filter, 0.0, factor);
+
+    KisConvolutionPainter gc(dev, KisConvolutionPainter::SPATIAL);
+    if (useTransaction) {
+        gc.beginTransaction();
+    }
+
+    const QRect filterRect = imageRect.adjusted(kw / 2, kh / 2, -kw / 2, -kh / 2);
+    gc.applyMatrix(kernel, dev, filterRect.topLeft(), filterRect.topLeft(),
+                   filterRect.size());
+
+    if (useTransaction) {
+        gc.deleteTransaction();
+    }
+
+    QVector<channels_type> resultData(initialData.size());
+    dev->readBytes(reinterpret_cast<quint8*>(resultData.data()), imageRect);
+
+    for (int y = filterRect.top(); y <= filterRect.bottom(); y++) {
+        for (int x = filterRect.left(); x <= filterRect.right(); x++) {
+            qreal sums[channelsNb] = {0};
+
+            for (int ky = 0; ky < kh; ky++) {
+                for (int kx = 0; kx < kw; kx++) {
+                    const channels_type *pixel =
+                        initialData.constData() + ((y - kh / 2 + ky) * size + x - kw / 2 + kx) * channelsNb;
+                    const qreal weight = filter(kh - 1 - ky, kw - 1 - kx) / factor;
+                    const qreal alpha = pixel[alphaPos];
+
+                    for (int ch = 0; ch < channelsNb; ch++) {
+                        sums[ch] += weight * (ch == alphaPos ? alpha : pixel[ch] * alpha);
+                    }
+                }
+            }
+
+            const qreal alpha = qBound(0.0, sums[alphaPos], unitValue);
+            const channels_type *result = resultData.constData() + (y * size + x) * channelsNb;
+
+            for (int ch = 0; ch < channelsNb; ch++) {
+                const qreal value = ch == alphaPos ? alpha :
+                    alpha != 0.0 ? qBound(0.0, sums[ch] * (1.0 / alpha), unitValue) : 0.0;
+
+                if (qAbs(int(result[ch]) - qRound(value)) > tolerance) {
+                    QFAIL(QString("Pixel (%1, %2) channel %3: expected %4, actual %5")
+                          .arg(x).arg(y).arg(ch).arg(qRound(value)).arg(result[ch]).toLatin1());
+                }
+            }
+        }
+    }
+}
+
+Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> asymmetricFilter()
+{
+    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> filter(3, 3);
+    filter << -2, -1, 0,
+              -1,  1, 1,
+               0,  1, 2;
+    return filter;
+}
+
+void KisConvolutionPainterTest::testSpatialMatchesReferenceU8()
+{
+    // 8-bit data with an integer kernel is accumulated in floats, must be exact
+    testSpatialMatchesReferenceImpl<KoBgrU8Traits>(KoColorSpaceRegistry::instance()->rgb8(), 0,
+                                                   asymmetricFilter(), 1.0);
+}
+
+void KisConvolutionPainterTest::testSpatialMatchesReferenceU16()
+{
+    testSpatialMatchesReferenceImpl<KoBgrU16Traits>(KoColorSpaceRegistry::instance()->rgb16(), 1,
+                                                    asymmetricFilter(), 1.0);
+}
+
+// a flat disk with soft edges, like the iris of the lens blur
+Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> softDiskFilter(int size)
+{
+    const qreal radius = 0.5 * size - 1.0;
+    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> filter(size, size);
+
+    for (int r = 0; r < size; r++) {
+        for (int c = 0; c < size; c++) {
+            const qreal distance = std::hypot(r - size / 2, c - size / 2);
+            filter(r, c) = qRound(255.0 * qBound(0.0, radius - distance, 1.0));
+        }
+    }
+
+    return filter;
+}
+
+void KisConvolutionPainterTest::testSpansMatchReference()
+{
+    const Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> filter = softDiskFilter(41);
+    const qreal factor = filter.sum();
+
+    testSpatialMatchesReferenceImpl<KoBgrU8Traits>(KoColorSpaceRegistry::instance()->rgb8(), 1,
+                                                   filter, factor);
+    testSpatialMatchesReferenceImpl<KoBgrU16Traits>(KoColorSpaceRegistry::instance()->rgb16(), 1,
+                                                    filter, factor);
+
+    // in-place without a transaction, the bands must not read each other's results
+    Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> box(9, 9);
+    box.setOnes();
+
+    testSpatialMatchesReferenceImpl<KoBgrU8Traits>(KoColorSpaceRegistry::instance()->rgb8(), 1,
+                                                   box, box.sum(), false);
+}
+
 void KisConvolutionPainterTest::testAsymmAllChannels()
 {
     QBitArray channelFlags =
@@ -308,6 +449,51 @@ void KisConvolutionPainterTest::benchmarkConvolution()
     }
 }
 
+void KisConvolutionPainterTest::benchmarkFlatKernels()
+{
+    QImage referenceImage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    QRect imageRect(QPoint(), referenceImage.size());
+
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    auto measure = [&] (KisConvolutionKernelSP kernel,
+                        KisConvolutionPainter::TestingEnginePreference engine) {
+        KisConvolutionPainter gc(dev, engine);
+
+        QTime timer; timer.start();
+
+        gc.beginTransaction();
+        gc.applyMatrix(kernel, dev, imageRect.topLeft(), imageRect.topLeft(),
+                       imageRect.size());
+        gc.revertTransaction();
+
+        return timer.elapsed();
+    };
+
+    // the time of both engines and the one chosen for the kernel, the
+    // soft disk is where the spans switch to FFT, the box never does
+    for (int size = 11; size <= 241; size = 2 * size - 1) {
+        Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> box(size, size);
+        box.setOnes();
+
+        const Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> disk = softDiskFilter(size);
+
+        KisConvolutionKernelSP boxKernel = KisConvolutionKernel::fromMatrix(box, 0.0, box.sum());
+        KisConvolutionKernelSP diskKernel = KisConvolutionKernel::fromMatrix(disk, 0.0, disk.sum());
+
+        KisConvolutionPainter gc(dev);
+
+        dbgKrita << "Size:" << size
+                 << "disk spatial:" << measure(diskKernel, KisConvolutionPainter::SPATIAL)
+                 << "fft:" << measure(diskKernel, KisConvolutionPainter::FFTW)
+                 << "chosen:" << (gc.useFFTImplemenation(diskKernel) ? "fft" : "spatial")
+                 << "box spatial:" << measure(boxKernel, KisConvolutionPainter::SPATIAL)
+                 << "fft:" << measure(boxKernel, KisConvolutionPainter::FFTW)
+                 << "chosen:" << (gc.useFFTImplemenation(boxKernel) ? "fft" : "spatial");
+    }
+}
+
 void KisConvolutionPainterTest::testGaussianBase(KisPaintDeviceSP dev, bool useFftw, const QString &prefix)
 {
    QBitArray channelFlags =
@@ -437,6 +623,252 @@ void KisConvolutionPainterTest::testGaussianDetailsFFTW()
     testGaussianDetails(true);
 }
 
+void KisConvolutionPainterTest::testFFTBlocksMatchSpatial()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    // big enough to be split into several FFT blocks
+    const QRect imageRect(0, 0, 1300, 1100);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(imageRect, KoColor(QColor(40, 80, 120, 255), cs));
+    dev->fill(QRect(100, 100, 700, 300), KoColor(QColor(250, 10, 30, 255), cs));
+    dev->fill(QRect(500, 350, 40, 700), KoColor(QColor(0, 200, 0, 100), cs));
+    dev->fill(QRect(1000, 0, 300, 600), KoColor(Qt::transparent, cs));
+
+    const Eigen::Matrix<qreal, Eigen::Dynamic, Eigen::Dynamic> matrix =
+        KisGaussianKernel::createVerticalMatrix(10) *
+        KisGaussianKernel::createHorizontalMatrix(10);
+
+    KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMatrix(matrix, 0, matrix.sum());
+
+    QBitArray partialFlags = cs->channelFlags(true, true);
+    partialFlags[2] = false;
+    partialFlags[3] = false;
+
+    QList<QBitArray> channelFlagsList;
+    channelFlagsList << QBitArray() << partialFlags;
+
+    Q_FOREACH (const QBitArray &channelFlags, channelFlagsList) {
+        KisPaintDeviceSP spatialDev = new KisPaintDevice(*dev);
+        {
+            KisConvolutionPainter gc(spatialDev, KisConvolutionPainter::SPATIAL);
+            gc.beginTransaction();
+            gc.setChannelFlags(channelFlags);
+            gc.applyMatrix(kernel, spatialDev, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+            gc.deleteTransaction();
+        }
+
+        // in-place application, the blocks must not see each other's results
+        // and the channels that are not convolved must be kept intact
+        KisPaintDeviceSP fftDev = new KisPaintDevice(*dev);
+        {
+            KisConvolutionPainter gc(fftDev, KisConvolutionPainter::FFTW);
+            gc.setChannelFlags(channelFlags);
+            gc.applyMatrix(kernel, fftDev, imageRect.topLeft(), imageRect.topLeft(), imageRect.size(), BORDER_REPEAT);
+        }
+
+        QPoint errorPoint;
+        if (!TestUtil::compareQImages(errorPoint,
+                                      spatialDev->convertToQImage(0, imageRect),
+                                      fftDev->convertToQImage(0, imageRect), 1, 1)) {
+            QFAIL(QString("FFT convolution differs from the spatial one at (%1, %2), channel flags %3")
+                  .arg(errorPoint.x()).arg(errorPoint.y())
+                  .arg(channelFlags.isEmpty() ? "all" : "partial").toLatin1());
+        }
+    }
+}
+
+void KisConvolutionPainterTest::testEdgeDetectionTilesMatchWholeRect()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    const QRect imageRect(0, 0, 1300, 900);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(imageRect, KoColor(QColor(40, 80, 120, 255), cs));
+    dev->fill(QRect(100, 100, 700, 300), KoColor(QColor(250, 10, 30, 255), cs));
+    dev->fill(QRect(500, 350, 40, 500), KoColor(QColor(0, 200, 0, 100), cs));
+    dev->fill(QRect(1000, 0, 300, 600), KoColor(Qt::transparent, cs));
+
+    // crosses several patches and touches the bounds of the device
+    const QRect applyRect(30, 20, 1270, 700);
+    const qreal radius = 3;
+
+    // the whole-rect version of the filter, as it used to be implemented
+    KisPaintDeviceSP refDev = new KisPaintDevice(*dev);
+    {
+        KisConvolutionKernelSP kernelX =
+            KisEdgeDetectionKernel::createHorizontalKernel(radius, KisEdgeDetectionKernel::SobelVector);
+        KisConvolutionKernelSP kernelY =
+            KisEdgeDetectionKernel::createVerticalKernel(radius, KisEdgeDetectionKernel::SobelVector);
+
+        const int extentX = ceil(qreal(kernelX->width()) / 2.0);
+        const int extentY = ceil(qreal(kernelY->height()) / 2.0);
+
+        KisPaintDeviceSP xDev = new KisPaintDevice(cs);
+        KisConvolutionPainter xPainter(xDev);
+        xPainter.applyMatrix(kernelX, refDev,
+                             applyRect.topLeft() - QPoint(0, extentX),
+                             applyRect.topLeft() - QPoint(0, extentX),
+                             applyRect.size() + QSize(0, 2 * extentX), BORDER_REPEAT);
+
+        KisPaintDeviceSP yDev = new KisPaintDevice(cs);
+        KisConvolutionPainter yPainter(yDev);
+        yPainter.applyMatrix(kernelY, refDev,
+                             applyRect.topLeft() - QPoint(0, extentY),
+                             applyRect.topLeft() - QPoint(0, extentY),
+                             applyRect.size() + QSize(0, 2 * extentY), BORDER_REPEAT);
+
+        KisSequentialConstIterator xIt(xDev, applyRect);
+        KisSequentialConstIterator yIt(yDev, applyRect);
+        KisSequentialIterator dstIt(refDev, applyRect);
+
+        const int channels = cs->channelCount();
+        QVector<float> x(channels);
+        QVector<float> y(channels);
+        QVector<float> result(channels);
+
+        while (xIt.nextPixel() && yIt.nextPixel() && dstIt.nextPixel()) {
+            cs->normalisedChannelsValue(xIt.rawDataConst(), x);
+            cs->normalisedChannelsValue(yIt.rawDataConst(), y);
+
+            for (int c = 0; c < channels; c++) {
+                result[c] = 2 * sqrt((x[c] - 0.5) * (x[c] - 0.5) + (y[c] - 0.5) * (y[c] - 0.5));
+            }
+            cs->fromNormalisedChannelsValue(dstIt.rawData(), result);
+        }
+    }
+
+    // in-place application without a transaction, the patches must
+    // not see each other's results
+    KisPaintDeviceSP tiledDev = new KisPaintDevice(*dev);
+    KisEdgeDetectionKernel::applyEdgeDetection(tiledDev, applyRect, radius, radius,
+                                               KisEdgeDetectionKernel::SobelVector,
+                                               QBitArray(), 0);
+
+    QPoint errorPoint;
+    if (!TestUtil::compareQImages(errorPoint,
+                                  refDev->convertToQImage(0, imageRect),
+                                  tiledDev->convertToQImage(0, imageRect))) {
+        QFAIL(QString("Tiled edge detection differs from the whole-rect one at (%1, %2)")
+              .arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+    }
+}
+
+void KisConvolutionPainterTest::testRecursiveGaussian_data()
+{
+    QTest::addColumn<qreal>("xRadius");
+    QTest::addColumn<qreal>("yRadius");
+
+    QTest::newRow("10x10") << 10.0 << 10.0;
+    QTest::newRow("30x30") << 30.0 << 30.0;
+    QTest::newRow("60x20") << 60.0 << 20.0;
+    QTest::newRow("40x0") << 40.0 << 0.0;
+    QTest::newRow("0x40") << 0.0 << 40.0;
+}
+
+void KisConvolutionPainterTest::testRecursiveGaussian()
+{
+    QFETCH(qreal, xRadius);
+    QFETCH(qreal, yRadius);
+
+    QImage referenceImage(TestUtil::fetchDataFileLazy("kritaTransparent.png"));
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    const QRect applyRect = dev->exactBounds();
+
+    KisPaintDeviceSP exactDev = new KisPaintDevice(*dev);
+    KisGaussianKernel::applyGaussian(exactDev, applyRect, xRadius, yRadius,
+                                     QBitArray(), 0, true,
+                                     KisGaussianKernel::ConvolutionEngine);
+
+    KisPaintDeviceSP recursiveDev = new KisPaintDevice(*dev);
+    KisGaussianKernel::applyGaussian(recursiveDev, applyRect, xRadius, yRadius,
+                                     QBitArray(), 0, true,
+                                     KisGaussianKernel::RecursiveEngine);
+
+    const QImage exactImage = exactDev->convertToQImage(0, applyRect);
+    const QImage recursiveImage = recursiveDev->convertToQImage(0, applyRect);
+
+    // the recursive filter is an approximation, so allow a few levels of error
+    QPoint errorPoint;
+    if (!TestUtil::compareQImages(errorPoint, exactImage, recursiveImage, 4, 4)) {
+        QFAIL(QString("Recursive gaussian differs from the exact one at (%1, %2)")
+              .arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+    }
+}
+
+void KisConvolutionPainterTest::testAnisotropicGaussian_data()
+{
+    QTest::addColumn<qreal>("xRadius");
+    QTest::addColumn<qreal>("yRadius");
+
+    QTest::newRow("100x1") << 100.0 << 1.0;
+    QTest::newRow("1x100") << 1.0 << 100.0;
+    QTest::newRow("80x3") << 80.0 << 3.0;
+}
+
+void KisConvolutionPainterTest::testAnisotropicGaussian()
+{
+    QFETCH(qreal, xRadius);
+    QFETCH(qreal, yRadius);
+
+    QImage referenceImage(TestUtil::fetchDataFileLazy("kritaTransparent.png"));
+    KisPaintDeviceSP dev = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb8());
+    dev->convertFromQImage(referenceImage, 0, 0, 0);
+
+    const QRect applyRect = dev->exactBounds();
+
+    // only the large axis should go to the recursive engine
+    QVERIFY(KisGaussianKernel::prefersRecursiveEngine(dev, qMax(xRadius, yRadius)));
+    QVERIFY(!KisGaussianKernel::prefersRecursiveEngine(dev, qMin(xRadius, yRadius)));
+
+    KisPaintDeviceSP exactDev = new KisPaintDevice(*dev);
+    KisGaussianKernel::applyGaussian(exactDev, applyRect, xRadius, yRadius,
+                                     QBitArray(), 0, true,
+                                     KisGaussianKernel::ConvolutionEngine);
+
+    KisPaintDeviceSP autoDev = new KisPaintDevice(*dev);
+    KisGaussianKernel::applyGaussian(autoDev, applyRect, xRadius, yRadius,
+                                     QBitArray(), 0, true,
+                                     KisGaussianKernel::AutoEngine);
+
+    const QImage exactImage = exactDev->convertToQImage(0, applyRect);
+    const QImage autoImage = autoDev->convertToQImage(0, applyRect);
+
+    // the large axis is approximated, the small one must stay sharp
+    QPoint errorPoint;
+    if (!TestUtil::compareQImages(errorPoint, exactImage, autoImage, 4, 4)) {
+        QFAIL(QString("Anisotropic gaussian differs from the exact one at (%1, %2)")
+              .arg(errorPoint.x()).arg(errorPoint.y()).toLatin1());
+    }
+}
+
+void KisConvolutionPainterTest::testRecursiveGaussianUniform()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+
+    const QRect fillRect(0, 0, 300, 200);
+    const KoColor color(QColor(200, 100, 50, 180), cs);
+    dev->fill(fillRect, color);
+
+    // a uniform area should stay the same, including the edges of the rect
+    KisGaussianKernel::applyGaussian(dev, fillRect, 100, 100,
+                                     QBitArray(), 0, true,
+                                     KisGaussianKernel::RecursiveEngine);
+
+    KoColor pixel(cs);
+    const QVector<QPoint> samplePoints({QPoint(0, 0), QPoint(150, 100), QPoint(299, 199), QPoint(299, 0)});
+
+    Q_FOREACH (const QPoint &pt, samplePoints) {
+        dev->pixel(pt.x(), pt.y(), &pixel);
+        QCOMPARE(pixel.toQColor(), color.toQColor());
+    }
+}
+
 #include "kis_transaction.h"
 
 void KisConvolutionPainterTest::testDilate()
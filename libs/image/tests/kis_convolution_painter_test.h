@@ -47,7 +47,12 @@ private Q_SLOTS:
     void testAsymmSkipBlue();
     void testAsymmSkipAlpha();
 
+    void testSpatialMatchesReferenceU8();
+    void testSpatialMatchesReferenceU16();
+    void testSpansMatchReference();
+
     void benchmarkConvolution();
+    void benchmarkFlatKernels();
     void testGaussianSpatial();
     void testGaussianFFTW();
 
@@ -57,6 +62,16 @@ private Q_SLOTS:
     void testGaussianDetailsSpatial();
     void testGaussianDetailsFFTW();
 
+    void testFFTBlocksMatchSpatial();
+    void testEdgeDetectionTilesMatchWholeRect();
+
+    void testRecursiveGaussian_data();
+    void testRecursiveGaussian();
+    void testRecursiveGaussianUniform();
+
+    void testAnisotropicGaussian_data();
+    void testAnisotropicGaussian();
+
     void testDilate();
     void testErode();
 };
@@ -50,6 +50,23 @@ public:
 
 };
 
+class TestLodApproximatedFilter : public TestFilter
+{
+public:
+    TestLodApproximatedFilter() {
+        setSupportsLevelOfDetailApproximation(QStringList() << "radius" << "sigma" << "offset");
+    }
+
+    KisFilterConfigurationSP factoryConfiguration() const override {
+        KisFilterConfigurationSP config = new KisFilterConfiguration("test", 1);
+        config->setProperty("radius", 10);
+        config->setProperty("sigma", 3.0);
+        config->setProperty("offset", 0);
+        config->setProperty("strength", 50);
+        return config;
+    }
+};
+
 void KisFilterTest::testCreation()
 {
     TestFilter test;
@@ -236,5 +253,112 @@ void KisFilterTest::testBlurFilterApplicationRect()
     QVERIFY(TestUtil::compareQImages(pt, refImage, dst2Image));
 }
 
+void KisFilterTest::testProcessInPatches()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QImage qimage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+
+    // big enough to be split into several patches
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 2; col++) {
+            src->convertFromQImage(qimage, 0, col * qimage.width(), row * qimage.height());
+        }
+    }
+
+    const QRect filterRect = src->exactBounds().adjusted(7, 13, -11, -5);
+
+    KisFilterSP f = KisFilterRegistry::instance()->value("blur");
+    Q_ASSERT(f);
+    QVERIFY(f->supportsThreading());
+    KisFilterConfigurationSP  kfc = f->defaultConfiguration();
+    Q_ASSERT(kfc);
+
+    // in-place processing handles the whole rect in one go
+    KisPaintDeviceSP reference = new KisPaintDevice(*src);
+    f->process(reference, filterRect, kfc);
+
+    KisPaintDeviceSP dst = new KisPaintDevice(cs);
+    f->process(src, dst, 0, filterRect, kfc);
+
+    QImage refImage = reference->convertToQImage(0, filterRect);
+    QImage dstImage = dst->convertToQImage(0, filterRect);
+
+    QPoint pt;
+    QVERIFY(TestUtil::compareQImages(pt, refImage, dstImage, 1, 1));
+}
+
+void KisFilterTest::testProcessInPatchesInPlace()
+{
+    const KoColorSpace * cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    QImage qimage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+
+    // big enough to be split into several patches
+    KisPaintDeviceSP src = new KisPaintDevice(cs);
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 2; col++) {
+            src->convertFromQImage(qimage, 0, col * qimage.width(), row * qimage.height());
+        }
+    }
+
+    const QRect filterRect = src->exactBounds().adjusted(7, 13, -11, -5);
+
+    KisFilterSP f = KisFilterRegistry::instance()->value("blur");
+    Q_ASSERT(f);
+    QVERIFY(f->supportsThreading());
+    KisFilterConfigurationSP  kfc = f->defaultConfiguration();
+    Q_ASSERT(kfc);
+
+    // without a selection in-place processing handles the whole rect in one go
+    KisPaintDeviceSP reference = new KisPaintDevice(*src);
+    f->process(reference, filterRect, kfc);
+
+    // the selection forces in-place processing to go through the patches,
+    // which must not read the pixels already written by their neighbours
+    KisSelectionSP sel = new KisSelection(new KisSelectionDefaultBounds(src));
+    sel->pixelSelection()->invert(); // select everything
+    sel->updateProjection();
+
+    f->process(src, src, sel, filterRect, kfc);
+
+    QImage refImage = reference->convertToQImage(0, filterRect);
+    QImage dstImage = src->convertToQImage(0, filterRect);
+
+    QPoint pt;
+    QVERIFY(TestUtil::compareQImages(pt, refImage, dstImage, 1, 1));
+}
+
+void KisFilterTest::testLodConfiguration()
+{
+    TestLodApproximatedFilter filter;
+
+    KisFilterConfigurationSP config = filter.defaultConfiguration();
+    config->setProperty("radius", 7);
+    config->setProperty("sigma", 5.0);
+
+    QVERIFY(filter.supportsLevelOfDetail(config, 2));
+    QVERIFY(filter.lodConfiguration(config, 0) == config);
+
+    KisFilterConfigurationSP lodConfig = filter.lodConfiguration(config, 2);
+
+    QVERIFY(lodConfig != config);
+    QCOMPARE(lodConfig->getInt("radius"), 2);
+    QCOMPARE(lodConfig->getDouble("sigma"), 1.25);
+    QCOMPARE(lodConfig->getInt("offset"), 0);
+    QCOMPARE(lodConfig->getInt("strength"), 50);
+
+    // the original configuration is not changed
+    QCOMPARE(config->getInt("radius"), 7);
+
+    // a non-zero length never disappears
+    config->setProperty("radius", 1);
+    QCOMPARE(filter.lodConfiguration(config, 3)->getInt("radius"), 1);
+
+    TestFilter plainFilter;
+    QVERIFY(!plainFilter.supportsLevelOfDetail(config, 2));
+    QVERIFY(plainFilter.lodConfiguration(config, 2) == config);
+}
 
 QTEST_MAIN(KisFilterTest)
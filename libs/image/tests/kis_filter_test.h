@@ -32,6 +32,9 @@ private Q_SLOTS:
     void testDifferentSrcAndDst();
     void testOldDataApiAfterCopy();
     void testBlurFilterApplicationRect();
+    void testProcessInPatches();
+    void testProcessInPatchesInPlace();
+    void testLodConfiguration();
 };
 
 #endif
@@ -19,7 +19,11 @@
 #include "kis_math_toolbox_test.h"
 
 #include <QTest>
+#include <QPainter>
+#include <KoColorSpaceRegistry.h>
 #include "kis_math_toolbox.h"
+#include "kis_paint_device.h"
+#include "testutil.h"
 
 void KisMathToolboxTest::testCreation()
 {
@@ -27,5 +31,75 @@ void KisMathToolboxTest::testCreation()
     Q_UNUSED(tb)
 }
 
+namespace {
+void softThreshold(KisMathToolbox::KisWavelet *wav, float threshold)
+{
+    float* const fin = wav->coeffs + wav->depth * wav->size * wav->size;
+
+    for (float* it = wav->coeffs + wav->depth; it < fin; it++) {
+        *it = *it > threshold ? *it - threshold :
+              *it < -threshold ? *it + threshold : 0.0f;
+    }
+}
+}
+
+void KisMathToolboxTest::testTiledRoundTrip()
+{
+    QImage qimage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+
+    // make the image bigger than a single patch
+    QImage tiled(2 * qimage.width() + 100, 2 * qimage.height() + 100, QImage::Format_ARGB32);
+    {
+        QPainter gc(&tiled);
+        gc.drawTiledPixmap(tiled.rect(), QPixmap::fromImage(qimage));
+    }
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->convertFromQImage(tiled, 0, 0, 0);
+
+    const QRect rc = tiled.rect().adjusted(30, 20, -10, -40);
+
+    KisMathToolbox tb;
+    tb.fastWaveletTiledProcessing(dev, rc, [] (KisMathToolbox::KisWavelet*) {});
+
+    QPoint errpoint;
+    if (!TestUtil::compareQImages(errpoint, tiled, dev->convertToQImage(0, 0, 0, tiled.width(), tiled.height()), 1)) {
+        QFAIL(QString("Failed to restore the image after the tiled wavelet transform, first different pixel: %1,%2 ")
+              .arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
+
+void KisMathToolboxTest::testTiledMatchesSingleTransform()
+{
+    QImage qimage(QString(FILES_DATA_DIR) + QDir::separator() + "hakonepa.png");
+    const QRect rc = QRect(0, 0, 300, 200) & qimage.rect();
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisPaintDeviceSP dev1 = new KisPaintDevice(cs);
+    dev1->convertFromQImage(qimage, 0, 0, 0);
+    KisPaintDeviceSP dev2 = new KisPaintDevice(*dev1);
+
+    KisMathToolbox tb;
+
+    QScopedPointer<KisMathToolbox::KisWavelet> buff(tb.initWavelet(dev1, rc));
+    QScopedPointer<KisMathToolbox::KisWavelet> wav(tb.fastWaveletTransformation(dev1, rc, buff.data()));
+    softThreshold(wav.data(), 7.0f);
+    tb.fastWaveletUntransformation(dev1, rc, wav.data(), buff.data());
+
+    tb.fastWaveletTiledProcessing(dev2, rc,
+        [] (KisMathToolbox::KisWavelet *wav) {
+            softThreshold(wav, 7.0f);
+        });
+
+    QImage result1 = dev1->convertToQImage(0, rc.x(), rc.y(), rc.width(), rc.height());
+    QImage result2 = dev2->convertToQImage(0, rc.x(), rc.y(), rc.width(), rc.height());
+
+    QPoint errpoint;
+    if (!TestUtil::compareQImages(errpoint, result1, result2)) {
+        QFAIL(QString("Tiled wavelet processing differs from the plain transform, first different pixel: %1,%2 ")
+              .arg(errpoint.x()).arg(errpoint.y()).toLatin1());
+    }
+}
 
 QTEST_MAIN(KisMathToolboxTest)
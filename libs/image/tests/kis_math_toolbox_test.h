@@ -27,6 +27,8 @@ class KisMathToolboxTest : public QObject
 private Q_SLOTS:
 
     void testCreation();
+    void testTiledRoundTrip();
+    void testTiledMatchesSingleTransform();
 
 };
 
@@ -28,13 +28,51 @@
 #include <KoColorProfile.h>
 #include <KoColorSpaceMaths.h>
 #include <KoColorSpaceRegistry.h>
+#include "KoColorSpaceTraits.h"
 #include "KoFallBackColorTransformation.h"
 #include "KoLabDarkenColorTransformation.h"
 #include "KoMixColorsOpImpl.h"
+#include "KoOptimizedMixColorsOpFactory.h"
 
 #include "KoConvolutionOpImpl.h"
 #include "KoInvertColorTransformation.h"
 
+/**
+ * Selects the implementation of the mix colors op for the traits.
+ * The most used color spaces get a vectorized version of the op.
+ */
+template<class _CSTrait>
+struct KoMixColorsOpSelector
+{
+    static KoMixColorsOp* create() {
+        return new KoMixColorsOpImpl<_CSTrait>();
+    }
+};
+
+template<>
+struct KoMixColorsOpSelector<KoBgrU8Traits>
+{
+    static KoMixColorsOp* create() {
+        return KoOptimizedMixColorsOpFactory::createMixColorsOp32();
+    }
+};
+
+template<>
+struct KoMixColorsOpSelector<KoBgrU16Traits>
+{
+    static KoMixColorsOp* create() {
+        return KoOptimizedMixColorsOpFactory::createMixColorsOp64();
+    }
+};
+
+template<>
+struct KoMixColorsOpSelector<KoRgbF32Traits>
+{
+    static KoMixColorsOp* create() {
+        return KoOptimizedMixColorsOpFactory::createMixColorsOp128();
+    }
+};
+
 /**
  * This in an implementation of KoColorSpace which can be used as a base for colorspaces with as many
  * different channels of the same type.
@@ -50,7 +88,7 @@ class KoColorSpaceAbstract : public KoColorSpace
 {
 public:
     KoColorSpaceAbstract(const QString &id, const QString &name) :
-        KoColorSpace(id, name, new KoMixColorsOpImpl< _CSTrait>(), new KoConvolutionOpImpl< _CSTrait>()) {
+        KoColorSpace(id, name, KoMixColorsOpSelector<_CSTrait>::create(), new KoConvolutionOpImpl< _CSTrait>()) {
     }
 
     quint32 colorChannelCount() const override {
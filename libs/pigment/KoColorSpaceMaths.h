@@ -444,6 +444,25 @@ inline double KoColorSpaceMaths<half>::clamp(double a)
     return a;
 }
 
+/**
+ * Batch conversion of half-float values into floats and back. The
+ * implementation is selected at runtime and uses F16C instructions
+ * when the CPU supports them. The results are bit-exact with the
+ * per-value conversion done by OpenEXR's half.
+ */
+class KRITAPIGMENT_EXPORT KoHalfBatchConversion
+{
+public:
+    virtual ~KoHalfBatchConversion();
+
+    virtual void toFloat(const half *src, float *dst, int numValues) const = 0;
+    virtual void fromFloat(const float *src, half *dst, int numValues) const = 0;
+
+    /**
+     * @return the implementation optimized for the current CPU
+     */
+    static const KoHalfBatchConversion* instance();
+};
 
 #endif
 
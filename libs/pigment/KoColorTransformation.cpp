@@ -24,6 +24,18 @@ KoColorTransformation::~KoColorTransformation()
 {
 }
 
+bool KoColorTransformation::supportsPlanarTransform() const
+{
+    return false;
+}
+
+void KoColorTransformation::transformPlanar(float * const *planes, qint32 nPixels) const
+{
+    Q_UNUSED(planes);
+    Q_UNUSED(nPixels);
+    qWarning() << "KoColorTransformation::transformPlanar() is called for a transformation that doesn't support it";
+}
+
 QList<QString> KoColorTransformation::parameters() const
 {
     return QList<QString>();
@@ -59,6 +59,30 @@ public:
      */
     virtual void transform(const quint8 *src, quint8 *dst, qint32 nPixels) const = 0;
 
+    /**
+     * @return true if the transformation implements transformPlanar()
+     */
+    virtual bool supportsPlanarTransform() const;
+
+    /**
+     * Planar variant of transform(). The pixels are passed as a set of
+     * float planes, one plane per channel, in the order the channels are
+     * stored in the pixel, that is, plane \p i keeps the channel that
+     * lives at byte offset i * channelSize. Integer channels are
+     * normalized into [0, 1] range, floating point channels are passed
+     * as they are. That is exactly the representation that
+     * KoColorSpaceMaths<T, float>::scaleToA() produces, so the result of
+     * the planar transformation should be the same as the one of
+     * transform().
+     *
+     * The transformation happens in place. Clamping of the values is done
+     * by the caller when the planes are converted back into the pixels.
+     *
+     * The default implementation does nothing, check
+     * supportsPlanarTransform() before calling it.
+     */
+    virtual void transformPlanar(float * const *planes, qint32 nPixels) const;
+
     /**
      * @return the list of parameters
      */
@@ -21,6 +21,7 @@
 #define KO_MIX_COLORS_OP_H
 
 #include <limits.h>
+#include <QtGlobal>
 
 /**
  * Base class of the mix color operation. It's defined by
@@ -29,6 +30,71 @@
  */
 class KoMixColorsOp
 {
+public:
+    /**
+     * Mixer is a stateful object that mixes the colors arriving in
+     * chunks, e.g. row-by-row from a paint device iterator. It works
+     * with plain arrays of pixels, so the caller doesn't need to
+     * materialize an array of pointers for every pixel of the mixed
+     * area. It is the preferred way of mixing big areas of the image,
+     * like a whole dab of a brush.
+     *
+     * @code
+     * QScopedPointer<KoMixColorsOp::Mixer> mixer(cs->mixColorsOp()->createMixer());
+     *
+     * KisSequentialConstIterator it(dev, rect);
+     * int numConseqPixels = it.nConseqPixels();
+     * while (it.nextPixels(numConseqPixels)) {
+     *     numConseqPixels = it.nConseqPixels();
+     *     mixer->accumulateAverage(it.rawDataConst(), numConseqPixels);
+     * }
+     *
+     * mixer->computeMixedColor(ptrToDestinationPixel);
+     * @endcode
+     */
+    class Mixer
+    {
+    public:
+        virtual ~Mixer() {}
+
+        /**
+         * Add \p nPixels pixels from a continuous array \p data to
+         * the mix. Every pixel is premultiplied by the corresponding
+         * weight from \p weights.
+         *
+         * @param weightSum the sum of the weights the caller considers
+         *                  to be "a unit". It is accumulated and used as
+         *                  a normalization factor when computing the
+         *                  resulting color. If you want to average the
+         *                  colors, it should be equal to the sum of
+         *                  \p weights.
+         */
+        virtual void accumulate(const quint8 *data, const qint16 *weights, int weightSum, int nPixels) = 0;
+
+        /**
+         * Add \p nPixels pixels from a continuous array \p data to
+         * the mix with equal weights
+         */
+        virtual void accumulateAverage(const quint8 *data, int nPixels) = 0;
+
+        /**
+         * Write the mixed color into \p data. The mixer is not reset,
+         * so the caller may add more pixels and compute the color again.
+         */
+        virtual void computeMixedColor(quint8 *data) = 0;
+
+        /**
+         * Forget all the pixels accumulated so far, so that the mixer
+         * can be reused for a new mix without allocating a new one
+         */
+        virtual void reset() = 0;
+
+        /**
+         * \return the sum of weights accumulated so far
+         */
+        virtual qint64 currentWeightsSum() const = 0;
+    };
+
 public:
     virtual ~KoMixColorsOp() { }
     /**
@@ -76,6 +142,13 @@ public:
      */
     virtual void mixColors(const quint8 * const*colors, quint32 nColors, quint8 *dst) const = 0;
     virtual void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const = 0;
+
+    /**
+     * Create a new mixer object for streamed mixing of the colors
+     * of this color space. The caller takes the ownership of the
+     * returned object.
+     */
+    virtual Mixer* createMixer() const = 0;
 };
 
 #endif
@@ -23,30 +23,172 @@
 
 #include "KoMixColorsOp.h"
 
+#include <type_traits>
+
 template<class _CSTrait>
 class KoMixColorsOpImpl : public KoMixColorsOp
 {
+public:
+    typedef typename _CSTrait::channels_type channels_type;
+    typedef typename KoColorSpaceMathsTraits<channels_type>::compositetype compositetype;
+
+    /**
+     * The type used for accumulating the channel values. For 8-bit
+     * channels it is wider than compositetype, so that the sum would not
+     * overflow when mixing big areas of the image, e.g. a whole dab of
+     * the smudge brush
+     */
+    typedef typename std::conditional<std::is_same<compositetype, qint32>::value,
+                                      qint64, compositetype>::type mixtype;
+
+    /**
+     * The intermediate state of the mixing. It is shared between the
+     * scalar and the vectorized implementations of the op, so that both
+     * of them produce exactly the same rounding of the final color.
+     */
+    struct MixDataResult {
+        MixDataResult()
+            : totalAlpha(0),
+              sumOfWeights(0)
+        {
+            memset(totals, 0, sizeof(totals));
+        }
+
+        mixtype totals[_CSTrait::channels_nb];
+        mixtype totalAlpha;
+        qint64 sumOfWeights;
+
+        void computeMixedColor(quint8 *dst) const {
+            channels_type* dstColor = _CSTrait::nativeArray(dst);
+
+            // set totalAlpha to the minimum between its value and the unit value of the channels
+            mixtype clampedAlpha = totalAlpha;
+            const mixtype maxAlpha = mixtype(KoColorSpaceMathsTraits<channels_type>::unitValue) * sumOfWeights;
+
+            if (clampedAlpha > maxAlpha) {
+                clampedAlpha = maxAlpha;
+            }
+
+            if (clampedAlpha > 0) {
+
+                for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
+                    if (i != _CSTrait::alpha_pos) {
+
+                        mixtype v = totals[i] / clampedAlpha;
+
+                        if (v > KoColorSpaceMathsTraits<channels_type>::max) {
+                            v = KoColorSpaceMathsTraits<channels_type>::max;
+                        }
+                        if (v < KoColorSpaceMathsTraits<channels_type>::min) {
+                            v = KoColorSpaceMathsTraits<channels_type>::min;
+                        }
+                        dstColor[ i ] = v;
+                    }
+                }
+
+                if (_CSTrait::alpha_pos != -1) {
+                    dstColor[ _CSTrait::alpha_pos ] = clampedAlpha / sumOfWeights;
+                }
+            } else {
+                memset(dst, 0, sizeof(channels_type) * _CSTrait::channels_nb);
+            }
+        }
+    };
+
 public:
     KoMixColorsOpImpl() {
     }
     ~KoMixColorsOpImpl() override { }
     void mixColors(const quint8 * const* colors, const qint16 *weights, quint32 nColors, quint8 *dst) const override {
-        mixColorsImpl(ArrayOfPointers(colors), WeightsWrapper(weights), nColors, dst);
+        MixDataResult result;
+        accumulateColorsImpl(ArrayOfPointers(colors), WeightsWrapper(weights), nColors, &result);
+        result.sumOfWeights = 255;
+        result.computeMixedColor(dst);
     }
 
     void mixColors(const quint8 *colors, const qint16 *weights, quint32 nColors, quint8 *dst) const override {
-        mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), WeightsWrapper(weights), nColors, dst);
+        MixDataResult result;
+        accumulateArray(colors, weights, nColors, &result);
+        result.sumOfWeights = 255;
+        result.computeMixedColor(dst);
     }
 
     void mixColors(const quint8 * const* colors, quint32 nColors, quint8 *dst) const override {
-        mixColorsImpl(ArrayOfPointers(colors), NoWeightsSurrogate(nColors), nColors, dst);
+        MixDataResult result;
+        accumulateColorsImpl(ArrayOfPointers(colors), NoWeightsSurrogate(), nColors, &result);
+        result.sumOfWeights = nColors;
+        result.computeMixedColor(dst);
     }
 
     void mixColors(const quint8 *colors, quint32 nColors, quint8 *dst) const override {
-        mixColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), NoWeightsSurrogate(nColors), nColors, dst);
+        MixDataResult result;
+        accumulateArrayAverage(colors, nColors, &result);
+        result.sumOfWeights = nColors;
+        result.computeMixedColor(dst);
+    }
+
+    KoMixColorsOp::Mixer* createMixer() const override {
+        return new MixerImpl(this);
+    }
+
+protected:
+    /**
+     * Accumulate \p nPixels pixels of a continuous array \p colors
+     * into \p result, premultiplying them by \p weights. This is the
+     * hot spot of the op, so the optimized implementations reimplement
+     * this method (and accumulateArrayAverage()) with vector instructions.
+     *
+     * NOTE: the method doesn't touch \p result->sumOfWeights, it is
+     *       the responsibility of the caller.
+     */
+    virtual void accumulateArray(const quint8 *colors, const qint16 *weights, int nPixels, MixDataResult *result) const {
+        accumulateColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), WeightsWrapper(weights), nPixels, result);
+    }
+
+    /**
+     * Same as accumulateArray(), but adds all the pixels with equal
+     * (unit) weights
+     */
+    virtual void accumulateArrayAverage(const quint8 *colors, int nPixels, MixDataResult *result) const {
+        accumulateColorsImpl(PointerToArray(colors, _CSTrait::pixelSize), NoWeightsSurrogate(), nPixels, result);
     }
 
 private:
+    class MixerImpl : public KoMixColorsOp::Mixer
+    {
+    public:
+        MixerImpl(const KoMixColorsOpImpl *op)
+            : m_op(op)
+        {
+        }
+
+        void accumulate(const quint8 *data, const qint16 *weights, int weightSum, int nPixels) override {
+            m_op->accumulateArray(data, weights, nPixels, &m_result);
+            m_result.sumOfWeights += weightSum;
+        }
+
+        void accumulateAverage(const quint8 *data, int nPixels) override {
+            m_op->accumulateArrayAverage(data, nPixels, &m_result);
+            m_result.sumOfWeights += nPixels;
+        }
+
+        void computeMixedColor(quint8 *data) override {
+            m_result.computeMixedColor(data);
+        }
+
+        void reset() override {
+            m_result = MixDataResult();
+        }
+
+        qint64 currentWeightsSum() const override {
+            return m_result.sumOfWeights;
+        }
+
+    private:
+        const KoMixColorsOpImpl *m_op;
+        MixDataResult m_result;
+    };
+
     struct ArrayOfPointers {
         ArrayOfPointers(const quint8 * const* colors)
             : m_colors(colors)
@@ -87,8 +229,6 @@ private:
 
     struct WeightsWrapper
     {
-        typedef typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype compositetype;
-
         WeightsWrapper(const qint16 *weights)
             : m_weights(weights)
         {
@@ -98,106 +238,50 @@ private:
             m_weights++;
         }
 
-        inline void premultiplyAlphaWithWeight(compositetype &alpha) const {
+        inline void premultiplyAlphaWithWeight(mixtype &alpha) const {
             alpha *= *m_weights;
         }
 
-        inline int normalizeFactor() const {
-            return 255;
-        }
-
     private:
         const qint16 *m_weights;
     };
 
     struct NoWeightsSurrogate
     {
-        typedef typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype compositetype;
-
-        NoWeightsSurrogate(int numPixels)
-            : m_numPixles(numPixels)
-        {
-        }
-
         inline void nextPixel() {
         }
 
-        inline void premultiplyAlphaWithWeight(compositetype &) const {
+        inline void premultiplyAlphaWithWeight(mixtype &) const {
         }
-
-        inline int normalizeFactor() const {
-            return m_numPixles;
-        }
-
-    private:
-        const int m_numPixles;
     };
 
     template<class AbstractSource, class WeightsWrapper>
-    void mixColorsImpl(AbstractSource source, WeightsWrapper weightsWrapper, quint32 nColors, quint8 *dst) const {
-        // Create and initialize to 0 the array of totals
-        typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype totals[_CSTrait::channels_nb];
-        typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype totalAlpha = 0;
-
-        memset(totals, 0, sizeof(totals));
+    static void accumulateColorsImpl(AbstractSource source, WeightsWrapper weightsWrapper, int nColors, MixDataResult *result) {
 
         // Compute the total for each channel by summing each colors multiplied by the weightlabcache
 
         while (nColors--) {
-            const typename _CSTrait::channels_type* color = _CSTrait::nativeArray(source.getPixel());
-            typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype alphaTimesWeight;
+            const channels_type* color = _CSTrait::nativeArray(source.getPixel());
+            mixtype alphaTimesWeight;
 
             if (_CSTrait::alpha_pos != -1) {
                 alphaTimesWeight = color[_CSTrait::alpha_pos];
             } else {
-                alphaTimesWeight = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue;
+                alphaTimesWeight = KoColorSpaceMathsTraits<channels_type>::unitValue;
             }
 
             weightsWrapper.premultiplyAlphaWithWeight(alphaTimesWeight);
 
             for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
                 if (i != _CSTrait::alpha_pos) {
-                    totals[i] += color[i] * alphaTimesWeight;
+                    result->totals[i] += color[i] * alphaTimesWeight;
                 }
             }
 
-            totalAlpha += alphaTimesWeight;
+            result->totalAlpha += alphaTimesWeight;
             source.nextPixel();
             weightsWrapper.nextPixel();
         }
-
-        // set totalAlpha to the minimum between its value and the unit value of the channels
-        const int sumOfWeights = weightsWrapper.normalizeFactor();
-
-        if (totalAlpha > KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue * sumOfWeights) {
-            totalAlpha = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::unitValue * sumOfWeights;
-        }
-
-        typename _CSTrait::channels_type* dstColor = _CSTrait::nativeArray(dst);
-
-        if (totalAlpha > 0) {
-
-            for (int i = 0; i < (int)_CSTrait::channels_nb; i++) {
-                if (i != _CSTrait::alpha_pos) {
-
-                    typename KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::compositetype v = totals[i] / totalAlpha;
-
-                    if (v > KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::max) {
-                        v = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::max;
-                    }
-                    if (v < KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::min) {
-                        v = KoColorSpaceMathsTraits<typename _CSTrait::channels_type>::min;
-                    }
-                    dstColor[ i ] = v;
-                }
-            }
-
-            if (_CSTrait::alpha_pos != -1) {
-                dstColor[ _CSTrait::alpha_pos ] = totalAlpha / sumOfWeights;
-            }
-        } else {
-            memset(dst, 0, sizeof(typename _CSTrait::channels_type) * _CSTrait::channels_nb);
-        }
     }
 
 };
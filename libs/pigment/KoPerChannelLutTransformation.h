@@ -0,0 +1,206 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KO_PER_CHANNEL_LUT_TRANSFORMATION_H
+#define KO_PER_CHANNEL_LUT_TRANSFORMATION_H
+
+#include <QVector>
+
+#include "KoColorTransformation.h"
+#include "KoColorSpace.h"
+#include "KoColorSpaceMaths.h"
+#include "KoChannelInfo.h"
+
+#include <KoConfig.h>
+#ifdef HAVE_OPENEXR
+#include <half.h>
+#endif
+
+namespace KoPerChannelLutPrivate {
+
+/**
+ * The size of the transfer tables passed to
+ * KoColorSpace::createPerChannelAdjustment()
+ */
+static const int transferSize = 256;
+
+/**
+ * Applies a single transfer table to a channel value. The table is a
+ * tabulated curve: transferSize samples of the range [0, 0xFFFF],
+ * evenly spaced in the input range. The values in between the samples
+ * are interpolated linearly.
+ *
+ * The generic version evaluates the interpolation for every value and
+ * is used for floating point channels.
+ */
+template <typename channels_type>
+struct ChannelLut
+{
+    void init(const quint16 *transfer) {
+        m_identity = !transfer;
+        if (m_identity) return;
+
+        m_table.resize(transferSize);
+        for (int i = 0; i < transferSize; i++) {
+            m_table[i] = KoColorSpaceMaths<quint16, float>::scaleToA(transfer[i]);
+        }
+    }
+
+    inline channels_type operator()(channels_type value) const {
+        if (m_identity) return value;
+
+        const float x = qBound(0.0f, KoColorSpaceMaths<channels_type, float>::scaleToA(value), 1.0f);
+        const float pos = x * (transferSize - 1);
+        const int index = qMin(int(pos), transferSize - 2);
+        const float offset = pos - index;
+
+        const float result = m_table[index] + offset * (m_table[index + 1] - m_table[index]);
+        return KoColorSpaceMaths<float, channels_type>::scaleToA(result);
+    }
+
+private:
+    QVector<float> m_table;
+    bool m_identity = true;
+};
+
+/**
+ * For 8-bit channels every possible value coincides with one of the
+ * samples of the transfer table, so it becomes a direct lookup.
+ */
+template <>
+struct ChannelLut<quint8>
+{
+    void init(const quint16 *transfer) {
+        for (int i = 0; i < 256; i++) {
+            m_table[i] = transfer ? KoColorSpaceMaths<quint16, quint8>::scaleToA(transfer[i]) : quint8(i);
+        }
+    }
+
+    inline quint8 operator()(quint8 value) const {
+        return m_table[value];
+    }
+
+private:
+    quint8 m_table[256];
+};
+
+/**
+ * For 16-bit channels the interpolated curve is precomputed for all
+ * the 65536 values, so the per-pixel work is a single lookup.
+ */
+template <>
+struct ChannelLut<quint16>
+{
+    void init(const quint16 *transfer) {
+        m_table.resize(0x10000);
+
+        if (!transfer) {
+            for (int i = 0; i < 0x10000; i++) {
+                m_table[i] = quint16(i);
+            }
+            return;
+        }
+
+        const qreal scale = qreal(transferSize - 1) / 0xFFFF;
+
+        for (int i = 0; i < 0x10000; i++) {
+            const qreal pos = i * scale;
+            const int index = qMin(int(pos), transferSize - 2);
+            const qreal offset = pos - index;
+
+            const qreal result = transfer[index] + offset * (transfer[index + 1] - transfer[index]);
+            m_table[i] = quint16(qBound(0, qRound(result), 0xFFFF));
+        }
+    }
+
+    inline quint16 operator()(quint16 value) const {
+        return m_table[value];
+    }
+
+private:
+    QVector<quint16> m_table;
+};
+
+}
+
+/**
+ * A per-channel curves adjustment that applies the transfer tables
+ * passed to KoColorSpace::createPerChannelAdjustment() directly to the
+ * channel values. The table lookup is selected in compile time by the
+ * channel type of the color space traits:
+ *
+ *  - 8-bit channels use a direct 256-entries lookup table
+ *  - 16-bit channels use a full 65536-entries lookup table
+ *  - floating point channels evaluate the piecewise-linear curve
+ *
+ * The transfer tables are ordered as the color channels are shown to
+ * the user (KoChannelInfo::displayPosition()), with the alpha channel
+ * table coming last. A null table means the channel is not changed.
+ *
+ * The transformation is valid only for the color models where the
+ * channel values are the plain normalized coordinates of the color,
+ * e.g. RGB or grayscale.
+ */
+template <class _CSTrait>
+class KoPerChannelLutTransformation : public KoColorTransformation
+{
+    typedef typename _CSTrait::channels_type channels_type;
+    typedef KoPerChannelLutPrivate::ChannelLut<channels_type> ChannelLut;
+
+public:
+    KoPerChannelLutTransformation(const KoColorSpace *cs, const quint16 * const *transferValues)
+    {
+        Q_ASSERT(cs->channelCount() == _CSTrait::channels_nb);
+
+        const QList<KoChannelInfo *> sortedChannels =
+            KoChannelInfo::displayOrderSorted(cs->channels());
+
+        const int alphaTransferIndex = cs->colorChannelCount();
+        int colorTransferIndex = 0;
+
+        Q_FOREACH (const KoChannelInfo *channel, sortedChannels) {
+            const int pixelIndex = channel->pos() / sizeof(channels_type);
+            const int transferIndex =
+                channel->channelType() == KoChannelInfo::ALPHA ?
+                alphaTransferIndex : colorTransferIndex++;
+
+            m_luts[pixelIndex].init(transferValues[transferIndex]);
+        }
+    }
+
+    void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const override
+    {
+        const channels_type *src = reinterpret_cast<const channels_type*>(srcU8);
+        channels_type *dst = reinterpret_cast<channels_type*>(dstU8);
+
+        for (qint32 i = 0; i < nPixels; i++) {
+            for (int c = 0; c < int(_CSTrait::channels_nb); c++) {
+                dst[c] = m_luts[c](src[c]);
+            }
+
+            src += _CSTrait::channels_nb;
+            dst += _CSTrait::channels_nb;
+        }
+    }
+
+private:
+    ChannelLut m_luts[_CSTrait::channels_nb];
+};
+
+#endif // KO_PER_CHANNEL_LUT_TRANSFORMATION_H
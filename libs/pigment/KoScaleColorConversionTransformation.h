@@ -21,6 +21,42 @@
 
 #include <KoColorConversionTransformation.h>
 #include <KoColorConversionTransformationFactory.h>
+#include <KoColorSpaceMaths.h>
+
+namespace KoScaleColorConversionPrivate {
+
+template<typename src_channel_type, typename dst_channel_type>
+struct ChannelScaler
+{
+    static inline void scale(const src_channel_type *src, dst_channel_type *dst, int numValues) {
+        for (int i = 0; i < numValues; i++) {
+            dst[i] = KoColorSpaceMaths<src_channel_type, dst_channel_type>::scaleToA(src[i]);
+        }
+    }
+};
+
+#ifdef HAVE_OPENEXR
+
+template<>
+struct ChannelScaler<half, float>
+{
+    static inline void scale(const half *src, float *dst, int numValues) {
+        KoHalfBatchConversion::instance()->toFloat(src, dst, numValues);
+    }
+};
+
+template<>
+struct ChannelScaler<float, half>
+{
+    static inline void scale(const float *src, half *dst, int numValues) {
+        KoHalfBatchConversion::instance()->fromFloat(src, dst, numValues);
+    }
+};
+
+#endif
+
+}
+
 /**
  * This transformation allows to convert between two color spaces with the same
  * color model but different channel type.
@@ -35,9 +71,7 @@ public:
     virtual void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const {
         const typename _src_CSTraits_::channels_type* src = _src_CSTraits_::nativeArray(srcU8);
         typename _dst_CSTraits_::channels_type* dst = _dst_CSTraits_::nativeArray(dstU8);
-        for (quint32 i = 0; i < _src_CSTraits_::channels_nb * nPixels; i++) {
-            dst[i] = KoColorSpaceMaths<typename _src_CSTraits_::channels_type, typename _dst_CSTraits_::channels_type>::scaleToA(src[i]);
-        }
+        KoScaleColorConversionPrivate::ChannelScaler<typename _src_CSTraits_::channels_type, typename _dst_CSTraits_::channels_type>::scale(src, dst, _src_CSTraits_::channels_nb * nPixels);
     }
 };
 
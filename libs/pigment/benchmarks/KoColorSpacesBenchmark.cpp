@@ -21,6 +21,8 @@
 #include <QTest>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorSpace.h>
+#include <KoMixColorsOp.h>
+#include <QScopedPointer>
 
 #define NB_PIXELS 1000000
 
@@ -146,4 +148,45 @@ void KoColorSpacesBenchmark::benchmarkSetAlpha2IndividualCall()
     END_BENCHMARK
 }
 
+void KoColorSpacesBenchmark::benchmarkMixColors_data()
+{
+    createRowsColumns();
+}
+
+void KoColorSpacesBenchmark::benchmarkMixColors()
+{
+    START_BENCHMARK
+    const KoMixColorsOp *mixOp = colorSpace->mixColorsOp();
+    QScopedArrayPointer<quint8> result(new quint8[pixelSize]);
+
+    QBENCHMARK {
+        mixOp->mixColors(data, NB_PIXELS, result.data());
+    }
+    END_BENCHMARK
+}
+
+void KoColorSpacesBenchmark::benchmarkMixColorsMixer_data()
+{
+    createRowsColumns();
+}
+
+void KoColorSpacesBenchmark::benchmarkMixColorsMixer()
+{
+    START_BENCHMARK
+    const KoMixColorsOp *mixOp = colorSpace->mixColorsOp();
+    QScopedArrayPointer<quint8> result(new quint8[pixelSize]);
+
+    // emulates feeding of a dab of 1000x1000 pixels row by row
+    const int rowLength = 1000;
+
+    QBENCHMARK {
+        QScopedPointer<KoMixColorsOp::Mixer> mixer(mixOp->createMixer());
+        for (int i = 0; i < NB_PIXELS; i += rowLength) {
+            mixer->accumulateAverage(data + i * pixelSize, rowLength);
+        }
+        mixer->computeMixedColor(result.data());
+    }
+    END_BENCHMARK
+}
+
 QTEST_MAIN(KoColorSpacesBenchmark)
@@ -93,6 +93,19 @@ struct OptimizedOpsSelector<KoRgbF32Traits>
     }
 };
 
+#ifdef HAVE_OPENEXR
+template<>
+struct OptimizedOpsSelector<KoRgbF16Traits>
+{
+    static KoCompositeOp* createAlphaDarkenOp(const KoColorSpace *cs) {
+        return KoOptimizedCompositeOpFactory::createAlphaDarkenOpF16(cs);
+    }
+    static KoCompositeOp* createOverOp(const KoColorSpace *cs) {
+        return KoOptimizedCompositeOpFactory::createOverOpF16(cs);
+    }
+};
+#endif
+
 template<class Traits>
 struct AddGeneralOps<Traits, true>
 {
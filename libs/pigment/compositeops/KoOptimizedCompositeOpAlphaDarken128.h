@@ -176,9 +176,11 @@ struct AlphaDarkenCompositor128 {
             dst[1] = lerp(dst[1], src[1], srcAlphaNorm);
             dst[2] = lerp(dst[2], src[2], srcAlphaNorm);
         } else {
-            const pixel_type *s = reinterpret_cast<const pixel_type*>(src);
-            pixel_type *d = reinterpret_cast<pixel_type*>(dst);
-            *d = *s;
+            // pixel_type covers only a single channel of a 128-bit pixel,
+            // so copy the color channels one by one
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
         }
 
         float flow = oparams.flow;
@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPALPHADARKENF16_H
+#define KOOPTIMIZEDCOMPOSITEOPALPHADARKENF16_H
+
+#include "KoOptimizedCompositeOpAlphaDarken128.h"
+#include "KoStreamedMathF16.h"
+
+/**
+ * An optimized version of a composite op for the use in half-float
+ * RGBA colorspaces (8 byte pixels with alpha channel placed at the
+ * end of the pixel). The pixels are converted into floats in batches
+ * and composed with the same compositor as RGBA F32 pixels.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenF16 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpAlphaDarkenF16(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_ALPHA_DARKEN, i18n("Alpha darken"), KoCompositeOp::categoryMix()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            KoStreamedMathF16<_impl>::template genericCompositeF16<true, true, AlphaDarkenCompositor128<float, quint32> >(params);
+        } else {
+            KoStreamedMathF16<_impl>::template genericCompositeF16<false, true, AlphaDarkenCompositor128<float, quint32> >(params);
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPALPHADARKENF16_H
@@ -20,6 +20,9 @@
 #include "KoOptimizedCompositeOpFactoryPerArch.h" // vc.h must come first
 #include "KoOptimizedCompositeOpFactory.h"
 
+#include <QScopedPointer>
+#include <KoColorSpaceMaths.h>
+
 #if defined(__clang__)
 #pragma GCC diagnostic ignored "-Wundef"
 #endif
@@ -44,3 +47,29 @@ KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOp128(const KoColorSpace
 {
     return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128> >(cs);
 }
+
+#ifdef HAVE_OPENEXR
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createAlphaDarkenOpF16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenF16> >(cs);
+}
+
+KoCompositeOp* KoOptimizedCompositeOpFactory::createOverOpF16(const KoColorSpace *cs)
+{
+    return createOptimizedClass<KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOverF16> >(cs);
+}
+
+KoHalfBatchConversion::~KoHalfBatchConversion()
+{
+}
+
+const KoHalfBatchConversion* KoHalfBatchConversion::instance()
+{
+    static QScopedPointer<KoHalfBatchConversion> s_instance(
+        createOptimizedClass<KoHalfBatchConversionFactoryPerArch>(0));
+
+    return s_instance.data();
+}
+
+#endif /* HAVE_OPENEXR */
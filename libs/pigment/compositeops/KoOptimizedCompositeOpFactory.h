@@ -21,6 +21,7 @@
 #define KOOPTIMIZEDCOMPOSITEOPFACTORY_H
 
 #include "kritapigment_export.h"
+#include <KoConfig.h>
 
 class KoCompositeOp;
 class KoColorSpace;
@@ -44,6 +45,11 @@ public:
     static KoCompositeOp* createOverOp32(const KoColorSpace *cs);
     static KoCompositeOp* createAlphaDarkenOp128(const KoColorSpace *cs);
     static KoCompositeOp* createOverOp128(const KoColorSpace *cs);
+
+#ifdef HAVE_OPENEXR
+    static KoCompositeOp* createAlphaDarkenOpF16(const KoColorSpace *cs);
+    static KoCompositeOp* createOverOpF16(const KoColorSpace *cs);
+#endif
 };
 
 #endif /* KOOPTIMIZEDCOMPOSITEOPFACTORY_H */
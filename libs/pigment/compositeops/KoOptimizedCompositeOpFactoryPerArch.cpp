@@ -26,6 +26,8 @@
 #include "KoOptimizedCompositeOpAlphaDarken128.h"
 #include "KoOptimizedCompositeOpOver32.h"
 #include "KoOptimizedCompositeOpOver128.h"
+#include "KoOptimizedCompositeOpAlphaDarkenF16.h"
+#include "KoOptimizedCompositeOpOverF16.h"
 
 #include <QString>
 #include "DebugPigment.h"
@@ -67,3 +69,30 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoOptimizedCompositeOpOver128<Vc::CurrentImplementation::current()>(param);
 }
+
+#ifdef HAVE_OPENEXR
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenF16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenF16>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpAlphaDarkenF16<Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOverF16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOverF16>::create<Vc::CurrentImplementation::current()>(ParamType param)
+{
+    return new KoOptimizedCompositeOpOverF16<Vc::CurrentImplementation::current()>(param);
+}
+
+template<>
+KoHalfBatchConversionFactoryPerArch::ReturnType
+KoHalfBatchConversionFactoryPerArch::create<Vc::CurrentImplementation::current()>(ParamType)
+{
+    return new KoHalfBatchConversionImpl<Vc::CurrentImplementation::current()>();
+}
+
+#endif /* HAVE_OPENEXR */
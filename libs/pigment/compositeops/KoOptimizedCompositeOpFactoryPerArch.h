@@ -22,6 +22,7 @@
 
 
 #include <compositeops/KoVcMultiArchBuildSupport.h>
+#include <KoConfig.h>
 
 
 class KoCompositeOp;
@@ -40,6 +41,31 @@ class KoOptimizedCompositeOpAlphaDarken128;
 template<Vc::Implementation _impl>
 class KoOptimizedCompositeOpOver128;
 
+#ifdef HAVE_OPENEXR
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpAlphaDarkenF16;
+
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverF16;
+
+class KoHalfBatchConversion;
+
+struct KoHalfBatchConversionFactoryPerArch
+{
+    /**
+     * The conversion doesn't need any parameters, the type is
+     * present only to satisfy the interface of createOptimizedClass()
+     */
+    typedef void* ParamType;
+    typedef KoHalfBatchConversion* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType);
+};
+
+#endif /* HAVE_OPENEXR */
+
 template<template<Vc::Implementation I> class CompositeOp>
 struct KoOptimizedCompositeOpFactoryPerArch
 {
@@ -22,6 +22,7 @@
 #include "KoColorSpaceTraits.h"
 #include "KoCompositeOpAlphaDarken.h"
 #include "KoCompositeOpOver.h"
+#include "KoColorSpaceMaths.h"
 
 
 template<>
@@ -55,3 +56,50 @@ KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOver128>::create<Vc::
 {
     return new KoCompositeOpOver<KoRgbF32Traits>(param);
 }
+
+#ifdef HAVE_OPENEXR
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenF16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpAlphaDarkenF16>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return new KoCompositeOpAlphaDarken<KoRgbF16Traits>(param);
+}
+
+template<>
+template<>
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOverF16>::ReturnType
+KoOptimizedCompositeOpFactoryPerArch<KoOptimizedCompositeOpOverF16>::create<Vc::ScalarImpl>(ParamType param)
+{
+    return new KoCompositeOpOver<KoRgbF16Traits>(param);
+}
+
+namespace {
+
+class KoHalfBatchConversionScalar : public KoHalfBatchConversion
+{
+public:
+    void toFloat(const half *src, float *dst, int numValues) const override {
+        for (int i = 0; i < numValues; i++) {
+            dst[i] = src[i];
+        }
+    }
+
+    void fromFloat(const float *src, half *dst, int numValues) const override {
+        for (int i = 0; i < numValues; i++) {
+            dst[i] = src[i];
+        }
+    }
+};
+
+}
+
+template<>
+KoHalfBatchConversionFactoryPerArch::ReturnType
+KoHalfBatchConversionFactoryPerArch::create<Vc::ScalarImpl>(ParamType)
+{
+    return new KoHalfBatchConversionScalar();
+}
+
+#endif /* HAVE_OPENEXR */
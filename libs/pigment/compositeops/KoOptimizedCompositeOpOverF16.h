@@ -0,0 +1,76 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDCOMPOSITEOPOVERF16_H
+#define KOOPTIMIZEDCOMPOSITEOPOVERF16_H
+
+#include "KoOptimizedCompositeOpOver128.h"
+#include "KoStreamedMathF16.h"
+
+/**
+ * An optimized version of a composite op for the use in half-float
+ * RGBA colorspaces (8 byte pixels with alpha channel placed at the
+ * end of the pixel). The pixels are converted into floats in batches
+ * and composed with the same compositor as RGBA F32 pixels.
+ */
+template<Vc::Implementation _impl>
+class KoOptimizedCompositeOpOverF16 : public KoCompositeOp
+{
+public:
+    KoOptimizedCompositeOpOverF16(const KoColorSpace* cs)
+        : KoCompositeOp(cs, COMPOSITE_OVER, i18n("Normal"), KoCompositeOp::categoryMix()) {}
+
+    using KoCompositeOp::composite;
+
+    virtual void composite(const KoCompositeOp::ParameterInfo& params) const
+    {
+        if(params.maskRowStart) {
+            composite<true>(params);
+        } else {
+            composite<false>(params);
+        }
+    }
+
+    template <bool haveMask>
+    inline void composite(const KoCompositeOp::ParameterInfo& params) const {
+        if (params.channelFlags.isEmpty() ||
+            params.channelFlags == QBitArray(4, true)) {
+
+            KoStreamedMathF16<_impl>::template genericCompositeF16<haveMask, false, OverCompositor128<float, quint32, false, true> >(params);
+        } else {
+            const bool allChannelsFlag =
+                params.channelFlags.at(0) &&
+                params.channelFlags.at(1) &&
+                params.channelFlags.at(2);
+
+            const bool alphaLocked =
+                !params.channelFlags.at(3);
+
+            if (allChannelsFlag && alphaLocked) {
+                KoStreamedMathF16<_impl>::template genericCompositeF16_novector<haveMask, false, OverCompositor128<float, quint32, true, true> >(params);
+            } else if (!allChannelsFlag && !alphaLocked) {
+                KoStreamedMathF16<_impl>::template genericCompositeF16_novector<haveMask, false, OverCompositor128<float, quint32, false, false> >(params);
+            } else /*if (!allChannelsFlag && alphaLocked) */{
+                KoStreamedMathF16<_impl>::template genericCompositeF16_novector<haveMask, false, OverCompositor128<float, quint32, true, false> >(params);
+            }
+        }
+    }
+};
+
+#endif // KOOPTIMIZEDCOMPOSITEOPOVERF16_H
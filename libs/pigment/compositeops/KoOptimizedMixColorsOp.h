@@ -0,0 +1,381 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDMIXCOLORSOP_H
+#define KOOPTIMIZEDMIXCOLORSOP_H
+
+#include "KoVcMultiArchBuildSupport.h"
+
+#include <KoAlwaysInline.h>
+
+#include <limits>
+
+#include "KoColorSpaceTraits.h"
+#include "KoMixColorsOpImpl.h"
+
+
+/**
+ * Vectorized implementations of the accumulation loop of
+ * KoMixColorsOpImpl. Every kernel processes as many whole vectors of
+ * pixels as possible and returns the number of the processed pixels.
+ * The tail is processed by the scalar code of KoMixColorsOpImpl, so
+ * the final color is rounded exactly in the same way.
+ */
+
+/**
+ * The weights of KoMixColorsOp::Mixer::accumulate() may be any qint16
+ * values, so the integer kernels check how big they actually are
+ */
+static inline int maxAbsWeight(const qint16 *weights, int nPixels)
+{
+    int result = 0;
+    for (int i = 0; i < nPixels; i++) {
+        result = qMax(result, qAbs(int(weights[i])));
+    }
+    return result;
+}
+
+/**
+ * 4 channels, 8 bit per channel, alpha in the most significant byte
+ * (e.g. KoBgrU8Traits)
+ */
+template<Vc::Implementation _impl>
+struct KoMixColorsKernel32
+{
+    typedef qint64 mixtype;
+    typedef Vc::SimdArray<int, Vc::float_v::size()> int_v;
+    typedef Vc::SimdArray<unsigned int, Vc::float_v::size()> uint_v;
+
+    template<bool useWeights>
+    static int accumulate(const quint8 *colors, const qint16 *weights, int nPixels,
+                          mixtype *totals, mixtype *totalAlpha)
+    {
+        const int vectorSize = Vc::float_v::size();
+        const int numVectors = nPixels / vectorSize;
+
+        /**
+         * Every lane of the accumulators grows by up to 255 * 255 * |weight|
+         * per vector, where the weight is 1 when no weights are used.
+         * We use 32-bit integer math to get exactly the same result as
+         * the scalar version, so the accumulators should be flushed into
+         * 64-bit totals before they overflow. Even the biggest qint16
+         * weight keeps a single step below 2^31.
+         */
+        const int maxWeight = useWeights ? qMax(1, maxAbsWeight(weights, numVectors * vectorSize)) : 1;
+        const int flushPeriod = qMax(1, int(std::numeric_limits<qint32>::max() / (255 * 255 * qint64(maxWeight))));
+
+        const uint_v lowByteMask(0xFF);
+
+        int_v acc0(Vc::Zero);
+        int_v acc1(Vc::Zero);
+        int_v acc2(Vc::Zero);
+        int_v accAlpha(Vc::Zero);
+
+        int blockCounter = 0;
+
+        for (int i = 0; i < numVectors; i++) {
+            uint_v data_i;
+            data_i.load(reinterpret_cast<const quint32*>(colors), Vc::Unaligned);
+
+            int_v alpha = int_v(data_i >> 24);
+
+            if (useWeights) {
+                const int_v weights_i(weights, Vc::Unaligned);
+                alpha *= weights_i;
+                weights += vectorSize;
+            }
+
+            acc0 += int_v( data_i        & lowByteMask) * alpha;
+            acc1 += int_v((data_i >> 8)  & lowByteMask) * alpha;
+            acc2 += int_v((data_i >> 16) & lowByteMask) * alpha;
+            accAlpha += alpha;
+
+            colors += vectorSize * 4;
+
+            if (++blockCounter >= flushPeriod) {
+                flushLanes(acc0, &totals[0]);
+                flushLanes(acc1, &totals[1]);
+                flushLanes(acc2, &totals[2]);
+                flushLanes(accAlpha, totalAlpha);
+                blockCounter = 0;
+            }
+        }
+
+        flushLanes(acc0, &totals[0]);
+        flushLanes(acc1, &totals[1]);
+        flushLanes(acc2, &totals[2]);
+        flushLanes(accAlpha, totalAlpha);
+
+        return numVectors * vectorSize;
+    }
+
+private:
+    static ALWAYS_INLINE void flushLanes(int_v &acc, mixtype *total) {
+        // the horizontal sum of the lanes may overflow 32-bit integer
+        for (size_t i = 0; i < int_v::size(); i++) {
+            *total += acc[i];
+        }
+        acc.setZero();
+    }
+};
+
+/**
+ * 4 channels, 16 bit per channel, alpha in the last channel
+ * (e.g. KoBgrU16Traits)
+ *
+ * The products of the channels with the alpha and the weights don't fit
+ * into 32-bit integers anymore, so the kernel uses float math. The
+ * partial sums are flushed into the 64-bit totals often enough to keep
+ * the error much lower than a unit of the channel value.
+ */
+template<Vc::Implementation _impl>
+struct KoMixColorsKernel64
+{
+    typedef qint64 mixtype;
+    typedef Vc::SimdArray<int, Vc::float_v::size()> int_v;
+    typedef Vc::SimdArray<unsigned int, Vc::float_v::size()> uint_v;
+
+    template<bool useWeights>
+    static int accumulate(const quint8 *colors, const qint16 *weights, int nPixels,
+                          mixtype *totals, mixtype *totalAlpha)
+    {
+        const int vectorSize = Vc::float_v::size();
+        const int numVectors = nPixels / vectorSize;
+        const int flushPeriod = 8;
+
+        /**
+         * alpha * weight is exact in float only while it fits into 24 bits,
+         * so bigger weights are left to the scalar code
+         */
+        if (useWeights && maxAbsWeight(weights, numVectors * vectorSize) > 255) {
+            return 0;
+        }
+
+        const uint_v lowWordMask(0xFFFF);
+        const int_v loIndexes = int_v(Vc::IndexesFromZero) * 2;
+        const int_v hiIndexes = loIndexes + 1;
+
+        Vc::float_v acc0(Vc::Zero);
+        Vc::float_v acc1(Vc::Zero);
+        Vc::float_v acc2(Vc::Zero);
+        int_v accAlpha(Vc::Zero);
+
+        int blockCounter = 0;
+
+        for (int i = 0; i < numVectors; i++) {
+            const quint32 *ptr = reinterpret_cast<const quint32*>(colors);
+
+            // every pixel is stored as two 32-bit words: (c0, c1) and (c2, alpha)
+            uint_v lo;
+            uint_v hi;
+            lo.gather(ptr, loIndexes);
+            hi.gather(ptr, hiIndexes);
+
+            // alpha * weight is less than 2^24, so it is exact both in int and float
+            int_v alpha_i = int_v(hi >> 16);
+
+            if (useWeights) {
+                const int_v weights_i(weights, Vc::Unaligned);
+                alpha_i *= weights_i;
+                weights += vectorSize;
+            }
+
+            const Vc::float_v alpha = Vc::simd_cast<Vc::float_v>(alpha_i);
+
+            acc0 += Vc::simd_cast<Vc::float_v>(int_v(lo & lowWordMask)) * alpha;
+            acc1 += Vc::simd_cast<Vc::float_v>(int_v(lo >> 16)) * alpha;
+            acc2 += Vc::simd_cast<Vc::float_v>(int_v(hi & lowWordMask)) * alpha;
+            accAlpha += alpha_i;
+
+            colors += vectorSize * 8;
+
+            if (++blockCounter >= flushPeriod) {
+                flushLanes(acc0, &totals[0]);
+                flushLanes(acc1, &totals[1]);
+                flushLanes(acc2, &totals[2]);
+                flushLanes(accAlpha, totalAlpha);
+                blockCounter = 0;
+            }
+        }
+
+        flushLanes(acc0, &totals[0]);
+        flushLanes(acc1, &totals[1]);
+        flushLanes(acc2, &totals[2]);
+        flushLanes(accAlpha, totalAlpha);
+
+        return numVectors * vectorSize;
+    }
+
+private:
+    static ALWAYS_INLINE void flushLanes(Vc::float_v &acc, mixtype *total) {
+        double sum = 0;
+        for (size_t i = 0; i < Vc::float_v::size(); i++) {
+            sum += acc[i];
+        }
+        *total += qRound64(sum);
+        acc.setZero();
+    }
+
+    static ALWAYS_INLINE void flushLanes(int_v &acc, mixtype *total) {
+        for (size_t i = 0; i < int_v::size(); i++) {
+            *total += acc[i];
+        }
+        acc.setZero();
+    }
+};
+
+/**
+ * 4 channels, 32-bit float per channel, alpha in the last channel
+ * (e.g. KoRgbF32Traits)
+ */
+template<Vc::Implementation _impl>
+struct KoMixColorsKernel128
+{
+    typedef double mixtype;
+
+    struct Pixel {
+        float c0;
+        float c1;
+        float c2;
+        float alpha;
+    };
+
+    template<bool useWeights>
+    static int accumulate(const quint8 *colors, const qint16 *weights, int nPixels,
+                          mixtype *totals, mixtype *totalAlpha)
+    {
+        typedef Vc::SimdArray<int, Vc::float_v::size()> int_v;
+
+        const int vectorSize = Vc::float_v::size();
+        const int numVectors = nPixels / vectorSize;
+
+        // flush the float accumulators into double totals to avoid error build-up
+        const int flushPeriod = 64;
+
+        const Vc::float_v::IndexType indexes(Vc::IndexesFromZero);
+
+        Vc::float_v acc0(Vc::Zero);
+        Vc::float_v acc1(Vc::Zero);
+        Vc::float_v acc2(Vc::Zero);
+        Vc::float_v accAlpha(Vc::Zero);
+
+        int blockCounter = 0;
+
+        for (int i = 0; i < numVectors; i++) {
+            const Pixel *pixels = reinterpret_cast<const Pixel*>(colors);
+
+            Vc::float_v c0;
+            Vc::float_v c1;
+            Vc::float_v c2;
+            Vc::float_v alpha;
+
+            Vc::InterleavedMemoryWrapper<Pixel, Vc::float_v> data(const_cast<Pixel*>(pixels));
+            Vc::tie(c0, c1, c2, alpha) = data[indexes];
+
+            if (useWeights) {
+                const int_v weights_i(weights, Vc::Unaligned);
+                alpha *= Vc::simd_cast<Vc::float_v>(weights_i);
+                weights += vectorSize;
+            }
+
+            acc0 += c0 * alpha;
+            acc1 += c1 * alpha;
+            acc2 += c2 * alpha;
+            accAlpha += alpha;
+
+            colors += vectorSize * sizeof(Pixel);
+
+            if (++blockCounter >= flushPeriod) {
+                flushLanes(acc0, &totals[0]);
+                flushLanes(acc1, &totals[1]);
+                flushLanes(acc2, &totals[2]);
+                flushLanes(accAlpha, totalAlpha);
+                blockCounter = 0;
+            }
+        }
+
+        flushLanes(acc0, &totals[0]);
+        flushLanes(acc1, &totals[1]);
+        flushLanes(acc2, &totals[2]);
+        flushLanes(accAlpha, totalAlpha);
+
+        return numVectors * vectorSize;
+    }
+
+private:
+    static ALWAYS_INLINE void flushLanes(Vc::float_v &acc, mixtype *total) {
+        for (size_t i = 0; i < Vc::float_v::size(); i++) {
+            *total += acc[i];
+        }
+        acc.setZero();
+    }
+};
+
+/**
+ * A mix colors op that uses \p Kernel for mixing continuous arrays of
+ * pixels. The arrays of pointers are still mixed by the scalar code.
+ */
+template<class _CSTrait, class Kernel>
+class KoOptimizedMixColorsOpImpl : public KoMixColorsOpImpl<_CSTrait>
+{
+    typedef KoMixColorsOpImpl<_CSTrait> BaseClass;
+    typedef typename BaseClass::MixDataResult MixDataResult;
+
+    static_assert(_CSTrait::channels_nb == 4 && _CSTrait::alpha_pos == 3,
+                  "The vectorized mixing supports 4-channel pixels with alpha in the end only");
+    static_assert(std::is_same<typename BaseClass::mixtype, typename Kernel::mixtype>::value,
+                  "The kernel should accumulate data in the same type as the scalar implementation");
+
+protected:
+    void accumulateArray(const quint8 *colors, const qint16 *weights, int nPixels, MixDataResult *result) const override {
+        const int numProcessed =
+            Kernel::template accumulate<true>(colors, weights, nPixels,
+                                              result->totals, &result->totalAlpha);
+
+        BaseClass::accumulateArray(colors + numProcessed * _CSTrait::pixelSize,
+                                   weights + numProcessed,
+                                   nPixels - numProcessed, result);
+    }
+
+    void accumulateArrayAverage(const quint8 *colors, int nPixels, MixDataResult *result) const override {
+        const int numProcessed =
+            Kernel::template accumulate<false>(colors, 0, nPixels,
+                                               result->totals, &result->totalAlpha);
+
+        BaseClass::accumulateArrayAverage(colors + numProcessed * _CSTrait::pixelSize,
+                                          nPixels - numProcessed, result);
+    }
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedMixColorsOp32 : public KoOptimizedMixColorsOpImpl<KoBgrU8Traits, KoMixColorsKernel32<_impl>>
+{
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedMixColorsOp64 : public KoOptimizedMixColorsOpImpl<KoBgrU16Traits, KoMixColorsKernel64<_impl>>
+{
+};
+
+template<Vc::Implementation _impl>
+class KoOptimizedMixColorsOp128 : public KoOptimizedMixColorsOpImpl<KoRgbF32Traits, KoMixColorsKernel128<_impl>>
+{
+};
+
+#endif /* KOOPTIMIZEDMIXCOLORSOP_H */
@@ -0,0 +1,40 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDMIXCOLORSOPFACTORY_H
+#define KOOPTIMIZEDMIXCOLORSOPFACTORY_H
+
+#include "kritapigment_export.h"
+
+class KoMixColorsOp;
+
+/**
+ * Creates the vectorized versions of KoMixColorsOp for the most used
+ * color spaces. The ops are created in a separate object module for
+ * the same reasons as in KoOptimizedCompositeOpFactory.
+ */
+class KRITAPIGMENT_EXPORT KoOptimizedMixColorsOpFactory
+{
+public:
+    static KoMixColorsOp* createMixColorsOp32();
+    static KoMixColorsOp* createMixColorsOp64();
+    static KoMixColorsOp* createMixColorsOp128();
+};
+
+#endif /* KOOPTIMIZEDMIXCOLORSOPFACTORY_H */
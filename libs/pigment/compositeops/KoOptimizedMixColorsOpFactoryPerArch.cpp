@@ -0,0 +1,53 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#if !defined _MSC_VER
+#pragma GCC diagnostic ignored "-Wundef"
+#endif
+
+#include "KoOptimizedMixColorsOpFactoryPerArch.h"
+#include "KoOptimizedMixColorsOp.h"
+
+#if defined(__clang__)
+#pragma GCC diagnostic ignored "-Wlocal-type-template-args"
+#endif
+
+template<>
+template<>
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp32>::ReturnType
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp32>::create<Vc::CurrentImplementation::current()>(ParamType)
+{
+    return new KoOptimizedMixColorsOp32<Vc::CurrentImplementation::current()>();
+}
+
+template<>
+template<>
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp64>::ReturnType
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp64>::create<Vc::CurrentImplementation::current()>(ParamType)
+{
+    return new KoOptimizedMixColorsOp64<Vc::CurrentImplementation::current()>();
+}
+
+template<>
+template<>
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp128>::ReturnType
+KoOptimizedMixColorsOpFactoryPerArch<KoOptimizedMixColorsOp128>::create<Vc::CurrentImplementation::current()>(ParamType)
+{
+    return new KoOptimizedMixColorsOp128<Vc::CurrentImplementation::current()>();
+}
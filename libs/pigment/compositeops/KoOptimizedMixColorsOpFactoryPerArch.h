@@ -0,0 +1,54 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KOOPTIMIZEDMIXCOLORSOPFACTORYPERARCH_H
+#define KOOPTIMIZEDMIXCOLORSOPFACTORYPERARCH_H
+
+
+#include <compositeops/KoVcMultiArchBuildSupport.h>
+
+
+class KoMixColorsOp;
+
+
+template<Vc::Implementation _impl>
+class KoOptimizedMixColorsOp32;
+
+template<Vc::Implementation _impl>
+class KoOptimizedMixColorsOp64;
+
+template<Vc::Implementation _impl>
+class KoOptimizedMixColorsOp128;
+
+template<template<Vc::Implementation I> class MixColorsOp>
+struct KoOptimizedMixColorsOpFactoryPerArch
+{
+    /**
+     * The mix colors ops don't need any parameters, the type is
+     * present only to satisfy the interface of createOptimizedClass()
+     */
+    typedef void* ParamType;
+    typedef KoMixColorsOp* ReturnType;
+
+    template<Vc::Implementation _impl>
+    static ReturnType create(ParamType);
+};
+
+
+#endif /* KOOPTIMIZEDMIXCOLORSOPFACTORYPERARCH_H */
@@ -0,0 +1,241 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; see the file COPYING.LIB.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __KOSTREAMED_MATH_F16_H
+#define __KOSTREAMED_MATH_F16_H
+
+#include <KoConfig.h>
+
+#ifdef HAVE_OPENEXR
+
+#include "KoStreamedMath.h"
+#include <KoColorSpaceMaths.h>
+#include <half.h>
+
+#if defined __AVX2__
+#include <immintrin.h>
+#define KO_HAVE_F16C_INTRINSICS
+#endif
+
+#if defined KO_HAVE_F16C_INTRINSICS && (defined __GNUC__ || defined __clang__)
+/**
+ * F16C is not a part of the AVX2 instruction set formally, but all
+ * the CPUs supporting AVX2 support F16C as well, so we just enable
+ * it for the conversion functions of the AVX2 implementation
+ */
+#define KO_F16C_TARGET __attribute__((target("f16c")))
+#else
+#define KO_F16C_TARGET
+#endif
+
+/**
+ * Batch conversion of half floats into floats and back. The generic
+ * version uses the OpenEXR conversion routines, the AVX2 one uses
+ * F16C instructions, which give bit-exact results: both round to the
+ * nearest even and handle denormals and infinities the same way.
+ */
+template<Vc::Implementation _impl>
+struct KoStreamedMathF16Conversion
+{
+    static inline void toFloat(const half *src, float *dst, int numValues) {
+        for (int i = 0; i < numValues; i++) {
+            dst[i] = src[i];
+        }
+    }
+
+    static inline void fromFloat(const float *src, half *dst, int numValues) {
+        for (int i = 0; i < numValues; i++) {
+            dst[i] = src[i];
+        }
+    }
+};
+
+#if defined KO_HAVE_F16C_INTRINSICS
+
+template<>
+struct KoStreamedMathF16Conversion<Vc::AVX2Impl>
+{
+    KO_F16C_TARGET static inline void toFloat(const half *src, float *dst, int numValues) {
+        int i = 0;
+
+        for (; i <= numValues - 8; i += 8) {
+            const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+        }
+
+        for (; i < numValues; i++) {
+            dst[i] = src[i];
+        }
+    }
+
+    KO_F16C_TARGET static inline void fromFloat(const float *src, half *dst, int numValues) {
+        int i = 0;
+
+        for (; i <= numValues - 8; i += 8) {
+            const __m256 f = _mm256_loadu_ps(src + i);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+        }
+
+        for (; i < numValues; i++) {
+            dst[i] = src[i];
+        }
+    }
+};
+
+#endif /* KO_HAVE_F16C_INTRINSICS */
+
+template<Vc::Implementation _impl>
+class KoHalfBatchConversionImpl : public KoHalfBatchConversion
+{
+public:
+    void toFloat(const half *src, float *dst, int numValues) const override {
+        KoStreamedMathF16Conversion<_impl>::toFloat(src, dst, numValues);
+    }
+
+    void fromFloat(const float *src, half *dst, int numValues) const override {
+        KoStreamedMathF16Conversion<_impl>::fromFloat(src, dst, numValues);
+    }
+};
+
+template<Vc::Implementation _impl>
+struct KoStreamedMathF16
+{
+    typedef KoStreamedMathF16Conversion<_impl> Conversion;
+
+    /**
+     * Composes half-float RGBA pixels using a compositor written for
+     * 128-bit float pixels (e.g. OverCompositor128). Every vector of
+     * pixels is unpacked into an aligned float buffer, composed and
+     * packed back.
+     */
+    template<bool useMask, bool useFlow, class Compositor>
+    static void genericCompositeF16(const KoCompositeOp::ParameterInfo& params)
+    {
+        genericCompositeF16Impl<useMask, useFlow, true, Compositor>(params);
+    }
+
+    /**
+     * Composes half-float RGBA pixels without using vector instructions
+     * in the compositor itself, the conversion is still batched per pixel
+     */
+    template<bool useMask, bool useFlow, class Compositor>
+    static void genericCompositeF16_novector(const KoCompositeOp::ParameterInfo& params)
+    {
+        genericCompositeF16Impl<useMask, useFlow, false, Compositor>(params);
+    }
+
+private:
+    template<bool useMask, bool useFlow, bool useVector, class Compositor>
+    static void genericCompositeF16Impl(const KoCompositeOp::ParameterInfo& params)
+    {
+        Q_UNUSED(useFlow);
+
+        const int channelsNb = 4;
+        const int vectorSize = useVector ? int(Vc::float_v::size()) : 1;
+        const int vectorChannels = channelsNb * vectorSize;
+        const bool srcIsSolid = !params.srcRowStride;
+        const int srcVectorInc = srcIsSolid ? 0 : vectorChannels;
+        const int srcLinearInc = srcIsSolid ? 0 : channelsNb;
+
+        typename Compositor::OptionalParams optionalParams(params);
+
+        /**
+         * Vc::float_v arrays guarantee the alignment required by the
+         * compositors for the destination data
+         */
+        Vc::float_v srcBuffer[channelsNb];
+        Vc::float_v dstBuffer[channelsNb];
+        float *srcFloat = reinterpret_cast<float*>(srcBuffer);
+        float *dstFloat = reinterpret_cast<float*>(dstBuffer);
+
+        if (srcIsSolid) {
+            const half *src = reinterpret_cast<const half*>(params.srcRowStart);
+            for (int i = 0; i < int(Vc::float_v::size()); i++) {
+                Conversion::toFloat(src, srcFloat + i * channelsNb, channelsNb);
+            }
+        }
+
+        quint8 *dstRowStart = params.dstRowStart;
+        const quint8 *srcRowStart = params.srcRowStart;
+        const quint8 *maskRowStart = params.maskRowStart;
+
+        for (quint32 r = params.rows; r > 0; --r) {
+            const half *src = reinterpret_cast<const half*>(srcRowStart);
+            half *dst = reinterpret_cast<half*>(dstRowStart);
+            const quint8 *mask = maskRowStart;
+
+            int i = 0;
+
+            if (useVector) {
+                for (; i <= qint32(params.cols) - vectorSize; i += vectorSize) {
+                    if (!srcIsSolid) {
+                        Conversion::toFloat(src, srcFloat, vectorChannels);
+                    }
+                    Conversion::toFloat(dst, dstFloat, vectorChannels);
+
+                    Compositor::template compositeVector<useMask, true, _impl>(
+                        reinterpret_cast<const quint8*>(srcFloat),
+                        reinterpret_cast<quint8*>(dstFloat),
+                        mask, params.opacity, optionalParams);
+
+                    Conversion::fromFloat(dstFloat, dst, vectorChannels);
+
+                    src += srcVectorInc;
+                    dst += vectorChannels;
+
+                    if (useMask) {
+                        mask += vectorSize;
+                    }
+                }
+            }
+
+            for (; i < qint32(params.cols); i++) {
+                if (!srcIsSolid) {
+                    Conversion::toFloat(src, srcFloat, channelsNb);
+                }
+                Conversion::toFloat(dst, dstFloat, channelsNb);
+
+                Compositor::template compositeOnePixelScalar<useMask, _impl>(
+                    reinterpret_cast<const quint8*>(srcFloat),
+                    reinterpret_cast<quint8*>(dstFloat),
+                    mask, params.opacity, optionalParams);
+
+                Conversion::fromFloat(dstFloat, dst, channelsNb);
+
+                src += srcLinearInc;
+                dst += channelsNb;
+
+                if (useMask) {
+                    mask++;
+                }
+            }
+
+            srcRowStart += params.srcRowStride;
+            dstRowStart += params.dstRowStride;
+
+            if (useMask) {
+                maskRowStart += params.maskRowStride;
+            }
+        }
+    }
+};
+
+#endif /* HAVE_OPENEXR */
+
+#endif /* __KOSTREAMED_MATH_F16_H */
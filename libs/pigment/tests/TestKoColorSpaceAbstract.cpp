@@ -2,8 +2,11 @@
 
 #include "KoColorSpaceAbstract.h"
 #include "KoColorSpaceTraits.h"
+#include "KoOptimizedMixColorsOpFactory.h"
 
 #include <cfloat>
+#include <QScopedPointer>
+#include <QVector>
 
 #include <QTest>
 
@@ -386,4 +389,151 @@ void TestKoColorSpaceAbstract::testMixColorsOpU8NoAlphaLinear()
 }
 
 
+void TestKoColorSpaceAbstract::testMixColorsOpMixer()
+{
+    typedef KoColorSpaceTrait<quint8, 3, 2> U8ColorSpace;
+    QScopedPointer<KoMixColorsOp> op(new KoMixColorsOpImpl<U8ColorSpace>);
+
+    const int numPixels = 1000;
+    QVector<quint8> pixels(numPixels * U8ColorSpace::pixelSize);
+    QVector<qint16> weights(numPixels);
+
+    qsrand(1);
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = qrand() % 256;
+    }
+    for (int i = 0; i < weights.size(); i++) {
+        weights[i] = qrand() % 256;
+    }
+
+    quint8 expectedPixel[U8ColorSpace::pixelSize];
+    quint8 outputPixel[U8ColorSpace::pixelSize];
+
+    op->mixColors(pixels.constData(), numPixels, expectedPixel);
+
+    {
+        QScopedPointer<KoMixColorsOp::Mixer> mixer(op->createMixer());
+        for (int i = 0; i < numPixels; i += 100) {
+            mixer->accumulateAverage(pixels.constData() + i * U8ColorSpace::pixelSize, 100);
+        }
+        QCOMPARE(mixer->currentWeightsSum(), qint64(numPixels));
+
+        mixer->computeMixedColor(outputPixel);
+        QCOMPARE(memcmp(outputPixel, expectedPixel, U8ColorSpace::pixelSize), 0);
+
+        // a reset mixer starts from scratch
+        mixer->reset();
+        QCOMPARE(mixer->currentWeightsSum(), qint64(0));
+
+        mixer->accumulateAverage(pixels.constData(), numPixels);
+        mixer->computeMixedColor(outputPixel);
+        QCOMPARE(memcmp(outputPixel, expectedPixel, U8ColorSpace::pixelSize), 0);
+    }
+
+    // the sum of the weights is not necessarily equal to 255 for the mixer
+    qint64 weightSum = 0;
+    for (int i = 0; i < numPixels; i++) {
+        weightSum += weights[i];
+    }
+
+    {
+        QScopedPointer<KoMixColorsOp::Mixer> mixer(op->createMixer());
+        mixer->accumulate(pixels.constData(), weights.constData(), weightSum, numPixels);
+        mixer->computeMixedColor(outputPixel);
+
+        // compare with the average of the pixels duplicated according to their weights
+        QScopedPointer<KoMixColorsOp::Mixer> referenceMixer(op->createMixer());
+        for (int i = 0; i < numPixels; i++) {
+            for (int j = 0; j < weights[i]; j++) {
+                referenceMixer->accumulateAverage(pixels.constData() + i * U8ColorSpace::pixelSize, 1);
+            }
+        }
+        referenceMixer->computeMixedColor(expectedPixel);
+
+        QCOMPARE(memcmp(outputPixel, expectedPixel, U8ColorSpace::pixelSize), 0);
+    }
+}
+
+template <class Traits>
+void testOptimizedMixColorsOpImpl(KoMixColorsOp *optimizedOp, typename Traits::channels_type tolerance)
+{
+    typedef typename Traits::channels_type channels_type;
+
+    QScopedPointer<KoMixColorsOp> op(optimizedOp);
+    QScopedPointer<KoMixColorsOp> scalarOp(new KoMixColorsOpImpl<Traits>());
+
+    // an odd number of pixels checks the processing of the tail of the array
+    const int numPixels = 4099;
+    QVector<channels_type> pixels(numPixels * Traits::channels_nb);
+    QVector<qint16> weights(numPixels);
+
+    qsrand(1);
+    for (int i = 0; i < pixels.size(); i++) {
+        pixels[i] = KoColorSpaceMaths<quint8, channels_type>::scaleToA(quint8(qrand() % 256));
+    }
+    for (int i = 0; i < weights.size(); i++) {
+        weights[i] = qrand() % 256;
+    }
+
+    const quint8 *data = reinterpret_cast<const quint8*>(pixels.constData());
+
+    channels_type expectedPixel[Traits::channels_nb];
+    channels_type outputPixel[Traits::channels_nb];
+
+    for (int numMixedPixels = 1; numMixedPixels <= numPixels; numMixedPixels = numMixedPixels * 3 + 1) {
+        scalarOp->mixColors(data, weights.constData(), numMixedPixels, reinterpret_cast<quint8*>(expectedPixel));
+        op->mixColors(data, weights.constData(), numMixedPixels, reinterpret_cast<quint8*>(outputPixel));
+
+        for (int i = 0; i < int(Traits::channels_nb); i++) {
+            QVERIFY2(qAbs(outputPixel[i] - expectedPixel[i]) <= tolerance,
+                     QString("weighted, %1 pixels, channel %2: %3 vs %4")
+                     .arg(numMixedPixels).arg(i)
+                     .arg(float(outputPixel[i])).arg(float(expectedPixel[i])).toLatin1());
+        }
+
+        scalarOp->mixColors(data, numMixedPixels, reinterpret_cast<quint8*>(expectedPixel));
+        op->mixColors(data, numMixedPixels, reinterpret_cast<quint8*>(outputPixel));
+
+        for (int i = 0; i < int(Traits::channels_nb); i++) {
+            QVERIFY2(qAbs(outputPixel[i] - expectedPixel[i]) <= tolerance,
+                     QString("average, %1 pixels, channel %2: %3 vs %4")
+                     .arg(numMixedPixels).arg(i)
+                     .arg(float(outputPixel[i])).arg(float(expectedPixel[i])).toLatin1());
+        }
+    }
+
+    // the mixer accepts any qint16 weights, the kernels must not overflow with them
+    QVector<qint16> bigWeights(numPixels);
+    qint64 bigWeightSum = 0;
+    for (int i = 0; i < bigWeights.size(); i++) {
+        bigWeights[i] = 32767 - qrand() % 256;
+        bigWeightSum += bigWeights[i];
+    }
+
+    {
+        QScopedPointer<KoMixColorsOp::Mixer> scalarMixer(scalarOp->createMixer());
+        scalarMixer->accumulate(data, bigWeights.constData(), bigWeightSum, numPixels);
+        scalarMixer->computeMixedColor(reinterpret_cast<quint8*>(expectedPixel));
+
+        QScopedPointer<KoMixColorsOp::Mixer> mixer(op->createMixer());
+        mixer->accumulate(data, bigWeights.constData(), bigWeightSum, numPixels);
+        mixer->computeMixedColor(reinterpret_cast<quint8*>(outputPixel));
+
+        for (int i = 0; i < int(Traits::channels_nb); i++) {
+            QVERIFY2(qAbs(outputPixel[i] - expectedPixel[i]) <= tolerance,
+                     QString("big weights, channel %1: %2 vs %3")
+                     .arg(i)
+                     .arg(float(outputPixel[i])).arg(float(expectedPixel[i])).toLatin1());
+        }
+    }
+}
+
+void TestKoColorSpaceAbstract::testOptimizedMixColorsOp()
+{
+    // 8-bit version uses integer math, so it should be exact
+    testOptimizedMixColorsOpImpl<KoBgrU8Traits>(KoOptimizedMixColorsOpFactory::createMixColorsOp32(), 0);
+    testOptimizedMixColorsOpImpl<KoBgrU16Traits>(KoOptimizedMixColorsOpFactory::createMixColorsOp64(), 1);
+    testOptimizedMixColorsOpImpl<KoRgbF32Traits>(KoOptimizedMixColorsOpFactory::createMixColorsOp128(), 1e-5f);
+}
+
 QTEST_GUILESS_MAIN(TestKoColorSpaceAbstract)
@@ -11,6 +11,8 @@ private Q_SLOTS:
     void testMixColorsOpF32();
     void testMixColorsOpU8NoAlpha();
     void testMixColorsOpU8NoAlphaLinear();
+    void testMixColorsOpMixer();
+    void testOptimizedMixColorsOp();
 };
 
 #endif
@@ -4,6 +4,8 @@
 #include "KoColorSpaceMaths.h"
 
 #include <QTest>
+#include <QVector>
+#include <cmath>
 
 void TestKoColorSpaceMaths::testColorSpaceMathsTraits()
 {
@@ -26,4 +28,53 @@ void TestKoColorSpaceMaths::testScaleToA()
     }
 }
 
+void TestKoColorSpaceMaths::testHalfBatchConversion()
+{
+#ifdef HAVE_OPENEXR
+    const KoHalfBatchConversion *conversion = KoHalfBatchConversion::instance();
+    QVERIFY(conversion);
+
+    // an odd size, so that both vector and scalar parts are used
+    const int numValues = 65536 + 3;
+
+    QVector<half> halfValues(numValues);
+    for (int i = 0; i < numValues; i++) {
+        halfValues[i].setBits(quint16(i));
+    }
+
+    QVector<float> floatValues(numValues);
+    conversion->toFloat(halfValues.constData(), floatValues.data(), numValues);
+
+    for (int i = 0; i < numValues; i++) {
+        const float expected = halfValues[i];
+        if (std::isnan(expected)) {
+            QVERIFY(std::isnan(floatValues[i]));
+        } else {
+            QCOMPARE(floatValues[i], expected);
+        }
+    }
+
+    /**
+     * Check rounding: the values placed in the middle between two
+     * representable halves and some values out of the half range
+     */
+    for (int i = 0; i < numValues - 1; i++) {
+        floatValues[i] = 0.5f * (floatValues[i] + floatValues[i + 1]);
+    }
+    floatValues[numValues - 1] = 1e10f;
+
+    QVector<half> result(numValues);
+    conversion->fromFloat(floatValues.constData(), result.data(), numValues);
+
+    for (int i = 0; i < numValues; i++) {
+        const half expected = floatValues[i];
+        if (expected.isNan()) {
+            QVERIFY(result[i].isNan());
+        } else {
+            QCOMPARE(result[i].bits(), expected.bits());
+        }
+    }
+#endif
+}
+
 QTEST_GUILESS_MAIN(TestKoColorSpaceMaths)
@@ -9,6 +9,7 @@ class TestKoColorSpaceMaths : public QObject
 private Q_SLOTS:
     void testColorSpaceMathsTraits();
     void testScaleToA();
+    void testHalfBatchConversion();
 };
 
 #endif
@@ -0,0 +1,105 @@
+#include "TestKoPerChannelLutTransformation.h"
+
+#include <QTest>
+#include <QScopedPointer>
+#include <QVector>
+
+#include "KoColorSpace.h"
+#include "KoColorSpaceRegistry.h"
+#include "KoColorModelStandardIds.h"
+#include "KoColorTransformation.h"
+
+namespace {
+
+QVector<quint16> invertedTransfer()
+{
+    QVector<quint16> transfer(256);
+    for (int i = 0; i < transfer.size(); i++) {
+        transfer[i] = 0xFFFF - i * 257;
+    }
+    return transfer;
+}
+
+/**
+ * Red and alpha channels are inverted, green and blue are
+ * left untouched. The transfers are passed in the display
+ * order: red, green, blue, alpha.
+ */
+KoColorTransformation* createRedAlphaInversion(const KoColorSpace *cs, const QVector<quint16> &transfer)
+{
+    const quint16 *transfers[4] = { transfer.constData(), 0, 0, transfer.constData() };
+    return cs->createPerChannelAdjustment(transfers);
+}
+
+}
+
+void TestKoPerChannelLutTransformation::testU8()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    const QVector<quint16> transfer = invertedTransfer();
+
+    QScopedPointer<KoColorTransformation> t(createRedAlphaInversion(cs, transfer));
+    QVERIFY(t);
+
+    // BGRA
+    const quint8 src[] = { 10, 20, 30, 40,
+                           0, 128, 255, 255 };
+    quint8 dst[8];
+
+    t->transform(src, dst, 2);
+
+    QCOMPARE(dst[0], quint8(10));
+    QCOMPARE(dst[1], quint8(20));
+    QCOMPARE(dst[2], quint8(225));
+    QCOMPARE(dst[3], quint8(215));
+
+    QCOMPARE(dst[4], quint8(0));
+    QCOMPARE(dst[5], quint8(128));
+    QCOMPARE(dst[6], quint8(0));
+    QCOMPARE(dst[7], quint8(0));
+}
+
+void TestKoPerChannelLutTransformation::testU16()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb16();
+    const QVector<quint16> transfer = invertedTransfer();
+
+    QScopedPointer<KoColorTransformation> t(createRedAlphaInversion(cs, transfer));
+    QVERIFY(t);
+
+    // BGRA, the values fall in between the samples of the transfer
+    const quint16 src[] = { 1000, 2000, 1000, 65535 };
+    quint16 dst[4];
+
+    t->transform(reinterpret_cast<const quint8*>(src), reinterpret_cast<quint8*>(dst), 1);
+
+    QCOMPARE(dst[0], quint16(1000));
+    QCOMPARE(dst[1], quint16(2000));
+    QCOMPARE(dst[2], quint16(64535));
+    QCOMPARE(dst[3], quint16(0));
+}
+
+void TestKoPerChannelLutTransformation::testF32()
+{
+    const KoColorSpace *cs =
+        KoColorSpaceRegistry::instance()->colorSpace(RGBAColorModelID.id(), Float32BitsColorDepthID.id(), 0);
+    QVERIFY(cs);
+
+    const QVector<quint16> transfer = invertedTransfer();
+
+    QScopedPointer<KoColorTransformation> t(createRedAlphaInversion(cs, transfer));
+    QVERIFY(t);
+
+    // RGBA
+    const float src[] = { 0.25f, 0.3f, 1.5f, 1.0f };
+    float dst[4];
+
+    t->transform(reinterpret_cast<const quint8*>(src), reinterpret_cast<quint8*>(dst), 1);
+
+    QVERIFY(qAbs(dst[0] - 0.75f) < 1e-5);
+    QCOMPARE(dst[1], 0.3f);
+    QCOMPARE(dst[2], 1.5f);
+    QVERIFY(qAbs(dst[3] - 0.0f) < 1e-5);
+}
+
+QTEST_GUILESS_MAIN(TestKoPerChannelLutTransformation)
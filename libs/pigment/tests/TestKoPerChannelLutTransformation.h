@@ -0,0 +1,15 @@
+#ifndef TESTKOPERCHANNELLUTTRANSFORMATION_H
+#define TESTKOPERCHANNELLUTTRANSFORMATION_H
+
+#include <QObject>
+
+class TestKoPerChannelLutTransformation : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testU8();
+    void testU16();
+    void testF32();
+};
+
+#endif
@@ -152,4 +152,14 @@ void FreehandStrokeBenchmark::testColorsmudgeDefaultTip()
     benchmarkBrush("testing_200px_colorsmudge_default.kpp");
 }
 
+void FreehandStrokeBenchmark::testSprayRasterParticles()
+{
+    benchmarkBrush("testing_spray_30px_raster_particles.kpp");
+}
+
+void FreehandStrokeBenchmark::testFilterOpGaussianBlur()
+{
+    benchmarkBrush("testing_filterop_gauss.kpp");
+}
+
 QTEST_MAIN(FreehandStrokeBenchmark)
@@ -38,6 +38,9 @@ private Q_SLOTS:
     void testStampTip();
 
     void testColorsmudgeDefaultTip();
+
+    void testSprayRasterParticles();
+    void testFilterOpGaussianBlur();
 };
 
 #endif // FREEHANDSTROKEBENCHMARK_H
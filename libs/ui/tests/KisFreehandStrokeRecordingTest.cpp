@@ -0,0 +1,115 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisFreehandStrokeRecordingTest.h"
+
+#include <QTest>
+#include <QBuffer>
+
+#include "KisFreehandStrokeRecording.h"
+
+namespace {
+
+void compareInfos(const KisPaintInformation &lhs, const KisPaintInformation &rhs)
+{
+    // the recording is stored with single precision
+    QVERIFY(qAbs(lhs.pos().x() - rhs.pos().x()) < 1e-3);
+    QVERIFY(qAbs(lhs.pos().y() - rhs.pos().y()) < 1e-3);
+    QVERIFY(qFuzzyCompare(float(lhs.pressure()), float(rhs.pressure())));
+    QVERIFY(qFuzzyCompare(float(lhs.xTilt()), float(rhs.xTilt())));
+    QVERIFY(qFuzzyCompare(float(lhs.yTilt()), float(rhs.yTilt())));
+    QVERIFY(qFuzzyCompare(float(lhs.rotation()), float(rhs.rotation())));
+    QVERIFY(qFuzzyCompare(float(lhs.currentTime()), float(rhs.currentTime())));
+    QCOMPARE(lhs.canvasRotation(), rhs.canvasRotation());
+    QCOMPARE(lhs.canvasMirroredH(), rhs.canvasMirroredH());
+}
+
+}
+
+void KisFreehandStrokeRecordingTest::testSaveLoad()
+{
+    KisPaintInformation startInfo(QPointF(10.5, 20.25), 0.3, 10, -20, 15, 0.0, 1.0, 0.0, 0.0);
+
+    KisFreehandStrokeRecording recording;
+    recording.startStroke(0.5, startInfo, 2, 90, true);
+
+    KisPaintInformation pi1(QPointF(100.125, 200.5), 0.5, 30, 40, 0, 0.1, 1.0, 15.0, 2.0);
+    KisPaintInformation pi2(QPointF(300.75, 150.5), 0.9, -30, 10, 0, 0.2, 1.0, 30.0, 3.0);
+
+    recording.addPoint(0, startInfo);
+    recording.addLine(1, pi1, pi2);
+    recording.addBezierCurve(0, pi1, QPointF(150, 150), QPointF(250, 250), pi2);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY(recording.save(&buffer));
+    buffer.close();
+
+    buffer.open(QIODevice::ReadOnly);
+    KisFreehandStrokeRecording loaded;
+    QVERIFY(loaded.load(&buffer));
+
+    QCOMPARE(loaded.startAngle(), 0.5);
+    QCOMPARE(loaded.numStrokeInfos(), 2);
+    QCOMPARE(loaded.canvasRotation(), 90);
+    QCOMPARE(loaded.canvasMirroredH(), true);
+    QCOMPARE(loaded.segments().size(), 3);
+
+    const QVector<KisFreehandStrokeRecording::Segment> &segments = loaded.segments();
+
+    QCOMPARE(segments[0].type, KisFreehandStrokeRecording::PaintPoint);
+    QCOMPARE(segments[1].type, KisFreehandStrokeRecording::PaintLine);
+    QCOMPARE(segments[2].type, KisFreehandStrokeRecording::PaintBezierCurve);
+
+    QCOMPARE(segments[1].strokeInfoId, 1);
+    QCOMPARE(segments[2].control1, QPointF(150, 150));
+    QCOMPARE(segments[2].control2, QPointF(250, 250));
+
+    for (int i = 0; i < segments.size(); i++) {
+        QCOMPARE(segments[i].timestamp, recording.segments()[i].timestamp);
+    }
+
+    startInfo.setCanvasRotation(90);
+    startInfo.setCanvasHorizontalMirrorState(true);
+    pi1.setCanvasRotation(90);
+    pi1.setCanvasHorizontalMirrorState(true);
+    pi2.setCanvasRotation(90);
+    pi2.setCanvasHorizontalMirrorState(true);
+
+    compareInfos(loaded.startInfo(), startInfo);
+    compareInfos(segments[0].pi1, startInfo);
+    compareInfos(segments[1].pi1, pi1);
+    compareInfos(segments[1].pi2, pi2);
+    compareInfos(segments[2].pi1, pi1);
+    compareInfos(segments[2].pi2, pi2);
+
+    QCOMPARE(loaded.boundingRect(), QRectF(QPointF(10.5, 20.25), QPointF(300.75, 250)));
+}
+
+void KisFreehandStrokeRecordingTest::testCorruptedFile()
+{
+    QByteArray data("this is not a stroke recording");
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    KisFreehandStrokeRecording recording;
+    QVERIFY(!recording.load(&buffer));
+}
+
+QTEST_MAIN(KisFreehandStrokeRecordingTest)
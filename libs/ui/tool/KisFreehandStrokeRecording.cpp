@@ -0,0 +1,344 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisFreehandStrokeRecording.h"
+
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QPolygonF>
+
+#include "kis_debug.h"
+
+namespace {
+
+const quint32 recordingMagic = 0x4B465352; // "KFSR"
+const quint16 recordingVersion = 1;
+
+void writePaintInformation(QDataStream &stream, const KisPaintInformation &pi)
+{
+    stream << pi.pos().x() << pi.pos().y()
+           << pi.pressure()
+           << pi.xTilt() << pi.yTilt()
+           << pi.rotation()
+           << pi.tangentialPressure()
+           << pi.perspective()
+           << pi.currentTime()
+           << pi.drawingSpeed();
+}
+
+KisPaintInformation readPaintInformation(QDataStream &stream)
+{
+    qreal x, y, pressure, xTilt, yTilt, rotation;
+    qreal tangentialPressure, perspective, time, speed;
+
+    stream >> x >> y
+           >> pressure
+           >> xTilt >> yTilt
+           >> rotation
+           >> tangentialPressure
+           >> perspective
+           >> time
+           >> speed;
+
+    return KisPaintInformation(QPointF(x, y), pressure, xTilt, yTilt, rotation,
+                               tangentialPressure, perspective, time, speed);
+}
+
+void prepareStream(QDataStream &stream)
+{
+    // the coordinates do not need double precision, so keep
+    // the files compact
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+}
+
+KisFreehandStrokeRecording::KisFreehandStrokeRecording()
+{
+}
+
+KisFreehandStrokeRecording::~KisFreehandStrokeRecording()
+{
+}
+
+void KisFreehandStrokeRecording::startStroke(qreal startAngle,
+                                             const KisPaintInformation &startInfo,
+                                             int numStrokeInfos,
+                                             int canvasRotation,
+                                             bool canvasMirroredH)
+{
+    m_startAngle = startAngle;
+    m_startInfo = startInfo;
+    m_numStrokeInfos = numStrokeInfos;
+    m_canvasRotation = canvasRotation;
+    m_canvasMirroredH = canvasMirroredH;
+    m_segments.clear();
+    m_strokeTime.start();
+}
+
+void KisFreehandStrokeRecording::addPoint(int strokeInfoId, const KisPaintInformation &pi)
+{
+    Segment segment;
+    segment.type = PaintPoint;
+    segment.strokeInfoId = strokeInfoId;
+    segment.timestamp = m_strokeTime.elapsed();
+    segment.pi1 = pi;
+
+    m_segments.append(segment);
+}
+
+void KisFreehandStrokeRecording::addLine(int strokeInfoId,
+                                         const KisPaintInformation &pi1,
+                                         const KisPaintInformation &pi2)
+{
+    Segment segment;
+    segment.type = PaintLine;
+    segment.strokeInfoId = strokeInfoId;
+    segment.timestamp = m_strokeTime.elapsed();
+    segment.pi1 = pi1;
+    segment.pi2 = pi2;
+
+    m_segments.append(segment);
+}
+
+void KisFreehandStrokeRecording::addBezierCurve(int strokeInfoId,
+                                                const KisPaintInformation &pi1,
+                                                const QPointF &control1,
+                                                const QPointF &control2,
+                                                const KisPaintInformation &pi2)
+{
+    Segment segment;
+    segment.type = PaintBezierCurve;
+    segment.strokeInfoId = strokeInfoId;
+    segment.timestamp = m_strokeTime.elapsed();
+    segment.pi1 = pi1;
+    segment.pi2 = pi2;
+    segment.control1 = control1;
+    segment.control2 = control2;
+
+    m_segments.append(segment);
+}
+
+void KisFreehandStrokeRecording::addSegment(const Segment &segment)
+{
+    m_segments.append(segment);
+}
+
+qreal KisFreehandStrokeRecording::startAngle() const
+{
+    return m_startAngle;
+}
+
+KisPaintInformation KisFreehandStrokeRecording::startInfo() const
+{
+    return m_startInfo;
+}
+
+int KisFreehandStrokeRecording::numStrokeInfos() const
+{
+    return m_numStrokeInfos;
+}
+
+int KisFreehandStrokeRecording::canvasRotation() const
+{
+    return m_canvasRotation;
+}
+
+bool KisFreehandStrokeRecording::canvasMirroredH() const
+{
+    return m_canvasMirroredH;
+}
+
+const QVector<KisFreehandStrokeRecording::Segment>& KisFreehandStrokeRecording::segments() const
+{
+    return m_segments;
+}
+
+QRectF KisFreehandStrokeRecording::boundingRect() const
+{
+    QPolygonF points;
+    points << m_startInfo.pos();
+
+    Q_FOREACH (const Segment &segment, m_segments) {
+        points << segment.pi1.pos();
+
+        if (segment.type != PaintPoint) {
+            points << segment.pi2.pos();
+        }
+
+        if (segment.type == PaintBezierCurve) {
+            points << segment.control1 << segment.control2;
+        }
+    }
+
+    return points.boundingRect();
+}
+
+bool KisFreehandStrokeRecording::save(QIODevice *device) const
+{
+    QDataStream stream(device);
+    prepareStream(stream);
+
+    stream << recordingMagic << recordingVersion;
+    stream << m_startAngle
+           << qint32(m_numStrokeInfos)
+           << qint32(m_canvasRotation)
+           << m_canvasMirroredH;
+
+    writePaintInformation(stream, m_startInfo);
+
+    stream << quint32(m_segments.size());
+
+    Q_FOREACH (const Segment &segment, m_segments) {
+        stream << quint8(segment.type)
+               << quint8(segment.strokeInfoId)
+               << qint32(segment.timestamp);
+
+        writePaintInformation(stream, segment.pi1);
+
+        if (segment.type != PaintPoint) {
+            writePaintInformation(stream, segment.pi2);
+        }
+
+        if (segment.type == PaintBezierCurve) {
+            stream << segment.control1 << segment.control2;
+        }
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool KisFreehandStrokeRecording::load(QIODevice *device)
+{
+    QDataStream stream(device);
+    prepareStream(stream);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+
+    stream >> magic >> version;
+
+    if (magic != recordingMagic || version != recordingVersion) {
+        warnKrita << "KisFreehandStrokeRecording: unsupported file format" << magic << version;
+        return false;
+    }
+
+    qint32 numStrokeInfos = 0;
+    qint32 canvasRotation = 0;
+
+    stream >> m_startAngle
+           >> numStrokeInfos
+           >> canvasRotation
+           >> m_canvasMirroredH;
+
+    m_numStrokeInfos = numStrokeInfos;
+    m_canvasRotation = canvasRotation;
+
+    auto prepareInfo = [this] (KisPaintInformation pi) {
+        pi.setCanvasRotation(m_canvasRotation);
+        pi.setCanvasHorizontalMirrorState(m_canvasMirroredH);
+        return pi;
+    };
+
+    m_startInfo = prepareInfo(readPaintInformation(stream));
+
+    quint32 numSegments = 0;
+    stream >> numSegments;
+
+    m_segments.clear();
+    m_segments.reserve(numSegments);
+
+    for (quint32 i = 0; i < numSegments && stream.status() == QDataStream::Ok; i++) {
+        quint8 type = 0;
+        quint8 strokeInfoId = 0;
+        qint32 timestamp = 0;
+
+        stream >> type >> strokeInfoId >> timestamp;
+
+        if (type > PaintBezierCurve || strokeInfoId >= m_numStrokeInfos) {
+            warnKrita << "KisFreehandStrokeRecording: corrupted segment" << i;
+            return false;
+        }
+
+        Segment segment;
+        segment.type = SegmentType(type);
+        segment.strokeInfoId = strokeInfoId;
+        segment.timestamp = timestamp;
+        segment.pi1 = prepareInfo(readPaintInformation(stream));
+
+        if (segment.type != PaintPoint) {
+            segment.pi2 = prepareInfo(readPaintInformation(stream));
+        }
+
+        if (segment.type == PaintBezierCurve) {
+            stream >> segment.control1 >> segment.control2;
+        }
+
+        m_segments.append(segment);
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool KisFreehandStrokeRecording::save(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        warnKrita << "KisFreehandStrokeRecording: failed to open" << fileName << "for writing";
+        return false;
+    }
+
+    return save(&file);
+}
+
+bool KisFreehandStrokeRecording::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        warnKrita << "KisFreehandStrokeRecording: failed to open" << fileName;
+        return false;
+    }
+
+    return load(&file);
+}
+
+QString KisFreehandStrokeRecording::recordingDirectory()
+{
+    return QString::fromLocal8Bit(qgetenv("KRITA_RECORD_FREEHAND_STROKES"));
+}
+
+QString KisFreehandStrokeRecording::generateRecordingFileName()
+{
+    const QString baseName =
+        QString("stroke-%1").arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz"));
+
+    QDir dir(recordingDirectory());
+
+    QString fileName = dir.absoluteFilePath(baseName + ".kisstroke");
+    for (int i = 1; QFileInfo(fileName).exists(); i++) {
+        fileName = dir.absoluteFilePath(QString("%1-%2.kisstroke").arg(baseName).arg(i));
+    }
+
+    return fileName;
+}
@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef KISFREEHANDSTROKERECORDING_H
+#define KISFREEHANDSTROKERECORDING_H
+
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include <QElapsedTimer>
+
+#include "kritaui_export.h"
+#include <brushengine/kis_paint_information.h>
+
+class QIODevice;
+
+/**
+ * KisFreehandStrokeRecording stores the stream of painting jobs that
+ * KisToolFreehandHelper generates for a single stroke, that is the
+ * already smoothed paint information objects exactly as they are passed
+ * to FreehandStrokeStrategy. The recording can be saved to a compact
+ * binary file and replayed later without any GUI, which lets us
+ * reproduce the performance of real strokes in the benchmarks.
+ *
+ * The recording is enabled by setting the KRITA_RECORD_FREEHAND_STROKES
+ * environment variable to a directory. Every finished freehand stroke
+ * is saved into that directory as a separate *.kisstroke file.
+ */
+class KRITAUI_EXPORT KisFreehandStrokeRecording
+{
+public:
+    enum SegmentType {
+        PaintPoint = 0,
+        PaintLine,
+        PaintBezierCurve
+    };
+
+    struct Segment {
+        SegmentType type = PaintPoint;
+        int strokeInfoId = 0;
+
+        /// the time (in ms) since the beginning of the stroke when
+        /// the job has been added
+        int timestamp = 0;
+
+        KisPaintInformation pi1;
+        KisPaintInformation pi2;
+        QPointF control1;
+        QPointF control2;
+    };
+
+public:
+    KisFreehandStrokeRecording();
+    ~KisFreehandStrokeRecording();
+
+    /**
+     * Resets the recording and starts measuring the time of a new stroke
+     */
+    void startStroke(qreal startAngle,
+                     const KisPaintInformation &startInfo,
+                     int numStrokeInfos,
+                     int canvasRotation,
+                     bool canvasMirroredH);
+
+    void addPoint(int strokeInfoId, const KisPaintInformation &pi);
+    void addLine(int strokeInfoId,
+                 const KisPaintInformation &pi1,
+                 const KisPaintInformation &pi2);
+    void addBezierCurve(int strokeInfoId,
+                        const KisPaintInformation &pi1,
+                        const QPointF &control1,
+                        const QPointF &control2,
+                        const KisPaintInformation &pi2);
+
+    /**
+     * Adds a segment with explicitly defined timestamp, used for
+     * generating synthetic recordings
+     */
+    void addSegment(const Segment &segment);
+
+    qreal startAngle() const;
+    KisPaintInformation startInfo() const;
+    int numStrokeInfos() const;
+    int canvasRotation() const;
+    bool canvasMirroredH() const;
+
+    const QVector<Segment>& segments() const;
+
+    /**
+     * @return the bounding rect of all the recorded positions
+     * (control points included)
+     */
+    QRectF boundingRect() const;
+
+    bool save(QIODevice *device) const;
+    bool load(QIODevice *device);
+
+    bool save(const QString &fileName) const;
+    bool load(const QString &fileName);
+
+    /**
+     * @return the directory where the freehand tool should save its
+     * recordings or an empty string if the recording is disabled
+     */
+    static QString recordingDirectory();
+
+    /**
+     * @return a new unique file name inside recordingDirectory()
+     */
+    static QString generateRecordingFileName();
+
+private:
+    qreal m_startAngle = 0.0;
+    KisPaintInformation m_startInfo;
+    int m_numStrokeInfos = 1;
+    int m_canvasRotation = 0;
+    bool m_canvasMirroredH = false;
+
+    QVector<Segment> m_segments;
+    QElapsedTimer m_strokeTime;
+};
+
+#endif // KISFREEHANDSTROKERECORDING_H
@@ -44,6 +44,7 @@
 
 #include "strokes/freehand_stroke.h"
 #include "strokes/KisFreehandStrokeInfo.h"
+#include "KisFreehandStrokeRecording.h"
 
 #include <math.h>
 
@@ -114,6 +115,9 @@ struct KisToolFreehandHelper::Private
     int canvasRotation;
     bool canvasMirroredH;
 
+    // is non-null only when the stroke recording is requested
+    QScopedPointer<KisFreehandStrokeRecording> recording;
+
     qreal effectiveSmoothnessDistance() const;
 };
 
@@ -307,6 +311,12 @@ void KisToolFreehandHelper::initPaintImpl(qreal startAngle,
     createPainters(m_d->strokeInfos,
                    startDist);
 
+    if (!KisFreehandStrokeRecording::recordingDirectory().isEmpty()) {
+        m_d->recording.reset(new KisFreehandStrokeRecording());
+        m_d->recording->startStroke(startAngle, pi, m_d->strokeInfos.size(),
+                                    m_d->canvasRotation, m_d->canvasMirroredH);
+    }
+
     KisStrokeStrategy *stroke =
         new FreehandStrokeStrategy(m_d->resources, m_d->strokeInfos, m_d->transactionText);
 
@@ -645,6 +655,11 @@ void KisToolFreehandHelper::endPaint()
 
     m_d->strokesFacade->endStroke(m_d->strokeId);
     m_d->strokeId.clear();
+
+    if (m_d->recording) {
+        m_d->recording->save(KisFreehandStrokeRecording::generateRecordingFileName());
+        m_d->recording.reset();
+    }
 }
 
 void KisToolFreehandHelper::cancelPaint()
@@ -675,6 +690,8 @@ void KisToolFreehandHelper::cancelPaint()
     m_d->strokesFacade->cancelStroke(m_d->strokeId);
     m_d->strokeId.clear();
 
+    m_d->recording.reset();
+
 }
 
 int KisToolFreehandHelper::elapsedStrokeTime() const
@@ -905,6 +922,10 @@ int KisToolFreehandHelper::computeAirbrushTimerInterval() const
 void KisToolFreehandHelper::paintAt(int strokeInfoId,
                                     const KisPaintInformation &pi)
 {
+    if (m_d->recording) {
+        m_d->recording->addPoint(strokeInfoId, pi);
+    }
+
     m_d->hasPaintAtLeastOnce = true;
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId, pi));
@@ -915,6 +936,10 @@ void KisToolFreehandHelper::paintLine(int strokeInfoId,
                                       const KisPaintInformation &pi1,
                                       const KisPaintInformation &pi2)
 {
+    if (m_d->recording) {
+        m_d->recording->addLine(strokeInfoId, pi1, pi2);
+    }
+
     m_d->hasPaintAtLeastOnce = true;
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId, pi1, pi2));
@@ -951,6 +976,10 @@ void KisToolFreehandHelper::paintBezierCurve(int strokeInfoId,
     paintLine(tpi1, tpi2);
 #endif
 
+    if (m_d->recording) {
+        m_d->recording->addBezierCurve(strokeInfoId, pi1, control1, control2, pi2);
+    }
+
     m_d->hasPaintAtLeastOnce = true;
     m_d->strokesFacade->addJob(m_d->strokeId,
                                new FreehandStrokeStrategy::Data(strokeInfoId,
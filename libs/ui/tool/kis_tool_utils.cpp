@@ -19,10 +19,13 @@
 
 #include <kis_tool_utils.h>
 
+#include <QScopedPointer>
+#include <QtMath>
+
 #include <KoMixColorsOp.h>
 #include <kis_group_layer.h>
+#include <kis_paint_device.h>
 #include <kis_transaction.h>
-#include <kis_sequential_iterator.h>
 #include <kis_properties_configuration.h>
 #include <kconfiggroup.h>
 #include <ksharedconfig.h>
@@ -47,25 +50,36 @@ namespace KisToolUtils {
 
         // Sampling radius.
         if (!pure && radius > 1) {
-            QVector<const quint8*> pixels;
             const int effectiveRadius = radius - 1;
 
             const QRect pickRect(pos.x() - effectiveRadius, pos.y() - effectiveRadius,
                                  2 * effectiveRadius + 1, 2 * effectiveRadius + 1);
-            KisSequentialConstIterator it(dev, pickRect);
+
+            const int pixelSize = cs->pixelSize();
+            QVector<quint8> pickData(pickRect.width() * pickRect.height() * pixelSize);
+            dev->readBytes(pickData.data(), pickRect);
 
             const int radiusSq = pow2(effectiveRadius);
 
-            while (it.nextPixel()) {
-                const QPoint realPos(it.x(),  it.y());
-                const QPoint pt = realPos - pos;
-                if (pow2(pt.x()) + pow2(pt.y()) < radiusSq) {
-                    pixels << it.oldRawData();
+            QScopedPointer<KoMixColorsOp::Mixer> mixer(cs->mixColorsOp()->createMixer());
+
+            for (int y = -effectiveRadius; y <= effectiveRadius; y++) {
+                const int rowRadiusSq = radiusSq - pow2(y);
+                if (rowRadiusSq <= 0) continue;
+
+                // the pixels with pow2(x) + pow2(y) < radiusSq form a continuous span of the row
+                int halfSpan = qFloor(std::sqrt(qreal(rowRadiusSq)));
+                while (pow2(halfSpan) >= rowRadiusSq) {
+                    halfSpan--;
                 }
+
+                const int offset =
+                    (y + effectiveRadius) * pickRect.width() + effectiveRadius - halfSpan;
+
+                mixer->accumulateAverage(pickData.constData() + offset * pixelSize, 2 * halfSpan + 1);
             }
 
-            const quint8 **cpixels = const_cast<const quint8**>(pixels.constData());
-            cs->mixColorsOp()->mixColors(cpixels, pixels.size(), pickedColor.data());
+            mixer->computeMixedColor(pickedColor.data());
         } else {
             dev->pixel(pos.x(), pos.y(), &pickedColor);
         }
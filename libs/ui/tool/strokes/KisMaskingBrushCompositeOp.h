@@ -19,6 +19,8 @@
 #ifndef KISMASKINGBRUSHCOMPOSITEOP_H
 #define KISMASKINGBRUSHCOMPOSITEOP_H
 
+#include <cstring>
+
 #include <KoColorSpaceTraits.h>
 #include <KoGrayColorSpaceTraits.h>
 #include <KoColorSpaceMaths.h>
@@ -36,32 +38,41 @@ public:
     }
 
     void composite(const quint8 *srcRowStart, int srcRowStride,
+                   const quint8 *maskRowStart, int maskRowStride,
                    quint8 *dstRowStart, int dstRowStride,
                    int columns, int rows) override {
 
         using MaskPixel = KoGrayU8Traits::Pixel;
 
-        dstRowStart += m_dstAlphaOffset;
+        const int rowBytes = columns * m_dstPixelSize;
 
         for (int y = 0; y < rows; y++) {
-            const quint8 *srcPtr = srcRowStart;
-            quint8 *dstPtr = dstRowStart;
+            /**
+             * The row is copied first and then its alpha channel is
+             * modified while the row is still hot in the cache, so we
+             * don't need a separate copying pass over the whole rect
+             */
+            memcpy(dstRowStart, srcRowStart, rowBytes);
+
+            const quint8 *maskPtr = maskRowStart;
+            quint8 *dstPtr = dstRowStart + m_dstAlphaOffset;
 
             for (int x = 0; x < columns; x++) {
 
-                const MaskPixel *srcDataPtr = reinterpret_cast<const MaskPixel*>(srcPtr);
+                const MaskPixel *maskDataPtr = reinterpret_cast<const MaskPixel*>(maskPtr);
 
-                const quint8 mask = KoColorSpaceMaths<quint8>::multiply(srcDataPtr->gray, srcDataPtr->alpha);
+                const quint8 mask = KoColorSpaceMaths<quint8>::multiply(maskDataPtr->gray, maskDataPtr->alpha);
                 const channels_type maskScaled = KoColorSpaceMaths<quint8, channels_type>::scaleToA(mask);
 
                 channels_type *dstDataPtr = reinterpret_cast<channels_type*>(dstPtr);
                 *dstDataPtr = compositeFunc(maskScaled, *dstDataPtr);
 
-                srcPtr += sizeof(MaskPixel);
+                maskPtr += sizeof(MaskPixel);
                 dstPtr += m_dstPixelSize;
             }
 
             srcRowStart += srcRowStride;
+            maskRowStart += maskRowStride;
             dstRowStart += dstRowStride;
         }
     }
@@ -26,7 +26,15 @@ class KisMaskingBrushCompositeOpBase
 {
 public:
     virtual ~KisMaskingBrushCompositeOpBase() {}
+
+    /**
+     * Copies the pixels of the stroke (\p srcRowStart) into the destination
+     * and composites the masking brush (\p maskRowStart) into the alpha
+     * channel of the copied pixels in the same pass. The mask is expected
+     * to be in GrayA-8 color space.
+     */
     virtual void composite(const quint8 *srcRowStart, int srcRowStride,
+                           const quint8 *maskRowStart, int maskRowStride,
                            quint8 *dstRowStart, int dstRowStride,
                            int columns, int rows) = 0;
 };
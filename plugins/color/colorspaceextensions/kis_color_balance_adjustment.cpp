@@ -53,14 +53,18 @@ void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const overrid
     KisColorBalanceMath bal;
     const RGBPixel* src = reinterpret_cast<const RGBPixel*>(srcU8);
     RGBPixel* dst = reinterpret_cast<RGBPixel*>(dstU8);
-    float value_red, value_green, value_blue, hue, saturation, lightness;
+    float value_red, value_green, value_blue;
 
     while(nPixels > 0) {
 
         float red = SCALE_TO_FLOAT(src->red);
         float green = SCALE_TO_FLOAT(src->green);
         float blue = SCALE_TO_FLOAT(src->blue);
-        RGBToHSL(red, green, blue, &hue, &saturation, &lightness);
+
+        // only lightness is needed, see the comment in transformPlanar()
+        const float maxValue = qMax(qMax(red, green), blue);
+        const float minValue = qMin(qMin(red, green), blue);
+        const float lightness = (minValue + maxValue) / 2.0;
 
         value_red = bal.colorBalanceTransform(red, lightness, m_cyan_shadows, m_cyan_midtones, m_cyan_highlights);
         value_green = bal.colorBalanceTransform(green, lightness, m_magenta_shadows, m_magenta_midtones, m_magenta_highlights);
@@ -68,10 +72,9 @@ void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const overrid
 
         if(m_preserve_luminosity)
         {
-            float h1, s1, l1, h2, s2, l2;
-            RGBToHSL(SCALE_TO_FLOAT(src->red), SCALE_TO_FLOAT(src->green), SCALE_TO_FLOAT(src->blue), &h1, &s1, &l1);
+            float h2, s2, l2;
             RGBToHSL(value_red, value_green, value_blue, &h2, &s2, &l2);
-            HSLToRGB(h2, s2, l1, &value_red, &value_green, &value_blue);
+            HSLToRGB(h2, s2, lightness, &value_red, &value_green, &value_blue);
         }
         dst->red = SCALE_FROM_FLOAT(value_red);
         dst->green = SCALE_FROM_FLOAT(value_green);
@@ -84,6 +87,47 @@ void transform(const quint8 *srcU8, quint8 *dstU8, qint32 nPixels) const overrid
     }
 }
 
+bool supportsPlanarTransform() const override
+{
+    return true;
+}
+
+void transformPlanar(float * const *planes, qint32 nPixels) const override
+{
+    KisColorBalanceMath bal;
+
+    float *red = planes[RGBTrait::red_pos];
+    float *green = planes[RGBTrait::green_pos];
+    float *blue = planes[RGBTrait::blue_pos];
+
+    for (qint32 i = 0; i < nPixels; i++) {
+        /**
+         * Only lightness of the HSL representation is used by the
+         * balancing itself, so there is no need to compute the full
+         * RGBToHSL() conversion. The expression is the same as in
+         * RGBToHSL(), so the result is exactly the same.
+         */
+        const float maxValue = qMax(qMax(red[i], green[i]), blue[i]);
+        const float minValue = qMin(qMin(red[i], green[i]), blue[i]);
+        const float lightness = (minValue + maxValue) / 2.0;
+
+        float value_red = bal.colorBalanceTransform(red[i], lightness, m_cyan_shadows, m_cyan_midtones, m_cyan_highlights);
+        float value_green = bal.colorBalanceTransform(green[i], lightness, m_magenta_shadows, m_magenta_midtones, m_magenta_highlights);
+        float value_blue = bal.colorBalanceTransform(blue[i], lightness, m_yellow_shadows, m_yellow_midtones, m_yellow_highlights);
+
+        if(m_preserve_luminosity)
+        {
+            float h2, s2, l2;
+            RGBToHSL(value_red, value_green, value_blue, &h2, &s2, &l2);
+            HSLToRGB(h2, s2, lightness, &value_red, &value_green, &value_blue);
+        }
+
+        red[i] = value_red;
+        green[i] = value_green;
+        blue[i] = value_blue;
+    }
+}
+
 
 QList<QString> parameters() const override
 {
@@ -107,147 +107,39 @@ public:
          * */
             const RGBPixel* src = reinterpret_cast<const RGBPixel*>(srcU8);
             RGBPixel* dst = reinterpret_cast<RGBPixel*>(dstU8);
-            float h, s, v;
             float r = 0.0;
             float g = 0.0;
             float b = 0.0;
             qreal lumaR, lumaG, lumaB;
-            //Default to rec 709 when there's no coefficients given//
-            if (m_lumaRed<=0 || m_lumaGreen<=0 || m_lumaBlue<=0) {
-                lumaR   = 0.2126;
-                lumaG   = 0.7152;
-                lumaB   = 0.0722;
-            } else {
-                lumaR   = m_lumaRed;
-                lumaG   = m_lumaGreen;
-                lumaB   = m_lumaBlue;
-            }
-            while (nPixels > 0) {
-
-                if (m_colorize) {
-                    h = m_adj_h * 360;
-                    if (h >= 360.0) h = 0;
-
-                    s = m_adj_s;
-
-                    r = SCALE_TO_FLOAT(src->red);
-                    g = SCALE_TO_FLOAT(src->green);
-                    b = SCALE_TO_FLOAT(src->blue);
-
-                    float luminance = r * lumaR + g * lumaG + b * lumaB;
-
-                    if (m_adj_v > 0) {
-                        luminance *= (1.0 - m_adj_v);
-                        luminance += 1.0 - (1.0 - m_adj_v);
-                    }
-                    else if (m_adj_v < 0 ){
-                        luminance *= (m_adj_v + 1.0);
-                    }
-                    v = luminance;
-                    HSLToRGB(h, s, v, &r, &g, &b);
-
-                } else {
-
-                    if (m_type == 0) {
-                        RGBToHSV(SCALE_TO_FLOAT(src->red), SCALE_TO_FLOAT(src->green), SCALE_TO_FLOAT(src->blue), &h, &s, &v);
-                        h += m_adj_h * 180;
-                        if (h > 360) h -= 360;
-                        if (h < 0) h += 360;
-                        s += m_adj_s;
-                        v += m_adj_v;
-                        HSVToRGB(h, s, v, &r, &g, &b);
-                    } else if (m_type == 1) {
-
-                        RGBToHSL(SCALE_TO_FLOAT(src->red), SCALE_TO_FLOAT(src->green), SCALE_TO_FLOAT(src->blue), &h, &s, &v);
-
-                        h += m_adj_h * 180;
-                        if (h > 360) h -= 360;
-                        if (h < 0) h += 360;
-
-                        s *= (m_adj_s + 1.0);
-                        if (s < 0.0) s = 0.0;
-                        if (s > 1.0) s = 1.0;
-
-                        if (m_adj_v < 0)
-                            v *= (m_adj_v + 1.0);
-                        else
-                            v += (m_adj_v * (1.0 - v));
-
-
-                        HSLToRGB(h, s, v, &r, &g, &b);
-                    } else if (m_type == 2) {
-
-                        qreal red = SCALE_TO_FLOAT(src->red);
-                        qreal green = SCALE_TO_FLOAT(src->green);
-                        qreal blue = SCALE_TO_FLOAT(src->blue);
-                        qreal hue, sat, intensity;
-                        RGBToHCI(red, green, blue, &hue, &sat, &intensity);
-
-                        hue *=360.0;
-                        hue += m_adj_h * 180;
-                        //if (intensity+m_adj_v>1.0){hue+=180.0;}
-                        if (hue < 0) hue += 360;
-                        hue = fmod(hue, 360.0);
-
-                        sat *= (m_adj_s + 1.0);
-                        //sat = qBound(0.0, sat, 1.0);
-
-                        intensity += (m_adj_v);
-
-                        HCIToRGB(hue/360.0, sat, intensity, &red, &green, &blue);
-
-                        r = red;
-                        g = green;
-                        b = blue;
-                    } else if (m_type == 3) {
-
-                        qreal red = SCALE_TO_FLOAT(src->red);
-                        qreal green = SCALE_TO_FLOAT(src->green);
-                        qreal blue = SCALE_TO_FLOAT(src->blue);
-                        qreal hue, sat, luma;
-                        RGBToHCY(red, green, blue, &hue, &sat, &luma, lumaR, lumaG, lumaB);
-
-                        hue *=360.0;
-                        hue += m_adj_h * 180;
-                        //if (luma+m_adj_v>1.0){hue+=180.0;}
-                        if (hue < 0) hue += 360;
-                        hue = fmod(hue, 360.0);
-
-                        sat *= (m_adj_s + 1.0);
-                        //sat = qBound(0.0, sat, 1.0);
-
-                        luma += m_adj_v;
-
-
-                        HCYToRGB(hue/360.0, sat, luma, &red, &green, &blue, lumaR, lumaG, lumaB);
-                        r = red;
-                        g = green;
-                        b = blue;
-
-                    } else if (m_type == 4) {
-
-                        qreal red = SCALE_TO_FLOAT(src->red);
-                        qreal green = SCALE_TO_FLOAT(src->green);
-                        qreal blue = SCALE_TO_FLOAT(src->blue);
-                        qreal y, cb, cr;
-                        RGBToYUV(red, green, blue, &y, &cb, &cr, lumaR, lumaG, lumaB);
-
-                        cb *= (m_adj_h + 1.0);
-                        //cb = qBound(0.0, cb, 1.0);
-
-                        cr *= (m_adj_s + 1.0);
-                        //cr = qBound(0.0, cr, 1.0);
-
-                        y += (m_adj_v);
+            lumaCoefficients(&lumaR, &lumaG, &lumaB);
 
+            while (nPixels > 0) {
 
-                        YUVToRGB(y, cb, cr, &red, &green, &blue, lumaR, lumaG, lumaB);
-                        r = red;
-                        g = green;
-                        b = blue;
-                    } else {
-                        Q_ASSERT_X(false, "", "invalid type");
-                    }
+                r = SCALE_TO_FLOAT(src->red);
+                g = SCALE_TO_FLOAT(src->green);
+                b = SCALE_TO_FLOAT(src->blue);
+
+                switch (mode()) {
+                case ModeColorize:
+                    adjustPixel<ModeColorize>(&r, &g, &b, lumaR, lumaG, lumaB);
+                    break;
+                case ModeHSV:
+                    adjustPixel<ModeHSV>(&r, &g, &b, lumaR, lumaG, lumaB);
+                    break;
+                case ModeHSL:
+                    adjustPixel<ModeHSL>(&r, &g, &b, lumaR, lumaG, lumaB);
+                    break;
+                case ModeHSI:
+                    adjustPixel<ModeHSI>(&r, &g, &b, lumaR, lumaG, lumaB);
+                    break;
+                case ModeHSY:
+                    adjustPixel<ModeHSY>(&r, &g, &b, lumaR, lumaG, lumaB);
+                    break;
+                case ModeYUV:
+                    adjustPixel<ModeYUV>(&r, &g, &b, lumaR, lumaG, lumaB);
+                    break;
+                default:
+                    Q_ASSERT_X(false, "", "invalid type");
                 }
 
                 clamp< _channel_type_ >(&r, &g, &b);
@@ -305,6 +197,49 @@ public:
         }*/
     }
 
+    bool supportsPlanarTransform() const override
+    {
+        return true;
+    }
+
+    void transformPlanar(float * const *planes, qint32 nPixels) const override
+    {
+        /**
+         * The values in the planes are produced by the same
+         * SCALE_TO_FLOAT conversion transform() uses, and clamping
+         * is done by the caller on interleaving, so the result is
+         * the same as the one of transform(). The alpha plane is
+         * left untouched.
+         */
+
+        float *r = planes[RGBTrait::red_pos];
+        float *g = planes[RGBTrait::green_pos];
+        float *b = planes[RGBTrait::blue_pos];
+
+        switch (mode()) {
+        case ModeColorize:
+            transformPlanarImpl<ModeColorize>(r, g, b, nPixels);
+            break;
+        case ModeHSV:
+            transformPlanarImpl<ModeHSV>(r, g, b, nPixels);
+            break;
+        case ModeHSL:
+            transformPlanarImpl<ModeHSL>(r, g, b, nPixels);
+            break;
+        case ModeHSI:
+            transformPlanarImpl<ModeHSI>(r, g, b, nPixels);
+            break;
+        case ModeHSY:
+            transformPlanarImpl<ModeHSY>(r, g, b, nPixels);
+            break;
+        case ModeYUV:
+            transformPlanarImpl<ModeYUV>(r, g, b, nPixels);
+            break;
+        default:
+            Q_ASSERT_X(false, "", "invalid type");
+        }
+    }
+
     QList<QString> parameters() const override
     {
       QList<QString> list;
@@ -379,6 +314,172 @@ public:
 
 private:
 
+    enum Mode {
+        ModeHSV = 0,
+        ModeHSL,
+        ModeHSI,
+        ModeHSY,
+        ModeYUV,
+        ModeColorize
+    };
+
+    int mode() const {
+        return m_colorize ? int(ModeColorize) : m_type;
+    }
+
+    void lumaCoefficients(qreal *lumaR, qreal *lumaG, qreal *lumaB) const
+    {
+        //Default to rec 709 when there's no coefficients given//
+        if (m_lumaRed<=0 || m_lumaGreen<=0 || m_lumaBlue<=0) {
+            *lumaR   = 0.2126;
+            *lumaG   = 0.7152;
+            *lumaB   = 0.0722;
+        } else {
+            *lumaR   = m_lumaRed;
+            *lumaG   = m_lumaGreen;
+            *lumaB   = m_lumaBlue;
+        }
+    }
+
+    /**
+     * The mode is a template parameter, so the loops of the planar
+     * path have no per-pixel branching on the adjustment type.
+     */
+    template <int mode>
+    void transformPlanarImpl(float *r, float *g, float *b, qint32 nPixels) const
+    {
+        qreal lumaR, lumaG, lumaB;
+        lumaCoefficients(&lumaR, &lumaG, &lumaB);
+
+        for (qint32 i = 0; i < nPixels; i++) {
+            adjustPixel<mode>(&r[i], &g[i], &b[i], lumaR, lumaG, lumaB);
+        }
+    }
+
+    template <int mode>
+    inline void adjustPixel(float *r, float *g, float *b,
+                            qreal lumaR, qreal lumaG, qreal lumaB) const
+    {
+        float h, s, v;
+
+        if (mode == ModeColorize) {
+            h = m_adj_h * 360;
+            if (h >= 360.0) h = 0;
+
+            s = m_adj_s;
+
+            float luminance = *r * lumaR + *g * lumaG + *b * lumaB;
+
+            if (m_adj_v > 0) {
+                luminance *= (1.0 - m_adj_v);
+                luminance += 1.0 - (1.0 - m_adj_v);
+            }
+            else if (m_adj_v < 0 ){
+                luminance *= (m_adj_v + 1.0);
+            }
+            v = luminance;
+            HSLToRGB(h, s, v, r, g, b);
+
+        } else if (mode == ModeHSV) {
+            RGBToHSV(*r, *g, *b, &h, &s, &v);
+            h += m_adj_h * 180;
+            if (h > 360) h -= 360;
+            if (h < 0) h += 360;
+            s += m_adj_s;
+            v += m_adj_v;
+            HSVToRGB(h, s, v, r, g, b);
+        } else if (mode == ModeHSL) {
+
+            RGBToHSL(*r, *g, *b, &h, &s, &v);
+
+            h += m_adj_h * 180;
+            if (h > 360) h -= 360;
+            if (h < 0) h += 360;
+
+            s *= (m_adj_s + 1.0);
+            if (s < 0.0) s = 0.0;
+            if (s > 1.0) s = 1.0;
+
+            if (m_adj_v < 0)
+                v *= (m_adj_v + 1.0);
+            else
+                v += (m_adj_v * (1.0 - v));
+
+
+            HSLToRGB(h, s, v, r, g, b);
+        } else if (mode == ModeHSI) {
+
+            qreal red = *r;
+            qreal green = *g;
+            qreal blue = *b;
+            qreal hue, sat, intensity;
+            RGBToHCI(red, green, blue, &hue, &sat, &intensity);
+
+            hue *=360.0;
+            hue += m_adj_h * 180;
+            //if (intensity+m_adj_v>1.0){hue+=180.0;}
+            if (hue < 0) hue += 360;
+            hue = fmod(hue, 360.0);
+
+            sat *= (m_adj_s + 1.0);
+            //sat = qBound(0.0, sat, 1.0);
+
+            intensity += (m_adj_v);
+
+            HCIToRGB(hue/360.0, sat, intensity, &red, &green, &blue);
+
+            *r = red;
+            *g = green;
+            *b = blue;
+        } else if (mode == ModeHSY) {
+
+            qreal red = *r;
+            qreal green = *g;
+            qreal blue = *b;
+            qreal hue, sat, luma;
+            RGBToHCY(red, green, blue, &hue, &sat, &luma, lumaR, lumaG, lumaB);
+
+            hue *=360.0;
+            hue += m_adj_h * 180;
+            //if (luma+m_adj_v>1.0){hue+=180.0;}
+            if (hue < 0) hue += 360;
+            hue = fmod(hue, 360.0);
+
+            sat *= (m_adj_s + 1.0);
+            //sat = qBound(0.0, sat, 1.0);
+
+            luma += m_adj_v;
+
+
+            HCYToRGB(hue/360.0, sat, luma, &red, &green, &blue, lumaR, lumaG, lumaB);
+            *r = red;
+            *g = green;
+            *b = blue;
+
+        } else if (mode == ModeYUV) {
+
+            qreal red = *r;
+            qreal green = *g;
+            qreal blue = *b;
+            qreal y, cb, cr;
+            RGBToYUV(red, green, blue, &y, &cb, &cr, lumaR, lumaG, lumaB);
+
+            cb *= (m_adj_h + 1.0);
+            //cb = qBound(0.0, cb, 1.0);
+
+            cr *= (m_adj_s + 1.0);
+            //cr = qBound(0.0, cr, 1.0);
+
+            y += (m_adj_v);
+
+
+            YUVToRGB(y, cb, cr, &red, &green, &blue, lumaR, lumaG, lumaB);
+            *r = red;
+            *g = green;
+            *b = blue;
+        }
+    }
+
     double m_adj_h, m_adj_s, m_adj_v;
     qreal m_lumaRed, m_lumaGreen, m_lumaBlue;
     int m_type;
@@ -489,16 +590,27 @@ public:
         float &b = component[KisHSVCurve::Blue];
         float &a = component[KisHSVCurve::Alpha];
 
+        /**
+         * When the curve neither reads nor writes any of the HSV
+         * components, the conversion to HSV and back is not needed
+         */
+        const bool needsHSV =
+            m_channel >= KisHSVCurve::Hue || driverChannel >= KisHSVCurve::Hue;
+
+        h = s = v = 0.0f;
+
         while (nPixels > 0) {
             r = SCALE_TO_FLOAT(src->red);
             g = SCALE_TO_FLOAT(src->green);
             b = SCALE_TO_FLOAT(src->blue);
             a = SCALE_TO_FLOAT(src->alpha);
 
-            RGBToHSV(r, g, b, &h, &s, &v);
+            if (needsHSV) {
+                RGBToHSV(r, g, b, &h, &s, &v);
 
-            // Normalize hue to 0.0 to 1.0 range
-            h /= 360.0f;
+                // Normalize hue to 0.0 to 1.0 range
+                h /= 360.0f;
+            }
 
             float adjustment = lookupComponent(component[driverChannel], max) * SCALE_FROM_16BIT;
 
@@ -521,11 +633,11 @@ public:
                 }
             }
 
-            h *= 360.0f;
-            if (h > 360) h -= 360;
-            if (h < 0) h += 360;
-
             if (m_channel >= KisHSVCurve::Hue) {
+                h *= 360.0f;
+                if (h > 360) h -= 360;
+                if (h < 0) h += 360;
+
                 HSVToRGB(h, s, v, &r, &g, &b);
             }
 
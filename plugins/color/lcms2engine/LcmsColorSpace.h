@@ -24,6 +24,7 @@
 
 #include <colorprofiles/LcmsColorProfileContainer.h>
 #include <KoColorSpaceAbstract.h>
+#include <KoPerChannelLutTransformation.h>
 #include <QMutex>
 #include <QMutexLocker>
 
@@ -328,6 +329,17 @@ public:
             return 0;
         }
 
+        /**
+         * For RGB and grayscale the curves are applied to the channel
+         * values directly, so we can skip lcms and use the lookup tables
+         * specialized for the channel type of the color space
+         */
+        if (this->colorSpaceSignature() == cmsSigRgbData ||
+            this->colorSpaceSignature() == cmsSigGrayData) {
+
+            return new KoPerChannelLutTransformation<_CSTraits>(this, transferValues);
+        }
+
         cmsToneCurve **transferFunctions = new cmsToneCurve*[ this->colorChannelCount()];
 
         for (uint ch = 0; ch < this->colorChannelCount(); ch++) {
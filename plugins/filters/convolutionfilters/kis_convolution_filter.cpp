@@ -36,6 +36,7 @@ KisConvolutionFilter::KisConvolutionFilter(const KoID& id, const KoID & category
         : KisFilter(id, category, entry)
 {
     setColorSpaceIndependence(FULLY_INDEPENDENT);
+    setSupportsLevelOfDetailApproximation(QStringList());
 }
 
 
@@ -58,6 +58,7 @@ KisEmbossFilter::KisEmbossFilter() : KisFilter(id(), FiltersCategoryEmbossId, i1
     setColorSpaceIndependence(TO_RGBA8);
     setSupportsThreading(false);
     setSupportsAdjustmentLayers(false);
+    setSupportsLevelOfDetailApproximation(QStringList());
 }
 
 KisFilterConfigurationSP KisEmbossFilter::factoryConfiguration() const
@@ -37,6 +37,7 @@
 #include <kis_types.h>
 #include "kis_simple_noise_reducer.h"
 #include "kis_wavelet_noise_reduction.h"
+#include "kis_median_filter.h"
 
 K_PLUGIN_FACTORY_WITH_JSON(KritaImageEnhancementFactory, "kritaimageenhancement.json", registerPlugin<KritaImageEnhancement>();)
 
@@ -45,6 +46,7 @@ KritaImageEnhancement::KritaImageEnhancement(QObject *parent, const QVariantList
 {
     KisFilterRegistry::instance()->add(new KisSimpleNoiseReducer());
     KisFilterRegistry::instance()->add(new KisWaveletNoiseReduction());
+    KisFilterRegistry::instance()->add(new KisMedianFilter());
 }
 
 KritaImageEnhancement::~KritaImageEnhancement()
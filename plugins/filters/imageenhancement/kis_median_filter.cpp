@@ -0,0 +1,95 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "kis_median_filter.h"
+
+#include <KoColorSpace.h>
+
+#include <widgets/kis_multi_integer_filter_widget.h>
+#include <filter/kis_filter_category_ids.h>
+#include <filter/kis_filter_configuration.h>
+#include <kis_lod_transform.h>
+#include <kis_paint_device.h>
+#include <kis_assert.h>
+#include <KisRankFilter.h>
+
+
+KisMedianFilter::KisMedianFilter()
+    : KisFilter(id(), FiltersCategoryEnhanceId, i18n("&Median..."))
+{
+    setSupportsPainting(true);
+    setSupportsAdjustmentLayers(true);
+    setSupportsLevelOfDetail(true);
+}
+
+KisMedianFilter::~KisMedianFilter()
+{
+}
+
+KisConfigWidget * KisMedianFilter::createConfigurationWidget(QWidget* parent, const KisPaintDeviceSP dev) const
+{
+    Q_UNUSED(dev);
+    vKisIntegerWidgetParam param;
+    param.push_back(KisIntegerWidgetParam(1, 100, 2, i18n("Radius"), "radius"));
+    param.push_back(KisIntegerWidgetParam(0, 100, 50, i18n("Percentile"), "percentile"));
+    return new KisMultiIntegerFilterWidget(id().id(), parent, id().id(), param);
+}
+
+KisFilterConfigurationSP KisMedianFilter::factoryConfiguration() const
+{
+    KisFilterConfigurationSP config = new KisFilterConfiguration(id().id(), 0);
+    config->setProperty("radius", 2);
+    config->setProperty("percentile", 50);
+    return config;
+}
+
+QRect KisMedianFilter::neededRect(const QRect & rect, const KisFilterConfigurationSP _config, int lod) const
+{
+    KisLodTransformScalar t(lod);
+    const int radius = qMax(1, qRound(t.scale(_config->getInt("radius", 2))));
+    return rect.adjusted(-radius, -radius, radius, radius);
+}
+
+QRect KisMedianFilter::changedRect(const QRect & rect, const KisFilterConfigurationSP _config, int lod) const
+{
+    return neededRect(rect, _config, lod);
+}
+
+void KisMedianFilter::processImpl(KisPaintDeviceSP device,
+                                  const QRect& applyRect,
+                                  const KisFilterConfigurationSP _config,
+                                  KoUpdater* progressUpdater
+                                  ) const
+{
+    Q_ASSERT(device);
+
+    KisFilterConfigurationSP config = _config ? _config : defaultConfiguration();
+
+    KisLodTransformScalar t(device);
+    const int radius = qMax(1, qRound(t.scale(config->getInt("radius", 2))));
+    const qreal percentile = config->getInt("percentile", 50);
+
+    /**
+     * The engine ranks floating point channels by their bit patterns,
+     * so HDR values are filtered exactly, without any conversion
+     */
+    KIS_SAFE_ASSERT_RECOVER_RETURN(KisRankFilter::supportsColorSpace(device->colorSpace()));
+
+    KisRankFilter::apply(device, device, applyRect, radius, percentile,
+                         config->channelFlags(), progressUpdater);
+}
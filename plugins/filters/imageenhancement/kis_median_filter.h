@@ -0,0 +1,54 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef KIS_MEDIAN_FILTER_H
+#define KIS_MEDIAN_FILTER_H
+
+#include <filter/kis_filter.h>
+
+/**
+ * Exposes KisRankFilter: replaces every pixel with the given percentile
+ * (the median by default) of its square neighbourhood.
+ */
+class KisMedianFilter : public KisFilter
+{
+public:
+    KisMedianFilter();
+    ~KisMedianFilter() override;
+
+public:
+
+    void processImpl(KisPaintDeviceSP device,
+                     const QRect& applyRect,
+                     const KisFilterConfigurationSP config,
+                     KoUpdater* progressUpdater
+                     ) const override;
+    KisConfigWidget * createConfigurationWidget(QWidget* parent, const KisPaintDeviceSP dev) const override;
+
+    QRect neededRect(const QRect & rect, const KisFilterConfigurationSP config, int lod) const override;
+    QRect changedRect(const QRect & rect, const KisFilterConfigurationSP config, int lod) const override;
+
+    static inline KoID id() {
+        return KoID("median", i18n("Median"));
+    }
+
+protected:
+    KisFilterConfigurationSP factoryConfiguration() const override;
+};
+
+#endif
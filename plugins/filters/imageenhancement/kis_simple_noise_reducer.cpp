@@ -42,6 +42,7 @@ KisSimpleNoiseReducer::KisSimpleNoiseReducer()
     : KisFilter(id(), FiltersCategoryEnhanceId, i18n("&Gaussian Noise Reduction..."))
 {
     setSupportsPainting(false);
+    setSupportsLevelOfDetailApproximation(QStringList() << "windowsize");
 }
 
 KisSimpleNoiseReducer::~KisSimpleNoiseReducer()
@@ -93,20 +94,23 @@ void KisSimpleNoiseReducer::processImpl(KisPaintDeviceSP device,
     KisConvolutionKernelSP kernel = KisConvolutionKernel::fromMaskGenerator(kas);
     delete kas;
 
-    KisPaintDeviceSP interm = new KisPaintDevice(*device); // TODO no need for a full copy and then a transaction
+    /**
+     * The blurred reference is written into a separate device, so the
+     * convolution doesn't need a copy of the whole source device and
+     * a transaction, and can process the area in parallel bands
+     */
+    KisPaintDeviceSP interm = new KisPaintDevice(cs);
     KisConvolutionPainter painter(interm);
-    painter.beginTransaction();
-    painter.applyMatrix(kernel, interm, srcTopLeft, srcTopLeft, applyRect.size(), BORDER_REPEAT);
-    painter.deleteTransaction();
+    painter.applyMatrix(kernel, device, srcTopLeft, srcTopLeft, applyRect.size(), BORDER_REPEAT);
 
 
     KisSequentialConstIteratorProgress intermIt(interm, applyRect, progressUpdater);
     KisSequentialIterator dstIt(device, applyRect);
 
     while (dstIt.nextPixel() && intermIt.nextPixel()) {
-        const quint8 diff = cs->difference(dstIt.oldRawData(), intermIt.oldRawData());
+        const quint8 diff = cs->difference(dstIt.oldRawData(), intermIt.rawDataConst());
         if (diff > threshold) {
-            memcpy(dstIt.rawData(), intermIt.oldRawData(), cs->pixelSize());
+            memcpy(dstIt.rawData(), intermIt.rawDataConst(), cs->pixelSize());
         }
     }
 }
@@ -20,8 +20,6 @@
 #include "kis_wavelet_noise_reduction.h"
 
 
-#include <cmath>
-
 #include <KoUpdater.h>
 
 #include <kis_layer.h>
@@ -39,6 +37,7 @@ KisWaveletNoiseReduction::KisWaveletNoiseReduction()
 {
     setSupportsPainting(false);
     setSupportsThreading(false);
+    setSupportsLevelOfDetailApproximation(QStringList());
 }
 
 
@@ -73,53 +72,20 @@ void KisWaveletNoiseReduction::processImpl(KisPaintDeviceSP device,
 
     KisMathToolbox mathToolbox;
 
-    //     dbgFilters << size <<"" << maxrectsize <<"" << srcTopLeft.x() <<"" << srcTopLeft.y();
-
-    //     dbgFilters <<"Transforming...";
-    KisMathToolbox::KisWavelet* buff = 0;
-    KisMathToolbox::KisWavelet* wav = 0;
-
-    try {
-        buff = mathToolbox.initWavelet(device, applyRect);
-    } catch (const std::bad_alloc&) {
-        if (buff) delete buff;
-        return;
-    }
-    try {
-        wav = mathToolbox.fastWaveletTransformation(device, applyRect, buff);
-    } catch (const std::bad_alloc&) {
-        if (wav) delete wav;
-        return;
-    }
-
-    float* const fin = wav->coeffs + wav->depth * pow2(wav->size);
-    float* const begin = wav->coeffs + wav->depth;
-
-    const int size = fin - begin;
-    const int progressOffset = int(std::ceil(std::log2(size / 100)));
-    const int progressMask = (1 << progressOffset) - 1;
-    const int numProgressSteps = size >> progressOffset;
-    int pointsProcessed = 0;
-
-    progressUpdater->setRange(0, numProgressSteps);
-
-    for (float* it = begin; it < fin; it++) {
-        if (*it > threshold) {
-            *it -= threshold;
-        } else if (*it < -threshold) {
-            *it += threshold;
-        } else {
-            *it = 0.;
-        }
-
-        if (!(pointsProcessed & progressMask)) {
-            progressUpdater->setValue(pointsProcessed >> progressOffset);
-        }
-        pointsProcessed++;
-    }
-
-    mathToolbox.fastWaveletUntransformation(device, applyRect, wav, buff);
-
-    delete wav;
-    delete buff;
+    mathToolbox.fastWaveletTiledProcessing(device, applyRect,
+        [threshold] (KisMathToolbox::KisWavelet *wav) {
+            float* const fin = wav->coeffs + wav->depth * pow2(wav->size);
+            float* const begin = wav->coeffs + wav->depth;
+
+            for (float* it = begin; it < fin; it++) {
+                if (*it > threshold) {
+                    *it -= threshold;
+                } else if (*it < -threshold) {
+                    *it += threshold;
+                } else {
+                    *it = 0.;
+                }
+            }
+        },
+        progressUpdater);
 }
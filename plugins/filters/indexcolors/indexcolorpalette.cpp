@@ -68,6 +68,22 @@ LabColor IndexColorPalette::getNearestIndex(LabColor clr) const
     return colors[primaryColor];
 }
 
+int IndexColorPalette::getNearestIndex(LabColor clr, const QVector<int> &candidates) const
+{
+    int primaryColor = -1;
+    float primarySimilarity = 0;
+    Q_FOREACH (int i, candidates)
+    {
+        const float s = similarity(colors[i], clr);
+        if(primaryColor < 0 || s > primarySimilarity)
+        {
+            primaryColor = i;
+            primarySimilarity = s;
+        }
+    }
+    return primaryColor;
+}
+
 QPair<int, int> IndexColorPalette::getNeighbours(int mainClr) const
 {
     QVector<float> diffs;
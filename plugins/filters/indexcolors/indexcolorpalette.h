@@ -58,6 +58,7 @@ struct IndexColorPalette
     void mergeMostReduantColors();
     
     LabColor getNearestIndex(LabColor clr) const;
+    int getNearestIndex(LabColor clr, const QVector<int> &candidates) const;
     int numColors() const;
     float similarity(LabColor c0, LabColor c1) const;
     QPair< int, int > getNeighbours(int mainClr) const;
@@ -102,12 +102,30 @@ KisFilterConfigurationSP KisFilterIndexColors::factoryConfiguration() const
 }
 
 KisIndexColorTransformation::KisIndexColorTransformation(IndexColorPalette palette, const KoColorSpace* cs, int alphaSteps)
-    : m_colorSpace(cs),
-      m_psize(cs->pixelSize())
+    : m_colorSpace(cs)
 {
     m_palette = palette;
 
+    /**
+     * The index measures the same distance what similarity() does, so the
+     * weights are scaled into its units. similarity() is calculated with
+     * float precision, so the index only picks the few colors that may be
+     * the most similar ones and the palette chooses between them exactly
+     * as its linear search would do.
+     */
     static const qreal max = KoColorSpaceMathsTraits<quint16>::max;
+
+    QVector<KisNearestColorIndex::Color> colors;
+    Q_FOREACH (const LabColor &clr, m_palette.colors) {
+        colors.append({{clr.L, clr.a, clr.b}});
+    }
+
+    m_index.reset(new KisNearestColorIndex(colors,
+                                           m_palette.similarityFactors.L / max,
+                                           m_palette.similarityFactors.a / max,
+                                           m_palette.similarityFactors.b / max));
+    m_cache.reset(new KisNearestColorIndex::Cache());
+
     if(alphaSteps > 0)
     {
         m_alphaStep = max / alphaSteps;
@@ -122,24 +140,37 @@ KisIndexColorTransformation::KisIndexColorTransformation(IndexColorPalette palet
 
 void KisIndexColorTransformation::transform(const quint8* src, quint8* dst, qint32 nPixels) const
 {
-    union
-    {
-        quint16 laba[4];
-        LabColor lab;
-    } clr;
-    while (nPixels--)
+    // the whole run is converted to and from L*a*b* at once
+    QVector<quint16> laba(nPixels * 4);
+    m_colorSpace->toLabA16(src, reinterpret_cast<quint8 *>(laba.data()), nPixels);
+
+    // much bigger than the precision of IndexColorPalette::similarity()
+    const qreal similaritySlack = 1e-4;
+    QVector<int> candidates;
+
+    for(quint16 *pixel = laba.data(); pixel != laba.data() + laba.size(); pixel += 4)
     {
-        m_colorSpace->toLabA16(src, reinterpret_cast<quint8 *>(clr.laba), 1);
-        clr.lab = m_palette.getNearestIndex(clr.lab);
+        LabColor *lab = reinterpret_cast<LabColor *>(pixel);
+
+        const KisNearestColorIndex::Color key = {{lab->L, lab->a, lab->b}};
+        int index = -1;
+        if(!m_cache->fetch(key, &index))
+        {
+            m_index->nearestCandidates(key, similaritySlack, &candidates);
+            index = m_palette.getNearestIndex(*lab, candidates);
+            m_cache->store(key, index);
+        }
+        if(index >= 0)
+            *lab = m_palette.colors[index];
+
         if(m_alphaStep)
         {
-            quint16 amod = clr.laba[3] % m_alphaStep;
-            clr.laba[3] = clr.laba[3] + (amod > m_alphaHalfStep ? m_alphaStep - amod : -amod);
+            quint16 amod = pixel[3] % m_alphaStep;
+            pixel[3] = pixel[3] + (amod > m_alphaHalfStep ? m_alphaStep - amod : -amod);
         }
-        m_colorSpace->fromLabA16(reinterpret_cast<quint8 *>(clr.laba), dst, 1);
-        src += m_psize;
-        dst += m_psize;
     }
+
+    m_colorSpace->fromLabA16(reinterpret_cast<const quint8 *>(laba.constData()), dst, nPixels);
 }
 
 #include "indexcolors.moc"
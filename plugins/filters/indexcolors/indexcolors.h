@@ -29,6 +29,10 @@
 #include "kis_config_widget.h"
 #include <KoColor.h>
 
+#include <QScopedPointer>
+
+#include <KisNearestColorIndex.h>
+
 #include "indexcolorpalette.h"
 
 class IndexColors : public QObject
@@ -60,8 +64,9 @@ public:
     void transform(const quint8* src, quint8* dst, qint32 nPixels) const override;
 private:
     const KoColorSpace* m_colorSpace;
-    quint32 m_psize;
     IndexColorPalette m_palette;
+    QScopedPointer<KisNearestColorIndex> m_index;
+    QScopedPointer<KisNearestColorIndex::Cache> m_cache;
     quint16 m_alphaStep;
     quint16 m_alphaHalfStep;
 };
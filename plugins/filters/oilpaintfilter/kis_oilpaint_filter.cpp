@@ -49,6 +49,7 @@
 #include <filter/kis_filter_configuration.h>
 #include <kis_processing_information.h>
 #include <kis_paint_device.h>
+#include <KisSlidingWindowHistogram.h>
 #include "widgets/kis_multi_integer_filter_widget.h"
 
 
@@ -57,6 +58,7 @@ KisOilPaintFilter::KisOilPaintFilter() : KisFilter(id(), FiltersCategoryArtistic
     setSupportsPainting(true);
     setSupportsThreading(false);
     setSupportsAdjustmentLayers(true);
+    setSupportsLevelOfDetailApproximation(QStringList() << "brushSize");
 }
 
 void KisOilPaintFilter::processImpl(KisPaintDeviceSP device,
@@ -86,16 +88,69 @@ void KisOilPaintFilter::processImpl(KisPaintDeviceSP device,
  *
  * Theory           => Using MostFrequentColor function we take the main color in
  *                     a matrix and simply write at the original position.
+ *
+ * The intensity histogram of the matrix is not rebuilt for every pixel,
+ * instead it slides over a band of precalculated intensities and
+ * channel values. Every step adds and removes a column of the matrix,
+ * so the cost per pixel is O(BrushSize) plus a scan of the histogram
+ * bins. The matrix is clipped by the bounds of the applied rect in the
+ * same way as it has always been.
  */
 
 void KisOilPaintFilter::OilPaint(const KisPaintDeviceSP src, KisPaintDeviceSP dst, const QRect &applyRect,
                                  int BrushSize, int Smoothness, KoUpdater* progressUpdater) const
 {
-    KisSequentialConstIteratorProgress it(src, applyRect, progressUpdater);
-    KisSequentialIterator dstIt(dst, applyRect);
+    const KoColorSpace* cs = src->colorSpace();
+    const double Scale = Smoothness / 255.0;
+    const int bandHeight = 64;
+
+    /**
+     * When the filter is applied in-place, the matrix of the
+     * following pixels contains the pixels that have already been
+     * processed, so we should feed them back into the histogram.
+     */
+    const bool isInPlace = src == dst;
+
+    QVector<float> channel(cs->channelCount());
+
+    if (progressUpdater) {
+        progressUpdater->setRange(0, applyRect.height());
+    }
+
+    for (int bandTop = applyRect.top(); bandTop <= applyRect.bottom(); bandTop += bandHeight) {
+        const int bandBottom = qMin(bandTop + bandHeight - 1, applyRect.bottom());
+
+        // the matrix of a pixel spans BrushSize rows above and below it
+        const QRect tileRect(QPoint(applyRect.left(), qMax(bandTop - BrushSize, applyRect.top())),
+                             QPoint(applyRect.right(), qMin(bandBottom + BrushSize, applyRect.bottom())));
+
+        KisSlidingWindowHistogram histogram(tileRect, Smoothness + 1, channel.size());
 
-    while (it.nextPixel() && dstIt.nextPixel()) {
-        MostFrequentColor(src, dstIt.rawData(), applyRect, it.x(), it.y(), BrushSize, Smoothness);
+        KisSequentialConstIterator srcIt(src, tileRect);
+        while (srcIt.nextPixel()) {
+            cs->normalisedChannelsValue(srcIt.rawDataConst(), channel);
+            histogram.setPixel(QPoint(srcIt.x(), srcIt.y()),
+                               int(cs->intensity8(srcIt.rawDataConst()) * Scale),
+                               channel.constData());
+        }
+
+        KisSequentialIterator dstIt(dst, QRect(QPoint(applyRect.left(), bandTop),
+                                               QPoint(applyRect.right(), bandBottom)));
+
+        while (dstIt.nextPixel()) {
+            const QPoint pt(dstIt.x(), dstIt.y());
+
+            MostFrequentColor(cs, histogram, dstIt.rawData(), applyRect, pt.x(), pt.y(), BrushSize, channel);
+
+            if (isInPlace) {
+                cs->normalisedChannelsValue(dstIt.rawData(), channel);
+                histogram.setPixel(pt, int(cs->intensity8(dstIt.rawData()) * Scale), channel.constData());
+            }
+
+            if (progressUpdater && pt.x() == applyRect.right()) {
+                progressUpdater->setValue(pt.y() - applyRect.top() + 1);
+            }
+        }
     }
 }
 
@@ -103,35 +158,19 @@ void KisOilPaintFilter::OilPaint(const KisPaintDeviceSP src, KisPaintDeviceSP ds
 
 /* Function to determine the most frequent color in a matrix
  *
- * Bits             => Bits array
- * Width            => Image width
- * Height           => Image height
+ * cs               => Color space of the device
+ * Histogram        => Intensity histogram of the tile
+ * Dst              => Destination pixel
  * X                => Position horizontal
  * Y                => Position vertical
  * Radius           => Is the radius of the matrix to be analyzed
- * Intensity        => Intensity to calculate
  *
  * Theory           => This function creates a matrix with the analyzed pixel in
  *                     the center of this matrix and find the most frequenty color
  */
 
-void KisOilPaintFilter::MostFrequentColor(KisPaintDeviceSP src, quint8* dst, const QRect& bounds, int X, int Y, int Radius, int Intensity) const
+void KisOilPaintFilter::MostFrequentColor(const KoColorSpace *cs, KisSlidingWindowHistogram &histogram, quint8* dst, const QRect& bounds, int X, int Y, int Radius, QVector<float> &channel) const
 {
-    uint I;
-
-    double Scale = Intensity / 255.0;
-
-    // Alloc some arrays to be used
-    uchar *IntensityCount = new uchar[(Intensity + 1) * sizeof(uchar)];
-
-    const KoColorSpace* cs = src->colorSpace();
-
-    QVector<float> channel(cs->channelCount());
-    QVector<float>* AverageChannels = new QVector<float>[(Intensity + 1)];
-
-    // Erase the array
-    memset(IntensityCount, 0, (Intensity + 1) * sizeof(uchar));
-
     int startx = qMax(X - Radius, bounds.left());
     int starty = qMax(Y - Radius, bounds.top());
     int width = (2 * Radius) + 1;
@@ -140,50 +179,25 @@ void KisOilPaintFilter::MostFrequentColor(KisPaintDeviceSP src, quint8* dst, con
     int height = (2 * Radius) + 1;
     if ((starty + height) > bounds.bottom()) height = bounds.bottom() - starty + 1;
     Q_ASSERT((starty + height - 1) <= bounds.bottom());
-    KisSequentialConstIterator srcIt(src, QRect(startx, starty, width, height));
-    while (srcIt.nextPixel()) {
-
-        cs->normalisedChannelsValue(srcIt.rawDataConst(), channel);
 
-        I = (uint)(cs->intensity8(srcIt.rawDataConst()) * Scale);
-        IntensityCount[I]++;
+    histogram.setWindow(QRect(startx, starty, width, height));
 
-        if (IntensityCount[I] == 1) {
-            AverageChannels[I] = channel;
-        } else {
-            for (int i = 0; i < channel.size(); i++) {
-                AverageChannels[I][i] += channel[i];
-            }
-        }
-    }
+    const int I = histogram.mostFrequentBin();
 
-    I = 0;
-    int MaxInstance = 0;
+    if (I >= 0) {
+        const int MaxInstance = histogram.count(I);
+        const double *AverageChannels = histogram.sums(I);
 
-    for (int i = 0 ; i <= Intensity ; ++i) {
-        if (IntensityCount[i] > MaxInstance) {
-            I = i;
-            MaxInstance = IntensityCount[i];
-        }
-    }
-
-    if (MaxInstance != 0) {
-        channel = AverageChannels[I];
         for (int i = 0; i < channel.size(); i++) {
-            channel[i] /= MaxInstance;
+            channel[i] = AverageChannels[i] / MaxInstance;
         }
         cs->fromNormalisedChannelsValue(dst, channel);
     } else {
         memset(dst, 0, cs->pixelSize());
         cs->setOpacity(dst, OPACITY_OPAQUE_U8, 1);
     }
-
-
-    delete [] IntensityCount;        // free all the arrays
-    delete [] AverageChannels;
 }
 
-
 KisConfigWidget * KisOilPaintFilter::createConfigurationWidget(QWidget* parent, const KisPaintDeviceSP) const
 {
     vKisIntegerWidgetParam param;
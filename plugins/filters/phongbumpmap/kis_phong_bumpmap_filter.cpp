@@ -32,6 +32,7 @@
 #include "kis_iterator_ng.h"
 #include "kundo2command.h"
 #include "kis_painter.h"
+#include "krita_utils.h"
 
 KisFilterPhongBumpmap::KisFilterPhongBumpmap()
                       : KisFilter(KoID("phongbumpmap", i18n("Phong Bumpmap")),
@@ -73,9 +74,65 @@ void KisFilterPhongBumpmap::processImpl(KisPaintDeviceSP device,
     }
     KIS_ASSERT_RECOVER_RETURN(m_heightChannel);
 
-    QRect inputArea = applyRect;
     QRect outputArea = applyRect;
-    if (m_usenormalmap==false) {
+
+    if (progressUpdater) progressUpdater->setProgress(1);
+
+    //======Preparation paraphlenalia=======
+
+    quint32         ki                       = KoChannelInfo::displayPositionToChannelIndex(m_heightChannel->displayPosition(), device->colorSpace()->channels());
+
+    if (progressUpdater) progressUpdater->setProgress(2);
+
+    //===============RENDER=================
+
+    QVector<PtrToDouble> toDoubleFuncPtr(device->colorSpace()->channels().count());
+    KisMathToolbox mathToolbox;
+    if (!mathToolbox.getToDoubleChannelPtr(device->colorSpace()->channels(), toDoubleFuncPtr)) {
+        return;
+    }
+
+    KisPaintDeviceSP bumpmapPaintDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb16());
+
+    /**
+     * The patches are rendered in parallel. Each of them reads its own
+     * heightmap with a one pixel border, so the normals are the same
+     * as if the whole area was rendered at once. The device is not
+     * changed until all the patches are ready.
+     */
+    const QVector<QRect> patches =
+        KritaUtils::splitRectIntoPatches(outputArea, KritaUtils::optimalPatchSize());
+
+    KritaUtils::processRectsInParallel(patches,
+        [&] (const QRect &patch) {
+            renderBumpmap(device, bumpmapPaintDevice, patch, m_usenormalmap,
+                          ki, toDoubleFuncPtr, config);
+        },
+        progressUpdater, 2, 90);
+
+    if (progressUpdater) progressUpdater->setProgress(90);
+
+    KUndo2Command *leaker = bumpmapPaintDevice->convertTo(device->colorSpace(), KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
+    KisPainter copier(device);
+    copier.bitBlt(outputArea.x(), outputArea.y(), bumpmapPaintDevice,
+                  outputArea.x(), outputArea.y(), outputArea.width(), outputArea.height());
+    //device->prepareClone(bumpmapPaintDevice);
+    //device->makeCloneFrom(bumpmapPaintDevice, bumpmapPaintDevice->extent());  // THIS COULD BE BUG GY
+
+    delete leaker;
+    if (progressUpdater) progressUpdater->setProgress(100);
+}
+
+void KisFilterPhongBumpmap::renderBumpmap(KisPaintDeviceSP device,
+                                          KisPaintDeviceSP bumpmapPaintDevice,
+                                          const QRect &outputArea,
+                                          bool useNormalMap,
+                                          quint32 ki,
+                                          const QVector<PtrToDouble> &toDoubleFuncPtr,
+                                          const KisFilterConfigurationSP config)
+{
+    QRect inputArea = outputArea;
+    if (useNormalMap==false) {
         inputArea.adjust(-1, -1, 1, 1);
     }
 
@@ -83,11 +140,6 @@ void KisFilterPhongBumpmap::processImpl(KisPaintDeviceSP device,
     quint32 posdown;
     quint32 posleft;
     quint32 posright;
-    QColor I; //Reflected light
-
-    if (progressUpdater) progressUpdater->setProgress(1);
-
-    //======Preparation paraphlenalia=======
 
     //Hardcoded facts about Phong Bumpmap: it _will_ generate an RGBA16 bumpmap
     const quint8    BYTE_DEPTH_OF_BUMPMAP    = 2;      // 16 bits per channel
@@ -98,19 +150,10 @@ void KisFilterPhongBumpmap::processImpl(KisPaintDeviceSP device,
     const quint32   bytesToFillBumpmapArea   = pixelsOfOutputArea * pixelSize;
     QVector<quint8> bumpmap(bytesToFillBumpmapArea);
     quint8         *bumpmapDataPointer       = bumpmap.data();
-    quint32         ki                       = KoChannelInfo::displayPositionToChannelIndex(m_heightChannel->displayPosition(), device->colorSpace()->channels());
     PhongPixelProcessor tileRenderer(pixelsOfInputArea, config);
 
-
-    if (progressUpdater) progressUpdater->setProgress(2);
-
-    //===============RENDER=================
-
-    QVector<PtrToDouble> toDoubleFuncPtr(device->colorSpace()->channels().count());
-    KisMathToolbox mathToolbox;
-    if (!mathToolbox.getToDoubleChannelPtr(device->colorSpace()->channels(), toDoubleFuncPtr)) {
-        return;
-    }
+    const KoColorSpace *cs = device->colorSpace();
+    const int heightChannelPos = cs->channels()[ki]->pos();
 
     KisHLineConstIteratorSP iterator;
     quint32 curPixel = 0;
@@ -119,17 +162,16 @@ void KisFilterPhongBumpmap::processImpl(KisPaintDeviceSP device,
                                              inputArea.width()
                                              );
 
-    if (m_usenormalmap==false) {
+    if (useNormalMap==false) {
         for (qint32 srcRow = 0; srcRow < inputArea.height(); ++srcRow) {
             do {
                 const quint8 *data = iterator->oldRawData();
-                tileRenderer.realheightmap[curPixel] = toDoubleFuncPtr[ki](data, device->colorSpace()->channels()[ki]->pos());
+                tileRenderer.realheightmap[curPixel] = toDoubleFuncPtr[ki](data, heightChannelPos);
                 curPixel++;
             }
             while (iterator->nextPixel());
             iterator->nextRow();
         }
-        if (progressUpdater) progressUpdater->setProgress(50);
 
         const int tileHeightMinus1 = inputArea.height() - 1;
         const int tileWidthMinus1 = inputArea.width() - 1;
@@ -151,43 +193,27 @@ void KisFilterPhongBumpmap::processImpl(KisPaintDeviceSP device,
             }
         }
     } else {
+        QVector <float> current_pixel_values(4);
+
         for (qint32 srcRow = 0; srcRow < inputArea.height(); ++srcRow) {
             do {
                 const quint8 *data = iterator->oldRawData();
-                tileRenderer.realheightmap[curPixel] = toDoubleFuncPtr[ki](data, device->colorSpace()->channels()[ki]->pos());
-                QVector <float> current_pixel_values(4);
-                device->colorSpace()->normalisedChannelsValue(data, current_pixel_values );
+                tileRenderer.realheightmap[curPixel] = toDoubleFuncPtr[ki](data, heightChannelPos);
+                cs->normalisedChannelsValue(data, current_pixel_values );
 
-                //dbgKrita<< "Vector:" << current_pixel_values[2] << "," << current_pixel_values[1] << "," << current_pixel_values[0];
                 memcpy(bumpmapDataPointer,
                       tileRenderer.IlluminatePixelFromNormalmap(current_pixel_values[2], current_pixel_values[1], current_pixel_values[0]).data(),
                       pixelSize);
 
                 curPixel++;
-                //pointer that crashes here, but not in the other if statement.
                 bumpmapDataPointer += pixelSize;
-
-
-
             }
             while (iterator->nextPixel());
             iterator->nextRow();
         }
     }
 
-    if (progressUpdater) progressUpdater->setProgress(90);
-
-    KisPaintDeviceSP bumpmapPaintDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->rgb16());
     bumpmapPaintDevice->writeBytes(bumpmap.data(), outputArea.x(), outputArea.y(), outputArea.width(), outputArea.height());
-    KUndo2Command *leaker = bumpmapPaintDevice->convertTo(device->colorSpace(), KoColorConversionTransformation::internalRenderingIntent(), KoColorConversionTransformation::internalConversionFlags());
-    KisPainter copier(device);
-    copier.bitBlt(outputArea.x(), outputArea.y(), bumpmapPaintDevice,
-                  outputArea.x(), outputArea.y(), outputArea.width(), outputArea.height());
-    //device->prepareClone(bumpmapPaintDevice);
-    //device->makeCloneFrom(bumpmapPaintDevice, bumpmapPaintDevice->extent());  // THIS COULD BE BUG GY
-
-    delete leaker;
-    if (progressUpdater) progressUpdater->setProgress(100);
 }
 
 KisFilterConfigurationSP KisFilterPhongBumpmap::factoryConfiguration() const
@@ -22,6 +22,7 @@
 
 #include <kis_types.h>
 #include <filter/kis_filter.h>
+#include <kis_math_toolbox.h>
 
 /**
  * This class is an implementation of the phong illumination model.
@@ -48,6 +49,19 @@ public:
     KisConfigWidget *createConfigurationWidget(QWidget *parent, const KisPaintDeviceSP dev) const override;
     KisFilterConfigurationSP factoryConfiguration() const override;
 private:
+    /**
+     * Renders the bumpmap of \p outputArea into \p bumpmapPaintDevice
+     * in RGBA16. Only reads \p device, so it can be called for
+     * different areas at the same time.
+     */
+    static void renderBumpmap(KisPaintDeviceSP device,
+                              KisPaintDeviceSP bumpmapPaintDevice,
+                              const QRect &outputArea,
+                              bool useNormalMap,
+                              quint32 ki,
+                              const QVector<PtrToDouble> &toDoubleFuncPtr,
+                              const KisFilterConfigurationSP config);
+
     //bool m_usenormalmap;
 };
 
@@ -26,6 +26,7 @@
 #include "kis_pixel_selection.h"
 #include "kis_transaction.h"
 #include <KoColorSpaceRegistry.h>
+#include <KoColor.h>
 #include <sdk/tests/qimage_test_util.h>
 #include <sdk/tests/testing_timed_default_bounds.h>
 
@@ -284,5 +285,42 @@ void KisAllFilterTest::testAllFiltersWithSelections()
 }
 
 
+void KisAllFilterTest::testOilPaintLargeBrush()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    KisFilterSP f = KisFilterRegistry::instance()->value("oilpaint");
+    QVERIFY(f);
+
+    const QRect rect(0, 0, 64, 64);
+    const KoColor white(Qt::white, cs);
+    const KoColor black(Qt::black, cs);
+
+    KisPaintDeviceSP dev = new KisPaintDevice(cs);
+    dev->fill(rect, white);
+    dev->fill(QRect(27, 27, 11, 11), black);
+
+    KisFilterConfigurationSP kfc = f->defaultConfiguration();
+    kfc->setProperty("brushSize", 10);
+    kfc->setProperty("smooth", 30);
+
+    f->process(dev, rect, kfc);
+
+    /**
+     * The 21x21 matrix around the center has 320 white pixels and 121
+     * black ones. The counts used to be stored in a byte, so 320
+     * wrapped to 64 and the black square survived. Now white wins
+     * everywhere.
+     */
+    KoColor pixel(cs);
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        for (int x = rect.left(); x <= rect.right(); x++) {
+            dev->pixel(x, y, &pixel);
+            if (!(pixel == white)) {
+                QFAIL(QString("Pixel (%1, %2) is not white").arg(x).arg(y).toLatin1());
+            }
+        }
+    }
+}
 
 QTEST_MAIN(KisAllFilterTest)
@@ -30,6 +30,7 @@ private Q_SLOTS:
     void testAllFilters();
     void testAllFiltersSrcNotIsDev();
     void testAllFiltersWithSelections();
+    void testOilPaintLargeBrush();
 };
 
 #endif
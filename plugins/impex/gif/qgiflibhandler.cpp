@@ -22,6 +22,7 @@
 #include <gif_lib.h>
 #include <string.h>		// memset
 #include <QPainter>
+#include <KisQuantizationUtils.h>
 
 extern int _GifError;
 
@@ -238,7 +239,9 @@ bool QGIFLibHandler::write ( const QImage & image )
     QImage toWrite(image);
     /// @todo how to specify dithering method
     if (toWrite.colorCount() == 0 || toWrite.colorCount() > 256)
-        toWrite = image.convertToFormat(QImage::Format_Indexed8);
+        toWrite = KisQuantizationUtils::convertToIndexed8(image,
+                                                          KisQuantizationUtils::generatePalette(image, 256),
+                                                          true);
 
     QVector<QRgb> colorTable = toWrite.colorTable();
     ColorMapObject cmap;
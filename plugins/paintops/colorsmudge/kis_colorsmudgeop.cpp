@@ -38,17 +38,58 @@
 #include <kis_fixed_paint_device.h>
 #include <kis_lod_transform.h>
 #include <kis_spacing_information.h>
+#include <kis_wrapped_rect.h>
+#include <kis_default_bounds_base.h>
 #include <KoColorModelStandardIds.h>
+#include <KisDependentDabsPipeline.h>
+
+
+struct KisColorSmudgeOp::DabRequest
+{
+    QRect dstDabRect;
+    QRect srcDabRect;
+    KisFixedPaintDeviceSP maskDab;
+
+    bool useDullingMode = false;
+    bool useOverlayMode = false;
+
+    /**
+     * The wrapper the canvas is sampled from and the parts of the sampled
+     * area that are not uploaded into its precise device yet
+     */
+    KisPrecisePaintDeviceWrapper *sourceWrapper = 0;
+    QVector<QRect> sourceFetchRects;
+
+    /**
+     * The parts of the destination area that are not uploaded
+     * into the precise device yet
+     */
+    QVector<QRect> dstFetchRects;
+
+    QPoint samplePoint;
+    int smudgeRadius = -1; // negative value means picking a single pixel
+
+    bool useColorRate = false;
+    KoColor paintColor;
+    quint8 colorRateOpacity = OPACITY_OPAQUE_U8;
+    quint8 smudgeRateOpacity = OPACITY_OPAQUE_U8;
+};
+
+struct KisColorSmudgeOp::DabResources
+{
+    KisPaintDeviceSP tempDev;
+    QScopedPointer<KisPainter> backgroundPainter;
+    QScopedPointer<KisPainter> smudgePainter;
+    QScopedPointer<KisPainter> colorRatePainter;
+    QScopedPointer<KisPainter> finalPainter;
+};
 
 KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image)
     : KisBrushBasedPaintOp(settings, painter)
     , m_firstRun(true)
     , m_image(image)
     , m_precisePainterWrapper(painter->device())
-    , m_tempDev(m_precisePainterWrapper.createPreciseCompositionSourceDevice())
-    , m_backgroundPainter(new KisPainter(m_tempDev))
-    , m_smudgePainter(new KisPainter(m_tempDev))
-    , m_colorRatePainter(new KisPainter(m_tempDev))
+    , m_colorRatePainter(new KisPainter())
     , m_finalPainter(new KisPainter(m_precisePainterWrapper.preciseDevice()))
     , m_smudgeRateOption()
     , m_colorRateOption("ColorRate", KisPaintOpOption::GENERAL, false)
@@ -81,18 +122,19 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
 
     m_gradient = painter->gradient();
 
-    m_backgroundPainter->setCompositeOp(COMPOSITE_COPY);
-    // Smudge Painter works in default COMPOSITE_OVER mode
-    m_colorRatePainter->setCompositeOp(painter->compositeOp()->id());
+    m_colorRateCompositeOpId = painter->compositeOp()->id();
 
     m_finalPainter->setCompositeOp(COMPOSITE_COPY);
     m_finalPainter->setSelection(painter->selection());
     m_finalPainter->setChannelFlags(painter->channelFlags());
     m_finalPainter->copyMirrorInformationFrom(painter);
 
-    m_paintColor = painter->paintColor().convertedTo(m_tempDev->colorSpace());
+    const KoColorSpace *preciseCompositionColorSpace =
+        m_precisePainterWrapper.createPreciseCompositionSourceDevice()->colorSpace();
+
+    m_paintColor = painter->paintColor().convertedTo(preciseCompositionColorSpace);
     m_preciseColorRateCompositeOp =
-        m_tempDev->colorSpace()->compositeOp(m_colorRatePainter->compositeOp()->id());
+        preciseCompositionColorSpace->compositeOp(m_colorRateCompositeOpId);
 
     m_hsvOptions.append(KisPressureHSVOption::createHueOption());
     m_hsvOptions.append(KisPressureHSVOption::createSaturationOption());
@@ -110,6 +152,18 @@ KisColorSmudgeOp::KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPaint
     if(m_overlayModeOption.isChecked()){
         m_preciseImageDeviceWrapper.reset(new KisPrecisePaintDeviceWrapper(m_image->projection()));
     }
+
+    m_resourcesPool.reset(
+        new KisAsyncDabResourcesPool<DabResources>(
+            [this] () { return createDabResources(); }));
+
+    /**
+     * In overlay mode the dabs sample the projection of the image, which
+     * is updated asynchronously, so the dabs cannot be reordered safely.
+     */
+    if (!m_overlayModeOption.isChecked()) {
+        m_dabsPipeline.reset(new KisDependentDabsPipeline(painter->runnableStrokeJobsInterface()));
+    }
 }
 
 KisColorSmudgeOp::~KisColorSmudgeOp()
@@ -118,6 +172,63 @@ KisColorSmudgeOp::~KisColorSmudgeOp()
     delete m_hsvTransform;
 }
 
+std::pair<int, bool> KisColorSmudgeOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs)
+{
+    if (!m_dabsPipeline) {
+        return KisBrushBasedPaintOp::doAsyncronousUpdate(jobs);
+    }
+
+    painter()->addDirtyRects(m_dabsPipeline->takeDirtyRects());
+
+    const int updatePeriod =
+        qBound(10, qRound(3 * m_dabsPipeline->averageDabRenderingTime()), 100);
+
+    return std::make_pair(updatePeriod, m_dabsPipeline->hasPendingDabs());
+}
+
+KisColorSmudgeOp::DabResources *KisColorSmudgeOp::createDabResources() const
+{
+    DabResources *resources = new DabResources();
+    resources->tempDev = m_precisePainterWrapper.createPreciseCompositionSourceDevice();
+
+    resources->backgroundPainter.reset(new KisPainter(resources->tempDev));
+    resources->backgroundPainter->setCompositeOp(COMPOSITE_COPY);
+
+    // Smudge Painter works in default COMPOSITE_OVER mode
+    resources->smudgePainter.reset(new KisPainter(resources->tempDev));
+
+    resources->colorRatePainter.reset(new KisPainter(resources->tempDev));
+    resources->colorRatePainter->setCompositeOp(m_colorRateCompositeOpId);
+
+    resources->finalPainter.reset(new KisPainter(m_precisePainterWrapper.preciseDevice()));
+    resources->finalPainter->setCompositeOp(COMPOSITE_COPY);
+    resources->finalPainter->setSelection(m_finalPainter->selection());
+    resources->finalPainter->setChannelFlags(m_finalPainter->channelFlags());
+    resources->finalPainter->copyMirrorInformationFrom(m_finalPainter.data());
+
+    return resources;
+}
+
+QVector<QRect> KisColorSmudgeOp::accessRects(const QVector<QRect> &rects) const
+{
+    KisDefaultBoundsBaseSP defaultBounds = m_precisePainterWrapper.sourceDevice()->defaultBounds();
+    if (!defaultBounds->wrapAroundMode()) return rects;
+
+    const QRect wrapRect = defaultBounds->bounds();
+
+    QVector<QRect> result;
+    Q_FOREACH (const QRect &rc, rects) {
+        KisWrappedRect wrappedRect(rc, wrapRect);
+        Q_FOREACH (const QRect &wrc, wrappedRect) {
+            if (!wrc.isEmpty()) {
+                result << wrc;
+            }
+        }
+    }
+
+    return result;
+}
+
 void KisColorSmudgeOp::updateMask(const KisPaintInformation& info, double scale, double rotation, const QPointF &cursorPoint)
 {
     static const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
@@ -238,46 +349,31 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
     const qreal fpOpacity = (qreal(painter()->opacity()) / 255.0) * m_opacityOption.getOpacityf(info);
 
-    if (m_image && m_overlayModeOption.isChecked()) {
-        m_image->blockUpdates();
-        m_backgroundPainter->bitBlt(QPoint(), m_image->projection(), srcDabRect);
-        m_image->unblockUpdates();
-    }
-    else {
-        // IMPORTANT: Clear the temporary painting device to transparent black.
-        //            It will only clear the extents of the brush.
-        m_tempDev->clear(QRect(QPoint(), m_dstDabRect.size()));
-    }
-
-    // stored in the color space of the paintColor
-    KoColor dullingFillColor = m_paintColor;
+    DabRequest request;
+    request.dstDabRect = m_dstDabRect;
+    request.srcDabRect = srcDabRect;
+    request.useDullingMode = useDullingMode;
+    request.useOverlayMode = m_image && m_overlayModeOption.isChecked();
+    request.sourceWrapper = &activeWrapper;
+    request.samplePoint = (srcDabRect.topLeft() + hotSpot).toPoint();
 
-    QPoint canvasLocalSamplePoint = (srcDabRect.topLeft() + hotSpot).toPoint();
+    QRect sampledRect = srcDabRect;
 
-    if (!useDullingMode) {
-        activeWrapper.readRect(srcDabRect);
-        m_smudgePainter->bitBlt(QPoint(), activeWrapper.preciseDevice(), srcDabRect);
-    } else {
+    if (useDullingMode) {
         if (m_smudgeRadiusOption.isChecked()) {
             const qreal effectiveSize = 0.5 * (m_dstDabRect.width() + m_dstDabRect.height());
 
-            const QRect sampleRect = m_smudgeRadiusOption.sampleRect(info, effectiveSize, canvasLocalSamplePoint);
-            activeWrapper.readRect(sampleRect);
-
-            m_smudgeRadiusOption.apply(&dullingFillColor, info, effectiveSize, canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), activeWrapper.preciseDevice());
-            KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
+            sampledRect = m_smudgeRadiusOption.sampleRect(info, effectiveSize, request.samplePoint);
+            request.smudgeRadius = m_smudgeRadiusOption.smudgeRadius(info, effectiveSize);
         } else {
-            // get the pixel on the canvas that lies beneath the hot spot
-            // of the dab and fill  the temporary paint device with that color
-            activeWrapper.readRect(QRect(canvasLocalSamplePoint, QSize(1,1)));
-            KisCrossDeviceColorPickerInt colorPicker(activeWrapper.preciseDevice(), dullingFillColor);
-            colorPicker.pickColor(canvasLocalSamplePoint.x(), canvasLocalSamplePoint.y(), dullingFillColor.data());
-            KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
+            sampledRect = QRect(request.samplePoint, QSize(1,1));
         }
     }
 
+    request.sourceFetchRects = activeWrapper.planReadRects({sampledRect});
+
     // if the user selected the color smudge option,
-    // we will mix some color into the temporary painting device (m_tempDev)
+    // we will mix some color into the temporary painting device
     if (m_colorRateOption.isChecked()) {
         // this will apply the opacity (selected by the user) to copyPainter
         // (but fit the rate inbetween the range 0.0 to (1.0-SmudgeRate))
@@ -286,8 +382,6 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
 
         // paint a rectangle with the current color (foreground color)
         // or a gradient color (if enabled)
-        // into the temporary painting device and use the user selected
-        // composite mode
         KoColor color = m_paintColor;
         m_gradientOption.apply(color, m_gradient, info);
         if (m_hsvTransform) {
@@ -297,59 +391,137 @@ KisSpacingInformation KisColorSmudgeOp::paintAt(const KisPaintInformation& info)
             m_hsvTransform->transform(color.data(), color.data(), 1);
         }
 
-        if (!useDullingMode) {
-            KIS_SAFE_ASSERT_RECOVER(*m_colorRatePainter->device()->colorSpace() == *color.colorSpace()) {
-                color.convertTo(m_colorRatePainter->device()->colorSpace());
+        request.useColorRate = true;
+        request.paintColor = color;
+        request.colorRateOpacity = m_colorRatePainter->opacity();
+    }
+
+    const QVector<QRect> dstRects = m_finalPainter->calculateAllMirroredRects(m_dstDabRect);
+    request.dstFetchRects = m_precisePainterWrapper.planReadRects(dstRects);
+
+    // set opacity calculated by the rate option
+    m_smudgeRateOption.apply(*m_finalPainter, info, 0.0, 1.0, fpOpacity);
+    request.smudgeRateOpacity = m_finalPainter->opacity();
+
+    if (m_dabsPipeline) {
+        // the mask device is reused by the dab cache for the next dab
+        request.maskDab = new KisFixedPaintDevice(*m_maskDab);
+
+        m_dabsPipeline->addDab(accessRects(QVector<QRect>(dstRects) << sampledRect),
+            [this, request] () {
+                DabResources *resources = m_resourcesPool->fetch();
+                const QVector<QRect> dirtyRects = renderDab(request, resources);
+                m_resourcesPool->put(resources);
+                return dirtyRects;
+            });
+    } else {
+        request.maskDab = m_maskDab;
+
+        DabResources *resources = m_resourcesPool->fetch();
+        painter()->addDirtyRects(renderDab(request, resources));
+        m_resourcesPool->put(resources);
+    }
+
+    return spacingInfo;
+}
+
+QVector<QRect> KisColorSmudgeOp::renderDab(const DabRequest &request, DabResources *resources)
+{
+    KisPaintDeviceSP tempDev = resources->tempDev;
+    const QRect &dstDabRect = request.dstDabRect;
+
+    if (request.useOverlayMode) {
+        m_image->blockUpdates();
+        resources->backgroundPainter->bitBlt(QPoint(), m_image->projection(), request.srcDabRect);
+        m_image->unblockUpdates();
+    }
+    else {
+        // IMPORTANT: Clear the temporary painting device to transparent black.
+        //            It will only clear the extents of the brush.
+        tempDev->clear(QRect(QPoint(), dstDabRect.size()));
+    }
+
+    request.sourceWrapper->fetchRects(request.sourceFetchRects);
+    KisPaintDeviceSP sourceDevice = request.sourceWrapper->preciseDevice();
+
+    // stored in the color space of the paintColor
+    KoColor dullingFillColor = m_paintColor;
+
+    if (!request.useDullingMode) {
+        resources->smudgePainter->bitBlt(QPoint(), sourceDevice, request.srcDabRect);
+    } else if (request.smudgeRadius >= 0) {
+        KisSmudgeRadiusOption::sampleColor(&dullingFillColor, request.smudgeRadius,
+                                           request.samplePoint.x(), request.samplePoint.y(),
+                                           sourceDevice);
+        KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *tempDev->colorSpace());
+    } else {
+        // get the pixel on the canvas that lies beneath the hot spot
+        // of the dab and fill  the temporary paint device with that color
+        KisCrossDeviceColorPickerInt colorPicker(sourceDevice, dullingFillColor);
+        colorPicker.pickColor(request.samplePoint.x(), request.samplePoint.y(), dullingFillColor.data());
+        KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *tempDev->colorSpace());
+    }
+
+    // mix the paint color into the temporary painting device
+    // using the user selected composite mode
+    if (request.useColorRate) {
+        KoColor color = request.paintColor;
+        KisPainter *colorRatePainter = resources->colorRatePainter.data();
+        colorRatePainter->setOpacity(request.colorRateOpacity);
+
+        if (!request.useDullingMode) {
+            KIS_SAFE_ASSERT_RECOVER(*colorRatePainter->device()->colorSpace() == *color.colorSpace()) {
+                color.convertTo(colorRatePainter->device()->colorSpace());
             }
 
-            m_colorRatePainter->fill(0, 0, m_dstDabRect.width(), m_dstDabRect.height(), color);
+            colorRatePainter->fill(0, 0, dstDabRect.width(), dstDabRect.height(), color);
         } else {
             KIS_SAFE_ASSERT_RECOVER(*dullingFillColor.colorSpace() == *color.colorSpace()) {
                 color.convertTo(dullingFillColor.colorSpace());
             }
-            KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
+            KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *tempDev->colorSpace());
             m_preciseColorRateCompositeOp->composite(dullingFillColor.data(), 0,
                                                      color.data(), 0,
                                                      0, 0,
                                                      1, 1,
-                                                     m_colorRatePainter->opacity());
+                                                     request.colorRateOpacity);
         }
     }
 
-    if (useDullingMode) {
-        KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *m_tempDev->colorSpace());
-        m_tempDev->fill(QRect(0, 0, m_dstDabRect.width(), m_dstDabRect.height()), dullingFillColor);
+    if (request.useDullingMode) {
+        KIS_SAFE_ASSERT_RECOVER_NOOP(*dullingFillColor.colorSpace() == *tempDev->colorSpace());
+        tempDev->fill(QRect(0, 0, dstDabRect.width(), dstDabRect.height()), dullingFillColor);
     }
 
-    m_precisePainterWrapper.readRects(m_finalPainter->calculateAllMirroredRects(m_dstDabRect));
+    m_precisePainterWrapper.fetchRects(request.dstFetchRects);
+
+    KisPainter *finalPainter = resources->finalPainter.data();
 
     // if color is disabled (only smudge) and "overlay mode" is enabled
     // then first blit the region under the brush from the image projection
     // to the painting device to prevent a rapid build up of alpha value
     // if the color to be smudged is semi transparent.
-    if (m_image && m_overlayModeOption.isChecked() && !m_colorRateOption.isChecked()) {
-        m_finalPainter->setOpacity(OPACITY_OPAQUE_U8);
+    if (request.useOverlayMode && !request.useColorRate) {
+        finalPainter->setOpacity(OPACITY_OPAQUE_U8);
         m_image->blockUpdates();
         // TODO: check if this code is correct in mirrored mode! Technically, the
         //       painter renders the mirrored dab only, so we should also prepare
         //       the overlay for it in all the places.
-        m_finalPainter->bitBlt(m_dstDabRect.topLeft(), m_image->projection(), m_dstDabRect);
+        finalPainter->bitBlt(dstDabRect.topLeft(), m_image->projection(), dstDabRect);
         m_image->unblockUpdates();
     }
 
-    // set opacity calculated by the rate option
-    m_smudgeRateOption.apply(*m_finalPainter, info, 0.0, 1.0, fpOpacity);
+    finalPainter->setOpacity(request.smudgeRateOpacity);
 
     // then blit the temporary painting device on the canvas at the current brush position
     // the alpha mask (maskDab) will be used here to only blit the pixels that are in the area (shape) of the brush
-    m_finalPainter->bitBltWithFixedSelection(m_dstDabRect.x(), m_dstDabRect.y(), m_tempDev, m_maskDab, m_dstDabRect.width(), m_dstDabRect.height());
-    m_finalPainter->renderMirrorMaskSafe(m_dstDabRect, m_tempDev, 0, 0, m_maskDab, !m_dabCache->needSeparateOriginal());
+    finalPainter->bitBltWithFixedSelection(dstDabRect.x(), dstDabRect.y(), tempDev, request.maskDab, dstDabRect.width(), dstDabRect.height());
+    finalPainter->renderMirrorMaskSafe(dstDabRect, tempDev, 0, 0, request.maskDab, !m_dabsPipeline && !m_dabCache->needSeparateOriginal());
 
-    const QVector<QRect> dirtyRects = m_finalPainter->takeDirtyRegion();
+    const QVector<QRect> dirtyRects = finalPainter->takeDirtyRegion();
     m_precisePainterWrapper.writeRects(dirtyRects);
-    painter()->addDirtyRects(dirtyRects);
 
-    return spacingInfo;
+    return dirtyRects;
 }
 
 KisSpacingInformation KisColorSmudgeOp::updateSpacingImpl(const KisPaintInformation &info) const
@@ -37,12 +37,14 @@
 #include "kis_smudge_option.h"
 #include "kis_smudge_radius_option.h"
 #include "KisPrecisePaintDeviceWrapper.h"
+#include "KisAsyncDabPipeline.h"
 
 class QPointF;
 class KoAbstractGradient;
 class KisBrushBasedPaintOpSettings;
 class KisPainter;
 class KoColorSpace;
+class KisDependentDabsPipeline;
 
 class KisColorSmudgeOp: public KisBrushBasedPaintOp
 {
@@ -50,6 +52,8 @@ public:
     KisColorSmudgeOp(const KisPaintOpSettingsSP settings, KisPainter* painter, KisNodeSP node, KisImageSP image);
     ~KisColorSmudgeOp() override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs) override;
+
 protected:
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
 
@@ -61,17 +65,39 @@ private:
 
     inline void getTopLeftAligned(const QPointF &pos, const QPointF &hotSpot, qint32 *x, qint32 *y);
 
+    struct DabRequest;
+    struct DabResources;
+
+    DabResources* createDabResources() const;
+    QVector<QRect> accessRects(const QVector<QRect> &rects) const;
+
+    /**
+     * Samples the canvas, mixes the paint color into the sample and blits
+     * the result into the destination device. The function doesn't access
+     * any state of the paintop that is modified by paintAt(), so it can
+     * be called from a background thread.
+     *
+     * \return the changed rects of the destination device
+     */
+    QVector<QRect> renderDab(const DabRequest &request, DabResources *resources);
+
 private:
     bool                      m_firstRun;
     KisImageWSP               m_image;
     KisPrecisePaintDeviceWrapper m_precisePainterWrapper;
     KoColor                   m_paintColor;
-    KisPaintDeviceSP          m_tempDev;
     QScopedPointer<KisPrecisePaintDeviceWrapper> m_preciseImageDeviceWrapper;
-    QScopedPointer<KisPainter> m_backgroundPainter;
-    QScopedPointer<KisPainter> m_smudgePainter;
+
+    /**
+     * These painters are never used for painting. They keep the
+     * configuration (mirroring, opacity) for calculating the
+     * parameters of the dabs in paintAt()
+     */
     QScopedPointer<KisPainter> m_colorRatePainter;
     QScopedPointer<KisPainter> m_finalPainter;
+
+    QScopedPointer<KisAsyncDabResourcesPool<DabResources>> m_resourcesPool;
+    QScopedPointer<KisDependentDabsPipeline> m_dabsPipeline;
     const KoAbstractGradient* m_gradient {0};
     KisPressureSizeOption     m_sizeOption;
     KisPressureOpacityOption  m_opacityOption;
@@ -90,6 +116,7 @@ private:
 
     KoColorTransformation *m_hsvTransform {0};
     const KoCompositeOp *m_preciseColorRateCompositeOp {0};
+    QString m_colorRateCompositeOpId;
 };
 
 #endif // _KIS_COLORSMUDGEOP_H_
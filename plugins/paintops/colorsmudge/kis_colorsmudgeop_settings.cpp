@@ -34,6 +34,13 @@ KisColorSmudgeOpSettings::~KisColorSmudgeOpSettings()
 {
 }
 
+bool KisColorSmudgeOpSettings::needsAsynchronousUpdates() const
+{
+    // the dabs are executed in background threads in all the
+    // modes except overlay, see KisColorSmudgeOp constructor
+    return !getBool("MergedPaint");
+}
+
 #include <brushengine/kis_slider_based_paintop_property.h>
 #include <brushengine/kis_combo_based_paintop_property.h>
 #include "kis_paintop_preset.h"
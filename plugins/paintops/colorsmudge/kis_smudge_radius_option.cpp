@@ -38,22 +38,23 @@
 
 
 
-class KisRandomConstAccessorNG;
-
 KisSmudgeRadiusOption::KisSmudgeRadiusOption():
     KisRateOption("SmudgeRadius", KisPaintOpOption::GENERAL, true)
 {
     setValueRange(0.0,300.0);
 }
 
+int KisSmudgeRadiusOption::smudgeRadius(const KisPaintInformation &info, qreal diameter) const
+{
+    const qreal sliderValue = computeSizeLikeValue(info);
+    return ((sliderValue * diameter) * 0.5) / 100.0;
+}
+
 QRect KisSmudgeRadiusOption::sampleRect(const KisPaintInformation& info,
                                         qreal diameter,
                                         const QPoint &pos) const
 {
-    const qreal sliderValue = computeSizeLikeValue(info);
-    const int smudgeRadius = ((sliderValue * diameter) * 0.5) / 100.0;
-
-    return kisGrowRect(QRect(pos, QSize(1,1)), smudgeRadius + 1);
+    return kisGrowRect(QRect(pos, QSize(1,1)), smudgeRadius(info, diameter) + 1);
 }
 
 void KisSmudgeRadiusOption::apply(KoColor *resultColor,
@@ -65,11 +66,15 @@ void KisSmudgeRadiusOption::apply(KoColor *resultColor,
 {
     if (!isChecked()) return;
 
-    qreal sliderValue = computeSizeLikeValue(info);
-
-    int smudgeRadius = ((sliderValue * diameter) * 0.5) / 100.0;
-
+    sampleColor(resultColor, smudgeRadius(info, diameter), posx, posy, dev);
+}
 
+void KisSmudgeRadiusOption::sampleColor(KoColor *resultColor,
+                                        int smudgeRadius,
+                                        qreal posx,
+                                        qreal posy,
+                                        KisPaintDeviceSP dev)
+{
     KoColor color(Qt::transparent, dev->colorSpace());
 
     if (smudgeRadius == 1) {
@@ -79,13 +84,16 @@ void KisSmudgeRadiusOption::apply(KoColor *resultColor,
         const KoColorSpace* cs = dev->colorSpace();
         const int pixelSize = cs->pixelSize();
 
-        quint8* data = new quint8[pixelSize];
-        quint8* pixels[2];
+        /**
+         * The pixels are blended in pairs: the color accumulated so far
+         * goes first and the new sample second, so that they can be
+         * passed to mixColors() as a continuous array.
+         */
+        QVector<quint8> pixels(2 * pixelSize);
+        quint8 *accumulated = pixels.data();
+        quint8 *sample = pixels.data() + pixelSize;
         qint16 weights[2];
 
-        pixels[1] = new quint8[pixelSize];
-        pixels[0] = new quint8[pixelSize];
-
         int loop_increment = 1;
         if(smudgeRadius >= 8)
         {
@@ -115,10 +123,10 @@ void KisSmudgeRadiusOption::apply(KoColor *resultColor,
                             x = x*(-1);
                         }
                         accessor->moveTo(posx + x, posy + y);
-                        memcpy(pixels[1], accessor->rawDataConst(), pixelSize);
+                        memcpy(sample, accessor->rawDataConst(), pixelSize);
                         if(i == 0)
                         {
-                            memcpy(pixels[0],accessor->rawDataConst(),pixelSize);
+                            memcpy(accumulated, accessor->rawDataConst(), pixelSize);
                         }
                         if (x == 0 && y == 0) {
                             // Because the sum of the weights must be 255,
@@ -135,11 +143,8 @@ void KisSmudgeRadiusOption::apply(KoColor *resultColor,
                         i++;
                         if (i>smudgeRadius){i=0;}
                         weights[0] = 255 - weights[1];
-                        const quint8** cpixels = const_cast<const quint8**>(pixels);
-                        cs->mixColorsOp()->mixColors(cpixels, weights,2, data);
-                        memcpy(pixels[0],data,pixelSize);
-
 
+                        cs->mixColorsOp()->mixColors(pixels.constData(), weights, 2, accumulated);
                     }
                     x = x*(-1);
                 }
@@ -148,12 +153,7 @@ void KisSmudgeRadiusOption::apply(KoColor *resultColor,
 
         }
 
-        color = KoColor(pixels[0],cs);
-
-        for (int l = 0; l < 2; l++){
-            delete[] pixels[l];
-        }
-        delete[] data;
+        color = KoColor(accumulated, cs);
     }
 
     *resultColor = color.convertedTo(resultColor->colorSpace());
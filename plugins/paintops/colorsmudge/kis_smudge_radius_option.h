@@ -29,6 +29,11 @@ class KisSmudgeRadiusOption: public KisRateOption
 public:
     KisSmudgeRadiusOption();
 
+    /**
+     * \return the radius of the sampled area for the dab of \p diameter
+     */
+    int smudgeRadius(const KisPaintInformation &info, qreal diameter) const;
+
     QRect sampleRect(const KisPaintInformation &info, qreal diameter, const QPoint &pos) const;
 
     /**
@@ -42,6 +47,17 @@ public:
                qreal posy,
                KisPaintDeviceSP dev) const;
 
+    /**
+     * Average the color of \p dev in the area of \p smudgeRadius around
+     * (\p posx, \p posy). The function doesn't access the sensors, so
+     * it can be called from the background threads of the paintop.
+     */
+    static void sampleColor(KoColor *resultColor,
+                            int smudgeRadius,
+                            qreal posx,
+                            qreal posy,
+                            KisPaintDeviceSP dev);
+
     void writeOptionSetting(KisPropertiesConfigurationSP setting) const override;
     void readOptionSetting(const KisPropertiesConfigurationSP setting) override;
 
@@ -0,0 +1,219 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisColorSmudgeOpTest.h"
+
+#include <QTest>
+#include <QThreadPool>
+#include <QRunnable>
+
+#include <KoColor.h>
+#include <KoColorSpaceRegistry.h>
+#include <stroke_testing_utils.h>
+#include <kis_canvas_resource_provider.h>
+#include <kis_resources_snapshot.h>
+#include <kis_image.h>
+#include <kis_paint_layer.h>
+#include <kis_painter.h>
+#include <kis_distance_information.h>
+#include <brushengine/kis_paint_information.h>
+#include <brushengine/kis_paintop_preset.h>
+#include <brushengine/kis_paintop_settings.h>
+#include <KisRunnableStrokeJobsInterface.h>
+#include <KisRunnableStrokeJobData.h>
+#include <KisPersistentDabCache.h>
+
+
+namespace {
+
+/**
+ * Executes the jobs in the reverse order of their addition, that is,
+ * the latest ready dab is always executed first
+ */
+struct ReversedJobsExecutor : public KisRunnableStrokeJobsInterface
+{
+    ~ReversedJobsExecutor() override {
+        qDeleteAll(jobs);
+    }
+
+    void addRunnableJobs(const QVector<KisRunnableStrokeJobDataBase*> &list) override {
+        jobs.append(list);
+    }
+
+    void runAllJobs() {
+        while (!jobs.isEmpty()) {
+            KisRunnableStrokeJobDataBase *job = jobs.takeLast();
+            job->run();
+            delete job;
+        }
+    }
+
+    QList<KisRunnableStrokeJobDataBase*> jobs;
+};
+
+/**
+ * Executes the jobs in a thread pool as soon as they are added
+ */
+struct ThreadedJobsExecutor : public KisRunnableStrokeJobsInterface
+{
+    struct JobRunnable : public QRunnable {
+        JobRunnable(KisRunnableStrokeJobDataBase *_job) : job(_job) {}
+        ~JobRunnable() override { delete job; }
+
+        void run() override {
+            job->run();
+        }
+
+        KisRunnableStrokeJobDataBase *job;
+    };
+
+    ~ThreadedJobsExecutor() override {
+        pool.waitForDone();
+    }
+
+    void addRunnableJobs(const QVector<KisRunnableStrokeJobDataBase*> &list) override {
+        Q_FOREACH (KisRunnableStrokeJobDataBase *job, list) {
+            pool.start(new JobRunnable(job));
+        }
+    }
+
+    QThreadPool pool;
+};
+
+enum ExecutorType {
+    SEQUENTIAL,
+    REVERSED,
+    THREADED
+};
+
+KisPaintDeviceSP paintStroke(const QString &presetFileName, int smudgeMode, bool mirrored, ExecutorType executorType)
+{
+    // every stroke should start with the same state of the dabs cache
+    KisPersistentDabCache::instance()->clear();
+
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+    KisImageSP image = new KisImage(0, 640, 480, cs, "test");
+    KisPaintLayerSP layer = new KisPaintLayer(image, "paint1", OPACITY_OPAQUE_U8);
+    image->addNode(layer);
+
+    KisPaintDeviceSP dev = layer->paintDevice();
+
+    // leave some transparent areas to check the handling of the extent
+    dev->fill(QRect(0, 0, 320, 240), KoColor(Qt::red, cs));
+    dev->fill(QRect(320, 0, 320, 240), KoColor(Qt::green, cs));
+    dev->fill(QRect(0, 240, 320, 180), KoColor(Qt::blue, cs));
+
+    QScopedPointer<KoCanvasResourceProvider> manager(
+        utils::createResourceManager(image, layer, presetFileName));
+
+    KisPaintOpPresetSP preset =
+        manager->resource(KisCanvasResourceProvider::CurrentPaintOpPreset).value<KisPaintOpPresetSP>();
+
+    KisPaintOpSettingsSP settings = preset->settings()->clone();
+    settings->setProperty("SmudgeRateMode", smudgeMode);
+    settings->setProperty("MergedPaint", false);
+    preset->setSettings(settings);
+
+    // mirror the dabs around the center of the image
+    manager->setResource(KisCanvasResourceProvider::MirrorHorizontal, mirrored);
+    manager->setResource(KisCanvasResourceProvider::MirrorVertical, mirrored);
+
+    ReversedJobsExecutor reversedExecutor;
+    ThreadedJobsExecutor threadedExecutor;
+
+    KisPainter gc(dev);
+
+    if (executorType == REVERSED) {
+        gc.setRunnableStrokeJobsInterface(&reversedExecutor);
+    } else if (executorType == THREADED) {
+        gc.setRunnableStrokeJobsInterface(&threadedExecutor);
+    }
+
+    KisResourcesSnapshotSP resources =
+        new KisResourcesSnapshot(image, layer, manager.data());
+    resources->setupPainter(&gc);
+
+    QVector<KisPaintInformation> points;
+    points << KisPaintInformation(QPointF(50, 50), 0.2);
+    points << KisPaintInformation(QPointF(600, 100), 1.0);
+    points << KisPaintInformation(QPointF(300, 300), 0.5);
+    points << KisPaintInformation(QPointF(310, 310), 1.0);
+    points << KisPaintInformation(QPointF(50, 450), 0.8);
+
+    KisDistanceInformation dist;
+
+    for (int i = 1; i < points.size(); i++) {
+        gc.paintLine(points[i - 1], points[i], &dist);
+        reversedExecutor.runAllJobs();
+    }
+
+    threadedExecutor.pool.waitForDone();
+
+    return dev;
+}
+
+bool compareDevicesExactly(KisPaintDeviceSP dev1, KisPaintDeviceSP dev2)
+{
+    const QRect rc = dev1->exactBounds();
+    if (rc != dev2->exactBounds()) return false;
+
+    const int numBytes = rc.width() * rc.height() * dev1->pixelSize();
+    QByteArray bytes1(numBytes, 0);
+    QByteArray bytes2(numBytes, 0);
+
+    dev1->readBytes(reinterpret_cast<quint8*>(bytes1.data()), rc);
+    dev2->readBytes(reinterpret_cast<quint8*>(bytes2.data()), rc);
+
+    return bytes1 == bytes2;
+}
+
+}
+
+void KisColorSmudgeOpTest::testParallelExecution_data()
+{
+    QTest::addColumn<QString>("presetFileName");
+    QTest::addColumn<int>("smudgeMode");
+    QTest::addColumn<bool>("mirrored");
+
+    QTest::newRow("smearing") << "testing_200px_colorsmudge_default.kpp" << 0 << false;
+    QTest::newRow("dulling") << "testing_200px_colorsmudge_default.kpp" << 1 << false;
+    QTest::newRow("smearing-mirrored") << "testing_200px_colorsmudge_default.kpp" << 0 << true;
+    QTest::newRow("dulling-mirrored") << "testing_200px_colorsmudge_default.kpp" << 1 << true;
+    QTest::newRow("smearing-color-rate") << "Mix_dull.kpp" << 0 << false;
+    QTest::newRow("dulling-color-rate") << "Mix_dull.kpp" << 1 << false;
+}
+
+void KisColorSmudgeOpTest::testParallelExecution()
+{
+    QFETCH(QString, presetFileName);
+    QFETCH(int, smudgeMode);
+    QFETCH(bool, mirrored);
+
+    KisPaintDeviceSP reference = paintStroke(presetFileName, smudgeMode, mirrored, SEQUENTIAL);
+
+    KisPaintDeviceSP reversed = paintStroke(presetFileName, smudgeMode, mirrored, REVERSED);
+    QVERIFY(compareDevicesExactly(reference, reversed));
+
+    for (int i = 0; i < 3; i++) {
+        KisPaintDeviceSP threaded = paintStroke(presetFileName, smudgeMode, mirrored, THREADED);
+        QVERIFY(compareDevicesExactly(reference, threaded));
+    }
+}
+
+QTEST_MAIN(KisColorSmudgeOpTest)
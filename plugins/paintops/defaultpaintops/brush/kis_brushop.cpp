@@ -43,6 +43,7 @@
 #include <QtConcurrent>
 #include "kis_algebra_2d.h"
 #include <KisDabRenderingExecutor.h>
+#include <KisAsyncDabUpdater.h>
 #include <KisDabCacheUtils.h>
 #include <KisRenderedDab.h>
 #include "KisBrushOpResources.h"
@@ -50,21 +51,12 @@
 #include <KisRunnableStrokeJobData.h>
 #include <KisRunnableStrokeJobsInterface.h>
 
-#include <QSharedPointer>
 #include <QThread>
-#include "kis_image_config.h"
-#include "kis_wrapped_rect.h"
 
 
 KisBrushOp::KisBrushOp(const KisPaintOpSettingsSP settings, KisPainter *painter, KisNodeSP node, KisImageSP image)
     : KisBrushBasedPaintOp(settings, painter)
     , m_opacityOption(node)
-    , m_avgSpacing(50)
-    , m_avgNumDabs(50)
-    , m_avgUpdateTimePerDab(50)
-    , m_idealNumRects(KisImageConfig(true).maxNumberOfThreads())
-    , m_minUpdatePeriod(10)
-    , m_maxUpdatePeriod(100)
 {
     Q_UNUSED(image);
     Q_ASSERT(settings);
@@ -119,6 +111,8 @@ KisBrushOp::KisBrushOp(const KisPaintOpSettingsSP settings, KisPainter *painter,
                     painter->runnableStrokeJobsInterface(),
                     &m_mirrorOption,
                     &m_precisionOption));
+
+    m_dabUpdater.reset(new KisAsyncDabUpdater(m_dabExecutor.data()));
 }
 
 KisBrushOp::~KisBrushOp()
@@ -170,222 +164,14 @@ KisSpacingInformation KisBrushOp::paintAt(const KisPaintInformation& info)
         effectiveSpacing(scale, rotation, &m_airbrushOption, &m_spacingOption, info);
 
     // gather statistics about dabs
-    m_avgSpacing(spacingInfo.scalarApprox());
+    m_dabUpdater->addSpacingSample(spacingInfo.scalarApprox());
 
     return spacingInfo;
 }
 
-struct KisBrushOp::UpdateSharedState
-{
-    // rendering data
-    KisPainter *painter = 0;
-    QList<KisRenderedDab> dabsQueue;
-
-    // speed metrics
-    QVector<QPointF> dabPoints;
-    QElapsedTimer dabRenderingTimer;
-
-    // final report
-    QVector<QRect> allDirtyRects;
-};
-
-void KisBrushOp::addMirroringJobs(Qt::Orientation direction,
-                                  QVector<QRect> &rects,
-                                  UpdateSharedStateSP state,
-                                  QVector<KisRunnableStrokeJobData*> &jobs)
-{
-    jobs.append(new KisRunnableStrokeJobData(0, KisStrokeJobData::SEQUENTIAL));
-
-    for (KisRenderedDab &dab : state->dabsQueue) {
-        jobs.append(
-            new KisRunnableStrokeJobData(
-                [state, &dab, direction] () {
-                    state->painter->mirrorDab(direction, &dab);
-                },
-                KisStrokeJobData::CONCURRENT));
-    }
-
-    jobs.append(new KisRunnableStrokeJobData(0, KisStrokeJobData::SEQUENTIAL));
-
-    for (QRect &rc : rects) {
-        state->painter->mirrorRect(direction, &rc);
-
-        jobs.append(
-            new KisRunnableStrokeJobData(
-                [rc, state] () {
-                    state->painter->bltFixed(rc, state->dabsQueue);
-                },
-                KisStrokeJobData::CONCURRENT));
-    }
-
-    state->allDirtyRects.append(rects);
-}
-
 std::pair<int, bool> KisBrushOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData*> &jobs)
 {
-    bool someDabsAreStillInQueue = false;
-    const bool hasPreparedDabsAtStart = m_dabExecutor->hasPreparedDabs();
-
-    if (!m_updateSharedState && hasPreparedDabsAtStart) {
-
-        m_updateSharedState = toQShared(new UpdateSharedState());
-        UpdateSharedStateSP state = m_updateSharedState;
-
-        state->painter = painter();
-
-        {
-            const qreal dabRenderingTime = m_dabExecutor->averageDabRenderingTime();
-            const qreal totalRenderingTimePerDab = dabRenderingTime + m_avgUpdateTimePerDab.rollingMeanSafe();
-
-            // we limit the number of fetched dabs to fit the maximum update period and not
-            // make visual hiccups
-            const int dabsLimit =
-                totalRenderingTimePerDab > 0 ?
-                    qMax(10, int(m_maxUpdatePeriod  / totalRenderingTimePerDab * m_idealNumRects)) :
-                    -1;
-
-            state->dabsQueue = m_dabExecutor->takeReadyDabs(painter()->hasMirroring(), dabsLimit, &someDabsAreStillInQueue);
-        }
-
-        KIS_SAFE_ASSERT_RECOVER_RETURN_VALUE(!state->dabsQueue.isEmpty(),
-                                             std::make_pair(m_currentUpdatePeriod, false));
-
-        const int diameter = m_dabExecutor->averageDabSize();
-        const qreal spacing = m_avgSpacing.rollingMean();
-
-        const int idealNumRects = m_idealNumRects;
-
-        QVector<QRect> rects;
-
-        // wrap the dabs if needed
-        if (painter()->device()->defaultBounds()->wrapAroundMode()) {
-            /**
-             * In WA mode we do two things:
-             *
-             * 1) We ensure that the parallel threads do not access the same are on
-             *    the image. For normal updates that is ensured by the code in KisImage
-             *    and the scheduler. Here we should do that manually by adjusting 'rects'
-             *    so that they would not intersect in the wrapped space.
-             *
-             * 2) We duplicate dabs, to ensure that all the pieces of dabs are painted
-             *    inside the wrapped rect. No pieces are dabs are painted twice, because
-             *    we paint only the parts intersecting the wrap rect.
-             */
-
-            const QRect wrapRect = painter()->device()->defaultBounds()->bounds();
-
-            QList<KisRenderedDab> wrappedDabs;
-
-            Q_FOREACH (const KisRenderedDab &dab, state->dabsQueue) {
-                const QVector<QPoint> normalizationOrigins =
-                    KisWrappedRect::normalizationOriginsForRect(dab.realBounds(), wrapRect);
-
-                Q_FOREACH(const QPoint &pt, normalizationOrigins) {
-                    KisRenderedDab newDab = dab;
-
-                    newDab.offset = pt;
-
-                    rects.append(newDab.realBounds() & wrapRect);
-                    wrappedDabs.append(newDab);
-                }
-            }
-
-            state->dabsQueue = wrappedDabs;
-
-        } else {
-            // just get all rects
-            Q_FOREACH (const KisRenderedDab &dab, state->dabsQueue) {
-                rects.append(dab.realBounds());
-            }
-        }
-
-        // split/merge rects into non-overlapping areas
-        rects = KisPaintOpUtils::splitDabsIntoRects(rects,
-                                                    idealNumRects, diameter, spacing);
-
-        state->allDirtyRects = rects;
-
-        Q_FOREACH (const KisRenderedDab &dab, state->dabsQueue) {
-            state->dabPoints.append(dab.realBounds().center());
-        }
-
-        state->dabRenderingTimer.start();
-
-        Q_FOREACH (const QRect &rc, rects) {
-            jobs.append(
-                new KisRunnableStrokeJobData(
-                    [rc, state] () {
-                        state->painter->bltFixed(rc, state->dabsQueue);
-                    },
-                    KisStrokeJobData::CONCURRENT));
-        }
-
-        /**
-         * After the dab has been rendered once, we should mirror it either one
-         * (h __or__ v) or three (h __and__ v) times. This sequence of 'if's achieves
-         * the goal without any extra copying. Please note that it has __no__ 'else'
-         * branches, which is done intentionally!
-         */
-        if (state->painter->hasHorizontalMirroring()) {
-            addMirroringJobs(Qt::Horizontal, rects, state, jobs);
-        }
-
-        if (state->painter->hasVerticalMirroring()) {
-            addMirroringJobs(Qt::Vertical, rects, state, jobs);
-        }
-
-        if (state->painter->hasHorizontalMirroring() && state->painter->hasVerticalMirroring()) {
-            addMirroringJobs(Qt::Horizontal, rects, state, jobs);
-        }
-
-        jobs.append(
-            new KisRunnableStrokeJobData(
-                [state, this, someDabsAreStillInQueue] () {
-                    Q_FOREACH(const QRect &rc, state->allDirtyRects) {
-                        state->painter->addDirtyRect(rc);
-                    }
-
-                    state->painter->setAverageOpacity(state->dabsQueue.last().averageOpacity);
-
-                    const int updateRenderingTime = state->dabRenderingTimer.elapsed();
-                    const qreal dabRenderingTime = m_dabExecutor->averageDabRenderingTime();
-
-                    m_avgNumDabs(state->dabsQueue.size());
-
-                    const qreal currentUpdateTimePerDab = qreal(updateRenderingTime) / state->dabsQueue.size();
-                    m_avgUpdateTimePerDab(currentUpdateTimePerDab);
-
-                    /**
-                     * NOTE: using currentUpdateTimePerDab in the calculation for the next update time instead
-                     *       of the average one makes rendering speed about 40% faster. It happens because the
-                     *       adaptation period is shorter than if it used
-                     */
-                    const qreal totalRenderingTimePerDab = dabRenderingTime + currentUpdateTimePerDab;
-
-                    const int approxDabRenderingTime =
-                        qreal(totalRenderingTimePerDab) * m_avgNumDabs.rollingMean() / m_idealNumRects;
-
-                    m_currentUpdatePeriod =
-                        someDabsAreStillInQueue ? m_minUpdatePeriod :
-                        qBound(m_minUpdatePeriod, int(1.5 * approxDabRenderingTime), m_maxUpdatePeriod);
-
-
-                    { // debug chunk
-//                        ENTER_FUNCTION() << ppVar(state->allDirtyRects.size()) << ppVar(state->dabsQueue.size()) << ppVar(dabRenderingTime) << ppVar(updateRenderingTime);
-//                        ENTER_FUNCTION() << ppVar(m_currentUpdatePeriod) << ppVar(someDabsAreStillInQueue);
-                    }
-
-                    // release all the dab devices
-                    state->dabsQueue.clear();
-
-                    m_updateSharedState.clear();
-                },
-                KisStrokeJobData::SEQUENTIAL));
-    } else if (m_updateSharedState && hasPreparedDabsAtStart) {
-        someDabsAreStillInQueue = true;
-    }
-
-    return std::make_pair(m_currentUpdatePeriod, someDabsAreStillInQueue);
+    return m_dabUpdater->doAsyncronousUpdate(painter(), jobs);
 }
 
 KisSpacingInformation KisBrushOp::updateSpacingImpl(const KisPaintInformation &info) const
@@ -24,6 +24,7 @@
 
 #include <kis_debug.h>
 
+#include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 #include <KoColorTransformation.h>
 #include <KoColor.h>
@@ -47,6 +48,9 @@
 #include <kis_transaction.h>
 #include <kis_lod_transform.h>
 #include <kis_spacing_information.h>
+#include <KisRenderedDab.h>
+#include <KisAsyncDabPipeline.h>
+#include <KisAsyncDabUpdater.h>
 
 
 KisFilterOp::KisFilterOp(const KisPaintOpSettingsSP settings, KisPainter *painter, KisNodeSP node, KisImageSP image)
@@ -68,12 +72,32 @@ KisFilterOp::KisFilterOp(const KisPaintOpSettingsSP settings, KisPainter *painte
     m_smudgeMode = settings->getBool(FILTER_SMUDGE_MODE);
 
     m_rotationOption.applyFanCornersInfo(this);
+
+    /**
+     * In non-smudge mode every dab reads only the original state of the
+     * device, so the dabs can be filtered in parallel. In smudge mode the
+     * dabs are accumulated in m_tmpDevice, so we keep painting them
+     * sequentially.
+     */
+    if (!m_smudgeMode && m_filter && m_filter->supportsThreading()) {
+        m_dabPipeline.reset(new KisAsyncDabPipeline(painter->runnableStrokeJobsInterface()));
+        m_dabUpdater.reset(new KisAsyncDabUpdater(m_dabPipeline.data()));
+    }
 }
 
 KisFilterOp::~KisFilterOp()
 {
 }
 
+std::pair<int, bool> KisFilterOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs)
+{
+    if (!m_dabUpdater) {
+        return KisBrushBasedPaintOp::doAsyncronousUpdate(jobs);
+    }
+
+    return m_dabUpdater->doAsyncronousUpdate(painter(), jobs);
+}
+
 KisSpacingInformation KisFilterOp::paintAt(const KisPaintInformation& info)
 {
     if (!painter()) {
@@ -120,6 +144,51 @@ KisSpacingInformation KisFilterOp::paintAt(const KisPaintInformation& info)
     // Filter the paint device
     QRect neededRect = m_filter->neededRect(dstRect, m_filterConfiguration, painter()->device()->defaultBounds()->currentLevelOfDetail());
 
+    const KisSpacingInformation spacingInfo = effectiveSpacing(scale, rotation, info);
+
+    if (m_dabPipeline) {
+        // the dab cache reuses its device for the next dab
+        KisFixedPaintDeviceSP mask = new KisFixedPaintDevice(*dab);
+
+        KisPaintDeviceSP sourceDevice = source();
+        KisFilterSP filter = m_filter;
+        KisFilterConfigurationSP config = m_filterConfiguration;
+        const qreal opacity = qreal(painter()->opacity()) / 255.0;
+        const qreal flow = qreal(painter()->flow()) / 255.0;
+
+        m_dabPipeline->addDab(
+            [sourceDevice, filter, config, mask, dstRect, neededRect, opacity, flow] () {
+                const QRect dabRect = mask->bounds();
+
+                KisPaintDeviceSP tmpDevice = sourceDevice->createCompositionSourceDevice();
+
+                KisPainter p(tmpDevice);
+                p.setCompositeOp(COMPOSITE_COPY);
+                p.bitBltOldData(neededRect.topLeft() - dstRect.topLeft(), sourceDevice, neededRect);
+
+                KisTransaction transaction(tmpDevice);
+                filter->process(tmpDevice, dabRect, config, 0);
+                transaction.end();
+
+                KisFixedPaintDeviceSP result = new KisFixedPaintDevice(tmpDevice->colorSpace());
+                result->setRect(dstRect);
+                result->lazyGrowBufferWithoutInitialization();
+                tmpDevice->readBytes(result->data(), dabRect);
+
+                tmpDevice->colorSpace()->applyAlphaU8Mask(result->data(), mask->data(),
+                                                          dabRect.width() * dabRect.height());
+
+                KisRenderedDab renderedDab(result);
+                renderedDab.opacity = opacity;
+                renderedDab.flow = flow;
+                return renderedDab;
+            });
+
+        m_dabUpdater->addSpacingSample(spacingInfo.scalarApprox());
+
+        return spacingInfo;
+    }
+
     KisPainter p(m_tmpDevice);
     if (!m_smudgeMode) {
         p.setCompositeOp(COMPOSITE_COPY);
@@ -139,7 +208,7 @@ KisSpacingInformation KisFilterOp::paintAt(const KisPaintInformation& info)
     painter()->renderMirrorMaskSafe(dstRect, m_tmpDevice, 0, 0, dab,
                                     !m_dabCache->needSeparateOriginal());
 
-    return effectiveSpacing(scale, rotation, info);
+    return spacingInfo;
 }
 
 KisSpacingInformation KisFilterOp::updateSpacingImpl(const KisPaintInformation &info) const
@@ -27,10 +27,14 @@
 #include <kis_pressure_size_option.h>
 #include <kis_pressure_rotation_option.h>
 
+#include <QScopedPointer>
+
 class KisFilterConfiguration;
 class KisFilterOpSettings;
 class KisPaintInformation;
 class KisPainter;
+class KisAsyncDabPipeline;
+class KisAsyncDabUpdater;
 
 class KisFilterOp : public KisBrushBasedPaintOp
 {
@@ -40,6 +44,8 @@ public:
     KisFilterOp(const KisPaintOpSettingsSP settings, KisPainter * painter, KisNodeSP node, KisImageSP image);
     ~KisFilterOp() override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs) override;
+
 protected:
 
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
@@ -54,6 +60,9 @@ private:
     KisFilterSP m_filter;
     KisFilterConfigurationSP m_filterConfiguration;
     bool m_smudgeMode;
+
+    QScopedPointer<KisAsyncDabPipeline> m_dabPipeline;
+    QScopedPointer<KisAsyncDabUpdater> m_dabUpdater;
 };
 
 #endif // KIS_FILTEROP_H_
@@ -48,6 +48,16 @@ bool KisFilterOpSettings::paintIncremental()
     return true; // We always paint on the existing data
 }
 
+bool KisFilterOpSettings::needsAsynchronousUpdates() const
+{
+    // the dabs are filtered in parallel only in non-smudge mode,
+    // see KisFilterOp constructor
+    if (getBool(FILTER_SMUDGE_MODE)) return false;
+
+    KisFilterSP filter = KisFilterRegistry::instance()->get(getString(FILTER_ID));
+    return filter && filter->supportsThreading();
+}
+
 KisFilterConfigurationSP KisFilterOpSettings::filterConfig() const
 {
     if (hasProperty(FILTER_ID)) {
@@ -39,6 +39,7 @@ public:
 
     ~KisFilterOpSettings() override;
     bool paintIncremental() override;
+    bool needsAsynchronousUpdates() const override;
 
     KisFilterConfigurationSP filterConfig() const;
 
@@ -18,53 +18,48 @@
 
 #include "bristle.h"
 
-Bristle::Bristle(float x, float y, float length)
-    : m_x(x)
-    , m_y(y)
-    , m_prevX(x)
-    , m_prevY(y)
-    , m_length(length)
-{}
+#include <cstring>
 
-Bristle::~Bristle()
+Bristles::Bristles()
 {
 }
 
-void Bristle::setLength(float length)
+Bristles::~Bristles()
 {
-    m_length = length;
 }
 
-
-void Bristle::addInk(float value)
+void Bristles::reset(int pixelSize)
 {
-    m_inkAmount = m_inkAmount + value;
-}
+    m_pixelSize = pixelSize;
 
-void Bristle::removeInk(float value)
-{
-    m_inkAmount = m_inkAmount - value;
+    x.clear();
+    y.clear();
+    prevX.clear();
+    prevY.clear();
+    length.clear();
+    inkAmount.clear();
+    counter.clear();
+    enabled.clear();
+    colors.clear();
 }
 
-void Bristle::setInkAmount(float inkAmount)
+void Bristles::append(float _x, float _y, float _length, const quint8 *color)
 {
-    if (inkAmount > 1.0f) {
-        inkAmount = 1.0f;
-    }
-    else if (inkAmount < -1.0f) {
-        inkAmount = -1.0f;
-    }
+    x.append(_x);
+    y.append(_y);
+    prevX.append(_x);
+    prevY.append(_y);
+    length.append(_length);
+    inkAmount.append(0.0f);
+    counter.append(0);
+    enabled.append(true);
 
-    m_inkAmount = inkAmount;
+    const int offset = colors.size();
+    colors.resize(offset + m_pixelSize);
+    memcpy(colors.data() + offset, color, m_pixelSize);
 }
 
-void Bristle::setColor(const KoColor &color)
-{
-    m_color = color;
-}
-
-
-void Bristle::setEnabled(bool enabled)
+void Bristles::setInkAmount(int i, float value)
 {
-    m_enabled = enabled;
+    inkAmount[i] = qBound(-1.0f, value, 1.0f);
 }
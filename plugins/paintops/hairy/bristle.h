@@ -19,101 +19,65 @@
 #ifndef _BRISTLE_H_
 #define _BRISTLE_H_
 
-#include <cmath>
-#include <KoColor.h>
+#include <QVector>
+#include <QtGlobal>
 
-class Bristle
+/**
+ * Storage for all the bristles of the hairy brush.
+ *
+ * The bristles are stored as a structure of arrays: every property of
+ * the bristle lives in its own contiguous array, indexed by the number
+ * of the bristle. It lets HairyBrush transform the whole set of bristles
+ * in tight loops, which the compiler can vectorize, instead of chasing
+ * pointers to individually allocated objects.
+ */
+class Bristles
 {
-
 public:
-    Bristle() = default;
-    Bristle(float x, float y, float length);
-    ~Bristle();
-
-    inline float x() const {
-        return m_x;
-    }
-
-    inline float y() const {
-        return m_y;
-    }
-
-    inline float prevX() const {
-        return m_prevX;
-    }
-
-    inline float prevY() const {
-        return m_prevY;
-    }
-
-    inline float length() const {
-        return m_length;
-    }
+    Bristles();
+    ~Bristles();
 
-    inline  const KoColor &color() const {
-        return m_color;
-    }
+    /// sets the size of the color of a single bristle and removes all the bristles
+    void reset(int pixelSize);
 
-    inline int counter() const {
-        return m_counter;
-    }
+    /// adds a new bristle with color \p color of pixelSize() bytes
+    void append(float x, float y, float length, const quint8 *color);
 
-    inline void upIncrement() {
-        m_counter++;
+    inline int size() const {
+        return x.size();
     }
 
-    inline float inkAmount() const {
-        return m_inkAmount;
-    };
-
-    inline float distanceCenter() {
-        return std::sqrt(m_x * m_x + m_y * m_y);
+    inline int pixelSize() const {
+        return m_pixelSize;
     }
 
-    inline void setX(float x) {
-        m_x = x;
-    }
-    inline void setY(float y) {
-        m_y = y;
+    inline const quint8* color(int i) const {
+        return colors.constData() + i * m_pixelSize;
     }
 
-    inline void setPrevX(float prevX) {
-        m_prevX = prevX;
+    inline quint8* color(int i) {
+        return colors.data() + i * m_pixelSize;
     }
 
-    inline void setPrevY(float prevY) {
-        m_prevY = prevY;
-    }
-
-    inline bool enabled() const {
-        return m_enabled;
-    }
+    void setInkAmount(int i, float inkAmount);
 
-    void setLength(float length);
-    void setColor(const KoColor &color);
+public:
+    // coordinates of bristles
+    QVector<float> x;
+    QVector<float> y;
+    QVector<float> prevX;
+    QVector<float> prevY;
+    QVector<float> length; // z - coordinate
+    QVector<float> inkAmount;
 
-    void addInk(float value);
-    void removeInk(float value);
-    void setInkAmount(float inkAmount);
-    void setEnabled(bool enabled);
+    // new dimension in bristle
+    QVector<int> counter;
+    QVector<quint8> enabled;
 
+    QVector<quint8> colors;
 
 private:
-    void init(float x, float y, float length);
-
-    // coordinates of bristle
-    float m_x{0.0f};
-    float m_y{0.0f};
-    float m_prevX{0.0f};
-    float m_prevY{0.0f};
-    float m_length{0.0f}; // z - coordinate
-    KoColor m_color;
-    float m_inkAmount{0.0f};
-
-    // new dimension in bristle
-    int m_counter{0};
-
-    bool m_enabled{true};
+    int m_pixelSize {0};
 };
 
 #endif
@@ -28,14 +28,21 @@
 #include <QVector>
 
 #include <kis_types.h>
-#include <kis_random_accessor_ng.h>
 #include <kis_cross_device_color_picker.h>
 #include <kis_fixed_paint_device.h>
+#include <brushengine/kis_random_source.h>
 
 
 #include <cmath>
 #include <ctime>
 
+/**
+ * The size of the bins the ink splats are sorted into before rendering. The
+ * splats of a bin are rendered together, so the accessed part of the dab
+ * stays in the CPU cache even for huge brushes.
+ */
+static const int SPLAT_BIN_SIZE_SHIFT = 6;
+
 
 HairyBrush::HairyBrush()
 {
@@ -50,8 +57,6 @@ HairyBrush::HairyBrush()
 HairyBrush::~HairyBrush()
 {
     delete m_transfo;
-    qDeleteAll(m_bristles.begin(), m_bristles.end());
-    m_bristles.clear();
 }
 
 
@@ -59,6 +64,7 @@ void HairyBrush::initAndCache()
 {
     m_compositeOp = m_dab->colorSpace()->compositeOp(COMPOSITE_OVER);
     m_pixelSize = m_dab->colorSpace()->pixelSize();
+    m_tempPixel.resize(m_pixelSize);
 
     if (m_properties->useSaturation) {
         m_transfo = m_dab->colorSpace()->createColorTransformation("hsv_adjustment", m_params);
@@ -77,27 +83,23 @@ void HairyBrush::fromDabWithDensity(KisFixedPaintDeviceSP dab, qreal density)
     int centerY = height * 0.5;
 
     // make mask
-    Bristle * bristle = 0;
     qreal alpha;
 
     quint8 * dabPointer = dab->data();
     quint8 pixelSize = dab->pixelSize();
     const KoColorSpace * cs = dab->colorSpace();
-    KoColor bristleColor(cs);
 
     KisRandomSource randomSource(0);
 
+    m_bristles.reset(pixelSize);
+
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
             alpha =  cs->opacityF(dabPointer);
             if (alpha != 0.0) {
                 if (density == 1.0 || randomSource.generateNormalized() <= density) {
-                    memcpy(bristleColor.data(), dabPointer, pixelSize);
-
-                    bristle = new Bristle(x - centerX, y - centerY, alpha); // using value from image as length of bristle
-                    bristle->setColor(bristleColor);
-
-                    m_bristles.append(bristle);
+                    // using value from image as length of bristle
+                    m_bristles.append(x - centerX, y - centerY, alpha, dabPointer);
                 }
             }
             dabPointer += pixelSize;
@@ -105,8 +107,86 @@ void HairyBrush::fromDabWithDensity(KisFixedPaintDeviceSP dab, qreal density)
     }
 }
 
+void HairyBrush::transformBristles(KisRandomSourceSP randomSource,
+                                   qreal x1, qreal y1, qreal x2, qreal y2,
+                                   qreal scale, qreal angle, qreal shear)
+{
+    const int bristleCount = m_bristles.size();
+
+    m_randomX.resize(bristleCount);
+    m_randomY.resize(bristleCount);
+    m_pathStartX.resize(bristleCount);
+    m_pathStartY.resize(bristleCount);
+    m_pathEndX.resize(bristleCount);
+    m_pathEndY.resize(bristleCount);
+
+    /**
+     * The random source must be consumed in exactly the same order as
+     * before, so the random offsets are generated in a separate pass.
+     */
+    for (int i = 0; i < bristleCount; i++) {
+        if (!m_bristles.enabled[i]) {
+            m_randomX[i] = 0.0;
+            m_randomY[i] = 0.0;
+            continue;
+        }
+
+        m_randomX[i] = (randomSource->generateNormalized() * 2 - 1.0) * m_properties->randomFactor;
+        m_randomY[i] = (randomSource->generateNormalized() * 2 - 1.0) * m_properties->randomFactor;
+    }
+
+    /**
+     * The transformation is equivalent to:
+     *
+     *     QTransform t;
+     *     t.rotateRadians(-angle);
+     *     t.scale(scale, scale);
+     *     t.translate(randomX, randomY);
+     *     t.shear(shear, shear);
+     *
+     * but is unrolled manually to let the compiler vectorize the loop
+     * over all the bristles.
+     */
+    const qreal cosA = std::cos(-angle) * scale;
+    const qreal sinA = std::sin(-angle) * scale;
+    const bool continuePath = !firstStroke() && m_properties->connectedPath;
+
+    const float *bristleX = m_bristles.x.constData();
+    const float *bristleY = m_bristles.y.constData();
+    const quint8 *enabled = m_bristles.enabled.constData();
+    float *prevX = m_bristles.prevX.data();
+    float *prevY = m_bristles.prevY.data();
+    const qreal *randomX = m_randomX.constData();
+    const qreal *randomY = m_randomY.constData();
+    qreal *startX = m_pathStartX.data();
+    qreal *startY = m_pathStartY.data();
+    qreal *endX = m_pathEndX.data();
+    qreal *endY = m_pathEndY.data();
+
+    for (int i = 0; i < bristleCount; i++) {
+        const qreal sx = bristleX[i] + shear * bristleY[i] + randomX[i];
+        const qreal sy = shear * bristleX[i] + bristleY[i] + randomY[i];
+
+        const qreal fx2 = cosA * sx - sinA * sy;
+        const qreal fy2 = sinA * sx + cosA * sy;
+
+        // continue the path of the bristle from the previous position
+        const qreal fx1 = continuePath ? qreal(prevX[i]) : fx2;
+        const qreal fy1 = continuePath ? qreal(prevY[i]) : fy2;
+
+        // remember the end point
+        prevX[i] = enabled[i] ? float(fx2) : prevX[i];
+        prevY[i] = enabled[i] ? float(fy2) : prevY[i];
+
+        // all coords relative to device position
+        startX[i] = fx1 + x1;
+        startY[i] = fy1 + y1;
+        endX[i] = fx2 + x2;
+        endY[i] = fy2 + y2;
+    }
+}
 
-void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const KisPaintInformation &pi1, const KisPaintInformation &pi2, qreal scale, qreal rotation)
+QRect HairyBrush::paintLine(KisFixedPaintDeviceSP dab, KisPaintDeviceSP layer, const KisPaintInformation &pi1, const KisPaintInformation &pi2, qreal scale, qreal rotation)
 {
     m_counter++;
 
@@ -133,11 +213,8 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
     // this pressure controls shear and ink depletion
     qreal pressure = mousePressure * (pi2.pressure() * 2);
 
-    Bristle *bristle = 0;
     KoColor bristleColor(dab->colorSpace());
 
-    m_dabAccessor = dab->createRandomAccessorNG((int)x1, (int)y1);
-
     m_dab = dab;
 
     // initialization block
@@ -157,11 +234,12 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
         }
     }
 
-    KisRandomSourceSP randomSource = pi2.randomSource();
+    transformBristles(pi2.randomSource(), x1, y1, x2, y2,
+                      scale, angle, pressure * m_properties->shearFactor);
 
-    qreal fx1, fy1, fx2, fy2;
-    qreal randomX, randomY;
-    qreal shear;
+    m_splats.clear();
+    m_splatColors.clear();
+    m_splatBounds = QRect();
 
     float inkDeplation = 0.0;
     int inkDepletionSize = m_properties->inkDepletionCurve.size();
@@ -170,107 +248,82 @@ void HairyBrush::paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const K
     qreal threshold = 1.0 - pi2.pressure();
     for (int i = 0; i < bristleCount; i++) {
 
-        if (!m_bristles.at(i)->enabled()) continue;
-        bristle = m_bristles[i];
+        if (!m_bristles.enabled[i]) continue;
+        if (m_properties->threshold && (m_bristles.length[i] < threshold)) continue;
 
-        randomX = (randomSource->generateNormalized() * 2 - 1.0) * m_properties->randomFactor;
-        randomY = (randomSource->generateNormalized() * 2 - 1.0) * m_properties->randomFactor;
-
-        shear = pressure * m_properties->shearFactor;
-
-        m_transform.reset();
-        m_transform.rotateRadians(-angle);
-        m_transform.scale(scale, scale);
-        m_transform.translate(randomX, randomY);
-        m_transform.shear(shear, shear);
-
-        if (firstStroke() || (!m_properties->connectedPath)) {
-            // transform start dab
-            m_transform.map(bristle->x(), bristle->y(), &fx1, &fy1);
-            // transform end dab
-            m_transform.map(bristle->x(), bristle->y(), &fx2, &fy2);
-        }
-        else {
-            // continue the path of the bristle from the previous position
-            fx1 = bristle->prevX();
-            fy1 = bristle->prevY();
-            m_transform.map(bristle->x(), bristle->y(), &fx2, &fy2);
-        }
-        // remember the end point
-        bristle->setPrevX(fx2);
-        bristle->setPrevY(fy2);
-
-        // all coords relative to device position
-        fx1 += x1;
-        fy1 += y1;
-
-        fx2 += x2;
-        fy2 += y2;
-
-        if (m_properties->threshold && (bristle->length() < threshold)) continue;
         // paint between first and last dab
-        const QVector<QPointF> bristlePath = m_trajectory.getLinearTrajectory(QPointF(fx1, fy1), QPointF(fx2, fy2), 1.0);
+        const QVector<QPointF> &bristlePath =
+            m_trajectory.getLinearTrajectory(QPointF(m_pathStartX[i], m_pathStartY[i]),
+                                             QPointF(m_pathEndX[i], m_pathEndY[i]), 1.0);
         bristlePathSize = m_trajectory.size();
 
-        memcpy(bristleColor.data(), bristle->color().data() , m_pixelSize);
-        for (int i = 0; i < bristlePathSize ; i++) {
+        memcpy(bristleColor.data(), m_bristles.color(i), m_pixelSize);
+        for (int j = 0; j < bristlePathSize ; j++) {
 
             if (m_properties->inkDepletionEnabled) {
-                inkDeplation = fetchInkDepletion(bristle, inkDepletionSize);
+                inkDeplation = fetchInkDepletion(i, inkDepletionSize);
 
                 if (m_properties->useSaturation && m_transfo != 0) {
-                    saturationDepletion(bristle, bristleColor, pressure, inkDeplation);
+                    saturationDepletion(i, bristleColor, pressure, inkDeplation);
                 }
 
                 if (m_properties->useOpacity) {
-                    opacityDepletion(bristle, bristleColor, pressure, inkDeplation);
+                    opacityDepletion(i, bristleColor, pressure, inkDeplation);
                 }
 
             }
             else {
                 if (bristleColor.opacityU8() != 0) {
-                    bristleColor.setOpacity(bristle->length());
+                    bristleColor.setOpacity(m_bristles.length[i]);
                 }
             }
 
-            addBristleInk(bristle, bristlePath.at(i), bristleColor);
-            bristle->setInkAmount(1.0 - inkDeplation);
-            bristle->upIncrement();
+            addBristleInk(bristlePath.at(j), bristleColor);
+            m_bristles.setInkAmount(i, 1.0 - inkDeplation);
+            m_bristles.counter[i]++;
         }
 
     }
+
+    const QRect dabRect = m_splatBounds;
+
+    if (!dabRect.isEmpty()) {
+        renderSplats(dab, dabRect);
+    }
+
     m_dab = 0;
-    m_dabAccessor = 0;
+
+    return dabRect;
 }
 
 
-inline qreal HairyBrush::fetchInkDepletion(Bristle* bristle, int inkDepletionSize)
+inline qreal HairyBrush::fetchInkDepletion(int bristle, int inkDepletionSize)
 {
-    if (bristle->counter() >= inkDepletionSize - 1) {
+    if (m_bristles.counter[bristle] >= inkDepletionSize - 1) {
         return m_properties->inkDepletionCurve[inkDepletionSize - 1];
     } else {
-        return m_properties->inkDepletionCurve[bristle->counter()];
+        return m_properties->inkDepletionCurve[m_bristles.counter[bristle]];
     }
 }
 
 
-void HairyBrush::saturationDepletion(Bristle * bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation)
+void HairyBrush::saturationDepletion(int bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation)
 {
     qreal saturation;
     if (m_properties->useWeights) {
         // new weighted way (experiment)
         saturation = (
                          (pressure * m_properties->pressureWeight) +
-                         (bristle->length() * m_properties->bristleLengthWeight) +
-                         (bristle->inkAmount() * m_properties->bristleInkAmountWeight) +
+                         (m_bristles.length[bristle] * m_properties->bristleLengthWeight) +
+                         (m_bristles.inkAmount[bristle] * m_properties->bristleInkAmountWeight) +
                          ((1.0 - inkDeplation) * m_properties->inkDepletionWeight)) - 1.0;
     }
     else {
         // old way of computing saturation
         saturation = (
                          pressure *
-                         bristle->length() *
-                         bristle->inkAmount() *
+                         m_bristles.length[bristle] *
+                         m_bristles.inkAmount[bristle] *
                          (1.0 - inkDeplation)) - 1.0;
 
     }
@@ -282,127 +335,145 @@ void HairyBrush::saturationDepletion(Bristle * bristle, KoColor &bristleColor, q
     m_transfo->transform(bristleColor.data(), bristleColor.data() , 1);
 }
 
-void HairyBrush::opacityDepletion(Bristle* bristle, KoColor& bristleColor, qreal pressure, qreal inkDeplation)
+void HairyBrush::opacityDepletion(int bristle, KoColor& bristleColor, qreal pressure, qreal inkDeplation)
 {
     qreal opacity = OPACITY_OPAQUE_F;
     if (m_properties->useWeights) {
         opacity = pressure * m_properties->pressureWeight +
-                  bristle->length() * m_properties->bristleLengthWeight +
-                  bristle->inkAmount() * m_properties->bristleInkAmountWeight +
+                  m_bristles.length[bristle] * m_properties->bristleLengthWeight +
+                  m_bristles.inkAmount[bristle] * m_properties->bristleInkAmountWeight +
                   (1.0 - inkDeplation) * m_properties->inkDepletionWeight;
     }
     else {
         opacity =
-            bristle->length() *
-            bristle->inkAmount();
+            m_bristles.length[bristle] *
+            m_bristles.inkAmount[bristle];
     }
 
     opacity = qBound(0.0, opacity, 1.0);
     bristleColor.setOpacity(opacity);
 }
 
-inline void HairyBrush::addBristleInk(Bristle *bristle,const QPointF &pos, const KoColor &color)
+inline void HairyBrush::addSplat(int x, int y, int colorOffset, quint8 opacity)
 {
-    Q_UNUSED(bristle);
-    if (m_properties->antialias) {
-        if (m_properties->useCompositing) {
-            paintParticle(pos, color);
-        } else {
-            paintParticle(pos, color, 1.0);
-        }
-    }
-    else {
-        int ix = qRound(pos.x());
-        int iy = qRound(pos.y());
-        if (m_properties->useCompositing) {
-            plotPixel(ix, iy, color);
-        }
-        else {
-            darkenPixel(ix, iy, color);
-        }
-    }
+    InkSplat splat;
+    splat.x = x;
+    splat.y = y;
+    splat.colorOffset = colorOffset;
+    splat.opacity = opacity;
+    m_splats.append(splat);
+
+    m_splatBounds |= QRect(x, y, 1, 1);
 }
 
-void HairyBrush::paintParticle(QPointF pos, const KoColor& color, qreal weight)
+inline void HairyBrush::addBristleInk(const QPointF &pos, const KoColor &color)
 {
-    // opacity top left, right, bottom left, right
-    quint8 opacity = color.opacityU8();
-    opacity *= weight;
-
-    int ipx = int (pos.x());
-    int ipy = int (pos.y());
-    qreal fx = pos.x() - ipx;
-    qreal fy = pos.y() - ipy;
-
-    quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity);
-    quint8 btr = qRound((fx)  * (1.0 - fy) * opacity);
-    quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
-    quint8 bbr = qRound((fx)  * (fy)  * opacity);
+    const int colorOffset = m_splatColors.size();
+    m_splatColors.resize(colorOffset + m_pixelSize);
+    memcpy(m_splatColors.data() + colorOffset, color.data(), m_pixelSize);
 
-    const KoColorSpace * cs = m_dab->colorSpace();
+    const quint8 opacity = color.opacityU8();
 
-    m_dabAccessor->moveTo(ipx  , ipy);
-    btl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy);
-    btr =  quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, btr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), btr, 1);
-
-    m_dabAccessor->moveTo(ipx, ipy + 1);
-    bbl = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbl + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbl, 1);
-
-    m_dabAccessor->moveTo(ipx + 1, ipy + 1);
-    bbr = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, bbr + cs->opacityU8(m_dabAccessor->rawData()), OPACITY_OPAQUE_U8));
-    memcpy(m_dabAccessor->rawData(), color.data(), cs->pixelSize());
-    cs->setOpacity(m_dabAccessor->rawData(), bbr, 1);
+    if (m_properties->antialias) {
+        // opacity top left, right, bottom left, right
+        int ipx = int (pos.x());
+        int ipy = int (pos.y());
+        qreal fx = pos.x() - ipx;
+        qreal fy = pos.y() - ipy;
+
+        quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity);
+        quint8 btr = qRound((fx)  * (1.0 - fy) * opacity);
+        quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
+        quint8 bbr = qRound((fx)  * (fy)  * opacity);
+
+        addSplat(ipx    , ipy    , colorOffset, btl);
+        addSplat(ipx + 1, ipy    , colorOffset, btr);
+        addSplat(ipx    , ipy + 1, colorOffset, bbl);
+        addSplat(ipx + 1, ipy + 1, colorOffset, bbr);
+    }
+    else {
+        addSplat(qRound(pos.x()), qRound(pos.y()), colorOffset, opacity);
+    }
 }
 
-void HairyBrush::paintParticle(QPointF pos, const KoColor& color)
+void HairyBrush::renderSplats(KisFixedPaintDeviceSP dab, const QRect &dabRect)
 {
-    // opacity top left, right, bottom left, right
-    memcpy(m_color.data(), color.data(), m_pixelSize);
-    quint8 opacity = color.opacityU8();
+    dab->setRect(QRect(QPoint(), dabRect.size()));
+    dab->lazyGrowBufferWithoutInitialization();
+    memset(dab->data(), 0, dabRect.width() * dabRect.height() * m_pixelSize);
+
+    /**
+     * Sort the splats into bins with a stable counting sort. The order of
+     * the splats inside every bin is preserved, so the overlapping ink is
+     * composited in exactly the same order as the bristles deposit it.
+     */
+    const int numBinsX = ((dabRect.width() - 1) >> SPLAT_BIN_SIZE_SHIFT) + 1;
+    const int numBinsY = ((dabRect.height() - 1) >> SPLAT_BIN_SIZE_SHIFT) + 1;
+
+    QVector<int> binOffsets(numBinsX * numBinsY + 1, 0);
+
+    auto binIndex = [&] (const InkSplat &splat) {
+        return ((splat.y - dabRect.y()) >> SPLAT_BIN_SIZE_SHIFT) * numBinsX +
+                ((splat.x - dabRect.x()) >> SPLAT_BIN_SIZE_SHIFT);
+    };
+
+    Q_FOREACH (const InkSplat &splat, m_splats) {
+        binOffsets[binIndex(splat) + 1]++;
+    }
 
-    int ipx = int (pos.x());
-    int ipy = int (pos.y());
-    qreal fx = pos.x() - ipx;
-    qreal fy = pos.y() - ipy;
+    for (int i = 1; i < binOffsets.size(); i++) {
+        binOffsets[i] += binOffsets[i - 1];
+    }
 
-    quint8 btl = qRound((1.0 - fx) * (1.0 - fy) * opacity);
-    quint8 btr = qRound((fx)  * (1.0 - fy) * opacity);
-    quint8 bbl = qRound((1.0 - fx) * (fy)  * opacity);
-    quint8 bbr = qRound((fx)  * (fy)  * opacity);
+    m_sortedSplats.resize(m_splats.size());
+    Q_FOREACH (const InkSplat &splat, m_splats) {
+        m_sortedSplats[binOffsets[binIndex(splat)]++] = splat;
+    }
 
-    m_color.setOpacity(btl);
-    plotPixel(ipx  , ipy, m_color);
+    quint8 *dabData = dab->data();
+    const int dabRowStride = dabRect.width() * m_pixelSize;
+    const quint8 *colors = m_splatColors.constData();
 
-    m_color.setOpacity(btr);
-    plotPixel(ipx + 1  , ipy, m_color);
+    Q_FOREACH (const InkSplat &splat, m_sortedSplats) {
+        quint8 *dst = dabData +
+            (splat.y - dabRect.y()) * dabRowStride +
+            (splat.x - dabRect.x()) * m_pixelSize;
 
-    m_color.setOpacity(bbl);
-    plotPixel(ipx  , ipy + 1, m_color);
+        const quint8 *color = colors + splat.colorOffset;
 
-    m_color.setOpacity(bbr);
-    plotPixel(ipx + 1 , ipy + 1, m_color);
+        if (m_properties->useCompositing) {
+            if (m_properties->antialias) {
+                memcpy(m_tempPixel.data(), color, m_pixelSize);
+                m_dab->colorSpace()->setOpacity(m_tempPixel.data(), splat.opacity, 1);
+                color = m_tempPixel.data();
+            }
+            plotPixel(dst, color);
+        } else if (m_properties->antialias) {
+            addParticleOpacity(dst, color, splat.opacity);
+        } else {
+            darkenPixel(dst, color, splat.opacity);
+        }
+    }
 }
 
+inline void HairyBrush::addParticleOpacity(quint8 *dst, const quint8 *color, quint8 opacity)
+{
+    const KoColorSpace * cs = m_dab->colorSpace();
+
+    opacity = quint8(qBound<quint16>(OPACITY_TRANSPARENT_U8, opacity + cs->opacityU8(dst), OPACITY_OPAQUE_U8));
+    memcpy(dst, color, m_pixelSize);
+    cs->setOpacity(dst, opacity, 1);
+}
 
-inline void HairyBrush::plotPixel(int wx, int wy, const KoColor &color)
+inline void HairyBrush::plotPixel(quint8 *dst, const quint8 *color)
 {
-    m_dabAccessor->moveTo(wx, wy);
-    m_compositeOp->composite(m_dabAccessor->rawData(), m_pixelSize, color.data() , m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
+    m_compositeOp->composite(dst, m_pixelSize, color, m_pixelSize, 0, 0, 1, 1, OPACITY_OPAQUE_U8);
 }
 
-inline void HairyBrush::darkenPixel(int wx, int wy, const KoColor &color)
+inline void HairyBrush::darkenPixel(quint8 *dst, const quint8 *color, quint8 opacity)
 {
-    m_dabAccessor->moveTo(wx, wy);
-    if (m_dab->colorSpace()->opacityU8(m_dabAccessor->rawData()) < color.opacityU8()) {
-        memcpy(m_dabAccessor->rawData(), color.data(), m_pixelSize);
+    if (m_dab->colorSpace()->opacityU8(dst) < opacity) {
+        memcpy(dst, color, m_pixelSize);
     }
 }
 
@@ -428,15 +499,12 @@ void HairyBrush::colorifyBristles(KisPaintDeviceSP source, QPointF point)
     KoColor bristleColor(m_dab->colorSpace());
     KisCrossDeviceColorPickerInt colorPicker(source, bristleColor);
 
-    Bristle *b = 0;
     int size = m_bristles.size();
     for (int i = 0; i < size; i++) {
-        b = m_bristles[i];
-        int x = qRound(b->x() + point.x());
-        int y = qRound(b->y() + point.y());
+        int x = qRound(m_bristles.x[i] + point.x());
+        int y = qRound(m_bristles.y[i] + point.y());
 
-        colorPicker.pickOldColor(x, y, bristleColor.data());
-        b->setColor(bristleColor);
+        colorPicker.pickOldColor(x, y, m_bristles.color(i));
     }
 
 }
@@ -29,8 +29,8 @@
 #include "bristle.h"
 
 #include <kis_paint_device.h>
+#include <kis_fixed_paint_device.h>
 #include <brushengine/kis_paint_information.h>
-#include <kis_random_accessor_ng.h>
 
 class KoCompositeOp;
 
@@ -73,7 +73,14 @@ public:
     HairyBrush();
     ~HairyBrush();
 
-    void paintLine(KisPaintDeviceSP dab, KisPaintDeviceSP layer, const KisPaintInformation &pi1, const KisPaintInformation &pi2, qreal scale, qreal rotation);
+    /**
+     * Paints the bristles between \p pi1 and \p pi2 into \p dab. The
+     * dab is resized to fit all the painted pixels and its origin is
+     * moved to (0, 0).
+     *
+     * @return the position of the dab in \p layer coordinates
+     */
+    QRect paintLine(KisFixedPaintDeviceSP dab, KisPaintDeviceSP layer, const KisPaintInformation &pi1, const KisPaintInformation &pi2, qreal scale, qreal rotation);
     /// set ink color for the whole bristle shape
     void setInkColor(const KoColor &color) {
         m_color = color;
@@ -86,46 +93,74 @@ public:
     void fromDabWithDensity(KisFixedPaintDeviceSP dab, qreal density);
 
 private:
-    /// paints single bristle
-    void addBristleInk(Bristle *bristle,const QPointF &pos, const KoColor &color);
+    /**
+     * A single pixel of ink deposited by a bristle. The splats are collected
+     * for the whole line first, and then rendered into the dab tile-by-tile.
+     */
+    struct InkSplat {
+        int x;
+        int y;
+        int colorOffset;
+        quint8 opacity;
+    };
+
+    /// generates the splats of a single bristle at position \p pos
+    void addBristleInk(const QPointF &pos, const KoColor &color);
+    /// adds a single splat and updates the bounds of the painted area
+    void addSplat(int x, int y, int colorOffset, quint8 opacity);
+    /// renders all the collected splats into \p dab located at \p dabRect
+    void renderSplats(KisFixedPaintDeviceSP dab, const QRect &dabRect);
     /// composite single pixel to dab
-    void plotPixel(int wx, int wy, const KoColor &color);
+    void plotPixel(quint8 *dst, const quint8 *color);
     /// check the opacity of dab pixel and if the opacity is less then color, it will copy color to dab
-    void darkenPixel(int wx, int wy, const KoColor &color);
+    void darkenPixel(quint8 *dst, const quint8 *color, quint8 opacity);
     /// paint wu particle by copying the color and setup just the opacity, weight is complementary to opacity of the color
-    void paintParticle(QPointF pos, const KoColor& color, qreal weight);
-    /// paint wu particle using composite operation
-    void paintParticle(QPointF pos, const KoColor& color);
+    void addParticleOpacity(quint8 *dst, const quint8 *color, quint8 opacity);
     /// similar to sample input color in spray
     void colorifyBristles(KisPaintDeviceSP source, QPointF point);
 
-    void repositionBristles(double angle, double slope);
+    /// transforms all the bristles and writes the start and end points of their paths
+    void transformBristles(KisRandomSourceSP randomSource, qreal x1, qreal y1, qreal x2, qreal y2,
+                           qreal scale, qreal angle, qreal shear);
     /// compute mouse pressure according distance
     double computeMousePressure(double distance);
 
     /// simulate running out of saturation
-    void saturationDepletion(Bristle * bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation);
+    void saturationDepletion(int bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation);
     /// simulate running out of ink through opacity decreasing
-    void opacityDepletion(Bristle * bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation);
+    void opacityDepletion(int bristle, KoColor &bristleColor, qreal pressure, qreal inkDeplation);
     /// fetch actual ink status according depletion curve
-    qreal fetchInkDepletion(Bristle * bristle, int inkDepletionSize);
+    qreal fetchInkDepletion(int bristle, int inkDepletionSize);
 
     void initAndCache();
 
 private:
     const KisHairyProperties * m_properties;
 
-    QVector<Bristle*> m_bristles;
-    QTransform m_transform;
+    Bristles m_bristles;
+
+    // the paths of the bristles in the current line
+    QVector<qreal> m_randomX;
+    QVector<qreal> m_randomY;
+    QVector<qreal> m_pathStartX;
+    QVector<qreal> m_pathStartY;
+    QVector<qreal> m_pathEndX;
+    QVector<qreal> m_pathEndY;
+
+    // ink deposited in the current line
+    QVector<InkSplat> m_splats;
+    QVector<InkSplat> m_sortedSplats;
+    QVector<quint8> m_splatColors;
+    QRect m_splatBounds;
 
     // used for interpolation the path of bristles
     Trajectory m_trajectory;
     QHash<QString, QVariant> m_params;
     // temporary device
-    KisPaintDeviceSP m_dab;
-    KisRandomAccessorSP m_dabAccessor;
+    KisFixedPaintDeviceSP m_dab;
     const KoCompositeOp * m_compositeOp;
     quint32 m_pixelSize;
+    QVector<quint8> m_tempPixel;
 
     int m_counter;
 
@@ -125,10 +125,7 @@ void KisHairyPaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
     if (!painter()) return;
 
     if (!m_dab) {
-        m_dab = source()->createCompositionSourceDevice();
-    }
-    else {
-        m_dab->clear();
+        m_dab = new KisFixedPaintDevice(source()->compositionSourceColorSpace());
     }
 
     /**
@@ -151,12 +148,12 @@ void KisHairyPaintOp::paintLine(const KisPaintInformation &pi1, const KisPaintIn
     // during initialization), so we should just skip the distance info
     // update
 
-    m_brush.paintLine(m_dab, m_dev, pi1, pi, scale * m_properties.scaleFactor, rotation);
+    const QRect rc = m_brush.paintLine(m_dab, m_dev, pi1, pi, scale * m_properties.scaleFactor, rotation);
 
-    //QRect rc = m_dab->exactBounds();
-    QRect rc = m_dab->extent();
-    painter()->bitBlt(rc.topLeft(), m_dab, rc);
-    painter()->renderMirrorMask(rc, m_dab);
+    if (!rc.isEmpty()) {
+        painter()->bltFixed(rc.topLeft(), m_dab, m_dab->bounds());
+        painter()->renderMirrorMask(rc, m_dab);
+    }
     painter()->setOpacity(origOpacity);
 
     // we don't use spacing in hairy brush, but history is
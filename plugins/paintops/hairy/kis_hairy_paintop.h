@@ -50,7 +50,7 @@ protected:
 private:
     KisHairyProperties m_properties;
 
-    KisPaintDeviceSP m_dab;
+    KisFixedPaintDeviceSP m_dab;
     KisPaintDeviceSP m_dev;
     HairyBrush m_brush;
     KisPressureRotationOption m_rotationOption;
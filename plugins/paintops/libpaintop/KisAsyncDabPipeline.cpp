@@ -0,0 +1,167 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisAsyncDabPipeline.h"
+
+#include <QHash>
+#include <QElapsedTimer>
+#include <limits>
+
+#include <kis_painter.h>
+#include <KisRenderedDab.h>
+#include <KisRunnableStrokeJobsInterface.h>
+#include <KisRollingMeanAccumulatorWrapper.h>
+#include <tool/strokes/FreehandStrokeRunnableJobDataWithUpdate.h>
+#include "kis_algebra_2d.h"
+
+
+struct KisAsyncDabPipeline::Private
+{
+    Private(KisRunnableStrokeJobsInterface *_runnableJobsInterface)
+        : runnableJobsInterface(_runnableJobsInterface),
+          avgExecutionTime(50),
+          avgDabSize(50)
+    {
+    }
+
+    KisRunnableStrokeJobsInterface *runnableJobsInterface;
+
+    QMutex mutex;
+    int nextSeqNo = 0;
+    int nextDabToTake = 0;
+    QHash<int, KisRenderedDab> readyDabs;
+    qreal averageOpacity = 0.0;
+
+    KisRollingMeanAccumulatorWrapper avgExecutionTime;
+    KisRollingMeanAccumulatorWrapper avgDabSize;
+
+    void skipEmptyDabs();
+    bool hasPreparedDabsImpl() const;
+};
+
+void KisAsyncDabPipeline::Private::skipEmptyDabs()
+{
+    auto it = readyDabs.find(nextDabToTake);
+
+    while (it != readyDabs.end() && !it->device) {
+        readyDabs.erase(it);
+        nextDabToTake++;
+        it = readyDabs.find(nextDabToTake);
+    }
+}
+
+bool KisAsyncDabPipeline::Private::hasPreparedDabsImpl() const
+{
+    return readyDabs.contains(nextDabToTake);
+}
+
+KisAsyncDabPipeline::KisAsyncDabPipeline(KisRunnableStrokeJobsInterface *runnableJobsInterface)
+    : m_d(new Private(runnableJobsInterface))
+{
+}
+
+KisAsyncDabPipeline::~KisAsyncDabPipeline()
+{
+}
+
+void KisAsyncDabPipeline::addDab(RenderFunc func)
+{
+    int seqNo = 0;
+
+    {
+        QMutexLocker l(&m_d->mutex);
+        seqNo = m_d->nextSeqNo++;
+    }
+
+    Private *d = m_d.data();
+
+    m_d->runnableJobsInterface->addRunnableJob(
+        new FreehandStrokeRunnableJobDataWithUpdate(
+            [d, seqNo, func] () {
+                QElapsedTimer timer;
+                timer.start();
+
+                const KisRenderedDab dab = func();
+                const int usecsTime = timer.nsecsElapsed() / 1000;
+
+                QMutexLocker l(&d->mutex);
+                d->readyDabs.insert(seqNo, dab);
+                d->skipEmptyDabs();
+
+                d->avgExecutionTime(usecsTime);
+                if (dab.device) {
+                    d->avgDabSize(KisAlgebra2D::maxDimension(dab.realBounds()));
+                }
+            },
+            KisStrokeJobData::CONCURRENT));
+}
+
+QList<KisRenderedDab> KisAsyncDabPipeline::takeReadyDabs(bool returnMutableDabs,
+                                                         int oneTimeLimit,
+                                                         bool *someDabsLeft)
+{
+    // every rendering function creates its own device, so the
+    // dabs are always mutable
+    Q_UNUSED(returnMutableDabs);
+
+    QMutexLocker l(&m_d->mutex);
+
+    QList<KisRenderedDab> renderedDabs;
+
+    if (oneTimeLimit < 0) {
+        oneTimeLimit = std::numeric_limits<int>::max();
+    }
+
+    while (oneTimeLimit > 0 && m_d->hasPreparedDabsImpl()) {
+        KisRenderedDab dab = m_d->readyDabs.take(m_d->nextDabToTake);
+        m_d->nextDabToTake++;
+
+        m_d->averageOpacity = KisPainter::blendAverageOpacity(dab.opacity, m_d->averageOpacity);
+        dab.averageOpacity = m_d->averageOpacity;
+
+        renderedDabs.append(dab);
+        oneTimeLimit--;
+
+        m_d->skipEmptyDabs();
+    }
+
+    if (someDabsLeft) {
+        *someDabsLeft = m_d->hasPreparedDabsImpl();
+    }
+
+    return renderedDabs;
+}
+
+bool KisAsyncDabPipeline::hasPreparedDabs() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->hasPreparedDabsImpl();
+}
+
+qreal KisAsyncDabPipeline::averageDabRenderingTime() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->avgExecutionTime.rollingMean() / 1000.0;
+}
+
+int KisAsyncDabPipeline::averageDabSize() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return qRound(m_d->avgDabSize.rollingMean());
+}
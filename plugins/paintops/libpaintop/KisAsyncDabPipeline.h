@@ -0,0 +1,126 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef KISASYNCDABPIPELINE_H
+#define KISASYNCDABPIPELINE_H
+
+#include "kritapaintop_export.h"
+
+#include <QScopedPointer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+#include <functional>
+
+#include <KisRenderedDab.h>
+#include "KisAsyncDabSource.h"
+
+class KisRunnableStrokeJobsInterface;
+
+
+/**
+ * A generic asynchronous dab pipeline for the paintops whose dabs do not
+ * depend on each other.
+ *
+ * The paintop calculates all the dynamics in paintAt() and passes a
+ * rendering function to addDab(). The function is executed in a
+ * concurrent stroke job and the resulting dabs are given out to
+ * KisAsyncDabUpdater strictly in the order they were added.
+ *
+ * When the pipeline is used outside a stroke (e.g. in unittests), the
+ * rendering function is executed immediately by the fake jobs executor.
+ */
+class PAINTOP_EXPORT KisAsyncDabPipeline : public KisAsyncDabSource
+{
+public:
+    /**
+     * Renders a dab. The function is called from a background thread,
+     * so it must not access any paintop state that is modified by
+     * paintAt(). It may return a dab with null device if there is
+     * nothing to paint. The device of the dab must not be shared
+     * with any other dab.
+     */
+    typedef std::function<KisRenderedDab()> RenderFunc;
+
+public:
+    KisAsyncDabPipeline(KisRunnableStrokeJobsInterface *runnableJobsInterface);
+    ~KisAsyncDabPipeline() override;
+
+    void addDab(RenderFunc func);
+
+    QList<KisRenderedDab> takeReadyDabs(bool returnMutableDabs = false, int oneTimeLimit = -1, bool *someDabsLeft = 0) override;
+
+    bool hasPreparedDabs() const override;
+
+    qreal averageDabRenderingTime() const override; // msecs
+    int averageDabSize() const override;
+
+private:
+    Q_DISABLE_COPY(KisAsyncDabPipeline)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+/**
+ * A thread-safe pool of per-thread rendering resources for the rendering
+ * functions of KisAsyncDabPipeline. New resources are created by the
+ * factory only when all the existing ones are busy.
+ */
+template <class T>
+class KisAsyncDabResourcesPool
+{
+public:
+    typedef std::function<T*()> ResourcesFactory;
+
+public:
+    KisAsyncDabResourcesPool(ResourcesFactory factory)
+        : m_factory(factory)
+    {
+    }
+
+    ~KisAsyncDabResourcesPool() {
+        qDeleteAll(m_resources);
+    }
+
+    T* fetch() {
+        {
+            QMutexLocker l(&m_mutex);
+            if (!m_resources.isEmpty()) {
+                return m_resources.takeLast();
+            }
+        }
+
+        return m_factory();
+    }
+
+    void put(T *resources) {
+        QMutexLocker l(&m_mutex);
+        m_resources.append(resources);
+    }
+
+private:
+    Q_DISABLE_COPY(KisAsyncDabResourcesPool)
+
+    ResourcesFactory m_factory;
+    QMutex m_mutex;
+    QVector<T*> m_resources;
+};
+
+#endif // KISASYNCDABPIPELINE_H
@@ -0,0 +1,59 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef KISASYNCDABSOURCE_H
+#define KISASYNCDABSOURCE_H
+
+#include <QList>
+
+struct KisRenderedDab;
+
+/**
+ * An interface of an object that renders dabs in background threads
+ * and lets KisAsyncDabUpdater fetch them for blitting in batches.
+ *
+ * The dabs must be returned in the order they were added to the source,
+ * all the methods are called from the stroke's threads, so the
+ * implementation should be thread-safe.
+ */
+class KisAsyncDabSource
+{
+public:
+    virtual ~KisAsyncDabSource() {}
+
+    /**
+     * Take all the dabs that are ready for blitting
+     *
+     * @param returnMutableDabs if true, the returned dabs may be modified
+     *                          by the caller (e.g. mirrored)
+     * @param oneTimeLimit maximum number of dabs to return, -1 means no limit
+     * @param someDabsLeft set to true if some ready dabs were not returned
+     *                     because of the limit
+     */
+    virtual QList<KisRenderedDab> takeReadyDabs(bool returnMutableDabs = false,
+                                                int oneTimeLimit = -1,
+                                                bool *someDabsLeft = 0) = 0;
+
+    virtual bool hasPreparedDabs() const = 0;
+
+    virtual qreal averageDabRenderingTime() const = 0; // msecs
+    virtual int averageDabSize() const = 0;
+};
+
+#endif // KISASYNCDABSOURCE_H
@@ -0,0 +1,69 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef KISASYNCDABUPDATER_H
+#define KISASYNCDABUPDATER_H
+
+#include "kritapaintop_export.h"
+
+#include <QScopedPointer>
+#include <QVector>
+#include <utility>
+
+class KisPainter;
+class KisAsyncDabSource;
+class KisRunnableStrokeJobData;
+
+/**
+ * Implements the asynchronous update cycle of a paintop that renders
+ * its dabs in background threads (see KisPaintOp::doAsyncronousUpdate()).
+ *
+ * On every update the updater fetches the ready dabs from the source,
+ * splits the dirty area into non-overlapping rects and blits the dabs
+ * into these rects concurrently, including the mirrored and wrapped
+ * copies. It also adapts the update period to the measured rendering
+ * speed.
+ */
+class PAINTOP_EXPORT KisAsyncDabUpdater
+{
+public:
+    KisAsyncDabUpdater(KisAsyncDabSource *source);
+    ~KisAsyncDabUpdater();
+
+    /**
+     * Register the spacing of a dab added to the source. The average
+     * spacing is used for splitting the dirty area into rects.
+     */
+    void addSpacingSample(qreal spacing);
+
+    /**
+     * Generates the jobs for blitting the dabs that are ready by this
+     * moment. The returned value has the same meaning as the one of
+     * KisPaintOp::doAsyncronousUpdate()
+     */
+    std::pair<int, bool> doAsyncronousUpdate(KisPainter *painter, QVector<KisRunnableStrokeJobData*> &jobs);
+
+private:
+    Q_DISABLE_COPY(KisAsyncDabUpdater)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISASYNCDABUPDATER_H
@@ -22,6 +22,7 @@
 #include "kis_paint_device.h"
 #include "kis_fixed_paint_device.h"
 #include "kis_color_source.h"
+#include "KisPersistentDabCache.h"
 
 #include <kis_pressure_sharpness_option.h>
 #include <kis_texture_option.h>
@@ -60,6 +61,18 @@ void generateDab(const DabGenerationInfo &di, DabRenderingResources *resources,
     KIS_SAFE_ASSERT_RECOVER_RETURN(*dab);
     const KoColorSpace *cs = (*dab)->colorSpace();
 
+    KisPersistentDabCache *persistentCache = KisPersistentDabCache::instance();
+    QByteArray persistentCacheKey;
+
+    if (!di.persistentCacheKey.isEmpty()) {
+        persistentCacheKey = KisPersistentDabCache::colorSpaceKey(di.persistentCacheKey, cs);
+
+        KisFixedPaintDeviceSP cachedDab = persistentCache->fetch(persistentCacheKey);
+        if (cachedDab) {
+            *dab = cachedDab;
+            return;
+        }
+    }
 
     if (resources->brush->brushType() == IMAGE || resources->brush->brushType() == PIPE_IMAGE) {
         *dab = resources->brush->paintDevice(cs, di.shape, di.info,
@@ -98,6 +111,10 @@ void generateDab(const DabGenerationInfo &di, DabRenderingResources *resources,
         (*dab)->mirror(di.mirrorProperties.horizontalMirror,
                        di.mirrorProperties.verticalMirror);
     }
+
+    if (!persistentCacheKey.isEmpty()) {
+        persistentCache->insert(persistentCacheKey, *dab);
+    }
 }
 
 void postProcessDab(KisFixedPaintDeviceSP dab,
@@ -21,6 +21,7 @@
 
 #include <QRect>
 #include <QSize>
+#include <QByteArray>
 
 #include "kis_types.h"
 
@@ -99,6 +100,12 @@ struct PAINTOP_EXPORT DabGenerationInfo
     qreal softnessFactor = 1.0;
 
     bool needsPostprocessing = false;
+
+    /**
+     * The key of the dab in KisPersistentDabCache. Empty
+     * key means that the dab cannot be cached.
+     */
+    QByteArray persistentCacheKey;
 };
 
 PAINTOP_EXPORT QRect correctDabRectWhenFetchedFromCache(const QRect &dabRect,
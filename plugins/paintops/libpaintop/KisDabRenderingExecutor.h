@@ -19,7 +19,7 @@
 #ifndef KISDABRENDERINGEXECUTOR_H
 #define KISDABRENDERINGEXECUTOR_H
 
-#include "kritadefaultpaintops_export.h"
+#include "kritapaintop_export.h"
 
 #include <QScopedPointer>
 
@@ -27,13 +27,14 @@
 struct KisRenderedDab;
 
 #include "KisDabCacheUtils.h"
+#include "KisAsyncDabSource.h"
 
 class KisPressureMirrorOption;
 class KisPrecisionOption;
 class KisRunnableStrokeJobsInterface;
 
 
-class KRITADEFAULTPAINTOPS_EXPORT KisDabRenderingExecutor
+class PAINTOP_EXPORT KisDabRenderingExecutor : public KisAsyncDabSource
 {
 public:
     KisDabRenderingExecutor(const KoColorSpace *cs,
@@ -41,17 +42,17 @@ public:
                             KisRunnableStrokeJobsInterface *runnableJobsInterface,
                             KisPressureMirrorOption *mirrorOption = 0,
                             KisPrecisionOption *precisionOption = 0);
-    ~KisDabRenderingExecutor();
+    ~KisDabRenderingExecutor() override;
 
     void addDab(const KisDabCacheUtils::DabRequestInfo &request,
                 qreal opacity, qreal flow);
 
-    QList<KisRenderedDab> takeReadyDabs(bool returnMutableDabs = false, int oneTimeLimit = -1, bool *someDabsLeft = 0);
+    QList<KisRenderedDab> takeReadyDabs(bool returnMutableDabs = false, int oneTimeLimit = -1, bool *someDabsLeft = 0) override;
 
-    bool hasPreparedDabs() const;
+    bool hasPreparedDabs() const override;
 
-    qreal averageDabRenderingTime() const; // msecs
-    int averageDabSize() const;
+    qreal averageDabRenderingTime() const override; // msecs
+    int averageDabSize() const override;
 
 private:
     KisDabRenderingExecutor(const KisDabRenderingExecutor &rhs) = delete;
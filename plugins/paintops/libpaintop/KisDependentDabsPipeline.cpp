@@ -0,0 +1,191 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisDependentDabsPipeline.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSharedPointer>
+#include <QElapsedTimer>
+#include <QList>
+
+#include <KisRunnableStrokeJobsInterface.h>
+#include <KisRollingMeanAccumulatorWrapper.h>
+#include <tool/strokes/FreehandStrokeRunnableJobDataWithUpdate.h>
+
+
+namespace {
+
+struct DabNode;
+typedef QSharedPointer<DabNode> DabNodeSP;
+
+struct DabNode
+{
+    QVector<QRect> accessRects;
+    QRect accessBounds;
+    KisDependentDabsPipeline::DabFunc func;
+
+    int numPendingDependencies = 0;
+    QVector<DabNodeSP> dependentDabs;
+
+    bool intersects(const DabNode &rhs) const {
+        if (!accessBounds.intersects(rhs.accessBounds)) return false;
+
+        Q_FOREACH (const QRect &rc1, accessRects) {
+            Q_FOREACH (const QRect &rc2, rhs.accessRects) {
+                if (rc1.intersects(rc2)) return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+}
+
+struct KisDependentDabsPipeline::Private
+{
+    Private(KisRunnableStrokeJobsInterface *_runnableJobsInterface)
+        : runnableJobsInterface(_runnableJobsInterface),
+          avgExecutionTime(50)
+    {
+    }
+
+    KisRunnableStrokeJobsInterface *runnableJobsInterface;
+
+    mutable QMutex mutex;
+
+    /**
+     * All the dabs that have been added, but not completed yet,
+     * in the order of addition
+     */
+    QList<DabNodeSP> unfinishedDabs;
+
+    QVector<QRect> dirtyRects;
+    KisRollingMeanAccumulatorWrapper avgExecutionTime;
+
+    void startDab(DabNodeSP dab);
+    void completeDab(DabNodeSP dab, const QVector<QRect> &changedRects, int usecsTime);
+};
+
+void KisDependentDabsPipeline::Private::startDab(DabNodeSP dab)
+{
+    runnableJobsInterface->addRunnableJob(
+        new FreehandStrokeRunnableJobDataWithUpdate(
+            [this, dab] () {
+                QElapsedTimer timer;
+                timer.start();
+
+                const QVector<QRect> changedRects = dab->func();
+                completeDab(dab, changedRects, timer.nsecsElapsed() / 1000);
+            },
+            KisStrokeJobData::CONCURRENT));
+}
+
+void KisDependentDabsPipeline::Private::completeDab(DabNodeSP dab, const QVector<QRect> &changedRects, int usecsTime)
+{
+    QVector<DabNodeSP> readyDabs;
+
+    {
+        QMutexLocker l(&mutex);
+
+        dirtyRects.append(changedRects);
+        avgExecutionTime(usecsTime);
+
+        unfinishedDabs.removeOne(dab);
+
+        Q_FOREACH (DabNodeSP dependentDab, dab->dependentDabs) {
+            if (!--dependentDab->numPendingDependencies) {
+                readyDabs.append(dependentDab);
+            }
+        }
+
+        dab->dependentDabs.clear();
+        dab->func = DabFunc();
+    }
+
+    /**
+     * The jobs are started without holding the lock, because the
+     * fake jobs executor runs them right inside addRunnableJob()
+     */
+    Q_FOREACH (DabNodeSP readyDab, readyDabs) {
+        startDab(readyDab);
+    }
+}
+
+KisDependentDabsPipeline::KisDependentDabsPipeline(KisRunnableStrokeJobsInterface *runnableJobsInterface)
+    : m_d(new Private(runnableJobsInterface))
+{
+}
+
+KisDependentDabsPipeline::~KisDependentDabsPipeline()
+{
+}
+
+void KisDependentDabsPipeline::addDab(const QVector<QRect> &accessRects, DabFunc func)
+{
+    DabNodeSP dab(new DabNode());
+    dab->accessRects = accessRects;
+    dab->func = func;
+
+    Q_FOREACH (const QRect &rc, accessRects) {
+        dab->accessBounds |= rc;
+    }
+
+    bool isReady = false;
+
+    {
+        QMutexLocker l(&m_d->mutex);
+
+        Q_FOREACH (DabNodeSP prevDab, m_d->unfinishedDabs) {
+            if (prevDab->intersects(*dab)) {
+                prevDab->dependentDabs.append(dab);
+                dab->numPendingDependencies++;
+            }
+        }
+
+        m_d->unfinishedDabs.append(dab);
+        isReady = !dab->numPendingDependencies;
+    }
+
+    if (isReady) {
+        m_d->startDab(dab);
+    }
+}
+
+QVector<QRect> KisDependentDabsPipeline::takeDirtyRects()
+{
+    QMutexLocker l(&m_d->mutex);
+
+    QVector<QRect> rects;
+    rects.swap(m_d->dirtyRects);
+    return rects;
+}
+
+bool KisDependentDabsPipeline::hasPendingDabs() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return !m_d->unfinishedDabs.isEmpty();
+}
+
+qreal KisDependentDabsPipeline::averageDabRenderingTime() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->avgExecutionTime.rollingMean() / 1000.0;
+}
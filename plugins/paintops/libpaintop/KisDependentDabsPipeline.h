@@ -0,0 +1,86 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef KISDEPENDENTDABSPIPELINE_H
+#define KISDEPENDENTDABSPIPELINE_H
+
+#include "kritapaintop_export.h"
+
+#include <QScopedPointer>
+#include <QVector>
+#include <QRect>
+#include <functional>
+
+class KisRunnableStrokeJobsInterface;
+
+
+/**
+ * An asynchronous pipeline for the paintops whose dabs read the canvas
+ * (e.g. the color smudge op), so they cannot be rendered independently.
+ *
+ * Every dab declares the rects of the canvas it accesses (both reads and
+ * writes). The dab is started only when all the previously added dabs
+ * accessing the intersecting areas have completed. The dabs that access
+ * non-overlapping areas are executed concurrently. Since every pair of
+ * conflicting dabs is executed in the order the dabs were added, the
+ * result is exactly the same as the one of the sequential execution.
+ *
+ * When the pipeline is used outside a stroke (e.g. in unittests), every
+ * dab is executed immediately by the fake jobs executor.
+ */
+class PAINTOP_EXPORT KisDependentDabsPipeline
+{
+public:
+    /**
+     * Executes a dab and returns the rects that were changed by it. The
+     * function is called from a background thread. It may access only the
+     * areas of the canvas that were declared in addDab().
+     */
+    typedef std::function<QVector<QRect>()> DabFunc;
+
+public:
+    KisDependentDabsPipeline(KisRunnableStrokeJobsInterface *runnableJobsInterface);
+    ~KisDependentDabsPipeline();
+
+    /**
+     * Add a dab that accesses \p accessRects of the canvas. All the rects
+     * are considered to be both read and written by the dab.
+     */
+    void addDab(const QVector<QRect> &accessRects, DabFunc func);
+
+    /**
+     * \return the rects changed by the completed dabs since the last call
+     */
+    QVector<QRect> takeDirtyRects();
+
+    /**
+     * \return true if some of the added dabs haven't been completed yet
+     */
+    bool hasPendingDabs() const;
+
+    qreal averageDabRenderingTime() const; // msecs
+
+private:
+    Q_DISABLE_COPY(KisDependentDabsPipeline)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISDEPENDENTDABSPIPELINE_H
@@ -0,0 +1,201 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisPersistentDabCache.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDomDocument>
+#include <QCryptographicHash>
+#include <QGlobalStatic>
+#include <limits>
+
+#include <KoColorSpace.h>
+#include <KoColorProfile.h>
+
+#include <kis_fixed_paint_device.h>
+#include <kis_image_config.h>
+#include "kis_brush.h"
+#include "kis_auto_brush.h"
+
+
+namespace {
+struct CachedDab {
+    CachedDab(KisFixedPaintDeviceSP _dab) : dab(_dab) {}
+    KisFixedPaintDeviceSP dab;
+};
+
+int dabMemoryCost(KisFixedPaintDeviceSP dab) {
+    const QRect rc = dab->bounds();
+    return rc.width() * rc.height() * dab->pixelSize();
+}
+
+struct GlobalCacheHolder {
+    GlobalCacheHolder()
+        : cache(qint64(KisImageConfig(true).persistentDabCacheLimit()) * 1024 * 1024)
+    {
+    }
+
+    KisPersistentDabCache cache;
+};
+
+Q_GLOBAL_STATIC(GlobalCacheHolder, s_instance)
+}
+
+struct KisPersistentDabCache::Private
+{
+    mutable QMutex mutex;
+
+    // the cost of the dabs is measured in bytes
+    QCache<QByteArray, CachedDab> dabs;
+
+    qint64 hits = 0;
+    qint64 misses = 0;
+};
+
+KisPersistentDabCache::KisPersistentDabCache(qint64 memoryLimit)
+    : m_d(new Private)
+{
+    setMemoryLimit(memoryLimit);
+}
+
+KisPersistentDabCache::~KisPersistentDabCache()
+{
+}
+
+KisPersistentDabCache *KisPersistentDabCache::instance()
+{
+    return &s_instance->cache;
+}
+
+KisFixedPaintDeviceSP KisPersistentDabCache::fetch(const QByteArray &key)
+{
+    QMutexLocker l(&m_d->mutex);
+
+    CachedDab *cachedDab = m_d->dabs.object(key);
+    if (!cachedDab) {
+        m_d->misses++;
+        return KisFixedPaintDeviceSP();
+    }
+
+    m_d->hits++;
+    return new KisFixedPaintDevice(*cachedDab->dab);
+}
+
+void KisPersistentDabCache::insert(const QByteArray &key, KisFixedPaintDeviceSP dab)
+{
+    KIS_SAFE_ASSERT_RECOVER_RETURN(dab);
+
+    const int cost = dabMemoryCost(dab);
+    KisFixedPaintDeviceSP dabCopy = new KisFixedPaintDevice(*dab);
+
+    QMutexLocker l(&m_d->mutex);
+
+    if (cost > m_d->dabs.maxCost()) return;
+
+    m_d->dabs.insert(key, new CachedDab(dabCopy), cost);
+}
+
+void KisPersistentDabCache::setMemoryLimit(qint64 bytes)
+{
+    QMutexLocker l(&m_d->mutex);
+    m_d->dabs.setMaxCost(int(qBound(qint64(0), bytes, qint64(std::numeric_limits<int>::max()))));
+}
+
+qint64 KisPersistentDabCache::memoryLimit() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->dabs.maxCost();
+}
+
+bool KisPersistentDabCache::isEnabled() const
+{
+    QMutexLocker l(&m_d->mutex);
+    return m_d->dabs.maxCost() > 0;
+}
+
+void KisPersistentDabCache::clear()
+{
+    QMutexLocker l(&m_d->mutex);
+    m_d->dabs.clear();
+}
+
+KisPersistentDabCache::Statistics KisPersistentDabCache::statistics() const
+{
+    QMutexLocker l(&m_d->mutex);
+
+    Statistics stats;
+    stats.hits = m_d->hits;
+    stats.misses = m_d->misses;
+    stats.numDabs = m_d->dabs.count();
+    stats.memoryUsage = m_d->dabs.totalCost();
+    stats.memoryLimit = m_d->dabs.maxCost();
+
+    return stats;
+}
+
+void KisPersistentDabCache::resetStatistics()
+{
+    QMutexLocker l(&m_d->mutex);
+    m_d->hits = 0;
+    m_d->misses = 0;
+}
+
+QByteArray KisPersistentDabCache::brushKey(KisBrushSP brush)
+{
+    if (!brush) return QByteArray();
+
+    /**
+     * Pipe brushes change their state on every dab, so the dabs
+     * cannot be reused even for the same parameters
+     */
+    if (brush->brushType() == PIPE_IMAGE || brush->brushType() == PIPE_MASK) {
+        return QByteArray();
+    }
+
+    const KisAutoBrush *autoBrush = dynamic_cast<const KisAutoBrush*>(brush.data());
+    if (autoBrush && (autoBrush->randomness() > 0.0 || autoBrush->density() < 1.0)) {
+        return QByteArray();
+    }
+
+    QDomDocument doc;
+    QDomElement element = doc.createElement("brush");
+    brush->toXML(doc, element);
+    doc.appendChild(element);
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(doc.toByteArray());
+    hash.addData(brush->md5());
+
+    return hash.result();
+}
+
+QByteArray KisPersistentDabCache::colorSpaceKey(const QByteArray &dabKey, const KoColorSpace *cs)
+{
+    QByteArray key(dabKey);
+    key += cs->id().toLatin1();
+    key += '|';
+
+    if (cs->profile()) {
+        key += cs->profile()->name().toUtf8();
+    }
+
+    return key;
+}
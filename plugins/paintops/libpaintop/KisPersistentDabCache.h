@@ -0,0 +1,122 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef KISPERSISTENTDABCACHE_H
+#define KISPERSISTENTDABCACHE_H
+
+#include "kritapaintop_export.h"
+
+#include <QScopedPointer>
+#include <QByteArray>
+
+#include "kis_types.h"
+
+class KoColorSpace;
+class KisBrush;
+typedef KisSharedPtr<KisBrush> KisBrushSP;
+
+
+/**
+ * A process-wide LRU cache of the generated dabs.
+ *
+ * KisDabCache and KisDabRenderingQueueCache can reuse only the previous
+ * dab of the current stroke. This cache keeps the dabs across the strokes
+ * and the paintops, so a stroke with the pressure-dependent size fetches
+ * the masks for the sizes and rotations that have already been painted.
+ *
+ * The dabs are identified by a key built from the definition of the brush
+ * and the quantized parameters of the dab: size, rotation, subpixel offset,
+ * softness, mirroring and color. The quantization steps are defined by the
+ * precision level of the paintop (see KisDabCacheBase).
+ *
+ * The cache doesn't store the dabs for the brushes that produce different
+ * masks for the same parameters (pipe brushes, randomized auto brushes).
+ *
+ * The total size of the cached dabs is limited by
+ * KisImageConfig::persistentDabCacheLimit(). The least recently used dabs
+ * are dropped when the limit is exceeded.
+ */
+class PAINTOP_EXPORT KisPersistentDabCache
+{
+public:
+    struct Statistics {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        int numDabs = 0;
+        qint64 memoryUsage = 0;
+        qint64 memoryLimit = 0;
+
+        qreal hitRate() const {
+            return hits + misses > 0 ? qreal(hits) / (hits + misses) : 0.0;
+        }
+    };
+
+public:
+    KisPersistentDabCache(qint64 memoryLimit);
+    ~KisPersistentDabCache();
+
+    static KisPersistentDabCache* instance();
+
+    /**
+     * \return a copy of the dab stored for \p key or a null pointer. The
+     *         copy shares the pixel data with the cached dab until one of
+     *         them is modified, so it is cheap.
+     */
+    KisFixedPaintDeviceSP fetch(const QByteArray &key);
+
+    /**
+     * Store a copy of \p dab under \p key. The dab is not stored if it
+     * alone exceeds the memory limit.
+     */
+    void insert(const QByteArray &key, KisFixedPaintDeviceSP dab);
+
+    /**
+     * Set the maximum size of the cached dabs in bytes. Zero
+     * limit disables the cache.
+     */
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const;
+
+    bool isEnabled() const;
+
+    void clear();
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+    /**
+     * \return the key identifying the masks generated by \p brush or
+     *         an empty array if the brush cannot be cached
+     */
+    static QByteArray brushKey(KisBrushSP brush);
+
+    /**
+     * \return the key of the dab extended with the color space
+     *         of the device the dab is generated into
+     */
+    static QByteArray colorSpaceKey(const QByteArray &dabKey, const KoColorSpace *cs);
+
+private:
+    Q_DISABLE_COPY(KisPersistentDabCache)
+
+    struct Private;
+    const QScopedPointer<Private> m_d;
+};
+
+#endif // KISPERSISTENTDABCACHE_H
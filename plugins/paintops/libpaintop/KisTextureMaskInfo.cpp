@@ -27,7 +27,6 @@
 
 #include <kis_algebra_2d.h>
 #include <kis_lod_transform.h>
-#include <kis_iterator_ng.h>
 
 #include <QGlobalStatic>
 
@@ -94,11 +93,11 @@ int KisTextureMaskInfo::levelOfDetail() const {
 }
 
 bool KisTextureMaskInfo::hasMask() const {
-    return m_mask;
+    return !m_mask.isEmpty();
 }
 
-KisPaintDeviceSP KisTextureMaskInfo::mask() {
-    return m_mask;
+const quint8* KisTextureMaskInfo::maskData() const {
+    return m_mask.constData();
 }
 
 QRect KisTextureMaskInfo::maskBounds() const {
@@ -136,10 +135,6 @@ void KisTextureMaskInfo::recalculateMask()
 
     const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
 
-    if (!m_mask) {
-        m_mask = new KisPaintDevice(cs);
-    }
-
     QImage mask = m_pattern->pattern();
 
     if ((mask.format() != QImage::Format_RGB32) |
@@ -161,7 +156,8 @@ void KisTextureMaskInfo::recalculateMask()
     const int width = mask.width();
     const int height = mask.height();
 
-    KisHLineIteratorSP iter = m_mask->createHLineIteratorNG(0, 0, width);
+    m_mask.resize(width * height);
+    quint8 *dstPtr = m_mask.data();
 
     for (int row = 0; row < height; ++row) {
         for (int col = 0; col < width; ++col) {
@@ -194,10 +190,9 @@ void KisTextureMaskInfo::recalculateMask()
                 maskValue = OPACITY_OPAQUE_F;
             }
 
-            cs->setOpacity(iter->rawData(), maskValue, 1);
-            iter->nextPixel();
+            cs->setOpacity(dstPtr, maskValue, 1);
+            dstPtr++;
         }
-        iter->nextRow();
     }
 
     m_maskBounds = QRect(0, 0, width, height);
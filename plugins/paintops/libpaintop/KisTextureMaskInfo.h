@@ -22,6 +22,7 @@
 
 #include <kis_paint_device.h>
 #include <QSharedPointer>
+#include <QVector>
 #include <QMutex>
 
 
@@ -46,7 +47,14 @@ public:
 
     bool hasMask() const;
 
-    KisPaintDeviceSP mask();
+    /**
+     * Row-major 8-bit alpha values of the pattern mask with all the
+     * scale/brightness/contrast/cutoff adjustments already applied.
+     * The size of the buffer is defined by maskBounds(). The mask is
+     * supposed to be tiled over the dab, so the caller should wrap
+     * the coordinates itself.
+     */
+    const quint8* maskData() const;
 
     QRect maskBounds() const;
 
@@ -68,7 +76,7 @@ private:
     int m_cutoffRight = 255;
     int m_cutoffPolicy = 0;
 
-    KisPaintDeviceSP m_mask;
+    QVector<quint8> m_mask;
     QRect m_maskBounds;
 
 };
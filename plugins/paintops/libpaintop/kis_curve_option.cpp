@@ -20,6 +20,7 @@
 #include "kis_curve_option.h"
 
 #include <QDomNode>
+#include <QVarLengthArray>
 
 KisCurveOption::KisCurveOption(const QString& name, KisPaintOpOption::PaintopCategory category,
                                bool checked, qreal value, qreal min, qreal max)
@@ -359,7 +360,9 @@ KisCurveOption::ValueComponents KisCurveOption::computeValueComponents(const Kis
 
     if (m_useCurve) {
         QMap<DynamicSensorType, KisDynamicSensorSP>::const_iterator i;
-        QList<double> sensorValues;
+        // the option is evaluated for every dab, so avoid
+        // allocating the list of values on the heap
+        QVarLengthArray<qreal, 16> sensorValues;
         for (i = m_sensorMap.constBegin(); i != m_sensorMap.constEnd(); ++i) {
             KisDynamicSensorSP s(i.value());
 
@@ -371,20 +374,19 @@ KisCurveOption::ValueComponents KisCurveOption::computeValueComponents(const Kis
                     components.absoluteOffset = s->parameter(info);
                     components.hasAbsoluteOffset =true;
                 } else {
-                    sensorValues << s->parameter(info);
+                    sensorValues.append(s->parameter(info));
                     components.hasScaling = true;
                 }
             }
         }
 
-        if (sensorValues.count() == 1) {
+        if (sensorValues.size() == 1) {
             components.scaling = sensorValues.first();
         } else {
 
             if (m_curveMode == 1){           // add
                 components.scaling = 0;
-                double i;
-                foreach (i, sensorValues) {
+                for (qreal i : sensorValues) {
                     components.scaling += i;
                 }
             } else if (m_curveMode == 2){    //max
@@ -399,8 +401,7 @@ KisCurveOption::ValueComponents KisCurveOption::computeValueComponents(const Kis
                 components.scaling = max-min;
 
             } else {                         //multuply - default
-                double i;
-                foreach (i, sensorValues) {
+                for (qreal i : sensorValues) {
                     components.scaling *= i;
                 }
             }
@@ -28,8 +28,13 @@
 #include <kis_precision_option.h>
 #include <kis_fixed_paint_device.h>
 #include <brushengine/kis_paintop.h>
+#include <kis_global.h>
+#include "KisPersistentDabCache.h"
 
 #include <kundo2command.h>
+#include <cmath>
+#include <algorithm>
+#include <iterator>
 
 struct PrecisionValues {
     qreal angle;
@@ -88,9 +93,69 @@ struct KisDabCacheBase::Private {
 
     SavedDabParameters lastSavedDabParameters;
 
+    /**
+     * The rendering resources of the dab rendering queue are cloned for
+     * every thread, so we should keep the keys for all the clones
+     */
+    QVector<std::pair<KisBrushSP, QByteArray>> persistentCacheBrushKeys;
+
     static qreal positiveFraction(qreal x);
+
+    QByteArray persistentCacheKey(KisBrushSP brush,
+                                  const SavedDabParameters &params,
+                                  int precisionLevel);
 };
 
+QByteArray KisDabCacheBase::Private::persistentCacheKey(KisBrushSP brush,
+                                                        const SavedDabParameters &params,
+                                                        int precisionLevel)
+{
+    auto it = std::find_if(persistentCacheBrushKeys.begin(), persistentCacheBrushKeys.end(),
+                           [brush] (const std::pair<KisBrushSP, QByteArray> &pair) {
+                               return pair.first == brush;
+                           });
+
+    if (it == persistentCacheBrushKeys.end()) {
+        persistentCacheBrushKeys.append(std::make_pair(brush, KisPersistentDabCache::brushKey(brush)));
+        it = std::prev(persistentCacheBrushKeys.end());
+    }
+
+    const QByteArray &brushKey = it->second;
+    if (brushKey.isEmpty()) return QByteArray();
+
+    /**
+     * The parameters are quantized with the same tolerances that are
+     * used for reusing the previous dab, so the persistent cache
+     * doesn't make the painting less precise than it already is
+     */
+    const PrecisionValues &prec = precisionLevels[precisionLevel];
+
+    const qint64 values[] = {
+        precisionLevel,
+        params.width,
+        params.height,
+        qRound64(normalizeAngle(params.angle) / prec.angle),
+        qint64(std::floor(params.subPixelX / prec.subPixel)),
+        qint64(std::floor(params.subPixelY / prec.subPixel)),
+        qRound64(params.softnessFactor / prec.softnessFactor),
+        params.index,
+        params.mirrorProperties.horizontalMirror,
+        params.mirrorProperties.verticalMirror
+    };
+
+    QByteArray key(brushKey);
+    key.append(reinterpret_cast<const char*>(values), sizeof(values));
+
+    // image brushes ignore the painting color
+    if (brush->brushType() != IMAGE) {
+        key.append(params.color.colorSpace()->id().toLatin1());
+        key.append(reinterpret_cast<const char*>(params.color.data()),
+                   params.color.colorSpace()->pixelSize());
+    }
+
+    return key;
+}
+
 
 
 KisDabCacheBase::KisDabCacheBase()
@@ -275,6 +340,12 @@ void KisDabCacheBase::fetchDabGenerationInfo(bool hasDabInCache,
         m_d->lastSavedDabParameters = newParams;
     }
 
+    di->persistentCacheKey =
+        !*shouldUseCache && di->solidColorFill &&
+        KisPersistentDabCache::instance()->isEnabled() ?
+            m_d->persistentCacheKey(resources->brush, newParams, precisionLevel) :
+            QByteArray();
+
     di->needsPostprocessing = needSeparateOriginal(resources->textureOption.data(), resources->sharpnessOption.data());
 }
 
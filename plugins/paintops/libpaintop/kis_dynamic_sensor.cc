@@ -28,6 +28,14 @@
 #include "sensors/kis_dynamic_sensor_fade.h"
 #include "sensors/kis_dynamic_sensor_fuzzy.h"
 
+namespace {
+/**
+ * The size of the lookup table the custom curve is baked into
+ * when the sensor is loaded
+ */
+const int curveTransferSize = 256;
+}
+
 KisDynamicSensor::KisDynamicSensor(DynamicSensorType type)
     : m_length(-1)
     , m_type(type)
@@ -509,17 +517,24 @@ void KisDynamicSensor::fromXML(const QDomElement& e)
     if (!curve_elt.isNull()) {
         m_customCurve = true;
         m_curve.fromString(curve_elt.text());
+        m_curveTransfer = m_curve.floatTransfer(curveTransferSize);
     }
 }
 
 qreal KisDynamicSensor::parameter(const KisPaintInformation& info)
 {
-    const qreal val = value(info);
+    qreal val = 0.0;
+
+    if (!isStateless()) {
+        val = value(info);
+    } else if (!info.fetchCachedSensorValue(m_type, &val)) {
+        val = value(info);
+        info.cacheSensorValue(m_type, val);
+    }
+
     if (m_customCurve) {
         qreal scaledVal = isAdditive() ? additiveToScaling(val) : val;
-
-        const QVector<qreal> transfer = m_curve.floatTransfer(256);
-        scaledVal = KisCubicCurve::interpolateLinear(scaledVal, transfer);
+        scaledVal = KisCubicCurve::interpolateLinear(scaledVal, m_curveTransfer);
 
         return isAdditive() ? scalingToAdditive(scaledVal) : scaledVal;
     }
@@ -532,6 +547,7 @@ void KisDynamicSensor::setCurve(const KisCubicCurve& curve)
 {
     m_customCurve = true;
     m_curve = curve;
+    m_curveTransfer = m_curve.floatTransfer(curveTransferSize);
 }
 
 const KisCubicCurve& KisDynamicSensor::curve() const
@@ -564,6 +580,11 @@ bool KisDynamicSensor::isAbsoluteRotation() const
     return false;
 }
 
+bool KisDynamicSensor::isStateless() const
+{
+    return false;
+}
+
 void KisDynamicSensor::setActive(bool active)
 {
     m_active = active;
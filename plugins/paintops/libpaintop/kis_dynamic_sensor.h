@@ -182,6 +182,17 @@ public:
     virtual bool isAdditive() const;
     virtual bool isAbsoluteRotation() const;
 
+    /**
+     * @return true if value() depends on the passed paint information
+     * only, that is the sensor keeps no state between the dabs and
+     * doesn't consume any random numbers. The value of such sensors is
+     * evaluated once per dab and shared among all the curve options
+     * of the paintop.
+     *
+     * \see KisPaintInformation::fetchCachedSensorValue()
+     */
+    virtual bool isStateless() const;
+
     inline DynamicSensorType sensorType() const { return m_type; }
 
 
@@ -213,6 +224,7 @@ private:
     DynamicSensorType m_type;
     bool m_customCurve;
     KisCubicCurve m_curve;
+    QVector<qreal> m_curveTransfer;
     bool m_active;
 
 };
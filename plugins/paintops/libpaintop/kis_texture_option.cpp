@@ -38,9 +38,8 @@
 #include <kis_multipliers_double_slider_spinbox.h>
 #include <resources/KoPattern.h>
 #include <kis_paint_device.h>
-#include <kis_fill_painter.h>
-#include <kis_painter.h>
-#include <kis_iterator_ng.h>
+#include <KoColorSpace.h>
+#include <KoChannelInfo.h>
 #include <kis_fixed_paint_device.h>
 #include <KisGradientSlider.h>
 #include "kis_embedded_pattern_manager.h"
@@ -226,48 +225,114 @@ void KisTextureProperties::fillProperties(const KisPropertiesConfigurationSP set
     m_strengthOption.resetAllSensors();
 }
 
+namespace {
+
+/**
+ * Returns the byte offset of the alpha channel if it is stored
+ * as a plain 8-bit integer, or -1 otherwise
+ */
+int alphaU8ChannelOffset(const KoColorSpace *cs)
+{
+    Q_FOREACH (const KoChannelInfo *channel, cs->channels()) {
+        if (channel->channelType() == KoChannelInfo::ALPHA) {
+            return channel->channelValueType() == KoChannelInfo::UINT8 ?
+                channel->pos() : -1;
+        }
+    }
+    return -1;
+}
+
+inline int wrapCoordinate(int value, int size)
+{
+    const int result = value % size;
+    return result >= 0 ? result : result + size;
+}
+
+}
+
 void KisTextureProperties::apply(KisFixedPaintDeviceSP dab, const QPoint &offset, const KisPaintInformation & info)
 {
     if (!m_enabled) return;
 
-    KisPaintDeviceSP fillDevice = new KisPaintDevice(KoColorSpaceRegistry::instance()->alpha8());
-    QRect rect = dab->bounds();
+    KIS_SAFE_ASSERT_RECOVER_RETURN(m_maskInfo->hasMask());
 
-    KisPaintDeviceSP mask = m_maskInfo->mask();
+    const QRect rect = dab->bounds();
     const QRect maskBounds = m_maskInfo->maskBounds();
+    const quint8 *maskData = m_maskInfo->maskData();
+
+    const int maskWidth = maskBounds.width();
+    const int maskHeight = maskBounds.height();
+
+    const int x = offset.x() % maskWidth - m_offsetX;
+    const int y = offset.y() % maskHeight - m_offsetY;
+
+    const qreal pressure = m_strengthOption.apply(info);
+    const int numPixels = rect.width() * rect.height();
+
+    /**
+     * Unwrap the tiled pattern into a plain buffer matching the dab
+     * pixel-by-pixel. The pattern rows are copied in runs, so there is
+     * no per-pixel modulo arithmetic here. The strength of the texture
+     * is baked into the buffer via a lookup table.
+     */
+    quint8 strengthTable[256];
+    if (m_texturingMode == MULTIPLY) {
+        for (int i = 0; i < 256; i++) {
+            strengthTable[i] = quint8(i * pressure);
+        }
+    } else {
+        const int pressureOffset = (1.0 - pressure) * 255;
+        for (int i = 0; i < 256; i++) {
+            strengthTable[i] = quint8(qBound(0, i + pressureOffset, 255));
+        }
+    }
 
-    KIS_SAFE_ASSERT_RECOVER_RETURN(mask);
-
-    int x = offset.x() % maskBounds.width() - m_offsetX;
-    int y = offset.y() % maskBounds.height() - m_offsetY;
+    QVector<quint8> textureMask(numPixels);
+    quint8 *dstPtr = textureMask.data();
 
+    for (int row = 0; row < rect.height(); ++row) {
+        const quint8 *srcRow = maskData + wrapCoordinate(y + row, maskHeight) * maskWidth;
 
-    KisFillPainter fillPainter(fillDevice);
-    fillPainter.fillRect(x - 1, y - 1, rect.width() + 2, rect.height() + 2, mask, maskBounds);
-    fillPainter.end();
+        int srcX = wrapCoordinate(x, maskWidth);
+        int columnsLeft = rect.width();
 
-    qreal pressure = m_strengthOption.apply(info);
-    quint8 *dabData = dab->data();
+        while (columnsLeft > 0) {
+            const int runLength = qMin(maskWidth - srcX, columnsLeft);
+            const quint8 *srcPtr = srcRow + srcX;
 
-    KisHLineIteratorSP iter = fillDevice->createHLineIteratorNG(x, y, rect.width());
-    for (int row = 0; row < rect.height(); ++row) {
-        for (int col = 0; col < rect.width(); ++col) {
-            if (m_texturingMode == MULTIPLY) {
-                dab->colorSpace()->multiplyAlpha(dabData, quint8(*iter->oldRawData() * pressure), 1);
+            for (int i = 0; i < runLength; i++) {
+                *dstPtr++ = strengthTable[*srcPtr++];
             }
-            else {
-                int pressureOffset = (1.0 - pressure) * 255;
 
-                qint16 maskA = *iter->oldRawData() + pressureOffset;
-                quint8 dabA = dab->colorSpace()->opacityU8(dabData);
+            columnsLeft -= runLength;
+            srcX = 0;
+        }
+    }
 
-                dabA = qMax(0, (qint16)dabA - maskA);
-                dab->colorSpace()->setOpacity(dabData, dabA, 1);
-            }
+    const KoColorSpace *cs = dab->colorSpace();
+    quint8 *dabData = dab->data();
 
-            iter->nextPixel();
-            dabData += dab->pixelSize();
+    if (m_texturingMode == MULTIPLY) {
+        cs->applyAlphaU8Mask(dabData, textureMask.constData(), numPixels);
+    } else {
+        const quint8 *maskPtr = textureMask.constData();
+        const int pixelSize = dab->pixelSize();
+        const int alphaOffset = alphaU8ChannelOffset(cs);
+
+        if (alphaOffset >= 0) {
+            quint8 *alphaPtr = dabData + alphaOffset;
+            for (int i = 0; i < numPixels; i++) {
+                *alphaPtr = quint8(qMax(0, int(*alphaPtr) - int(*maskPtr)));
+                alphaPtr += pixelSize;
+                maskPtr++;
+            }
+        } else {
+            for (int i = 0; i < numPixels; i++) {
+                const quint8 dabA = cs->opacityU8(dabData);
+                cs->setOpacity(dabData, quint8(qMax(0, int(dabA) - int(*maskPtr))), 1);
+                dabData += pixelSize;
+                maskPtr++;
+            }
         }
-        iter->nextRow();
     }
 }
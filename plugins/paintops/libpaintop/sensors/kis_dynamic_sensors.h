@@ -42,6 +42,7 @@ class KisDynamicSensorRotation : public KisDynamicSensor
 public:
     KisDynamicSensorRotation();
     ~KisDynamicSensorRotation() override { }
+    bool isStateless() const override { return true; }
     qreal value(const KisPaintInformation& info) override {
         return info.rotation() / 360.0;
     }
@@ -52,6 +53,7 @@ class KisDynamicSensorPressure : public KisDynamicSensor
 public:
     KisDynamicSensorPressure();
     ~KisDynamicSensorPressure() override { }
+    bool isStateless() const override { return true; }
     qreal value(const KisPaintInformation& info) override {
         return info.pressure();
     }
@@ -82,6 +84,7 @@ class KisDynamicSensorXTilt : public KisDynamicSensor
 public:
     KisDynamicSensorXTilt();
     ~KisDynamicSensorXTilt() override { }
+    bool isStateless() const override { return true; }
     qreal value(const KisPaintInformation& info) override {
         return 1.0 - fabs(info.xTilt()) / 60.0;
     }
@@ -92,6 +95,7 @@ class KisDynamicSensorYTilt : public KisDynamicSensor
 public:
     KisDynamicSensorYTilt();
     ~KisDynamicSensorYTilt() override { }
+    bool isStateless() const override { return true; }
     qreal value(const KisPaintInformation& info) override {
         return 1.0 - fabs(info.yTilt()) / 60.0;
     }
@@ -102,6 +106,7 @@ class KisDynamicSensorTiltDirection : public KisDynamicSensor
 public:
     KisDynamicSensorTiltDirection();
     ~KisDynamicSensorTiltDirection() override {}
+    bool isStateless() const override { return true; }
     qreal value(const KisPaintInformation& info) override {
         return KisPaintInformation::tiltDirection(info, true);
     }
@@ -112,6 +117,7 @@ class KisDynamicSensorTiltElevation : public KisDynamicSensor
 public:
     KisDynamicSensorTiltElevation();
     ~KisDynamicSensorTiltElevation() override {}
+    bool isStateless() const override { return true; }
     qreal value(const KisPaintInformation& info) override {
         return KisPaintInformation::tiltElevation(info, 60.0, 60.0, true);
     }
@@ -122,6 +128,7 @@ class KisDynamicSensorPerspective : public KisDynamicSensor
 public:
     KisDynamicSensorPerspective();
     ~KisDynamicSensorPerspective() override { }
+    bool isStateless() const override { return true; }
     qreal value(const KisPaintInformation& info) override {
         return info.perspective();
     }
@@ -132,6 +139,7 @@ class KisDynamicSensorTangentialPressure : public KisDynamicSensor
 public:
     KisDynamicSensorTangentialPressure();
     ~KisDynamicSensorTangentialPressure() override { }
+    bool isStateless() const override { return true; }
     qreal value(const KisPaintInformation& info) override {
         return info.tangentialPressure();
     }
@@ -22,9 +22,9 @@
 #include <KoColorSpace.h>
 #include <KoColorSpaceRegistry.h>
 
-#include <../KisDabRenderingQueue.h>
-#include <../KisRenderedDab.h>
-#include <../KisDabRenderingJob.h>
+#include <KisDabRenderingQueue.h>
+#include <KisRenderedDab.h>
+#include <KisDabRenderingJob.h>
 
 struct SurrogateCacheInterface : public KisDabRenderingQueue::CacheInterface
 {
@@ -443,7 +443,7 @@ void KisDabRenderingQueueTest::testPostprocessedDabs()
 
 }
 
-#include <../KisDabRenderingQueueCache.h>
+#include <KisDabRenderingQueueCache.h>
 
 void KisDabRenderingQueueTest::testRunningJobs()
 {
@@ -498,7 +498,7 @@ void KisDabRenderingQueueTest::testRunningJobs()
     QCOMPARE(renderedDabs[1].offset, QPoint(15,15));
 }
 
-#include "../KisDabRenderingExecutor.h"
+#include "KisDabRenderingExecutor.h"
 #include "KisFakeRunnableStrokeJobsExecutor.h"
 
 void KisDabRenderingQueueTest::testExecutor()
@@ -538,4 +538,152 @@ void KisDabRenderingQueueTest::testExecutor()
 
 }
 
+#include "KisAsyncDabPipeline.h"
+#include <KisRunnableStrokeJobData.h>
+
+namespace {
+
+/**
+ * Collects the jobs to let the test execute them in arbitrary order,
+ * simulating the concurrent execution of the rendering jobs
+ */
+struct DeferredJobsExecutor : public KisRunnableStrokeJobsInterface
+{
+    ~DeferredJobsExecutor() override {
+        qDeleteAll(jobs);
+    }
+
+    void addRunnableJobs(const QVector<KisRunnableStrokeJobDataBase*> &list) override {
+        jobs.append(list);
+    }
+
+    void runJob(int index) {
+        KisRunnableStrokeJobDataBase *job = jobs.takeAt(index);
+        job->run();
+        delete job;
+    }
+
+    QList<KisRunnableStrokeJobDataBase*> jobs;
+};
+
+KisAsyncDabPipeline::RenderFunc testRenderFunc(const KoColorSpace *cs, const QPoint &offset, qreal opacity)
+{
+    return [cs, offset, opacity] () {
+        KisRenderedDab dab;
+
+        if (opacity > 0.0) {
+            KisFixedPaintDeviceSP device = new KisFixedPaintDevice(cs);
+            device->setRect(QRect(offset, QSize(10, 10)));
+            device->initialize();
+
+            dab = KisRenderedDab(device);
+            dab.opacity = opacity;
+        }
+
+        return dab;
+    };
+}
+
+}
+
+void KisDabRenderingQueueTest::testAsyncPipeline()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->rgb8();
+
+    DeferredJobsExecutor executor;
+    KisAsyncDabPipeline pipeline(&executor);
+
+    pipeline.addDab(testRenderFunc(cs, QPoint(0, 0), 1.0));
+    pipeline.addDab(testRenderFunc(cs, QPoint(10, 10), 0.0)); // empty dab
+    pipeline.addDab(testRenderFunc(cs, QPoint(20, 20), 0.5));
+    pipeline.addDab(testRenderFunc(cs, QPoint(30, 30), 0.25));
+
+    QCOMPARE(executor.jobs.size(), 4);
+    QVERIFY(!pipeline.hasPreparedDabs());
+
+    // the third and the second dabs are ready, but the first one is not
+    executor.runJob(2);
+    executor.runJob(1);
+    QVERIFY(!pipeline.hasPreparedDabs());
+    QVERIFY(pipeline.takeReadyDabs().isEmpty());
+
+    // the first dab is ready, the empty dab should be skipped
+    executor.runJob(0);
+    QVERIFY(pipeline.hasPreparedDabs());
+
+    bool someDabsLeft = false;
+    QList<KisRenderedDab> renderedDabs = pipeline.takeReadyDabs(false, 1, &someDabsLeft);
+    QCOMPARE(renderedDabs.size(), 1);
+    QCOMPARE(renderedDabs[0].offset, QPoint(0, 0));
+    QVERIFY(someDabsLeft);
+
+    renderedDabs = pipeline.takeReadyDabs(false, -1, &someDabsLeft);
+    QCOMPARE(renderedDabs.size(), 1);
+    QCOMPARE(renderedDabs[0].offset, QPoint(20, 20));
+    QCOMPARE(renderedDabs[0].opacity, 0.5);
+    QVERIFY(!someDabsLeft);
+
+    executor.runJob(0);
+    renderedDabs = pipeline.takeReadyDabs();
+    QCOMPARE(renderedDabs.size(), 1);
+    QCOMPARE(renderedDabs[0].offset, QPoint(30, 30));
+    QCOMPARE(renderedDabs[0].opacity, 0.25);
+
+    QVERIFY(!pipeline.hasPreparedDabs());
+    QCOMPARE(pipeline.averageDabSize(), 10);
+}
+
+#include "KisDependentDabsPipeline.h"
+
+void KisDabRenderingQueueTest::testDependentDabsPipeline()
+{
+    DeferredJobsExecutor executor;
+    KisDependentDabsPipeline pipeline(&executor);
+
+    QVector<int> executionOrder;
+
+    auto dabFunc = [&executionOrder] (int index, const QRect &rc) {
+        return [&executionOrder, index, rc] () {
+            executionOrder << index;
+            return QVector<QRect>({rc});
+        };
+    };
+
+    const QRect rc0(0, 0, 10, 10);
+    const QRect rc1(20, 0, 10, 10);
+    const QRect rc2(5, 5, 10, 10);  // intersects rc0
+    const QRect rc3(25, 5, 10, 10); // intersects rc1
+
+    pipeline.addDab({rc0}, dabFunc(0, rc0));
+    pipeline.addDab({rc1}, dabFunc(1, rc1));
+    pipeline.addDab({rc2}, dabFunc(2, rc2));
+    pipeline.addDab({rc0, rc3}, dabFunc(3, rc3));
+
+    // only the independent dabs are started
+    QCOMPARE(executor.jobs.size(), 2);
+    QVERIFY(pipeline.hasPendingDabs());
+
+    // the second dab doesn't unblock anything
+    executor.runJob(1);
+    QCOMPARE(executor.jobs.size(), 1);
+    QCOMPARE(pipeline.takeDirtyRects(), QVector<QRect>({rc1}));
+    QVERIFY(pipeline.takeDirtyRects().isEmpty());
+
+    // the first dab unblocks the third one, but the fourth
+    // one still waits for the third
+    executor.runJob(0);
+    QCOMPARE(executor.jobs.size(), 1);
+
+    executor.runJob(0);
+    QCOMPARE(executor.jobs.size(), 1);
+    QVERIFY(pipeline.hasPendingDabs());
+
+    executor.runJob(0);
+    QCOMPARE(executor.jobs.size(), 0);
+    QVERIFY(!pipeline.hasPendingDabs());
+
+    QCOMPARE(executionOrder, QVector<int>({1, 0, 2, 3}));
+    QCOMPARE(pipeline.takeDirtyRects(), QVector<QRect>({rc0, rc2, rc3}));
+}
+
 QTEST_MAIN(KisDabRenderingQueueTest)
@@ -30,6 +30,9 @@ private Q_SLOTS:
     void testRunningJobs();
 
     void testExecutor();
+
+    void testAsyncPipeline();
+    void testDependentDabsPipeline();
 };
 
 #endif // KISDABRENDERINGQUEUETEST_H
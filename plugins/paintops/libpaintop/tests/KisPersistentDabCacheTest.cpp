@@ -0,0 +1,139 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisPersistentDabCacheTest.h"
+
+#include <QTest>
+#include <KoColor.h>
+#include <KoColorSpace.h>
+#include <KoColorSpaceRegistry.h>
+
+#include <kis_fixed_paint_device.h>
+#include <kis_mask_generator.h>
+#include <brushengine/kis_paint_information.h>
+#include "kis_auto_brush.h"
+#include "kis_dab_cache.h"
+#include "KisPersistentDabCache.h"
+
+
+namespace {
+KisFixedPaintDeviceSP createDab(const KoColorSpace *cs, int size, quint8 value)
+{
+    KisFixedPaintDeviceSP dab = new KisFixedPaintDevice(cs);
+    dab->setRect(QRect(0, 0, size, size));
+    dab->initialize(value);
+    return dab;
+}
+}
+
+void KisPersistentDabCacheTest::testLruEviction()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
+
+    // enough memory for three 10x10 dabs
+    KisPersistentDabCache cache(300);
+
+    cache.insert("dab1", createDab(cs, 10, 1));
+    cache.insert("dab2", createDab(cs, 10, 2));
+    cache.insert("dab3", createDab(cs, 10, 3));
+
+    QCOMPARE(cache.statistics().numDabs, 3);
+    QCOMPARE(cache.statistics().memoryUsage, qint64(300));
+
+    // touch the first dab, so the second one becomes the least recently used
+    KisFixedPaintDeviceSP dab = cache.fetch("dab1");
+    QVERIFY(dab);
+    QCOMPARE(*dab->data(), quint8(1));
+
+    // modifying the fetched copy doesn't change the cached dab
+    dab->initialize(100);
+    QCOMPARE(*cache.fetch("dab1")->data(), quint8(1));
+
+    cache.insert("dab4", createDab(cs, 10, 4));
+
+    QVERIFY(cache.fetch("dab1"));
+    QVERIFY(!cache.fetch("dab2"));
+    QVERIFY(cache.fetch("dab3"));
+    QVERIFY(cache.fetch("dab4"));
+
+    // the dab exceeding the limit is not cached at all
+    cache.insert("dab5", createDab(cs, 20, 5));
+    QVERIFY(!cache.fetch("dab5"));
+    QCOMPARE(cache.statistics().numDabs, 3);
+
+    const KisPersistentDabCache::Statistics stats = cache.statistics();
+    QCOMPARE(stats.hits, qint64(5));
+    QCOMPARE(stats.misses, qint64(2));
+    QCOMPARE(stats.hitRate(), 5.0 / 7.0);
+
+    cache.setMemoryLimit(0);
+    QVERIFY(!cache.isEnabled());
+    QCOMPARE(cache.statistics().numDabs, 0);
+}
+
+void KisPersistentDabCacheTest::testBrushKey()
+{
+    KisBrushSP brush1 = new KisAutoBrush(new KisCircleMaskGenerator(10, 1.0, 1.0, 1.0, 2, false), 0.0, 0.0);
+    KisBrushSP brush2 = new KisAutoBrush(new KisCircleMaskGenerator(10, 1.0, 1.0, 1.0, 2, false), 0.0, 0.0);
+    KisBrushSP brush3 = new KisAutoBrush(new KisCircleMaskGenerator(10, 1.0, 0.5, 1.0, 2, false), 0.0, 0.0);
+    KisBrushSP randomBrush = new KisAutoBrush(new KisCircleMaskGenerator(10, 1.0, 1.0, 1.0, 2, false), 0.0, 0.5);
+
+    QVERIFY(!KisPersistentDabCache::brushKey(brush1).isEmpty());
+    QCOMPARE(KisPersistentDabCache::brushKey(brush1), KisPersistentDabCache::brushKey(brush2));
+    QVERIFY(KisPersistentDabCache::brushKey(brush1) != KisPersistentDabCache::brushKey(brush3));
+    QVERIFY(KisPersistentDabCache::brushKey(randomBrush).isEmpty());
+}
+
+void KisPersistentDabCacheTest::testSharedBetweenDabCaches()
+{
+    const KoColorSpace *cs = KoColorSpaceRegistry::instance()->alpha8();
+    const KoColor color(Qt::black, cs);
+
+    KisPersistentDabCache *cache = KisPersistentDabCache::instance();
+    cache->clear();
+    cache->resetStatistics();
+
+    QVector<KisFixedPaintDeviceSP> dabs;
+
+    // two paintops of the same preset, i.e. two strokes
+    for (int i = 0; i < 2; i++) {
+        KisBrushSP brush = new KisAutoBrush(new KisCircleMaskGenerator(30, 1.0, 0.5, 0.5, 2, false), 0.0, 0.0);
+        KisDabCache dabCache(brush);
+
+        QRect dstRect;
+        KisPaintInformation info(QPointF(100, 100), 1.0);
+
+        KisFixedPaintDeviceSP dab =
+            dabCache.fetchDab(cs, color, info.pos(), KisDabShape(1.0, 1.0, 0.0), info, 1.0, &dstRect);
+
+        QCOMPARE(dstRect.size(), dab->bounds().size());
+        dabs << new KisFixedPaintDevice(*dab);
+    }
+
+    QCOMPARE(cache->statistics().misses, qint64(1));
+    QCOMPARE(cache->statistics().hits, qint64(1));
+    QCOMPARE(cache->statistics().numDabs, 1);
+
+    QCOMPARE(dabs[0]->bounds(), dabs[1]->bounds());
+
+    const int numBytes = dabs[0]->bounds().width() * dabs[0]->bounds().height() * cs->pixelSize();
+    QVERIFY(!memcmp(dabs[0]->data(), dabs[1]->data(), numBytes));
+}
+
+QTEST_MAIN(KisPersistentDabCacheTest)
@@ -18,6 +18,7 @@
 
 #include "kis_sensors_test.h"
 #include <kis_dynamic_sensor.h>
+#include <kis_curve_option.h>
 
 #include <QTest>
 
@@ -39,6 +40,97 @@ void KisSensorsTest::testDrawingAngle()
     testBound(sensor);
 }
 
+void KisSensorsTest::testCachedSensorValues()
+{
+    KisCubicCurve curve;
+    curve.fromString("0,0;0.5,0.9;1,1;");
+
+    KisDynamicSensorSP linearSensor = KisDynamicSensor::id2Sensor(PressureId, "testname");
+    KisDynamicSensorSP curvedSensor = KisDynamicSensor::id2Sensor(PressureId, "testname");
+    curvedSensor->setCurve(curve);
+
+    KisPaintInformation pi(QPointF(10, 10), 0.5);
+
+    const qreal linearValue = linearSensor->parameter(pi);
+    QCOMPARE(linearValue, 0.5);
+
+    qreal cachedValue = 0.0;
+    QVERIFY(pi.fetchCachedSensorValue(PRESSURE, &cachedValue));
+    QCOMPARE(cachedValue, 0.5);
+
+    // the raw value is cached, the curve is still applied per sensor
+    const qreal curvedValue = curvedSensor->parameter(pi);
+    QCOMPARE(curvedValue, KisCubicCurve::interpolateLinear(0.5, curve.floatTransfer(256)));
+    QVERIFY(curvedValue > linearValue);
+
+    // copies share the values, modifications reset the cache
+    KisPaintInformation copy(pi);
+    QVERIFY(copy.fetchCachedSensorValue(PRESSURE, &cachedValue));
+
+    copy.setPressure(0.25);
+    QVERIFY(!copy.fetchCachedSensorValue(PRESSURE, &cachedValue));
+    QCOMPARE(linearSensor->parameter(copy), 0.25);
+
+    KisPaintInformation mixed = KisPaintInformation::mix(0.5, pi, copy);
+    QVERIFY(!mixed.fetchCachedSensorValue(PRESSURE, &cachedValue));
+    QCOMPARE(linearSensor->parameter(mixed), 0.375);
+}
+
+void KisSensorsTest::testRandomSensorsAreNotCached()
+{
+    KisDynamicSensorSP sensor = KisDynamicSensor::id2Sensor(FuzzyPerDabId, "testname");
+
+    KisPaintInformation pi(QPointF(10, 10), 0.5);
+    pi.setRandomSource(new KisRandomSource(42));
+
+    const qreal value1 = sensor->parameter(pi);
+    const qreal value2 = sensor->parameter(pi);
+
+    qreal cachedValue = 0.0;
+    QVERIFY(!pi.fetchCachedSensorValue(FUZZY_PER_DAB, &cachedValue));
+    QVERIFY(value1 != value2);
+}
+
+void KisSensorsTest::benchmarkCurveOption()
+{
+    KisCubicCurve curve;
+    curve.fromString("0,0;0.3,0.1;0.7,0.8;1,1;");
+
+    QVector<QSharedPointer<KisCurveOption>> options;
+
+    for (int i = 0; i < 5; i++) {
+        QSharedPointer<KisCurveOption> option(
+            new KisCurveOption("option" + QString::number(i), KisPaintOpOption::GENERAL, true));
+
+        option->sensor(TILT_ELEVATATION, false)->setActive(true);
+        option->sensor(TILT_DIRECTION, false)->setActive(true);
+        option->setCurve(PRESSURE, true, curve);
+
+        options << option;
+    }
+
+    QVector<KisPaintInformation> infos;
+    for (int i = 0; i < 1000; i++) {
+        infos << KisPaintInformation(QPointF(i, i), qreal(i % 100) / 100.0,
+                                     qreal(i % 120) - 60.0, qreal(i % 60), 0.0);
+    }
+
+    qreal sum = 0.0;
+
+    QBENCHMARK {
+        Q_FOREACH (const KisPaintInformation &pi, infos) {
+            // every dab gets its own paint information object
+            KisPaintInformation dabInfo(pi);
+
+            Q_FOREACH (QSharedPointer<KisCurveOption> option, options) {
+                sum += option->computeSizeLikeValue(dabInfo);
+            }
+        }
+    }
+
+    QVERIFY(sum > 0.0);
+}
+
 void KisSensorsTest::testBound(KisDynamicSensorSP sensor)
 {
     Q_FOREACH (const KisPaintInformation & pi, paintInformations) {
@@ -32,6 +32,9 @@ public:
 private Q_SLOTS:
 
     void testDrawingAngle();
+    void testCachedSensorValues();
+    void testRandomSensorsAreNotCached();
+    void benchmarkCurveOption();
 private:
     void testBound(KisDynamicSensorSP sensor);
 private:
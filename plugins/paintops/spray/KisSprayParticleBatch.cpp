@@ -0,0 +1,198 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "KisSprayParticleBatch.h"
+
+#include <algorithm>
+
+#include <QPainter>
+
+#include <KoColor.h>
+#include <KoColorSpace.h>
+
+#include <kis_painter.h>
+#include <kis_paint_device.h>
+#include <kis_fixed_paint_device.h>
+#include <kis_random_accessor_ng.h>
+
+namespace {
+
+/**
+ * The size of the bin matches the size of the tile of KisPaintDevice,
+ * so every bin is composited into a single tile.
+ */
+const int BIN_SIZE = 64;
+
+inline int binCoordinate(int coord)
+{
+    return coord >= 0 ? coord / BIN_SIZE : -((-coord - 1) / BIN_SIZE) - 1;
+}
+
+}
+
+KisSprayParticleBatch::KisSprayParticleBatch()
+{
+}
+
+KisSprayParticleBatch::~KisSprayParticleBatch()
+{
+}
+
+KisFixedPaintDeviceSP KisSprayParticleBatch::createDab(const KoColorSpace *cs)
+{
+    KisFixedPaintDeviceSP dab;
+
+    if (m_numUsedDabs < m_dabsPool.size()) {
+        dab = m_dabsPool[m_numUsedDabs];
+
+        if (*dab->colorSpace() != *cs) {
+            dab = new KisFixedPaintDevice(cs);
+            m_dabsPool[m_numUsedDabs] = dab;
+        }
+    } else {
+        dab = new KisFixedPaintDevice(cs);
+        m_dabsPool.append(dab);
+    }
+
+    m_numUsedDabs++;
+    return dab;
+}
+
+void KisSprayParticleBatch::addDab(KisFixedPaintDeviceSP dab, const QPoint &offset, quint8 opacity)
+{
+    KisRenderedDab renderedDab(dab);
+    renderedDab.offset = offset;
+    renderedDab.opacity = qreal(opacity) / OPACITY_OPAQUE_U8;
+
+    const QRect rc = renderedDab.realBounds();
+    if (rc.isEmpty()) return;
+
+    const int firstBinX = binCoordinate(rc.left());
+    const int lastBinX = binCoordinate(rc.right());
+    const int firstBinY = binCoordinate(rc.top());
+    const int lastBinY = binCoordinate(rc.bottom());
+
+    for (int binY = firstBinY; binY <= lastBinY; binY++) {
+        for (int binX = firstBinX; binX <= lastBinX; binX++) {
+            m_dabBins[BinIndex(binY, binX)].append(renderedDab);
+        }
+    }
+}
+
+void KisSprayParticleBatch::addPath(const QPainterPath &path, const KoColor &color, quint8 opacity, bool antialiasing)
+{
+    // Expand the rectangle to allow for anti-aliasing, like KisPainter::fillPainterPath() does
+    const QRect fillRect = path.boundingRect().toAlignedRect().adjusted(-1, -1, 1, 1);
+    if (fillRect.isEmpty()) return;
+
+    if (m_pathMask.width() < fillRect.width() || m_pathMask.height() < fillRect.height()) {
+        m_pathMask = QImage(qMax(m_pathMask.width(), fillRect.width()),
+                            qMax(m_pathMask.height(), fillRect.height()),
+                            QImage::Format_ARGB32_Premultiplied);
+    }
+
+    m_pathMask.fill(QColor(Qt::black).rgb());
+
+    {
+        QPainter gc(&m_pathMask);
+        gc.setRenderHint(QPainter::Antialiasing, antialiasing);
+        gc.translate(-fillRect.topLeft());
+        gc.fillPath(path, QBrush(Qt::white));
+    }
+
+    const KoColorSpace *cs = color.colorSpace();
+    KisFixedPaintDeviceSP dab = createDab(cs);
+    dab->setRect(QRect(QPoint(), fillRect.size()));
+    dab->lazyGrowBufferWithoutInitialization();
+
+    KoColor opaqueColor(color);
+    opaqueColor.setOpacity(OPACITY_OPAQUE_U8);
+    dab->fill(dab->bounds(), opaqueColor);
+
+    const int pixelSize = cs->pixelSize();
+    QVector<quint8> maskRow(fillRect.width());
+    quint8 *dabPtr = dab->data();
+
+    for (int y = 0; y < fillRect.height(); y++) {
+        const QRgb *maskPtr = reinterpret_cast<const QRgb*>(m_pathMask.constScanLine(y));
+
+        for (int x = 0; x < fillRect.width(); x++) {
+            maskRow[x] = qRed(maskPtr[x]);
+        }
+
+        cs->applyAlphaU8Mask(dabPtr, maskRow.constData(), fillRect.width());
+        dabPtr += fillRect.width() * pixelSize;
+    }
+
+    addDab(dab, fillRect.topLeft(), opacity);
+}
+
+void KisSprayParticleBatch::addPixel(int x, int y, const KoColor &color)
+{
+    m_pixelSize = color.colorSpace()->pixelSize();
+
+    PixelParticle pixel;
+    pixel.x = x;
+    pixel.y = y;
+    pixel.colorOffset = m_pixelColors.size();
+    m_pixels.append(pixel);
+
+    m_pixelColors.resize(pixel.colorOffset + m_pixelSize);
+    memcpy(m_pixelColors.data() + pixel.colorOffset, color.data(), m_pixelSize);
+}
+
+void KisSprayParticleBatch::flush(KisPainter *painter)
+{
+    if (!m_pixels.isEmpty()) {
+        KisPaintDeviceSP device = painter->device();
+        KIS_SAFE_ASSERT_RECOVER_NOOP(device->pixelSize() == m_pixelSize);
+
+        // stable sort keeps the order of the pixels painted over each other
+        std::stable_sort(m_pixels.begin(), m_pixels.end(),
+                         [] (const PixelParticle &lhs, const PixelParticle &rhs) {
+                             return BinIndex(binCoordinate(lhs.y), binCoordinate(lhs.x)) <
+                                    BinIndex(binCoordinate(rhs.y), binCoordinate(rhs.x));
+                         });
+
+        KisRandomAccessorSP it = device->createRandomAccessorNG(m_pixels.first().x, m_pixels.first().y);
+        const quint8 *colors = m_pixelColors.constData();
+
+        Q_FOREACH (const PixelParticle &pixel, m_pixels) {
+            it->moveTo(pixel.x, pixel.y);
+            memcpy(it->rawData(), colors + pixel.colorOffset, m_pixelSize);
+        }
+
+        m_pixels.clear();
+        m_pixelColors.clear();
+    }
+
+    for (auto it = m_dabBins.constBegin(); it != m_dabBins.constEnd(); ++it) {
+        const QRect binRect(it.key().second * BIN_SIZE, it.key().first * BIN_SIZE,
+                            BIN_SIZE, BIN_SIZE);
+        painter->bltFixed(binRect, it.value());
+    }
+
+    m_dabBins.clear();
+    m_numUsedDabs = 0;
+}
+
+bool KisSprayParticleBatch::isEmpty() const
+{
+    return m_pixels.isEmpty() && m_dabBins.isEmpty();
+}
@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2020 Krita Developers <kimageshop@kde.org>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef KISSPRAYPARTICLEBATCH_H
+#define KISSPRAYPARTICLEBATCH_H
+
+#include <QMap>
+#include <utility>
+#include <QList>
+#include <QVector>
+#include <QPainterPath>
+#include <QImage>
+
+#include <kis_types.h>
+#include <KisRenderedDab.h>
+
+class KoColor;
+class KoColorSpace;
+class KisPainter;
+
+/**
+ * Collects all the particles of a single spray dab and renders them
+ * in a batch.
+ *
+ * Painting every particle with a separate KisPainter call means a
+ * separate allocation, readBytes()/writeBytes() round-trip and a set of
+ * tile locks for every tiny particle. Instead, the particles are
+ * accumulated into small fixed devices and binned by the tile of the
+ * destination device they cover. On flush() every bin is composited in
+ * one pass with KisPainter::bltFixed(). The particles inside a bin keep
+ * their order, so the overlapping particles are composited exactly in
+ * the order they were sprayed.
+ *
+ * Single-pixel particles are not composited at all, they overwrite the
+ * destination pixels, so they are written directly into the device,
+ * also sorted by tiles.
+ */
+class KisSprayParticleBatch
+{
+public:
+    KisSprayParticleBatch();
+    ~KisSprayParticleBatch();
+
+    /**
+     * Returns a fixed device for rendering a particle. The devices are
+     * recycled after every flush(), so don't keep the pointer.
+     */
+    KisFixedPaintDeviceSP createDab(const KoColorSpace *cs);
+
+    /// composite \p dab at \p offset with \p opacity
+    void addDab(KisFixedPaintDeviceSP dab, const QPoint &offset, quint8 opacity);
+
+    /// fill \p path with \p color and composite it with \p opacity
+    void addPath(const QPainterPath &path, const KoColor &color, quint8 opacity, bool antialiasing);
+
+    /// overwrite the pixel at (\p x, \p y) with \p color
+    void addPixel(int x, int y, const KoColor &color);
+
+    /// render all the collected particles with \p painter
+    void flush(KisPainter *painter);
+
+    bool isEmpty() const;
+
+private:
+    struct PixelParticle {
+        int x;
+        int y;
+        int colorOffset;
+    };
+
+    // (row, column) of the bin, sorted in the scanline order
+    typedef std::pair<int, int> BinIndex;
+
+private:
+    QMap<BinIndex, QList<KisRenderedDab>> m_dabBins;
+    QVector<PixelParticle> m_pixels;
+    QVector<quint8> m_pixelColors;
+    int m_pixelSize = 0;
+
+    QVector<KisFixedPaintDeviceSP> m_dabsPool;
+    int m_numUsedDabs = 0;
+
+    QImage m_pathMask;
+};
+
+#endif // KISSPRAYPARTICLEBATCH_H
@@ -39,6 +39,20 @@
 #include <kis_color_option.h>
 #include <kis_lod_transform.h>
 #include <kis_paintop_plugin_utils.h>
+#include <brushengine/kis_random_source.h>
+#include <KisRenderedDab.h>
+#include <KisAsyncDabPipeline.h>
+#include <KisAsyncDabUpdater.h>
+
+/**
+ * Per-thread resources for rendering the spray dabs asynchronously
+ */
+struct KisSprayPaintOp::SprayResources
+{
+    KisPaintDeviceSP dab;
+    KisBrushSP brush;
+    SprayBrush sprayBrush;
+};
 
 
 KisSprayPaintOp::KisSprayPaintOp(const KisPaintOpSettingsSP settings, KisPainter *painter, KisNodeSP node, KisImageSP image)
@@ -91,18 +105,130 @@ KisSprayPaintOp::KisSprayPaintOp(const KisPaintOpSettingsSP settings, KisPainter
         m_ySpacing = m_xSpacing = 1.0;
     }
     m_spacing = m_xSpacing;
+
+    /**
+     * Pipe brushes change their state with every painted dab, so
+     * the dabs cannot be rendered in parallel. Sampling of the input
+     * color reads the node's device, which the asynchronous updates
+     * write into at the same time, so it also needs the synchronous
+     * path.
+     */
+    KisBrushSP brush = m_brushOption.brush();
+    const bool brushHasState =
+        !m_shapeProperties.enabled && brush &&
+        (brush->brushType() == PIPE_IMAGE || brush->brushType() == PIPE_MASK);
+
+    if (m_isPresetValid && !brushHasState && !m_colorProperties.sampleInputColor) {
+        m_resourcesPool.reset(
+            new KisAsyncDabResourcesPool<SprayResources>(
+                [this] () { return createSprayResources(); }));
+
+        m_dabPipeline.reset(new KisAsyncDabPipeline(painter->runnableStrokeJobsInterface()));
+        m_dabUpdater.reset(new KisAsyncDabUpdater(m_dabPipeline.data()));
+    }
 }
 
 KisSprayPaintOp::~KisSprayPaintOp()
 {
 }
 
+KisSprayPaintOp::SprayResources* KisSprayPaintOp::createSprayResources()
+{
+    SprayResources *resources = new SprayResources();
+
+    resources->dab = source()->createCompositionSourceDevice();
+
+    if (m_brushOption.brush()) {
+        resources->brush = m_brushOption.brush()->clone();
+        resources->brush->setThreadingAllowed(false);
+    }
+
+    resources->sprayBrush.setProperties(&m_properties, &m_colorProperties,
+                                        &m_shapeProperties, &m_shapeDynamicsProperties,
+                                        resources->brush);
+    resources->sprayBrush.setFixedDab(new KisFixedPaintDevice(painter()->device()->colorSpace()));
+
+    return resources;
+}
+
+std::pair<int, bool> KisSprayPaintOp::doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs)
+{
+    if (!m_dabUpdater) {
+        return KisPaintOp::doAsyncronousUpdate(jobs);
+    }
+
+    return m_dabUpdater->doAsyncronousUpdate(painter(), jobs);
+}
+
 KisSpacingInformation KisSprayPaintOp::paintAt(const KisPaintInformation& info)
 {
     if (!painter() || !m_isPresetValid) {
         return KisSpacingInformation(m_spacing);
     }
 
+    if (m_dabPipeline) {
+        const qreal rotation = m_rotationOption.apply(info);
+        const quint8 origOpacity = m_opacityOption.apply(painter(), info);
+        const qreal scale = m_sizeOption.apply(info);
+        const qreal lodScale = KisLodTransform::lodToScale(painter()->device());
+
+        const qreal opacity = qreal(painter()->opacity()) / 255.0;
+        const qreal flow = qreal(painter()->flow()) / 255.0;
+        painter()->setOpacity(origOpacity);
+
+        /**
+         * The shared random source cannot be used from several threads,
+         * so every dab gets its own one seeded from the shared source. It
+         * keeps the stroke reproducible.
+         */
+        KisPaintInformation dabInfo(info);
+        dabInfo.setRandomSource(new KisRandomSource(int(info.randomSource()->generate())));
+
+        KisPaintDeviceSP colorSource = m_node->paintDevice();
+        const KoColor paintColor = painter()->paintColor();
+        const KoColor bgColor = painter()->backgroundColor();
+        KisAsyncDabResourcesPool<SprayResources> *pool = m_resourcesPool.data();
+
+        m_dabPipeline->addDab(
+            [pool, dabInfo, colorSource, rotation, scale, lodScale,
+             paintColor, bgColor, opacity, flow] () {
+
+                SprayResources *resources = pool->fetch();
+                resources->dab->clear();
+
+                resources->sprayBrush.paint(resources->dab,
+                                            colorSource,
+                                            dabInfo,
+                                            rotation,
+                                            scale, lodScale,
+                                            paintColor,
+                                            bgColor);
+
+                KisRenderedDab renderedDab;
+
+                const QRect rc = resources->dab->extent();
+                if (!rc.isEmpty()) {
+                    KisFixedPaintDeviceSP device = new KisFixedPaintDevice(resources->dab->colorSpace());
+                    device->setRect(rc);
+                    device->lazyGrowBufferWithoutInitialization();
+                    resources->dab->readBytes(device->data(), rc);
+
+                    renderedDab = KisRenderedDab(device);
+                    renderedDab.opacity = opacity;
+                    renderedDab.flow = flow;
+                }
+
+                pool->put(resources);
+
+                return renderedDab;
+            });
+
+        const KisSpacingInformation spacingInfo = computeSpacing(info, lodScale);
+        m_dabUpdater->addSpacingSample(spacingInfo.scalarApprox());
+
+        return spacingInfo;
+    }
+
     if (!m_dab) {
         m_dab = source()->createCompositionSourceDevice();
     }
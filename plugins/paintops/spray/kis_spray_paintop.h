@@ -32,7 +32,9 @@
 #include <kis_pressure_rate_option.h>
 
 class KisPainter;
-
+class KisAsyncDabPipeline;
+class KisAsyncDabUpdater;
+template <class T> class KisAsyncDabResourcesPool;
 
 class KisSprayPaintOp : public KisPaintOp
 {
@@ -42,6 +44,8 @@ public:
     KisSprayPaintOp(const KisPaintOpSettingsSP settings, KisPainter * painter, KisNodeSP node, KisImageSP image);
     ~KisSprayPaintOp() override;
 
+    std::pair<int, bool> doAsyncronousUpdate(QVector<KisRunnableStrokeJobData *> &jobs) override;
+
 protected:
 
     KisSpacingInformation paintAt(const KisPaintInformation& info) override;
@@ -53,6 +57,9 @@ protected:
 private:
     KisSpacingInformation computeSpacing(const KisPaintInformation &info, qreal lodScale) const;
 
+    struct SprayResources;
+    SprayResources* createSprayResources();
+
 private:
     KisShapeProperties m_shapeProperties;
     KisSprayOptionProperties m_properties;
@@ -70,6 +77,10 @@ private:
     KisPressureOpacityOption m_opacityOption;
     KisPressureRateOption m_rateOption;
     KisNodeSP m_node;
+
+    QScopedPointer<KisAsyncDabResourcesPool<SprayResources>> m_resourcesPool;
+    QScopedPointer<KisAsyncDabPipeline> m_dabPipeline;
+    QScopedPointer<KisAsyncDabUpdater> m_dabUpdater;
 };
 
 #endif // KIS_SPRAY_PAINTOP_H_
@@ -65,6 +65,13 @@ bool KisSprayPaintOpSettings::paintIncremental()
     return (enumPaintActionType)getInt("PaintOpAction", WASH) == BUILDUP;
 }
 
+bool KisSprayPaintOpSettings::needsAsynchronousUpdates() const
+{
+    // the paintop still paints synchronously with pipe brushes,
+    // which is handled by the freehand stroke as well
+    return true;
+}
+
 
 QPainterPath KisSprayPaintOpSettings::brushOutline(const KisPaintInformation &info, const OutlineMode &mode)
 {
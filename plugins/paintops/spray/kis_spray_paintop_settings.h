@@ -44,6 +44,7 @@ public:
     }
 
     bool paintIncremental() override;
+    bool needsAsynchronousUpdates() const override;
 
 protected:
 
@@ -118,7 +118,6 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
         m_painter = new KisPainter(dab);
         m_painter->setFillStyle(KisPainter::FillStyleForegroundColor);
         m_painter->setMaskImageSize(m_shapeProperties->width, m_shapeProperties->height);
-        m_dabPixelSize = dab->colorSpace()->pixelSize();
         if (m_colorProperties->useRandomHSV) {
             m_transfo = dab->colorSpace()->createColorTransformation("hsv_adjustment", QHash<QString, QVariant>());
         }
@@ -127,13 +126,11 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
         if (!m_brushQImage.isNull()) {
             m_brushQImage = m_brushQImage.scaled(m_shapeProperties->width, m_shapeProperties->height);
         }
-        m_imageDevice = new KisPaintDevice(dab->colorSpace());
     }
 
 
     qreal x = info.pos().x();
     qreal y = info.pos().y();
-    KisRandomAccessorSP accessor = dab->createRandomAccessorNG(qRound(x), qRound(y));
 
     Q_ASSERT(color.colorSpace()->pixelSize() == dab->pixelSize());
     m_inkColor = color;
@@ -170,7 +167,7 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
     bool shouldColor = true;
     if (m_colorProperties->fillBackground) {
         m_painter->setPaintColor(bgColor);
-        paintCircle(m_painter, x, y, m_radius);
+        m_painter->fillPainterPath(circlePath(x, y, m_radius));
     }
 
     QTransform m;
@@ -276,30 +273,29 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             case 0:
             {
                 if (m_shapeProperties->width == m_shapeProperties->height){
-                    paintCircle(m_painter, nx + x, ny + y, jitteredWidth * 0.5);
+                    addShapeParticle(circlePath(nx + x, ny + y, jitteredWidth * 0.5));
                 }
                 else {
-                    paintEllipse(m_painter, nx + x, ny + y, jitteredWidth * 0.5 , jitteredHeight * 0.5, rotationZ);
+                    addShapeParticle(ellipsePath(nx + x, ny + y, jitteredWidth * 0.5 , jitteredHeight * 0.5, rotationZ));
                 }
                 break;
             }
             // rectangle
             case 1:
             {
-                paintRectangle(m_painter, nx + x, ny + y, qRound(jitteredWidth) , qRound(jitteredHeight), rotationZ);
+                addShapeParticle(rectanglePath(nx + x, ny + y, qRound(jitteredWidth) , qRound(jitteredHeight), rotationZ));
                 break;
             }
             // wu-particle
             case 2: {
-                paintParticle(accessor, m_inkColor, nx + x, ny + y);
+                paintParticle(m_inkColor, nx + x, ny + y);
                 break;
             }
             // pixel
             case 3: {
                 ix = qRound(nx + x);
                 iy = qRound(ny + y);
-                accessor->moveTo(ix, iy);
-                memcpy(accessor->rawData(), m_inkColor.data(), m_dabPixelSize);
+                m_particleBatch.addPixel(ix, iy, m_inkColor);
                 break;
             }
             case 4: {
@@ -313,24 +309,18 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
                         m.scale(particleScale, particleScale);
                     }
                     m_transformed = m_brushQImage.transformed(m, Qt::SmoothTransformation);
-                    m_imageDevice->convertFromQImage(m_transformed, 0);
-                    KisRandomAccessorSP ac = m_imageDevice->createRandomAccessorNG(0, 0);
+
+                    KisFixedPaintDeviceSP imageDab = m_particleBatch.createDab(dab->colorSpace());
+                    imageDab->convertFromQImage(m_transformed, "");
                     QRect rc = m_transformed.rect();
 
                     if (m_colorProperties->useRandomHSV && m_transfo) {
-
-                        for (int y = rc.y(); y < rc.y() + rc.height(); y++) {
-                            for (int x = rc.x(); x < rc.x() + rc.width(); x++) {
-                                ac->moveTo(x, y);
-                                m_transfo->transform(ac->rawData(), ac->rawData() , 1);
-                            }
-                        }
+                        m_transfo->transform(imageDab->data(), imageDab->data(), rc.width() * rc.height());
                     }
 
                     ix = qRound(nx + x - rc.width() * 0.5);
                     iy = qRound(ny + y - rc.height() * 0.5);
-                    m_painter->bitBlt(QPoint(ix, iy), m_imageDevice, rc);
-                    m_imageDevice->clear();
+                    m_particleBatch.addDab(imageDab, QPoint(ix, iy), m_painter->opacity());
                     break;
                 }
             }
@@ -351,36 +341,40 @@ void SprayBrush::paint(KisPaintDeviceSP dab, KisPaintDeviceSP source,
             KisPaintOp::splitCoordinate(pt.x(), &ix, &xFraction);
             KisPaintOp::splitCoordinate(pt.y(), &iy, &yFraction);
 
-            //KisFixedPaintDeviceSP dab;
+            KisFixedPaintDeviceSP particleDab;
             if (m_brush->brushType() == IMAGE ||
                     m_brush->brushType() == PIPE_IMAGE) {
-                m_fixedDab = m_brush->paintDevice(m_fixedDab->colorSpace(),
+                particleDab = m_brush->paintDevice(m_fixedDab->colorSpace(),
                           shape, info, xFraction, yFraction);
 
                 if (m_colorProperties->useRandomHSV && m_transfo) {
-                    quint8 * dabPointer = m_fixedDab->data();
-                    int pixelCount = m_fixedDab->bounds().width() * m_fixedDab->bounds().height();
+                    quint8 * dabPointer = particleDab->data();
+                    int pixelCount = particleDab->bounds().width() * particleDab->bounds().height();
                     m_transfo->transform(dabPointer, dabPointer, pixelCount);
                 }
 
             }
             else {
-                m_brush->mask(m_fixedDab, m_inkColor, shape,
+                particleDab = m_particleBatch.createDab(m_fixedDab->colorSpace());
+                m_brush->mask(particleDab, m_inkColor, shape,
                               info, xFraction, yFraction);
             }
-            m_painter->bltFixed(QPoint(ix, iy), m_fixedDab, m_fixedDab->bounds());
+            m_particleBatch.addDab(particleDab, QPoint(ix, iy), m_painter->opacity());
         }
         if (m_colorProperties->colorPerParticle){
             m_inkColor=color;//reset color//
         }
     }
+
+    m_particleBatch.flush(m_painter);
+
     // recover from jittering of color,
     // m_inkColor.opacity is recovered with every paint
 }
 
 
 
-void SprayBrush::paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry)
+void SprayBrush::paintParticle(const KoColor &color, qreal rx, qreal ry)
 {
     // opacity top left, right, bottom left, right
     KoColor pcolor(color);
@@ -401,50 +395,50 @@ void SprayBrush::paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor
     // Maybe some kind of compositing using here would be cool
 
     pcolor.setOpacity(btl);
-    writeAccessor->moveTo(ipx  , ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    m_particleBatch.addPixel(ipx, ipy, pcolor);
 
     pcolor.setOpacity(btr);
-    writeAccessor->moveTo(ipx + 1, ipy);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    m_particleBatch.addPixel(ipx + 1, ipy, pcolor);
 
     pcolor.setOpacity(bbl);
-    writeAccessor->moveTo(ipx, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    m_particleBatch.addPixel(ipx, ipy + 1, pcolor);
 
     pcolor.setOpacity(bbr);
-    writeAccessor->moveTo(ipx + 1, ipy + 1);
-    memcpy(writeAccessor->rawData(), pcolor.data(), m_dabPixelSize);
+    m_particleBatch.addPixel(ipx + 1, ipy + 1, pcolor);
 }
 
-void SprayBrush::paintCircle(KisPainter* painter, qreal x, qreal y, qreal radius)
+QPainterPath SprayBrush::circlePath(qreal x, qreal y, qreal radius)
 {
     QPainterPath path;
     path.addEllipse(QPointF(x,y),radius,radius);
-    painter->fillPainterPath(path);
+    return path;
 }
 
 
-void SprayBrush::paintEllipse(KisPainter* painter, qreal x, qreal y, qreal a, qreal b, qreal angle)
+QPainterPath SprayBrush::ellipsePath(qreal x, qreal y, qreal a, qreal b, qreal angle)
 {
     QPainterPath path;
     path.addEllipse(QPointF(), a, b);
     QTransform t;
     t.translate(x, y);
     t.rotateRadians(angle);
-    path = t.map(path);
-    painter->fillPainterPath(path);
+    return t.map(path);
 }
 
-void SprayBrush::paintRectangle(KisPainter* painter, qreal x, qreal y, qreal width, qreal height, qreal angle)
+QPainterPath SprayBrush::rectanglePath(qreal x, qreal y, qreal width, qreal height, qreal angle)
 {
     QPainterPath path;
     path.addRect(QRectF(-0.5 * width, -0.5 * height, width, height));
     QTransform t;
     t.translate(x, y);
     t.rotateRadians(angle);
-    path = t.map(path);
-    painter->fillPainterPath(path);
+    return t.map(path);
+}
+
+void SprayBrush::addShapeParticle(const QPainterPath &path)
+{
+    m_particleBatch.addPath(path, m_painter->paintColor(), m_painter->opacity(),
+                            m_painter->antiAliasPolygonFill());
 }
 
 
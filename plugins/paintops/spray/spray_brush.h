@@ -34,6 +34,8 @@
 #include <QImage>
 #include <kis_brush.h>
 
+#include "KisSprayParticleBatch.h"
+
 class KisPaintInformation;
 
 class SprayBrush
@@ -56,10 +58,9 @@ private:
     KoColor m_inkColor;
     qreal m_radius;
     quint32 m_particlesCount;
-    quint8 m_dabPixelSize;
 
     KisPainter * m_painter;
-    KisPaintDeviceSP m_imageDevice;
+    KisSprayParticleBatch m_particleBatch;
     QImage m_brushQImage;
     QImage m_transformed;
 
@@ -77,10 +78,12 @@ private:
     /// rotation in radians according the settings (gauss distribution, uniform distribution or fixed angle)
     qreal rotationAngle(KisRandomSourceSP randomSource);
     /// Paints Wu Particle
-    void paintParticle(KisRandomAccessorSP &writeAccessor, const KoColor &color, qreal rx, qreal ry);
-    void paintCircle(KisPainter * painter, qreal x, qreal y, qreal radius);
-    void paintEllipse(KisPainter * painter, qreal x, qreal y, qreal a, qreal b, qreal angle);
-    void paintRectangle(KisPainter * painter, qreal x, qreal y, qreal width, qreal height, qreal angle);
+    void paintParticle(const KoColor &color, qreal rx, qreal ry);
+    QPainterPath circlePath(qreal x, qreal y, qreal radius);
+    QPainterPath ellipsePath(qreal x, qreal y, qreal a, qreal b, qreal angle);
+    QPainterPath rectanglePath(qreal x, qreal y, qreal width, qreal height, qreal angle);
+    /// adds a particle of shape \p path to the batch using the current color and opacity of the painter
+    void addShapeParticle(const QPainterPath &path);
 
     void paintOutline(KisPaintDeviceSP dev, const KoColor& painterColor, qreal posX, qreal posY, qreal radius);
 